@@ -0,0 +1,144 @@
+#include "alloc_stats.h"
+#include <errno.h>
+#include <openssl/crypto.h>
+#include <stddef.h>
+#include <string.h>
+
+// The allocator of glibc, which supports replacing malloc() by defining it in
+// the executable. Allocations of glibc itself and of the shared libraries go
+// through the replacements as well.
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+// Plain thread local counters, so that counting does not allocate and does
+// not need atomics. Benchmarks running on several threads take a delta on
+// every thread.
+static __thread struct alloc_stats thread_stats;
+
+static inline void count_alloc(const void *ptr, size_t size)
+{
+	if (ptr == NULL)
+		return;
+	thread_stats.allocs++;
+	thread_stats.bytes += size;
+}
+
+static inline void count_free(const void *ptr)
+{
+	if (ptr != NULL)
+		thread_stats.frees++;
+}
+
+void *malloc(size_t size)
+{
+	void *ptr = __libc_malloc(size);
+	count_alloc(ptr, size);
+	return ptr;
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	void *ptr = __libc_calloc(nmemb, size);
+	count_alloc(ptr, nmemb * size);
+	return ptr;
+}
+
+// Moving a block counts as a new allocation and a free, so that realloc()
+// loops show up like the copies they are
+void *realloc(void *ptr, size_t size)
+{
+	void *new_ptr = __libc_realloc(ptr, size);
+	if (ptr == NULL || new_ptr != ptr) {
+		count_alloc(new_ptr, size);
+		if (new_ptr != NULL || size == 0)
+			count_free(ptr);
+	}
+	return new_ptr;
+}
+
+void free(void *ptr)
+{
+	count_free(ptr);
+	__libc_free(ptr);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+	void *ptr = __libc_memalign(alignment, size);
+	count_alloc(ptr, size);
+	return ptr;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+	return memalign(alignment, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+	if (alignment % sizeof(void *) != 0 ||
+	    (alignment & (alignment - 1)) != 0)
+		return EINVAL;
+	void *ptr = memalign(alignment, size);
+	if (ptr == NULL)
+		return ENOMEM;
+	*memptr = ptr;
+	return 0;
+}
+
+static void *openssl_malloc(size_t num, const char *file, int line)
+{
+	(void)file;
+	(void)line;
+	void *ptr = malloc(num);
+	if (ptr != NULL) {
+		thread_stats.openssl_allocs++;
+		thread_stats.openssl_bytes += num;
+	}
+	return ptr;
+}
+
+static void *openssl_realloc(void *addr, size_t num, const char *file,
+			     int line)
+{
+	(void)file;
+	(void)line;
+	void *ptr = realloc(addr, num);
+	if (ptr != NULL && ptr != addr) {
+		thread_stats.openssl_allocs++;
+		thread_stats.openssl_bytes += num;
+	}
+	return ptr;
+}
+
+static void openssl_free(void *addr, const char *file, int line)
+{
+	(void)file;
+	(void)line;
+	free(addr);
+}
+
+int alloc_stats_install(void)
+{
+	return CRYPTO_set_mem_functions(openssl_malloc, openssl_realloc,
+					openssl_free);
+}
+
+void alloc_stats_get(struct alloc_stats *stats)
+{
+	*stats = thread_stats;
+}
+
+void alloc_stats_since(const struct alloc_stats *start,
+		       struct alloc_stats *delta)
+{
+	delta->allocs = thread_stats.allocs - start->allocs;
+	delta->bytes = thread_stats.bytes - start->bytes;
+	delta->frees = thread_stats.frees - start->frees;
+	delta->openssl_allocs =
+	    thread_stats.openssl_allocs - start->openssl_allocs;
+	delta->openssl_bytes = thread_stats.openssl_bytes - start->openssl_bytes;
+}
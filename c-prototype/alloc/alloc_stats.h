@@ -0,0 +1,66 @@
+#include <stdint.h>
+
+#pragma once
+
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Allocation accounting for the tests and benchmarks. Linking this library
+// replaces malloc() and friends of the whole binary with versions that count
+// per thread, and alloc_stats_install() hooks the allocator of OpenSSL on
+// top, so that the BIGNUM and EC_POINT churn can be told apart from the
+// arrays of the C code. Never link it into anything but tests and benchmarks.
+
+	struct alloc_stats {
+		// Calls to malloc(), calloc(), realloc() and the aligned
+		// allocators, and the number of bytes requested by them
+		uint64_t allocs;
+		uint64_t bytes;
+		// Objects freed, live is allocs - frees of a delta
+		uint64_t frees;
+		// Part of allocs and bytes that went through OpenSSL
+		uint64_t openssl_allocs;
+		uint64_t openssl_bytes;
+	};
+
+	// Hooks the allocations of OpenSSL, which has to happen before
+	// OpenSSL allocates anything. Returns 1 on success and 0 otherwise,
+	// allocations are still counted in the latter case but not split.
+	int alloc_stats_install(void);
+
+	// Counters of the calling thread since it started
+	void alloc_stats_get(struct alloc_stats *stats);
+
+	// Counters of the calling thread since start was taken
+	void alloc_stats_since(const struct alloc_stats *start,
+			       struct alloc_stats *delta);
+
+	// Objects allocated but not freed in a delta
+	static inline int64_t alloc_stats_live(const struct alloc_stats *delta)
+	{
+		return (int64_t) (delta->allocs - delta->frees);
+	}
+
+#ifdef __cplusplus
+}
+
+// Counters of the calling thread from construction to delta()
+class alloc_scope {
+public:
+	alloc_scope() { alloc_stats_get(&start_); }
+
+	struct alloc_stats delta() const {
+		struct alloc_stats delta;
+		alloc_stats_since(&start_, &delta);
+		return delta;
+	}
+
+private:
+	struct alloc_stats start_;
+};
+#endif
+#endif				// ALLOC_STATS_H
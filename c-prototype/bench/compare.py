@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+# Compares a JSON run of MultiPassWPA3_bench against the committed baseline:
+#
+#   ./MultiPassWPA3_bench --benchmark_repetitions=3 --benchmark_out=run.json \
+#       --benchmark_out_format=json
+#   ./compare.py baseline.json run.json
+#
+# The baseline keeps only what is compared, the fastest repetition of each
+# benchmark, written by
+#
+#   ./compare.py --reduce run.json baseline.json
+#
+# Times are divided by the BM_reference time of the same run, which does
+# fixed OpenSSL work outside of the code under test, so that a baseline
+# recorded on one machine can be checked on another. --absolute compares the
+# plain times instead.
+#
+# Exits with 1 when a benchmark got slower, or allocates more, than the
+# tolerance allows, or when it leaks. Exits with 2 when the runs come from
+# different build types. Benchmarks missing from either file are only listed.
+import argparse, json, sys
+
+UNITS = { "ns": 1, "us": 1e3, "ms": 1e6, "s": 1e9 }
+REFERENCE = "BM_reference"
+
+def load(filename):
+	with open(filename) as fp:
+		report = json.load(fp)
+
+	results = {}
+	order = {}
+	for bench in report["benchmarks"]:
+		# With --benchmark_repetitions the fastest repetition is compared,
+		# other processes and frequency changes only ever slow a run down.
+		# A reduced baseline stores it as the "min" aggregate.
+		if bench.get("run_type") == "aggregate" and bench.get("aggregate_name") != "min":
+			continue
+		name = bench.get("run_name", bench["name"])
+		# Threaded variants are measured in wall clock time, see UseRealTime
+		key = "real_time" if "/real_time" in name else "cpu_time"
+		time = bench[key] * UNITS[bench["time_unit"]]
+		live = bench.get("live", 0)
+		if name in results:
+			live = max(live, results[name][2])
+			if results[name][0] <= time:
+				results[name] = (results[name][0], results[name][1], live)
+				continue
+		results[name] = (time, bench.get("allocs"), live)
+		order[name] = (bench.get("family_index", 0), bench.get("per_family_instance_index", 0))
+	# --benchmark_enable_random_interleaving shuffles the runs
+	results = { name: results[name] for name in sorted(results, key=lambda name: order[name]) }
+	return report["context"].get("decoyauth_build_type", "unknown"), results
+
+def reduce(run, out):
+	with open(run) as fp:
+		report = json.load(fp)
+
+	# Variants with more threads than the machine has cores measure time
+	# slicing, they are no reference for another machine
+	cpus = report["context"].get("num_cpus", 1)
+	fastest = {}
+	live = {}
+	for bench in report["benchmarks"]:
+		if bench.get("run_type") == "aggregate" or bench.get("threads", 1) > cpus:
+			continue
+		name = bench.get("run_name", bench["name"])
+		key = "real_time" if "/real_time" in name else "cpu_time"
+		time = bench[key] * UNITS[bench["time_unit"]]
+		live[name] = max(live.get(name, 0), bench.get("live", 0))
+		if name not in fastest or time < fastest[name][0]:
+			fastest[name] = (time, bench)
+
+	benchmarks = []
+	for name, (_, bench) in fastest.items():
+		bench = dict(bench, name=name + "_min", run_type="aggregate",
+			aggregate_name="min", live=live[name])
+		bench.pop("repetition_index", None)
+		benchmarks.append(bench)
+	benchmarks.sort(key=lambda bench: (bench.get("family_index", 0), bench.get("per_family_instance_index", 0)))
+
+	with open(out, "w") as fp:
+		json.dump({ "context": report["context"], "benchmarks": benchmarks }, fp, indent=2)
+		fp.write("\n")
+	print(f"{len(benchmarks)} benchmarks written to {out}")
+	return 0
+
+def main():
+	parser = argparse.ArgumentParser(description="Check a benchmark run against a baseline")
+	parser.add_argument("--reduce", action="store_true",
+		help="write the fastest repetitions of the first file as baseline to the second")
+	parser.add_argument("baseline")
+	parser.add_argument("run")
+	parser.add_argument("--tolerance", type=float, default=0.15,
+		help="allowed relative slowdown (default: %(default)s)")
+	parser.add_argument("--absolute", action="store_true",
+		help=f"compare plain times instead of multiples of {REFERENCE}")
+	args = parser.parse_args()
+	if args.reduce:
+		# The positional arguments are the run and the output file here
+		return reduce(args.baseline, args.run)
+
+	base_type, baseline = load(args.baseline)
+	run_type, run = load(args.run)
+	if base_type != run_type:
+		print(f"Baseline is a {base_type} build, the run a {run_type} build", file=sys.stderr)
+		return 2
+
+	# Both runs are scaled to the speed of the machine of the baseline
+	scale = 1
+	if not args.absolute:
+		if REFERENCE not in baseline or REFERENCE not in run:
+			print(f"{REFERENCE} is missing, use --absolute", file=sys.stderr)
+			return 2
+		scale = baseline[REFERENCE][0] / run[REFERENCE][0]
+		print(f"{REFERENCE}: {baseline[REFERENCE][0]:.0f}ns -> {run[REFERENCE][0]:.0f}ns, run times scaled by {scale:.3f}")
+
+	failed = False
+	print(f"{'Benchmark':<44} {'Baseline':>14} {'Run':>14} {'Change':>8}  Allocs")
+	for name, (time, allocs, live) in run.items():
+		if name == REFERENCE and not args.absolute:
+			continue
+		time *= scale
+		if name not in baseline:
+			print(f"{name:<44} {'-':>14} {time:>12.0f}ns {'new':>8}")
+			continue
+
+		base_time, base_allocs, _ = baseline[name]
+		change = time / base_time - 1
+		status = ""
+		if change > args.tolerance:
+			status = "  SLOWER"
+			failed = True
+		if allocs is not None and base_allocs is not None and round(allocs) > round(base_allocs) * (1 + args.tolerance):
+			status += "  MORE ALLOCS"
+			failed = True
+		# Objects still alive after an iteration pile up in a long running
+		# process, whatever the baseline says
+		if round(live) > 0:
+			status += f"  LEAKS {live:.0f}"
+			failed = True
+
+		alloc_info = "" if allocs is None else f"{allocs:.0f}"
+		if base_allocs is not None and allocs is not None and round(allocs) != round(base_allocs):
+			alloc_info = f"{base_allocs:.0f} -> {allocs:.0f}"
+		print(f"{name:<44} {base_time:>12.0f}ns {time:>12.0f}ns {change:>+8.1%}  {alloc_info}{status}")
+
+	for name in baseline:
+		if name not in run:
+			print(f"{name:<44} not measured")
+
+	return 1 if failed else 0
+
+if __name__ == "__main__":
+	sys.exit(main())
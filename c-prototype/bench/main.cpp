@@ -1,274 +1,490 @@
 #include <benchmark/benchmark.h>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unistd.h>
+#include <openssl/crypto.h>
 #include <openssl/ec.h>
 #include <openssl/obj_mac.h>
 #include <openssl/bn.h>
 #include "util.h"
 #include "encode.h"
 #include "weaver.h"
+#include "rng.h"
+#include "decoyauth.hpp"
+#include "alloc_stats.h"
+
+using namespace decoyauth;
+
+// Every benchmark takes the SAE group as its first argument. The data files
+// written by build.sh only exist for group 19, inputs of the other curves
+// are generated in memory.
+struct curve_def {
+    int group;
+    int nid;
+};
+
+static const curve_def curve_defs[] = {
+    { 19, NID_X9_62_prime256v1 },
+    { 20, NID_secp384r1 },
+    { 21, NID_secp521r1 },
+};
+
+// Number of points cycled through by the per-point benchmarks when the data
+// files are absent
+#define GENERATED_POINTS 1000
+
+// DECOYAUTH_BENCH_CPU=<n> pins thread i of a benchmark to CPU n + i, so that
+// single threaded results are not disturbed by migrations
+static void pin_from_env(const benchmark::State& state) {
+    const char* cpu = getenv("DECOYAUTH_BENCH_CPU");
+    if (cpu == NULL)
+        return;
 
-#define A "115792089210356248762697446949407573530086143415290314195533631308867097853948"
-#define B "41058363725152142129326129780047268409114441015993725554835256314039467401291"
-#define P "115792089210356248762697446949407573530086143415290314195533631308867097853951"
-
-void pin_thread_to_cpu(int cpu_id) {
     cpu_set_t cpuset;
     CPU_ZERO(&cpuset);
-    CPU_SET(cpu_id, &cpuset);
-    
+    CPU_SET(atoi(cpu) + state.thread_index(), &cpuset);
+
     int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
-    if (rc != 0) {
+    if (rc != 0)
         std::cerr << "Error calling pthread_setaffinity_np: " << rc << std::endl;
-    }
-    
-    // Verify that thread is pinned (only print in verbose mode or first run)
-    static bool verified = false;
-    if (!verified) {
-        CPU_ZERO(&cpuset);
-        pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
-        
-        for (int i = 0; i < CPU_SETSIZE; i++) {
-            if (CPU_ISSET(i, &cpuset)) {
-                std::cout << "Thread pinned to CPU core " << i << std::endl;
-                verified = true;
-                break;
-            }
-        }
-    }
 }
 
-extern "C" BIGNUM** load_hashes(int num_points) {
-    return read_hashes("hashes.txt", num_points);
+// DECOYAUTH_BENCH_SEED=<n> replays the same random stream in every run, so
+// the number of rejected encoding attempts does not vary between runs
+static void seed_from_env(const benchmark::State& state) {
+    const char* seed = getenv("DECOYAUTH_BENCH_SEED");
+    if (seed != NULL)
+        rng_seed(strtoull(seed, NULL, 10) + state.thread_index());
 }
 
-extern "C" EC_POINT** load_points(int num_points, EC_GROUP* group) {
-    return read_points("points.txt", group, num_points);
+static bool file_exists(const char* filename) {
+    return access(filename, R_OK) == 0;
 }
 
-extern "C" BIGNUM** test_weave(BIGNUM** y_values, BIGNUM** matrix, int num_elements, BIGNUM* prime, BN_CTX* ctx) {
-    return weave(y_values, matrix, num_elements, prime, ctx);
-}
+// Inputs of one curve. They are loaded or generated once, on first use, and
+// only read afterwards by all benchmarks and threads. OpenSSL objects are not
+// documented to be safe for concurrent use even when only read, so every
+// thread runs on its own copy of the curve.
+class curve_data {
+public:
+    static curve_data& get(int group_id) {
+        static std::mutex lock;
+        static std::map<int, std::unique_ptr<curve_data>> curves;
+
+        std::lock_guard<std::mutex> guard(lock);
+        std::unique_ptr<curve_data>& data = curves[group_id];
+        if (!data)
+            data.reset(new curve_data(group_id));
+        return *data;
+    }
 
-extern "C" BIGNUM* test_evaluate(BIGNUM** vals, BIGNUM* x, int num_elements, BIGNUM* prime, BN_CTX* ctx) {
-    return evaluate(vals, x, num_elements, prime, ctx);
-}
+    int group_id;
+    curve params;
+    point_array points;
+    // u and v of point i are at 2 * i and 2 * i + 1
+    bignum_array encoded;
+    bignum_array hashes;
 
-extern "C" BIGNUM** test_precompute(BIGNUM** x_values, int num_elements, const BIGNUM* prime, BN_CTX* ctx) {
-    return precompute(x_values, num_elements, prime, ctx);
-}
+    // The { u, v } pair of point i as taken by es_decode
+    bignum_span encoded_point(size_t i) const {
+        return encoded.view().subspan(2 * i, 2);
+    }
 
-extern "C" BIGNUM*** load_encoded_points(int num_points) {
-    BIGNUM** bns = import_bignums("encoded_points.txt", num_points * 2);
-    BIGNUM*** result = (BIGNUM***) malloc(num_points * sizeof(BIGNUM**));
-    for (int i = 0; i < num_points; i++) {
-        result[i] = (BIGNUM**) malloc(2 * sizeof(BIGNUM*));
-        result[i][0] = bns[2 * i];
-        result[i][1] = bns[2 * i + 1];
+    // u values of the first n encoded points, the y values of the weaver
+    std::vector<BIGNUM*> u_values(int n) const {
+        std::vector<BIGNUM*> y_values;
+        for (int i = 0; i < n; i++)
+            y_values.push_back(encoded_point(i % points.size())[0]);
+        return y_values;
     }
-    free(bns);
-    return result;
-}
+
+    // Matrix of precompute() for the first n hashes
+    const bignum_array& matrix(int n) {
+        std::lock_guard<std::mutex> guard(lock);
+        bignum_array& matrix = matrices[n];
+        if (!matrix)
+            matrix = load_matrix(n);
+        return matrix;
+    }
+
+    // Polynomial of weave() through the first n hashes and encoded points
+    const bignum_array& values(int n) {
+        const bignum_array& m = matrix(n);
+
+        std::lock_guard<std::mutex> guard(lock);
+        bignum_array& vals = polynomials[n];
+        if (!vals)
+            vals = load_values(n, m);
+        return vals;
+    }
+
+private:
+    std::mutex lock;
+    std::map<int, bignum_array> matrices;
+    std::map<int, bignum_array> polynomials;
+
+    static int curve_nid(int group_id) {
+        for (const curve_def& def : curve_defs)
+            if (def.group == group_id)
+                return def.nid;
+        return NID_undef;
+    }
+
+    explicit curve_data(int group_id)
+        : group_id(group_id), params(curve_nid(group_id)) {
+        // The generated inputs do not change between runs
+        rng_seed(group_id);
+        if (group_id == 19 && file_exists("points.bin"))
+            load_points("points.bin", 10000);
+        else if (group_id == 19 && file_exists("points.txt"))
+            load_points("points.txt", 10000);
+        else
+            generate_points(GENERATED_POINTS);
+        if (group_id == 19 && file_exists("encoded_points.bin"))
+            encoded = bignum_array(import_bignums_bin("encoded_points.bin", 2 * points.size()),
+                                   2 * points.size());
+        else if (group_id == 19 && file_exists("encoded_points.txt"))
+            encoded = bignum_array(import_bignums("encoded_points.txt", 2 * points.size()),
+                                   2 * points.size());
+        else
+            generate_encoded();
+        if (group_id == 19 && file_exists("hashes.bin"))
+            hashes = bignum_array(read_hashes("hashes.bin", 10000), 10000);
+        else if (group_id == 19 && file_exists("hashes.txt"))
+            hashes = bignum_array(read_hashes("hashes.txt", 10000), 10000);
+        else
+            generate_hashes(GENERATED_POINTS);
+        rng_set_source(NULL, NULL);
+    }
+
+    // The text and binary fixtures are told apart by read_points and
+    // read_hashes
+    void load_points(const char* filename, int count) {
+        points = point_array(read_points(filename, params.group, count), count);
+    }
+
+    void generate_points(int count) {
+        ctx_guard ctx;
+        bignum k(BN_new());
+        points = point_array(count);
+        for (int i = 0; i < count; i++) {
+            points.set(i, EC_POINT_new(params.group));
+            rng_range(k, EC_GROUP_get0_order(params.group));
+            EC_POINT_mul(params.group, points[i], k, NULL, NULL, ctx);
+        }
+    }
+
+    void generate_encoded() {
+        encoded = bignum_array(2 * points.size());
+        for (size_t i = 0; i < points.size(); i++) {
+            bignum_array pair = es_encode(points[i], params);
+            encoded.set(2 * i, BN_dup(pair[0]));
+            encoded.set(2 * i + 1, BN_dup(pair[1]));
+        }
+    }
+
+    void generate_hashes(int count) {
+        hashes = bignum_array(count);
+        for (int i = 0; i < count; i++) {
+            hashes.set(i, BN_new());
+            rng_range(hashes[i], params.prime);
+        }
+    }
+
+    bignum_array load_matrix(int n) {
+        char filename[256];
+        snprintf(filename, sizeof(filename), "../matrices/matrix_%d.bin", n);
+        if (group_id == 19 && file_exists(filename)) {
+            bignum_array loaded(import_bignums_bin(filename, n * n), n * n);
+            if (loaded)
+                return loaded;
+        }
+        return precompute(hashes.view().subspan(0, n), params.prime, ctx_guard());
+    }
+
+    bignum_array load_values(int n, const bignum_array& m) {
+        char filename[256];
+        snprintf(filename, sizeof(filename), "../values/vals_%d.bin", n);
+        if (group_id == 19 && file_exists(filename)) {
+            bignum_array loaded(import_bignums_bin(filename, n), n);
+            if (loaded)
+                return loaded;
+        }
+
+        std::vector<BIGNUM*> y_values = u_values(n);
+        return weave(y_values, m, params.prime, ctx_guard());
+    }
+};
+
+// Reports the allocations made by the calling thread since the benchmark
+// started, per iteration: allocs and alloc_bytes, openssl_allocs for the
+// part of OpenSSL, and live for the objects that were not freed. Google
+// Benchmark sums counters over the threads of a run, so the thread local
+// counts give the exact numbers per iteration also in the ->Threads()
+// variants.
+class alloc_counter {
+public:
+    void report(benchmark::State& state) {
+        struct alloc_stats delta = scope.delta();
+        state.counters["allocs"] = per_iteration(delta.allocs);
+        state.counters["alloc_bytes"] = per_iteration(delta.bytes);
+        state.counters["openssl_allocs"] = per_iteration(delta.openssl_allocs);
+        state.counters["live"] = per_iteration(alloc_stats_live(&delta));
+    }
+
+private:
+    alloc_scope scope;
+
+    static benchmark::Counter per_iteration(double value) {
+        return benchmark::Counter(value, benchmark::Counter::kAvgIterations);
+    }
+};
 
 static void BM_encoding(benchmark::State &state)
 {
-    pin_thread_to_cpu(3);
-
-    BIGNUM *a = BN_new();
-    BN_dec2bn(&a, A);
-    BIGNUM *b = BN_new();
-    BN_dec2bn(&b, B);
-    BIGNUM *prime = BN_new();
-    BN_dec2bn(&prime, P);
-    EC_GROUP *group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+    pin_from_env(state);
 
-    int num_points = 10000;
-    EC_POINT** points = load_points(num_points, group);
+    curve_data& data = curve_data::get(state.range(0));
+    seed_from_env(state);
+    curve params(data.params.group);
+    size_t num_points = data.points.size();
 
-    int i = 0;
+    alloc_counter allocs;
+    size_t i = state.thread_index();
     for (auto _ : state) {
-        BIGNUM** result = es_encode(points[i++ % num_points], group, a, b, prime);
-        state.PauseTiming();
-        if (result != NULL) {
-            BN_free(result[0]);
-            BN_free(result[1]);
-            free(result);
-        }
-        state.ResumeTiming();
+        bignum_array result = es_encode(data.points[i++ % num_points], params);
+        benchmark::DoNotOptimize(result.data());
     }
+    allocs.report(state);
 
-    BN_free(a);
-    BN_free(b);
-    BN_free(prime);
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * 2 * params.coord_bytes());
+    rng_set_source(NULL, NULL);
+}
 
+static void BM_encoding_batch(benchmark::State &state)
+{
+    pin_from_env(state);
+
+    curve_data& data = curve_data::get(state.range(0));
+    seed_from_env(state);
+    curve params(data.params.group);
+    int num_points = state.range(1);
+    std::vector<EC_POINT*> points;
     for (int i = 0; i < num_points; i++)
-        EC_POINT_free(points[i]);
-    free(points);
+        points.push_back(data.points[i % data.points.size()]);
+    std::vector<BIGNUM*> u_values(num_points);
+    std::vector<BIGNUM*> v_values(num_points);
+
+    alloc_counter allocs;
+    for (auto _ : state) {
+        int ret = es_encode_batch(points.data(), num_points, u_values.data(), v_values.data(),
+                                  params.group, params.a, params.b, params.prime);
+        if (ret == 0) {
+            for (int i = 0; i < num_points; i++) {
+                BN_free(u_values[i]);
+                BN_free(v_values[i]);
+            }
+        }
+    }
+    allocs.report(state);
+
+    state.SetItemsProcessed(state.iterations() * num_points);
+    state.SetBytesProcessed(state.iterations() * num_points * 2 * params.coord_bytes());
+    rng_set_source(NULL, NULL);
 }
 
 static void BM_decoding(benchmark::State &state)
 {
-    pin_thread_to_cpu(3);
-    
-    BIGNUM *a = BN_new();
-    BN_dec2bn(&a, A);
-    BIGNUM *b = BN_new();
-    BN_dec2bn(&b, B);
-    BIGNUM *prime = BN_new();
-    BN_dec2bn(&prime, P);
-    EC_GROUP *group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
-
-    int num_points = 10000;
-    BIGNUM*** points = load_encoded_points(num_points);
-
-    int i = 0;
+    pin_from_env(state);
+
+    curve_data& data = curve_data::get(state.range(0));
+    curve params(data.params.group);
+    size_t num_points = data.points.size();
+
+    alloc_counter allocs;
+    size_t i = state.thread_index();
     for (auto _ : state) {
-        EC_POINT* result = es_decode(points[i++ % num_points], group, a, b, prime);
-        state.PauseTiming();
-        if (result != NULL)
-            EC_POINT_free(result);
-        state.ResumeTiming();
+        ec_point result = es_decode(data.encoded_point(i++ % num_points), params);
+        benchmark::DoNotOptimize(result.get());
     }
+    allocs.report(state);
 
-    BN_free(a);
-    BN_free(b);
-    BN_free(prime);
-    EC_GROUP_free(group);
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * 2 * params.coord_bytes());
+}
+
+static void BM_decoding_bytes(benchmark::State &state)
+{
+    pin_from_env(state);
 
-    for (int i = 0; i < num_points; i++) {
-        BN_free(points[i][0]);
-        BN_free(points[i][1]);
-        free(points[i]);
+    curve_data& data = curve_data::get(state.range(0));
+    curve params(data.params.group);
+    if (params.coord_bytes() != ES_COORD_BYTES) {
+        state.SkipWithError("the byte API only supports group 19");
+        return;
     }
-    free(points);
+    struct es_ctx *ctx = es_ctx_new(params.group, params.a, params.b, params.prime);
+
+    size_t num_points = data.points.size();
+    std::vector<uint8_t> uv(num_points * ES_BYTES);
+    for (size_t i = 0; i < num_points; i++) {
+        bignum_span pair = data.encoded_point(i);
+        BN_bn2binpad(pair[0], &uv[i * ES_BYTES], ES_COORD_BYTES);
+        BN_bn2binpad(pair[1], &uv[i * ES_BYTES + ES_COORD_BYTES], ES_COORD_BYTES);
+    }
+
+    alloc_counter allocs;
+    size_t i = state.thread_index();
+    uint8_t result[ES_BYTES];
+    for (auto _ : state) {
+        es_decode_bytes(&uv[(i++ % num_points) * ES_BYTES], result, ctx);
+        benchmark::DoNotOptimize(result);
+    }
+    allocs.report(state);
+
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * ES_BYTES);
+    es_ctx_free(ctx);
 }
 
 static void BM_precompute(benchmark::State &state)
 {
-    pin_thread_to_cpu(3);
-    
-    int num_points = state.range(0);
-    BIGNUM** hashes = load_hashes(num_points);
+    pin_from_env(state);
 
-    BIGNUM *prime = BN_new();
-    BN_dec2bn(&prime, P);
-    EC_GROUP *group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
-    BN_CTX *ctx = BN_CTX_new();
+    curve_data& data = curve_data::get(state.range(0));
+    curve params(data.params.group);
+    int num_points = state.range(1);
+    bignum_span hashes = data.hashes.view().subspan(0, num_points);
+    ctx_guard ctx;
 
+    alloc_counter allocs;
     for (auto _ : state) {
-        BIGNUM** result = test_precompute(hashes, num_points, prime, ctx);
-        state.PauseTiming();
-        if (result != NULL) {
-            for (int i = 0; i < num_points; i++)
-                BN_free(result[i]);
-            free(result);
-            result = NULL;
-        }
-        state.ResumeTiming();
+        bignum_array result = precompute(hashes, params.prime, ctx);
+        benchmark::DoNotOptimize(result.data());
     }
+    allocs.report(state);
 
-    BN_free(prime);
-    BN_CTX_free(ctx);
-    EC_GROUP_free(group);
-    
-    for (int i = 0; i < num_points; i++)
-        BN_free(hashes[i]);
-    free(hashes);
+    state.SetItemsProcessed(state.iterations() * num_points);
 }
 
 static void BM_weave(benchmark::State &state)
 {
-    pin_thread_to_cpu(3);
-    
-    int num_points = state.range(0);
-    char matrix_filename[256] = {0};
-    sprintf(matrix_filename, "../matrices/matrix_%d.txt", (int) num_points);
-    BIGNUM **matrix = import_bignums(matrix_filename, num_points * num_points);
-
-    BIGNUM *prime = BN_new();
-    BN_dec2bn(&prime, P);
-    EC_GROUP *group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
-    BN_CTX *ctx = BN_CTX_new();
-
-    BIGNUM*** points = load_encoded_points(num_points);
-    BIGNUM** y_values = (BIGNUM**) malloc(num_points * sizeof(BIGNUM*));
-    for (int i = 0; i < num_points; i++) {
-        y_values[i] = points[i][0];
-    }
+    pin_from_env(state);
+
+    curve_data& data = curve_data::get(state.range(0));
+    curve params(data.params.group);
+    int num_points = state.range(1);
+    const bignum_array& matrix = data.matrix(num_points);
+    std::vector<BIGNUM*> y_values = data.u_values(num_points);
+    ctx_guard ctx;
 
+    alloc_counter allocs;
     for (auto _ : state) {
-        BIGNUM** result = test_weave(y_values, matrix, num_points, prime, ctx);
-        state.PauseTiming();
-        if (result != NULL) {
-            for (int i = 0; i < num_points; i++)
-                BN_free(result[i]);
-            free(result);
-            result = NULL;
-        }
-        state.ResumeTiming();
+        bignum_array result = weave(y_values, matrix, params.prime, ctx);
+        benchmark::DoNotOptimize(result.data());
     }
+    allocs.report(state);
 
-    BN_free(prime);
-    BN_CTX_free(ctx);
-    EC_GROUP_free(group);
-    free(y_values);
-    
-    for (int i = 0; i < num_points; i++) {
-        BN_free(points[i][0]);
-        BN_free(points[i][1]);
-        free(points[i]);
-    }
-    free(points);
+    state.SetItemsProcessed(state.iterations() * num_points);
+    state.SetBytesProcessed(state.iterations() * num_points * params.coord_bytes());
 }
 
 static void BM_evaluate(benchmark::State &state)
 {
-    pin_thread_to_cpu(3);
-    
-    int num_points = state.range(0);
-    char vals_filename[256] = {0};
-    sprintf(vals_filename, "../values/vals_%d.txt", (int) num_points);
-    BIGNUM** vals = import_bignums(vals_filename, num_points);
-
-    BIGNUM* prime = BN_new();
-    BN_dec2bn(&prime, P);
-    EC_GROUP* group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
-    BN_CTX* ctx = BN_CTX_new();
-    BIGNUM** pwd = load_hashes(1);
+    pin_from_env(state);
+
+    curve_data& data = curve_data::get(state.range(0));
+    curve params(data.params.group);
+    int num_points = state.range(1);
+    const bignum_array& vals = data.values(num_points);
+    BIGNUM* pwd = data.hashes[0];
+    ctx_guard ctx;
+
+    alloc_counter allocs;
+    for (auto _ : state) {
+        bignum result = evaluate(vals, pwd, params.prime, ctx);
+        benchmark::DoNotOptimize(result.get());
+    }
+    allocs.report(state);
+
+    // One coefficient of the polynomial is consumed per item
+    state.SetItemsProcessed(state.iterations() * num_points);
+}
+
+// Fixed OpenSSL work that does not depend on the code under test. compare.py
+// divides the other results by it, so that a baseline recorded on one machine
+// can be checked on another
+static void BM_reference(benchmark::State &state)
+{
+    pin_from_env(state);
+
+    ctx_guard ctx;
+    BIGNUM* prime = NULL;
+    BIGNUM* base = NULL;
+    BN_hex2bn(&prime, "FFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFF");
+    BN_hex2bn(&base, "6B17D1F2E12C4247F8BCE6E563A440F277037D812DEB33A0F4A13945D898C296");
+    BIGNUM* result = BN_new();
 
     for (auto _ : state) {
-        BIGNUM* result = test_evaluate(vals, *pwd, num_points, prime, ctx);
-        state.PauseTiming();
-        if (result != NULL)
-            BN_free(result);
-        state.ResumeTiming();
+        BN_mod_exp(result, base, prime, prime, ctx);
+        benchmark::DoNotOptimize(result);
     }
 
+    BN_free(result);
+    BN_free(base);
     BN_free(prime);
-    BN_CTX_free(ctx);
-    EC_GROUP_free(group);
-    BN_free(*pwd);
-    free(pwd);
-    
-    for (int i = 0; i < num_points; i++)
-        BN_free(vals[i]);
-    free(vals);
 }
 
-template <class Func>
-void CustomArguments(Func* benchmark) {
-    // Argument here is the number of points: 3, 10, 20, 30, 40, 50, 100, 200, 500, 1000
-    benchmark->Arg(3);
-    benchmark->DenseRange(10, 50, 10);
-    benchmark->Arg(100);
-    benchmark->Arg(200);
-    benchmark->Arg(500);
-    benchmark->Arg(1000);
+static void CurveArguments(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({ "group" });
+    for (const curve_def& def : curve_defs)
+        benchmark->Arg(def.group);
+}
+
+static void CustomArguments(benchmark::internal::Benchmark* benchmark) {
+    // Arguments are the group and the number of points. Group 19 covers
+    // 3, 10, 20, 30, 40, 50, 100, 200, 500 and 1000 points, the larger
+    // curves are only measured at a few sizes to keep the run short.
+    static const int sizes[] = { 3, 10, 20, 30, 40, 50, 100, 200, 500, 1000 };
+    benchmark->ArgNames({ "group", "n" });
+    for (int n : sizes)
+        benchmark->Args({ 19, n });
+    for (int group : { 20, 21 })
+        for (int n : { 3, 10, 50, 100 })
+            benchmark->Args({ group, n });
 }
 
-BENCHMARK(BM_encoding);
-BENCHMARK(BM_decoding);
+BENCHMARK(BM_reference);
+BENCHMARK(BM_encoding)->Apply(CurveArguments);
+BENCHMARK(BM_encoding)->Arg(19)->ArgName("group")->Threads(4)->UseRealTime();
+BENCHMARK(BM_encoding_batch)->Apply(CustomArguments);
+BENCHMARK(BM_decoding)->Apply(CurveArguments);
+BENCHMARK(BM_decoding)->Arg(19)->ArgName("group")->Threads(4)->UseRealTime();
+BENCHMARK(BM_decoding_bytes)->Arg(19)->ArgName("group");
+BENCHMARK(BM_decoding_bytes)->Arg(19)->ArgName("group")->Threads(4)->UseRealTime();
 BENCHMARK(BM_precompute)->Apply(CustomArguments);
 BENCHMARK(BM_weave)->Apply(CustomArguments);
 BENCHMARK(BM_evaluate)->Apply(CustomArguments);
+BENCHMARK(BM_evaluate)->Args({ 19, 100 })->ArgNames({ "group", "n" })->Threads(4)->UseRealTime();
 
-BENCHMARK_MAIN();
+int main(int argc, char** argv)
+{
+    // Has to run before OpenSSL allocates anything
+    if (!alloc_stats_install())
+        std::cerr << "Could not hook OpenSSL allocations, openssl_allocs is 0" << std::endl;
+
+    // compare.py only compares runs of the same build type
+    benchmark::AddCustomContext("decoyauth_build_type", DECOYAUTH_BUILD_TYPE);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -16,16 +16,13 @@ cd tst
 make
 cd ..
 
-# Generate values
-cd src
-for NUM in {2..200}; do
-	echo "Generating vals $NUM/202"
-	./MultiPassWPA3_run $NUM 1 1
-done
-echo "Generating vals 201/202"
-./MultiPassWPA3_run  500 1 1
-echo "Generating vals 202/202"
-./MultiPassWPA3_run 1000 1 1
-
-# Generate matrices
+cd gen
+make
+cd ..
 
+# Generate the matrices and values of all benchmark sizes, and convert the
+# points and hashes into binary fixtures that load faster
+cd gen
+./MultiPassWPA3_gen -o ..
+./MultiPassWPA3_gen -c -o ../bench
+cd ..
@@ -0,0 +1,341 @@
+#include "encode.h"
+#include "weaver.h"
+#include "util.h"
+#include <errno.h>
+#include <openssl/ec.h>
+#include <openssl/obj_mac.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Generates the matrices of precompute() and the polynomials of weave() that
+// the benchmarks use, for many sizes in one process. The points and hashes
+// are parsed and the points encoded once, and the sizes are handed out to a
+// pool of threads, largest first so that the run is not held up by the
+// biggest size starting last.
+
+// Sizes generated when none are given on the command line, these are the
+// ones build.sh used to loop over
+#define DEFAULT_MIN_SIZE 2
+#define DEFAULT_MAX_SIZE 200
+
+struct gen_ctx {
+	const char *outdir;
+	int *sizes;
+	int num_sizes;
+	int next;
+	int failed;
+	pthread_mutex_t lock;
+
+	// Read-only inputs shared by all threads
+	BIGNUM **hashes;
+	BIGNUM **u_values;
+	const BIGNUM *prime;
+};
+
+static double elapsed_s(struct timespec start, struct timespec end)
+{
+	return (end.tv_sec - start.tv_sec) +
+	    (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static void free_bignums(BIGNUM **bignums, int count)
+{
+	for (int i = 0; i < count; i++)
+		BN_free(bignums[i]);
+	free(bignums);
+}
+
+static int generate_size(struct gen_ctx *gen, int n, BIGNUM *prime,
+			 BN_CTX *ctx)
+{
+	char filename[512];
+	int width = BN_num_bytes(prime);
+	int ret = -1;
+
+	BIGNUM **matrix = precompute(gen->hashes, n, prime, ctx);
+	if (matrix == NULL)
+		return -1;
+
+	snprintf(filename, sizeof(filename), "%s/matrices/matrix_%d.bin",
+		 gen->outdir, n);
+	if (export_bignums_bin(filename, matrix, n * n, width) < 0)
+		goto out;
+
+	BIGNUM **vals = weave(gen->u_values, matrix, n, prime, ctx);
+	if (vals == NULL)
+		goto out;
+
+	snprintf(filename, sizeof(filename), "%s/values/vals_%d.bin",
+		 gen->outdir, n);
+	ret = export_bignums_bin(filename, vals, n, width);
+	free_bignums(vals, n);
+
+out:
+	free_bignums(matrix, n * n);
+	return ret;
+}
+
+static void *worker(void *arg)
+{
+	struct gen_ctx *gen = (struct gen_ctx *)arg;
+	BN_CTX *ctx = BN_CTX_new();
+	BIGNUM *prime = BN_dup(gen->prime);
+
+	for (;;) {
+		struct timespec start, end;
+		int n;
+
+		pthread_mutex_lock(&gen->lock);
+		if (gen->failed || gen->next == gen->num_sizes) {
+			pthread_mutex_unlock(&gen->lock);
+			break;
+		}
+		n = gen->sizes[gen->next++];
+		pthread_mutex_unlock(&gen->lock);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		int ret = generate_size(gen, n, prime, ctx);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		pthread_mutex_lock(&gen->lock);
+		if (ret < 0) {
+			fprintf(stderr, "Generating size %d failed\n", n);
+			gen->failed = 1;
+		} else {
+			printf("Generated size %d in %.2f s\n", n,
+			       elapsed_s(start, end));
+			fflush(stdout);
+		}
+		pthread_mutex_unlock(&gen->lock);
+	}
+
+	BN_free(prime);
+	BN_CTX_free(ctx);
+	return NULL;
+}
+
+static int make_dir(const char *outdir, const char *name)
+{
+	char path[512];
+
+	snprintf(path, sizeof(path), "%s/%s", outdir, name);
+	if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+		fprintf(stderr, "Could not create %s: %s\n", path,
+			strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+static int count_lines(const char *filename)
+{
+	FILE *fp = fopen(filename, "r");
+	int lines = 0;
+	int c;
+
+	if (fp == NULL)
+		return -1;
+	while ((c = getc(fp)) != EOF)
+		if (c == '\n')
+			lines++;
+	fclose(fp);
+	return lines;
+}
+
+// Converts points.txt, hashes.txt and, when present, encoded_points.txt
+// into the binary fixtures points.bin, hashes.bin and encoded_points.bin
+static int convert_fixtures(const char *outdir, EC_GROUP *group,
+			    const BIGNUM *prime)
+{
+	char filename[512];
+	int width = BN_num_bytes(prime);
+	int count;
+	int ret = 0;
+
+	count = count_lines("points.txt");
+	EC_POINT **points = read_points("points.txt", group, count);
+	if (points == NULL)
+		return -1;
+	snprintf(filename, sizeof(filename), "%s/points.bin", outdir);
+	if (export_points_bin(filename, points, count, group,
+			      POINT_CONVERSION_UNCOMPRESSED) < 0)
+		ret = -1;
+	free_points(points, count);
+	printf("Converted %d points\n", count);
+
+	count = count_lines("hashes.txt");
+	BIGNUM **hashes = read_hashes("hashes.txt", count);
+	if (hashes == NULL)
+		return -1;
+	snprintf(filename, sizeof(filename), "%s/hashes.bin", outdir);
+	if (export_bignums_bin(filename, hashes, count, width) < 0)
+		ret = -1;
+	free_hashes(hashes, count);
+	printf("Converted %d hashes\n", count);
+
+	count = count_lines("encoded_points.txt");
+	if (count <= 0)
+		return ret;
+	BIGNUM **encoded = import_bignums("encoded_points.txt", count);
+	if (encoded == NULL)
+		return -1;
+	snprintf(filename, sizeof(filename), "%s/encoded_points.bin", outdir);
+	if (export_bignums_bin(filename, encoded, count, width) < 0)
+		ret = -1;
+	free_bignums(encoded, count);
+	printf("Converted %d encoded points\n", count / 2);
+
+	return ret;
+}
+
+static int compare_desc(const void *a, const void *b)
+{
+	return *(const int *)b - *(const int *)a;
+}
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [-j <threads>] [-o <dir>] [sizes...]\n"
+	       "       %s -c [-o <dir>]\n"
+	       "Writes <dir>/matrices/matrix_<n>.bin and "
+	       "<dir>/values/vals_<n>.bin for every size n.\n"
+	       "Defaults: as many threads as CPUs, <dir> is .., and the "
+	       "sizes %d to %d, 500 and 1000.\n"
+	       "With -c, converts the text fixtures of the current "
+	       "directory into binary ones in <dir>.\n",
+	       name, name, DEFAULT_MIN_SIZE, DEFAULT_MAX_SIZE);
+}
+
+int main(int argc, char **argv)
+{
+	struct gen_ctx gen;
+	int num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	int max_size = 0;
+	int convert = 0;
+	int opt;
+	int ret = 1;
+
+	memset(&gen, 0, sizeof(gen));
+	gen.outdir = "..";
+	pthread_mutex_init(&gen.lock, NULL);
+
+	while ((opt = getopt(argc, argv, "chj:o:")) != -1) {
+		switch (opt) {
+		case 'c':
+			convert = 1;
+			break;
+		case 'j':
+			num_threads = atoi(optarg);
+			break;
+		case 'o':
+			gen.outdir = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+	if (num_threads <= 0)
+		num_threads = 1;
+
+	if (convert) {
+		EC_GROUP *group =
+		    EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+		BIGNUM *prime = BN_new();
+		EC_GROUP_get_curve(group, prime, NULL, NULL, NULL);
+		ret = convert_fixtures(gen.outdir, group, prime) < 0;
+		BN_free(prime);
+		EC_GROUP_free(group);
+		pthread_mutex_destroy(&gen.lock);
+		return ret;
+	}
+
+	if (optind < argc) {
+		gen.num_sizes = argc - optind;
+		gen.sizes = (int *)malloc(gen.num_sizes * sizeof(int));
+		for (int i = 0; i < gen.num_sizes; i++) {
+			gen.sizes[i] = atoi(argv[optind + i]);
+			if (gen.sizes[i] <= 0) {
+				printf("Error: sizes must be positive "
+				       "integers\n");
+				free(gen.sizes);
+				return 1;
+			}
+		}
+	} else {
+		gen.num_sizes = DEFAULT_MAX_SIZE - DEFAULT_MIN_SIZE + 3;
+		gen.sizes = (int *)malloc(gen.num_sizes * sizeof(int));
+		for (int i = 0; i <= DEFAULT_MAX_SIZE - DEFAULT_MIN_SIZE; i++)
+			gen.sizes[i] = DEFAULT_MIN_SIZE + i;
+		gen.sizes[gen.num_sizes - 2] = 500;
+		gen.sizes[gen.num_sizes - 1] = 1000;
+	}
+	qsort(gen.sizes, gen.num_sizes, sizeof(int), compare_desc);
+	max_size = gen.sizes[0];
+
+	if (make_dir(gen.outdir, "matrices") < 0 ||
+	    make_dir(gen.outdir, "values") < 0)
+		goto out_sizes;
+
+	EC_GROUP *group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+	BIGNUM *a = BN_new();
+	BIGNUM *b = BN_new();
+	BIGNUM *prime = BN_new();
+	EC_GROUP_get_curve(group, prime, a, b, NULL);
+	gen.prime = prime;
+
+	EC_POINT **points = read_points("points.txt", group, max_size);
+	gen.hashes = read_hashes("hashes.txt", max_size);
+	if (points == NULL || gen.hashes == NULL)
+		goto out_inputs;
+
+	// Every size uses a prefix of the same encodings
+	BIGNUM **v_values = (BIGNUM **) malloc(max_size * sizeof(BIGNUM *));
+	gen.u_values = (BIGNUM **) malloc(max_size * sizeof(BIGNUM *));
+	if (es_encode_batch(points, max_size, gen.u_values, v_values, group,
+			    a, b, prime) < 0) {
+		printf("Error encoding points\n");
+		free(v_values);
+		free(gen.u_values);
+		gen.u_values = NULL;
+		goto out_inputs;
+	}
+	free_bignums(v_values, max_size);
+
+	if (num_threads > gen.num_sizes)
+		num_threads = gen.num_sizes;
+	printf("Generating %d sizes with %d threads\n", gen.num_sizes,
+	       num_threads);
+
+	pthread_t *threads =
+	    (pthread_t *) malloc(num_threads * sizeof(pthread_t));
+	for (int i = 0; i < num_threads; i++)
+		pthread_create(&threads[i], NULL, worker, &gen);
+	for (int i = 0; i < num_threads; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+
+	if (!gen.failed)
+		ret = 0;
+
+	free_bignums(gen.u_values, max_size);
+
+out_inputs:
+	if (points != NULL)
+		free_points(points, max_size);
+	if (gen.hashes != NULL)
+		free_hashes(gen.hashes, max_size);
+	BN_free(a);
+	BN_free(b);
+	BN_free(prime);
+	EC_GROUP_free(group);
+out_sizes:
+	free(gen.sizes);
+	pthread_mutex_destroy(&gen.lock);
+	return ret;
+}
@@ -0,0 +1,229 @@
+// C++ helpers for the tests and benchmarks: move-only owners of the OpenSSL
+// objects, views over the BIGNUM arrays of the C API, and overloads of the
+// encoder and weaver functions that return owners. Everything is header-only
+// and the C library does not depend on it.
+#pragma once
+#ifndef DECOYAUTH_HPP
+#define DECOYAUTH_HPP
+
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+#include "encode.h"
+#include "weaver.h"
+
+namespace decoyauth {
+
+// Owns one object and frees it with Free. It converts to the raw pointer so
+// that it can be handed to the C functions directly.
+template <typename T, void (*Free)(T*)>
+class handle {
+public:
+    handle() noexcept = default;
+    explicit handle(T* ptr) noexcept : ptr_(ptr) {}
+    handle(handle&& other) noexcept : ptr_(other.release()) {}
+    handle& operator=(handle&& other) noexcept {
+        reset(other.release());
+        return *this;
+    }
+    handle(const handle&) = delete;
+    handle& operator=(const handle&) = delete;
+    ~handle() { reset(); }
+
+    T* get() const noexcept { return ptr_; }
+    operator T*() const noexcept { return ptr_; }
+    explicit operator bool() const noexcept { return ptr_ != nullptr; }
+
+    T* release() noexcept { return std::exchange(ptr_, nullptr); }
+    void reset(T* ptr = nullptr) noexcept {
+        if (ptr_ != nullptr)
+            Free(ptr_);
+        ptr_ = ptr;
+    }
+
+private:
+    T* ptr_ = nullptr;
+};
+
+using bignum = handle<BIGNUM, BN_free>;
+using ec_point = handle<EC_POINT, EC_POINT_free>;
+using ec_group = handle<EC_GROUP, EC_GROUP_free>;
+using bn_ctx = handle<BN_CTX, BN_CTX_free>;
+
+// Non-owning view of count pointers, e.g. the pair { u, v } inside a flat
+// array of encoded points. data() is what the C functions take.
+template <typename T>
+class span {
+public:
+    span() noexcept = default;
+    span(T** data, size_t size) noexcept : data_(data), size_(size) {}
+    span(std::vector<T*>& values) noexcept : data_(values.data()), size_(values.size()) {}
+
+    T** data() const noexcept { return data_; }
+    size_t size() const noexcept { return size_; }
+    T* operator[](size_t i) const noexcept { return data_[i]; }
+    T** begin() const noexcept { return data_; }
+    T** end() const noexcept { return data_ + size_; }
+
+    span subspan(size_t offset, size_t count) const noexcept {
+        assert(offset + count <= size_);
+        return span(data_ + offset, count);
+    }
+
+private:
+    T** data_ = nullptr;
+    size_t size_ = 0;
+};
+
+using bignum_span = span<BIGNUM>;
+using point_span = span<EC_POINT>;
+
+// Owns a malloc()ed array of objects like the ones returned by precompute(),
+// weave() and read_points(), and frees the objects and the array
+template <typename T, void (*Free)(T*)>
+class owned_array {
+public:
+    owned_array() noexcept = default;
+    // Takes over an array returned by the C API
+    owned_array(T** data, size_t size) noexcept : data_(data), size_(data ? size : 0) {}
+    // An array of size empty slots, to be filled with set()
+    explicit owned_array(size_t size)
+        : data_(static_cast<T**>(calloc(size, sizeof(T*)))), size_(size) {}
+    owned_array(owned_array&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+    owned_array& operator=(owned_array&& other) noexcept {
+        clear();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        return *this;
+    }
+    owned_array(const owned_array&) = delete;
+    owned_array& operator=(const owned_array&) = delete;
+    ~owned_array() { clear(); }
+
+    T** data() const noexcept { return data_; }
+    size_t size() const noexcept { return size_; }
+    T* operator[](size_t i) const noexcept { return data_[i]; }
+    explicit operator bool() const noexcept { return data_ != nullptr; }
+    span<T> view() const noexcept { return span<T>(data_, size_); }
+    operator span<T>() const noexcept { return view(); }
+
+    // Stores ptr in slot i, freeing the previous object
+    void set(size_t i, T* ptr) noexcept {
+        if (data_[i] != nullptr)
+            Free(data_[i]);
+        data_[i] = ptr;
+    }
+
+private:
+    T** data_ = nullptr;
+    size_t size_ = 0;
+
+    void clear() noexcept {
+        for (size_t i = 0; i < size_; i++)
+            if (data_[i] != nullptr)
+                Free(data_[i]);
+        free(data_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+};
+
+using bignum_array = owned_array<BIGNUM, BN_free>;
+using point_array = owned_array<EC_POINT, EC_POINT_free>;
+
+// Borrows a BN_CTX from a pool of the calling thread for its lifetime, so
+// that short-lived helpers do not set up and tear down a context each time.
+// BN_CTX is not thread safe, hence the pool per thread.
+class ctx_guard {
+public:
+    ctx_guard() {
+        std::vector<BN_CTX*>& free_list = pool().contexts;
+        if (free_list.empty()) {
+            ctx_ = BN_CTX_new();
+        } else {
+            ctx_ = free_list.back();
+            free_list.pop_back();
+        }
+    }
+    ~ctx_guard() { pool().contexts.push_back(ctx_); }
+    ctx_guard(const ctx_guard&) = delete;
+    ctx_guard& operator=(const ctx_guard&) = delete;
+
+    BN_CTX* get() const noexcept { return ctx_; }
+    operator BN_CTX*() const noexcept { return ctx_; }
+
+private:
+    struct thread_pool {
+        std::vector<BN_CTX*> contexts;
+        ~thread_pool() {
+            for (BN_CTX* ctx : contexts)
+                BN_CTX_free(ctx);
+        }
+    };
+
+    static thread_pool& pool() {
+        thread_local thread_pool instance;
+        return instance;
+    }
+
+    BN_CTX* ctx_;
+};
+
+// Group and constants of the map for one curve, e.g. NID_X9_62_prime256v1
+struct curve {
+    ec_group group;
+    bignum a;
+    bignum b;
+    bignum prime;
+
+    explicit curve(int nid) : curve(ec_group(EC_GROUP_new_by_curve_name(nid))) {}
+
+    // Works on its own copy of the group, e.g. one per thread
+    explicit curve(const EC_GROUP* shared) : curve(ec_group(EC_GROUP_dup(shared))) {}
+
+    int coord_bytes() const { return BN_num_bytes(prime); }
+
+private:
+    explicit curve(ec_group&& owned)
+        : group(std::move(owned)), a(BN_new()), b(BN_new()), prime(BN_new()) {
+        EC_GROUP_get_curve(group, prime, a, b, ctx_guard());
+    }
+};
+
+// Encoded point as the array { u, v } that es_decode() takes, empty when the
+// point could not be encoded
+inline bignum_array es_encode(EC_POINT* point, const curve& c) {
+    return bignum_array(::es_encode(point, c.group, c.a, c.b, c.prime), 2);
+}
+
+inline ec_point es_decode(bignum_span uv, const curve& c) {
+    assert(uv.size() == 2);
+    return ec_point(::es_decode(uv.data(), c.group, c.a, c.b, c.prime));
+}
+
+inline bignum_array precompute(bignum_span x_values, const BIGNUM* prime, BN_CTX* ctx) {
+    return bignum_array(::precompute(x_values.data(), static_cast<int>(x_values.size()), prime, ctx),
+                        x_values.size() * x_values.size());
+}
+
+inline bignum_array weave(bignum_span y_values, bignum_span matrix, const BIGNUM* prime,
+                          BN_CTX* ctx) {
+    assert(matrix.size() == y_values.size() * y_values.size());
+    return bignum_array(::weave(y_values.data(), matrix.data(), static_cast<int>(y_values.size()),
+                                const_cast<BIGNUM*>(prime), ctx),
+                        y_values.size());
+}
+
+inline bignum evaluate(bignum_span vals, const BIGNUM* x, const BIGNUM* prime, BN_CTX* ctx) {
+    return bignum(::evaluate(vals.data(), const_cast<BIGNUM*>(x), static_cast<int>(vals.size()),
+                             const_cast<BIGNUM*>(prime), ctx));
+}
+
+} // namespace decoyauth
+
+#endif // DECOYAUTH_HPP
@@ -1,6 +1,8 @@
-#include <openssl/rand.h>
 #include <openssl/bn.h>
+#include <pthread.h>
 #include "encode.h"
+#include "field.h"
+#include "rng.h"
 
 // #define FIXED_U_VALUE "97945056622653298015081862479932987806690569858371314855998309191291337515864"
 // #define FIXED_J_VALUE 2
@@ -13,7 +15,7 @@ BIGNUM *generate_random_bn(BIGNUM *prime)
 		return NULL;
 
 	// Generate a random number between 1 and prime-1
-	if (!BN_rand_range(rand_bn, prime)) {
+	if (!rng_range(rand_bn, prime)) {
 		BN_free(rand_bn);
 		return NULL;
 	}
@@ -27,12 +29,7 @@ BIGNUM *generate_random_bn(BIGNUM *prime)
 
 int generate_j()
 {
-	unsigned char buffer[1];
-	if (RAND_bytes(buffer, sizeof(buffer)) != 1)
-		return -1;
-
-	int random_number = buffer[0] % 4;
-	return random_number;
+	return rng_below(4);
 }
 
 bool is_valid_u(BIGNUM *u, BIGNUM *prime)
@@ -61,6 +58,17 @@ bool is_valid_u(BIGNUM *u, BIGNUM *prime)
 	return result;
 }
 
+// BN_mod_sqrt() for values that are not always squares. The residue is
+// checked first, since a failing BN_mod_sqrt() leaves an error on the queue
+// of the thread, which allocates and keeps the memory until it is cleared.
+static BIGNUM *mod_sqrt(BIGNUM *ret, const BIGNUM *a, const BIGNUM *p,
+			BN_CTX *ctx)
+{
+	if (BN_kronecker(a, p, ctx) < 0)
+		return NULL;
+	return BN_mod_sqrt(ret, a, p, ctx);
+}
+
 BIGNUM *g(BIGNUM *x, BIGNUM *a, BIGNUM *b, BIGNUM *prime)
 {
 	BIGNUM *result = BN_new();
@@ -172,7 +180,7 @@ EC_POINT *f(BIGNUM *u, EC_GROUP *group, BIGNUM *a, BIGNUM *b, BIGNUM *prime)
 	BIGNUM *g_0 = g(x_0, a, b, prime);
 
 	BIGNUM *y = BN_new();
-	BIGNUM *is_mod_sqrt = BN_mod_sqrt(y, g_0, prime, ctx);
+	BIGNUM *is_mod_sqrt = mod_sqrt(y, g_0, prime, ctx);
 	BN_free(g_0);
 
 	if (is_mod_sqrt != NULL) {
@@ -189,7 +197,7 @@ EC_POINT *f(BIGNUM *u, EC_GROUP *group, BIGNUM *a, BIGNUM *b, BIGNUM *prime)
 	BIGNUM *x_1 = X_1(u, a, b, prime);
 	BIGNUM *g_1 = g(x_1, a, b, prime);
 
-	is_mod_sqrt = BN_mod_sqrt(y, g_1, prime, ctx);
+	is_mod_sqrt = mod_sqrt(y, g_1, prime, ctx);
 	BN_free(g_1);
 
 	if (is_mod_sqrt != NULL) {
@@ -252,28 +260,24 @@ BIGNUM *calc_v(EC_POINT *q, int j, EC_GROUP *group, BIGNUM *a, BIGNUM *b,
 	BN_free(subtractor);
 	BN_free(omega_square);
 
-	BIGNUM *is_mod_sqrt = BN_mod_sqrt(sqrt, sqrt, prime, ctx);
+	BIGNUM *is_mod_sqrt = mod_sqrt(sqrt, sqrt, prime, ctx);
 	if (is_mod_sqrt != NULL) {
 		if (j != 0 && j != 1)
 			BN_sub(sqrt, prime, sqrt);
 
-		BIGNUM *temp = BN_new();
-		is_mod_sqrt = BN_mod_sqrt(temp, y, prime, ctx);
-		BN_free(temp);
-
 		BIGNUM *multiply = BN_new();
-		if (is_mod_sqrt != NULL) {
+		if (BN_kronecker(y, prime, ctx) >= 0) {
 			BN_mod_mul(multiply, two, omega, prime, ctx);
 			BN_mod_inverse(multiply, multiply, prime, ctx);
 		} else {
 			BN_mod_inverse(multiply, two, prime, ctx);
 		}
 
-		temp = BN_new();
+		BIGNUM *temp = BN_new();
 		BN_mod_add(temp, omega, sqrt, prime, ctx);
 		BN_mod_mul(temp, temp, multiply, prime, ctx);
 
-		is_mod_sqrt = BN_mod_sqrt(temp, temp, prime, ctx);
+		is_mod_sqrt = mod_sqrt(temp, temp, prime, ctx);
 		BN_free(multiply);
 
 		if (is_mod_sqrt != NULL) {
@@ -294,6 +298,357 @@ BIGNUM *calc_v(EC_POINT *q, int j, EC_GROUP *group, BIGNUM *a, BIGNUM *b,
 	return result;
 }
 
+// Curve constants of the map in the representation of the field backend
+struct map_consts {
+	struct field_ctx *fctx;
+	fe_t one;
+	fe_t a;
+	fe_t b;
+	fe_t four;
+	fe_t inv_two;
+	fe_t neg_b_div_a;
+	fe_t a_div_b;
+};
+
+static int map_consts_init(struct map_consts *mc, BIGNUM *a, BIGNUM *b,
+			   BIGNUM *prime, enum field_backend backend)
+{
+	// The portable lanes lose against BN for the map, so only the vector
+	// backends take the batched path
+	if (backend == FIELD_BACKEND_SCALAR)
+		return -1;
+
+	mc->fctx = field_ctx_new_backend(prime, backend);
+	if (mc->fctx == NULL)
+		return -1;
+
+	BN_CTX *ctx = BN_CTX_new();
+	BIGNUM *tmp = BN_new();
+	BIGNUM *inv = BN_new();
+
+	BN_one(tmp);
+	fe_set(mc->fctx, &mc->one, tmp);
+	fe_set(mc->fctx, &mc->a, a);
+	fe_set(mc->fctx, &mc->b, b);
+	BN_set_word(tmp, 4);
+	fe_set(mc->fctx, &mc->four, tmp);
+
+	// 1 / 2 = (p + 1) / 2
+	BN_add(tmp, prime, BN_value_one());
+	BN_rshift1(tmp, tmp);
+	fe_set(mc->fctx, &mc->inv_two, tmp);
+
+	// A single inversion of a * b yields both 1 / a and 1 / b
+	fe_t ab_inv;
+	BN_mod_mul(tmp, a, b, prime, ctx);
+	BN_mod_inverse(inv, tmp, prime, ctx);
+	fe_set(mc->fctx, &ab_inv, inv);
+
+	fe_t b_square, a_square;
+	fe_sqr(mc->fctx, &b_square, &mc->b);
+	fe_mul(mc->fctx, &mc->neg_b_div_a, &b_square, &ab_inv);
+	fe_neg(mc->fctx, &mc->neg_b_div_a, &mc->neg_b_div_a);
+	fe_sqr(mc->fctx, &a_square, &mc->a);
+	fe_mul(mc->fctx, &mc->a_div_b, &a_square, &ab_inv);
+
+	BN_free(inv);
+	BN_free(tmp);
+	BN_CTX_free(ctx);
+	return 0;
+}
+
+static void map_consts_free(struct map_consts *mc)
+{
+	field_ctx_free(mc->fctx);
+}
+
+// Map constants of every curve seen by the batch functions. Like the
+// tables OpenSSL sets up for a group, they are built on first use and kept
+// until exit, so a call does not pay for the field setup again.
+struct map_consts_entry {
+	struct map_consts mc;
+	struct map_consts_entry *next;
+	enum field_backend backend;
+	BIGNUM *prime;
+	BIGNUM *a;
+	BIGNUM *b;
+	int usable;
+};
+
+static pthread_mutex_t map_consts_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct map_consts_entry *map_consts_list;
+
+// Returns NULL if the curve has to use the BN path
+static const struct map_consts *map_consts_get(BIGNUM *a, BIGNUM *b,
+					       BIGNUM *prime)
+{
+	enum field_backend backend = field_detect_backend();
+	struct map_consts_entry *entry;
+
+	if (backend == FIELD_BACKEND_SCALAR)
+		return NULL;
+
+	pthread_mutex_lock(&map_consts_lock);
+	for (entry = map_consts_list; entry != NULL; entry = entry->next) {
+		if (entry->backend == backend && BN_cmp(entry->prime, prime) == 0
+		    && BN_cmp(entry->a, a) == 0 && BN_cmp(entry->b, b) == 0)
+			goto out;
+	}
+
+	// The constants are vectors the SIMD backends load aligned
+	if (posix_memalign((void **)&entry, 64, sizeof(*entry)) != 0) {
+		entry = NULL;
+		goto out;
+	}
+	memset(entry, 0, sizeof(*entry));
+	entry->backend = backend;
+	entry->prime = BN_dup(prime);
+	entry->a = BN_dup(a);
+	entry->b = BN_dup(b);
+	if (entry->prime == NULL || entry->a == NULL || entry->b == NULL) {
+		BN_free(entry->prime);
+		BN_free(entry->a);
+		BN_free(entry->b);
+		free(entry);
+		entry = NULL;
+		goto out;
+	}
+
+	// A prime the lanes cannot handle is remembered as well
+	entry->usable = map_consts_init(&entry->mc, a, b, prime, backend) == 0;
+	entry->next = map_consts_list;
+	map_consts_list = entry;
+out:
+	pthread_mutex_unlock(&map_consts_lock);
+	return entry != NULL && entry->usable ? &entry->mc : NULL;
+}
+
+// r = x^3 + a * x + b
+static void g_lanes(const struct map_consts *mc, fe_t *r, const fe_t *x)
+{
+	fe_t x3, ax;
+
+	fe_sqr(mc->fctx, &x3, x);
+	fe_mul(mc->fctx, &x3, &x3, x);
+	fe_mul(mc->fctx, &ax, &mc->a, x);
+	fe_add(mc->fctx, r, &x3, &ax);
+	fe_add(mc->fctx, r, r, &mc->b);
+}
+
+// The computations of f() on all lanes. Both candidate x-coordinates are
+// evaluated so every lane follows the same instruction stream. Lanes not in
+// valid map to the point at infinity, lanes not in found have no image.
+static void f_lanes(const struct map_consts *mc, const fe_t *u, fe_t *x,
+		    fe_t *y, unsigned int *valid, unsigned int *found)
+{
+	const struct field_ctx *fctx = mc->fctx;
+	fe_t u_square, t, x_0, x_1, g_0, g_1, y_0, y_1;
+
+	// x_0 = -(b / a) * (1 + 1 / (u^4 - u^2)), zero for u in {0, 1, -1}
+	fe_sqr(fctx, &u_square, u);
+	fe_sqr(fctx, &t, &u_square);
+	fe_sub(fctx, &t, &t, &u_square);
+	*valid = ~fe_is_zero(fctx, &t) & ((1u << field_lanes(fctx)) - 1);
+	fe_inv(fctx, &t, &t);
+	fe_add(fctx, &t, &t, &mc->one);
+	fe_mul(fctx, &x_0, &mc->neg_b_div_a, &t);
+
+	g_lanes(mc, &g_0, &x_0);
+	unsigned int found_0 = fe_sqrt(fctx, &y_0, &g_0);
+
+	// x_1 = -u^2 * x_0 with y = -sqrt(g(x_1))
+	fe_mul(fctx, &x_1, &u_square, &x_0);
+	fe_neg(fctx, &x_1, &x_1);
+	g_lanes(mc, &g_1, &x_1);
+	unsigned int found_1 = fe_sqrt(fctx, &y_1, &g_1);
+	fe_neg(fctx, &y_1, &y_1);
+
+	fe_select(fctx, x, found_0, &x_0, &x_1);
+	fe_select(fctx, y, found_0, &y_0, &y_1);
+	*found = (found_0 | found_1) & *valid;
+}
+
+// The computations of calc_v() on all lanes, where the lanes in negate_sqrt
+// and negate_result correspond to the j values that pick the other roots
+static void calc_v_lanes(const struct map_consts *mc, const fe_t *x,
+			 const fe_t *y, unsigned int negate_sqrt,
+			 unsigned int negate_result, fe_t *v,
+			 unsigned int *found)
+{
+	const struct field_ctx *fctx = mc->fctx;
+	fe_t omega, t, sqrt, multiply, result;
+
+	// omega = (a / b) * x + 1
+	fe_mul(fctx, &omega, &mc->a_div_b, x);
+	fe_add(fctx, &omega, &omega, &mc->one);
+
+	// sqrt = +-sqrt(omega^2 - 4 * omega)
+	fe_sqr(fctx, &sqrt, &omega);
+	fe_mul(fctx, &t, &mc->four, &omega);
+	fe_sub(fctx, &t, &sqrt, &t);
+	unsigned int found_sqrt = fe_sqrt(fctx, &sqrt, &t);
+	fe_neg(fctx, &t, &sqrt);
+	fe_select(fctx, &sqrt, negate_sqrt, &t, &sqrt);
+
+	// multiply = 1 / (2 * omega) if y is a square and 1 / 2 otherwise
+	unsigned int y_square = fe_sqrt(fctx, &t, y);
+	fe_add(fctx, &multiply, &omega, &omega);
+	fe_inv(fctx, &multiply, &multiply);
+	fe_select(fctx, &multiply, y_square, &multiply, &mc->inv_two);
+
+	fe_add(fctx, &t, &omega, &sqrt);
+	fe_mul(fctx, &t, &t, &multiply);
+	unsigned int found_result = fe_sqrt(fctx, &result, &t);
+	fe_neg(fctx, &t, &result);
+	fe_select(fctx, v, negate_result, &t, &result);
+
+	*found = found_sqrt & found_result;
+}
+
+static void f_batch_mc(const struct map_consts *mc, BIGNUM **u,
+		       EC_POINT **out, int n, EC_GROUP *group, BN_CTX *ctx)
+{
+	const int lanes = field_lanes(mc->fctx);
+	BIGNUM *us[lanes], *xs[lanes], *ys[lanes];
+	fe_t u_fe, x_fe, y_fe;
+
+	for (int l = 0; l < lanes; l++) {
+		xs[l] = BN_new();
+		ys[l] = BN_new();
+	}
+
+	for (int base = 0; base < n; base += lanes) {
+		int count = n - base < lanes ? n - base : lanes;
+		unsigned int present = 0, valid, found;
+
+		// A missing u has no image, its lane computes with 1 instead
+		for (int l = 0; l < count; l++) {
+			us[l] = u[base + l];
+			if (us[l] != NULL)
+				present |= 1u << l;
+			else
+				us[l] = (BIGNUM *) BN_value_one();
+		}
+
+		fe_load(mc->fctx, &u_fe, us, count);
+		f_lanes(mc, &u_fe, &x_fe, &y_fe, &valid, &found);
+		fe_store(mc->fctx, xs, &x_fe, count);
+		fe_store(mc->fctx, ys, &y_fe, count);
+
+		for (int l = 0; l < count; l++) {
+			EC_POINT *point = NULL;
+			if (!(present & (1u << l))) {
+				out[base + l] = NULL;
+				continue;
+			}
+			if (!(valid & (1u << l))) {
+				point = EC_POINT_new(group);
+				EC_POINT_set_to_infinity(group, point);
+			} else if (found & (1u << l)) {
+				point = EC_POINT_new(group);
+				if (!EC_POINT_set_affine_coordinates
+				    (group, point, xs[l], ys[l], ctx)) {
+					EC_POINT_free(point);
+					point = NULL;
+				}
+			}
+			out[base + l] = point;
+		}
+	}
+
+	for (int l = 0; l < lanes; l++) {
+		BN_free(xs[l]);
+		BN_free(ys[l]);
+	}
+}
+
+static void calc_v_batch_mc(const struct map_consts *mc, EC_POINT **q,
+			    const int *j, BIGNUM **out, int n,
+			    EC_GROUP *group, BN_CTX *ctx)
+{
+	const int lanes = field_lanes(mc->fctx);
+	BIGNUM *xs[lanes], *ys[lanes];
+	fe_t x_fe, y_fe, v_fe;
+
+	for (int l = 0; l < lanes; l++) {
+		xs[l] = BN_new();
+		ys[l] = BN_new();
+	}
+
+	for (int base = 0; base < n; base += lanes) {
+		int count = n - base < lanes ? n - base : lanes;
+		unsigned int usable = 0, negate_sqrt = 0, negate_result = 0;
+		unsigned int found;
+
+		for (int l = 0; l < count; l++) {
+			if (q[base + l] != NULL
+			    && EC_POINT_get_affine_coordinates(group, q[base + l],
+							       xs[l], ys[l],
+							       ctx))
+				usable |= 1u << l;
+			if (j[base + l] != 0 && j[base + l] != 1)
+				negate_sqrt |= 1u << l;
+			if (j[base + l] != 0 && j[base + l] != 2)
+				negate_result |= 1u << l;
+		}
+
+		fe_load(mc->fctx, &x_fe, xs, count);
+		fe_load(mc->fctx, &y_fe, ys, count);
+		calc_v_lanes(mc, &x_fe, &y_fe, negate_sqrt, negate_result,
+			     &v_fe, &found);
+		found &= usable;
+
+		fe_store(mc->fctx, xs, &v_fe, count);
+		for (int l = 0; l < count; l++)
+			out[base + l] =
+			    (found & (1u << l)) ? BN_dup(xs[l]) : NULL;
+	}
+
+	for (int l = 0; l < lanes; l++) {
+		BN_free(xs[l]);
+		BN_free(ys[l]);
+	}
+}
+
+int f_batch(BIGNUM **u, EC_POINT **out, int n, EC_GROUP *group, BIGNUM *a,
+	    BIGNUM *b, BIGNUM *prime)
+{
+	if (u == NULL || out == NULL || n < 0)
+		return -1;
+
+	const struct map_consts *mc = map_consts_get(a, b, prime);
+	if (mc == NULL) {
+		for (int i = 0; i < n; i++)
+			out[i] = u[i] != NULL ? f(u[i], group, a, b, prime) : NULL;
+		return 0;
+	}
+
+	BN_CTX *ctx = BN_CTX_new();
+	f_batch_mc(mc, u, out, n, group, ctx);
+	BN_CTX_free(ctx);
+	return 0;
+}
+
+int calc_v_batch(EC_POINT **q, const int *j, BIGNUM **out, int n,
+		 EC_GROUP *group, BIGNUM *a, BIGNUM *b, BIGNUM *prime)
+{
+	if (q == NULL || j == NULL || out == NULL || n < 0)
+		return -1;
+
+	const struct map_consts *mc = map_consts_get(a, b, prime);
+	if (mc == NULL) {
+		for (int i = 0; i < n; i++)
+			out[i] = q[i] != NULL ?
+			    calc_v(q[i], j[i], group, a, b, prime) : NULL;
+		return 0;
+	}
+
+	BN_CTX *ctx = BN_CTX_new();
+	calc_v_batch_mc(mc, q, j, out, n, group, ctx);
+	BN_CTX_free(ctx);
+	return 0;
+}
+
 BIGNUM **es_encode(EC_POINT *point, EC_GROUP *group, BIGNUM *a, BIGNUM *b,
 		   BIGNUM *prime)
 {
@@ -328,8 +683,11 @@ BIGNUM **es_encode(EC_POINT *point, EC_GROUP *group, BIGNUM *a, BIGNUM *b,
 		}
 
 		int j = generate_j();
-		if (j < 0)
+		if (j < 0) {
+			EC_POINT_free(diff);
+			BN_free(u);
 			return NULL;
+		}
 
 		BIGNUM *v = calc_v(diff, j, group, a, b, prime);
 		if (!v) {
@@ -341,11 +699,132 @@ BIGNUM **es_encode(EC_POINT *point, EC_GROUP *group, BIGNUM *a, BIGNUM *b,
 		EC_POINT_free(diff);
 
 		BIGNUM **output = (BIGNUM **) malloc(2 * sizeof(BIGNUM *));
+		if (output == NULL) {
+			BN_free(u);
+			BN_free(v);
+			return NULL;
+		}
 		output[0] = u;
 		output[1] = v;
 
 		return output;
 	}
+
+	return NULL;
+}
+
+int es_encode_batch(EC_POINT **points, int n, BIGNUM **u_values,
+		    BIGNUM **v_values, EC_GROUP *group, BIGNUM *a, BIGNUM *b,
+		    BIGNUM *prime)
+{
+	if (points == NULL || u_values == NULL || v_values == NULL
+	    || prime == NULL || n < 0)
+		return -1;
+
+	for (int i = 0; i < n; i++) {
+		u_values[i] = NULL;
+		v_values[i] = NULL;
+	}
+
+	const struct map_consts *mc = map_consts_get(a, b, prime);
+	if (mc == NULL) {
+		for (int i = 0; i < n; i++) {
+			BIGNUM **pair = es_encode(points[i], group, a, b, prime);
+			if (pair == NULL)
+				goto fail;
+			u_values[i] = pair[0];
+			v_values[i] = pair[1];
+			free(pair);
+		}
+		return 0;
+	}
+
+	BN_CTX *ctx = BN_CTX_new();
+	int *pending = (int *)malloc(n * sizeof(int));
+	int *j = (int *)malloc(n * sizeof(int));
+	BIGNUM **u = (BIGNUM **) malloc(n * sizeof(BIGNUM *));
+	BIGNUM **v = (BIGNUM **) malloc(n * sizeof(BIGNUM *));
+	EC_POINT **f_val = (EC_POINT **) malloc(n * sizeof(EC_POINT *));
+	int num_pending = n;
+
+	for (int i = 0; i < n; i++)
+		pending[i] = i;
+
+	// Every round draws a fresh u for each point that is not encoded yet
+	// and runs the map for all of them together
+	for (int attempt = 0; attempt < 1000 && num_pending > 0; attempt++) {
+		for (int k = 0; k < num_pending; k++) {
+			u[k] = generate_random_bn(prime);
+			if (u[k] != NULL && !is_valid_u(u[k], prime)) {
+				BN_free(u[k]);
+				u[k] = NULL;
+			}
+		}
+
+		f_batch_mc(mc, u, f_val, num_pending, group, ctx);
+
+		// f_val[k] becomes point - f(u) for the candidates still usable
+		for (int k = 0; k < num_pending; k++) {
+			EC_POINT *diff = NULL;
+			j[k] = 0;
+			if (u[k] != NULL && f_val[k] != NULL) {
+				diff = EC_POINT_new(group);
+				EC_POINT_invert(group, f_val[k], ctx);
+				EC_POINT_add(group, diff, points[pending[k]],
+					     f_val[k], ctx);
+				if (EC_POINT_is_at_infinity(group, diff)) {
+					EC_POINT_free(diff);
+					diff = NULL;
+				} else {
+					j[k] = generate_j();
+					if (j[k] < 0) {
+						EC_POINT_free(diff);
+						diff = NULL;
+					}
+				}
+			}
+			EC_POINT_free(f_val[k]);
+			f_val[k] = diff;
+		}
+
+		calc_v_batch_mc(mc, f_val, j, v, num_pending, group, ctx);
+
+		int still_pending = 0;
+		for (int k = 0; k < num_pending; k++) {
+			EC_POINT_free(f_val[k]);
+			if (f_val[k] != NULL && v[k] != NULL) {
+				u_values[pending[k]] = u[k];
+				v_values[pending[k]] = v[k];
+			} else {
+				BN_free(u[k]);
+				BN_free(v[k]);
+				pending[still_pending++] = pending[k];
+			}
+		}
+		num_pending = still_pending;
+	}
+
+	free(f_val);
+	free(v);
+	free(u);
+	free(j);
+	free(pending);
+	BN_CTX_free(ctx);
+
+	if (num_pending == 0)
+		return 0;
+
+fail:
+#ifdef DEBUG_PRINTS
+	fprintf(stderr, "ERROR: Could not encode all points\n");
+#endif
+	for (int i = 0; i < n; i++) {
+		BN_free(u_values[i]);
+		BN_free(v_values[i]);
+		u_values[i] = NULL;
+		v_values[i] = NULL;
+	}
+	return -1;
 }
 
 EC_POINT *es_decode(BIGNUM **encoded_point, EC_GROUP *group, BIGNUM *a,
@@ -367,16 +846,401 @@ EC_POINT *es_decode(BIGNUM **encoded_point, EC_GROUP *group, BIGNUM *a,
 		return NULL;
 	}
 
-	EC_POINT *f_u = f(u, group, a, b, p);
-	EC_POINT *f_v = f(v, group, a, b, p);
+	// f(u) and f(v) are independent and share the lanes of one batch
+	EC_POINT *f_uv[2];
+	f_batch(encoded_point, f_uv, 2, group, a, b, p);
+	if (f_uv[0] == NULL || f_uv[1] == NULL) {
+		EC_POINT_free(f_uv[0]);
+		EC_POINT_free(f_uv[1]);
+		return NULL;
+	}
 
 	EC_POINT *result = EC_POINT_new(group);
 	BN_CTX *ctx = BN_CTX_new();
-	EC_POINT_add(group, result, f_u, f_v, ctx);
+	EC_POINT_add(group, result, f_uv[0], f_uv[1], ctx);
 
-	EC_POINT_free(f_u);
-	EC_POINT_free(f_v);
+	EC_POINT_free(f_uv[0]);
+	EC_POINT_free(f_uv[1]);
 	BN_CTX_free(ctx);
 
 	return result;
 }
+
+struct es_ctx {
+	EC_GROUP *group;
+	BIGNUM *a;
+	BIGNUM *b;
+	BIGNUM *prime;
+	BN_CTX *bnctx;
+	BN_MONT_CTX *mont;
+
+	// Constants of the map
+	BIGNUM *minus_one;
+	BIGNUM *exp_sqrt;
+	BIGNUM *inv_two;
+	BIGNUM *neg_b_div_a;
+	BIGNUM *a_div_b;
+
+	// Scratch space reused by every call
+	BIGNUM *uv[2];
+	BIGNUM *xs[2];
+	BIGNUM *ys[2];
+	EC_POINT *f_uv[2];
+	EC_POINT *point;
+
+	int use_lanes;
+	struct map_consts mc;
+};
+
+struct es_ctx *es_ctx_new(EC_GROUP *group, BIGNUM *a, BIGNUM *b,
+			  BIGNUM *prime)
+{
+	if (group == NULL || a == NULL || b == NULL || prime == NULL
+	    || BN_num_bytes(prime) > ES_COORD_BYTES)
+		return NULL;
+
+	// The map constants are vectors of the field backend, which the
+	// SIMD backends load with aligned instructions
+	struct es_ctx *ctx;
+	if (posix_memalign((void **)&ctx, 64, sizeof(*ctx)) != 0)
+		return NULL;
+	memset(ctx, 0, sizeof(*ctx));
+
+	ctx->group = group;
+	ctx->a = a;
+	ctx->b = b;
+	ctx->prime = prime;
+	ctx->bnctx = BN_CTX_new();
+	ctx->mont = BN_MONT_CTX_new();
+	ctx->minus_one = BN_new();
+	ctx->exp_sqrt = BN_new();
+	ctx->inv_two = BN_new();
+	ctx->neg_b_div_a = BN_new();
+	ctx->a_div_b = BN_new();
+	ctx->point = EC_POINT_new(group);
+	for (int i = 0; i < 2; i++) {
+		ctx->uv[i] = BN_new();
+		ctx->xs[i] = BN_new();
+		ctx->ys[i] = BN_new();
+		ctx->f_uv[i] = EC_POINT_new(group);
+		if (ctx->uv[i] == NULL || ctx->xs[i] == NULL
+		    || ctx->ys[i] == NULL || ctx->f_uv[i] == NULL)
+			goto fail;
+	}
+	if (ctx->bnctx == NULL || ctx->mont == NULL || ctx->minus_one == NULL
+	    || ctx->exp_sqrt == NULL || ctx->inv_two == NULL
+	    || ctx->neg_b_div_a == NULL || ctx->a_div_b == NULL
+	    || ctx->point == NULL)
+		goto fail;
+
+	if (!BN_MONT_CTX_set(ctx->mont, prime, ctx->bnctx)
+	    || !BN_sub(ctx->minus_one, prime, BN_value_one())
+	    || !BN_add(ctx->inv_two, prime, BN_value_one())
+	    || !BN_rshift1(ctx->inv_two, ctx->inv_two)
+	    || !BN_rshift1(ctx->exp_sqrt, ctx->inv_two)
+	    || BN_mod_inverse(ctx->neg_b_div_a, a, prime, ctx->bnctx) == NULL
+	    || !BN_mod_mul(ctx->neg_b_div_a, ctx->neg_b_div_a, b, prime,
+			   ctx->bnctx)
+	    || !BN_sub(ctx->neg_b_div_a, prime, ctx->neg_b_div_a)
+	    || BN_mod_inverse(ctx->a_div_b, b, prime, ctx->bnctx) == NULL
+	    || !BN_mod_mul(ctx->a_div_b, ctx->a_div_b, a, prime, ctx->bnctx))
+		goto fail;
+
+	ctx->use_lanes = map_consts_init(&ctx->mc, a, b, prime,
+					 field_detect_backend()) == 0;
+	return ctx;
+
+fail:
+	es_ctx_free(ctx);
+	return NULL;
+}
+
+void es_ctx_free(struct es_ctx *ctx)
+{
+	if (ctx == NULL)
+		return;
+
+	if (ctx->use_lanes)
+		map_consts_free(&ctx->mc);
+	for (int i = 0; i < 2; i++) {
+		BN_free(ctx->uv[i]);
+		BN_free(ctx->xs[i]);
+		BN_free(ctx->ys[i]);
+		EC_POINT_free(ctx->f_uv[i]);
+	}
+	EC_POINT_free(ctx->point);
+	BN_free(ctx->minus_one);
+	BN_free(ctx->exp_sqrt);
+	BN_free(ctx->inv_two);
+	BN_free(ctx->neg_b_div_a);
+	BN_free(ctx->a_div_b);
+	BN_MONT_CTX_free(ctx->mont);
+	BN_CTX_free(ctx->bnctx);
+	free(ctx);
+}
+
+// r = -r mod prime for 0 <= r < prime
+static int es_neg(struct es_ctx *ctx, BIGNUM *r)
+{
+	return BN_is_zero(r) || BN_sub(r, ctx->prime, r);
+}
+
+// r = a^((p+1)/4), returns 1 if that is a square root of a (0 <= a < p)
+static int es_sqrt(struct es_ctx *ctx, BIGNUM *r, const BIGNUM *a)
+{
+	BN_CTX_start(ctx->bnctx);
+	BIGNUM *check = BN_CTX_get(ctx->bnctx);
+	int ret = check != NULL
+	    && BN_mod_exp_mont(r, a, ctx->exp_sqrt, ctx->prime, ctx->bnctx,
+			       ctx->mont)
+	    && BN_mod_sqr(check, r, ctx->prime, ctx->bnctx)
+	    && BN_cmp(check, a) == 0;
+	BN_CTX_end(ctx->bnctx);
+	return ret;
+}
+
+// r = x^3 + a * x + b
+static int es_g(struct es_ctx *ctx, BIGNUM *r, const BIGNUM *x)
+{
+	BN_CTX_start(ctx->bnctx);
+	BIGNUM *t = BN_CTX_get(ctx->bnctx);
+	int ret = t != NULL
+	    && BN_mod_sqr(r, x, ctx->prime, ctx->bnctx)
+	    && BN_mod_mul(r, r, x, ctx->prime, ctx->bnctx)
+	    && BN_mod_mul(t, ctx->a, x, ctx->prime, ctx->bnctx)
+	    && BN_mod_add(r, r, t, ctx->prime, ctx->bnctx)
+	    && BN_mod_add(r, r, ctx->b, ctx->prime, ctx->bnctx);
+	BN_CTX_end(ctx->bnctx);
+	return ret;
+}
+
+// f() on BN without allocations, u has to be in [0, p)
+static int es_f_bn(struct es_ctx *ctx, const BIGNUM *u, EC_POINT *out)
+{
+	BN_CTX *bnctx = ctx->bnctx;
+	BIGNUM *prime = ctx->prime;
+	int ret = -1;
+
+	if (BN_is_zero(u) || BN_is_one(u) || BN_cmp(u, ctx->minus_one) == 0)
+		return EC_POINT_set_to_infinity(ctx->group, out) ? 0 : -1;
+
+	BN_CTX_start(bnctx);
+	BIGNUM *u_square = BN_CTX_get(bnctx);
+	BIGNUM *t = BN_CTX_get(bnctx);
+	BIGNUM *x = BN_CTX_get(bnctx);
+	BIGNUM *y = BN_CTX_get(bnctx);
+	if (y == NULL)
+		goto out;
+
+	// x_0 = -(b / a) * (1 + 1 / (u^4 - u^2))
+	if (!BN_mod_sqr(u_square, u, prime, bnctx)
+	    || !BN_mod_sqr(t, u_square, prime, bnctx)
+	    || !BN_mod_sub(t, t, u_square, prime, bnctx)
+	    || BN_mod_inverse(t, t, prime, bnctx) == NULL
+	    || !BN_mod_add(t, t, BN_value_one(), prime, bnctx)
+	    || !BN_mod_mul(x, ctx->neg_b_div_a, t, prime, bnctx)
+	    || !es_g(ctx, t, x))
+		goto out;
+
+	if (!es_sqrt(ctx, y, t)) {
+		// x_1 = -u^2 * x_0 with y = -sqrt(g(x_1))
+		if (!BN_mod_mul(x, u_square, x, prime, bnctx)
+		    || !es_neg(ctx, x) || !es_g(ctx, t, x)
+		    || !es_sqrt(ctx, y, t) || !es_neg(ctx, y))
+			goto out;
+	}
+
+	if (EC_POINT_set_affine_coordinates(ctx->group, out, x, y, bnctx))
+		ret = 0;
+out:
+	BN_CTX_end(bnctx);
+	return ret;
+}
+
+// calc_v() on BN without allocations
+static int es_calc_v_bn(struct es_ctx *ctx, const EC_POINT *q, int j,
+			BIGNUM *v)
+{
+	BN_CTX *bnctx = ctx->bnctx;
+	BIGNUM *prime = ctx->prime;
+	int ret = -1;
+
+	BN_CTX_start(bnctx);
+	BIGNUM *x = BN_CTX_get(bnctx);
+	BIGNUM *y = BN_CTX_get(bnctx);
+	BIGNUM *omega = BN_CTX_get(bnctx);
+	BIGNUM *sqrt = BN_CTX_get(bnctx);
+	BIGNUM *t = BN_CTX_get(bnctx);
+	if (t == NULL
+	    || !EC_POINT_get_affine_coordinates(ctx->group, q, x, y, bnctx))
+		goto out;
+
+	// omega = (a / b) * x + 1, sqrt = +-sqrt(omega^2 - 4 * omega)
+	if (!BN_mod_mul(omega, ctx->a_div_b, x, prime, bnctx)
+	    || !BN_mod_add(omega, omega, BN_value_one(), prime, bnctx)
+	    || !BN_mod_sqr(sqrt, omega, prime, bnctx)
+	    || !BN_mod_lshift(t, omega, 2, prime, bnctx)
+	    || !BN_mod_sub(t, sqrt, t, prime, bnctx)
+	    || !es_sqrt(ctx, sqrt, t))
+		goto out;
+	if (j != 0 && j != 1 && !es_neg(ctx, sqrt))
+		goto out;
+
+	// t = (omega + sqrt) / (2 * omega) if y is a square and
+	// (omega + sqrt) / 2 otherwise
+	if (es_sqrt(ctx, t, y)) {
+		if (!BN_mod_lshift1(t, omega, prime, bnctx)
+		    || BN_mod_inverse(t, t, prime, bnctx) == NULL)
+			goto out;
+	} else if (!BN_copy(t, ctx->inv_two)) {
+		goto out;
+	}
+	if (!BN_mod_add(omega, omega, sqrt, prime, bnctx)
+	    || !BN_mod_mul(t, omega, t, prime, bnctx)
+	    || !es_sqrt(ctx, v, t))
+		goto out;
+	if (j != 0 && j != 2 && !es_neg(ctx, v))
+		goto out;
+
+	ret = 0;
+out:
+	BN_CTX_end(bnctx);
+	return ret;
+}
+
+// Maps u[0..n-1] (n <= 2, values in [0, p)) to out[0..n-1]
+static int es_map(struct es_ctx *ctx, BIGNUM **u, int n, EC_POINT **out)
+{
+	if (!ctx->use_lanes) {
+		for (int i = 0; i < n; i++)
+			if (es_f_bn(ctx, u[i], out[i]) < 0)
+				return -1;
+		return 0;
+	}
+
+	const struct field_ctx *fctx = ctx->mc.fctx;
+	fe_t u_fe, x_fe, y_fe;
+	unsigned int valid, found;
+
+	fe_load(fctx, &u_fe, u, n);
+	f_lanes(&ctx->mc, &u_fe, &x_fe, &y_fe, &valid, &found);
+	if (fe_store(fctx, ctx->xs, &x_fe, n) < 0
+	    || fe_store(fctx, ctx->ys, &y_fe, n) < 0)
+		return -1;
+
+	for (int i = 0; i < n; i++) {
+		if (!(valid & (1u << i))) {
+			if (!EC_POINT_set_to_infinity(ctx->group, out[i]))
+				return -1;
+		} else if (!(found & (1u << i))
+			   || !EC_POINT_set_affine_coordinates(ctx->group,
+							       out[i],
+							       ctx->xs[i],
+							       ctx->ys[i],
+							       ctx->bnctx)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int es_calc_v(struct es_ctx *ctx, const EC_POINT *q, int j, BIGNUM *v)
+{
+	if (!ctx->use_lanes)
+		return es_calc_v_bn(ctx, q, j, v);
+
+	const struct field_ctx *fctx = ctx->mc.fctx;
+	fe_t x_fe, y_fe, v_fe;
+	unsigned int found;
+
+	if (!EC_POINT_get_affine_coordinates(ctx->group, q, ctx->xs[0],
+					     ctx->ys[0], ctx->bnctx))
+		return -1;
+
+	fe_load(fctx, &x_fe, ctx->xs, 1);
+	fe_load(fctx, &y_fe, ctx->ys, 1);
+	calc_v_lanes(&ctx->mc, &x_fe, &y_fe, j != 0 && j != 1,
+		     j != 0 && j != 2, &v_fe, &found);
+	if (!(found & 1))
+		return -1;
+	return fe_store(fctx, &v, &v_fe, 1);
+}
+
+int es_encode_bytes(const uint8_t point[ES_BYTES], uint8_t out_uv[ES_BYTES],
+		    struct es_ctx *ctx)
+{
+	if (ctx == NULL || point == NULL || out_uv == NULL)
+		return -1;
+
+	BIGNUM *u = ctx->uv[0];
+	BIGNUM *v = ctx->uv[1];
+
+	if (BN_bin2bn(point, ES_COORD_BYTES, ctx->xs[0]) == NULL
+	    || BN_bin2bn(point + ES_COORD_BYTES, ES_COORD_BYTES,
+			 ctx->ys[0]) == NULL
+	    || !EC_POINT_set_affine_coordinates(ctx->group, ctx->point,
+						ctx->xs[0], ctx->ys[0],
+						ctx->bnctx))
+		return -1;
+
+	for (int i = 0; i < 1000; i++) {
+		if (!rng_range(u, ctx->prime))
+			return -1;
+		if (BN_is_zero(u) || BN_is_one(u)
+		    || BN_cmp(u, ctx->minus_one) == 0)
+			continue;
+
+		// f_uv[1] = point - f(u)
+		if (es_map(ctx, &u, 1, ctx->f_uv) < 0)
+			continue;
+		if (!EC_POINT_invert(ctx->group, ctx->f_uv[0], ctx->bnctx)
+		    || !EC_POINT_add(ctx->group, ctx->f_uv[1], ctx->point,
+				     ctx->f_uv[0], ctx->bnctx))
+			return -1;
+		if (EC_POINT_is_at_infinity(ctx->group, ctx->f_uv[1]))
+			continue;
+
+		int j = generate_j();
+		if (j < 0)
+			return -1;
+		if (es_calc_v(ctx, ctx->f_uv[1], j, v) < 0)
+			continue;
+
+		if (BN_bn2binpad(u, out_uv, ES_COORD_BYTES) < 0
+		    || BN_bn2binpad(v, out_uv + ES_COORD_BYTES,
+				    ES_COORD_BYTES) < 0)
+			return -1;
+		return 0;
+	}
+
+#ifdef DEBUG_PRINTS
+	fprintf(stderr, "ERROR: Could not encode point\n");
+#endif
+	return -1;
+}
+
+int es_decode_bytes(const uint8_t uv[ES_BYTES], uint8_t point[ES_BYTES],
+		    struct es_ctx *ctx)
+{
+	if (ctx == NULL || uv == NULL || point == NULL)
+		return -1;
+
+	for (int i = 0; i < 2; i++) {
+		if (BN_bin2bn(uv + i * ES_COORD_BYTES, ES_COORD_BYTES,
+			      ctx->uv[i]) == NULL
+		    || BN_cmp(ctx->uv[i], ctx->prime) >= 0)
+			return -1;
+	}
+
+	if (es_map(ctx, ctx->uv, 2, ctx->f_uv) < 0
+	    || !EC_POINT_add(ctx->group, ctx->point, ctx->f_uv[0],
+			     ctx->f_uv[1], ctx->bnctx)
+	    || !EC_POINT_get_affine_coordinates(ctx->group, ctx->point,
+						ctx->xs[0], ctx->ys[0],
+						ctx->bnctx)
+	    || BN_bn2binpad(ctx->xs[0], point, ES_COORD_BYTES) < 0
+	    || BN_bn2binpad(ctx->ys[0], point + ES_COORD_BYTES,
+			    ES_COORD_BYTES) < 0)
+		return -1;
+	return 0;
+}
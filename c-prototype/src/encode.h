@@ -1,5 +1,6 @@
 #include <openssl/ec.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #pragma once
 
@@ -28,6 +29,45 @@ extern "C" {
 	EC_POINT *es_decode(BIGNUM ** encoded_point, EC_GROUP * group,
 			    BIGNUM * a, BIGNUM * b, BIGNUM * p);
 
+	// Batched versions that evaluate the map for many independent values
+	// at once on the lanes of the field backend (see field.h). Entries of
+	// the output arrays are NULL where the scalar function returns NULL.
+	int f_batch(BIGNUM ** u, EC_POINT ** out, int n, EC_GROUP * group,
+		    BIGNUM * a, BIGNUM * b, BIGNUM * prime);
+
+	int calc_v_batch(EC_POINT ** q, const int *j, BIGNUM ** out, int n,
+			 EC_GROUP * group, BIGNUM * a, BIGNUM * b,
+			 BIGNUM * prime);
+
+	// Encodes all points, writing the pairs into u_values and v_values.
+	// Returns 0 on success and -1 if any point could not be encoded.
+	int es_encode_batch(EC_POINT ** points, int n, BIGNUM ** u_values,
+			    BIGNUM ** v_values, EC_GROUP * group, BIGNUM * a,
+			    BIGNUM * b, BIGNUM * prime);
+
+#define ES_COORD_BYTES 32
+#define ES_BYTES (2 * ES_COORD_BYTES)
+
+	// Context of the byte oriented API below. It keeps the constants of
+	// the map and all scratch values, so that encoding and decoding do not
+	// allocate once it is warmed up. group, a, b and prime are borrowed
+	// and have to outlive the context. A context is not thread safe.
+	struct es_ctx;
+
+	struct es_ctx *es_ctx_new(EC_GROUP * group, BIGNUM * a, BIGNUM * b,
+				  BIGNUM * prime);
+
+	void es_ctx_free(struct es_ctx *ctx);
+
+	// Encodes the point x || y into u || v, every value being big-endian
+	// and ES_COORD_BYTES long. Returns 0 on success and -1 otherwise.
+	int es_encode_bytes(const uint8_t point[ES_BYTES],
+			    uint8_t out_uv[ES_BYTES], struct es_ctx *ctx);
+
+	// Inverse of es_encode_bytes, u and v have to be smaller than prime
+	int es_decode_bytes(const uint8_t uv[ES_BYTES],
+			    uint8_t point[ES_BYTES], struct es_ctx *ctx);
+
 #ifdef __cplusplus
 }
 #endif
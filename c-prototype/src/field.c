@@ -0,0 +1,633 @@
+#include "field.h"
+
+// The lane kernels rely on the intrinsics being inlined and the limb loops
+// being unrolled, which does not happen in the unoptimized default build
+#if defined(__GNUC__) && !defined(__clang__) && !defined(__OPTIMIZE__)
+#pragma GCC optimize("O3")
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FIELD_X86
+#endif
+
+#define FIELD_MAX_LIMBS 10
+#define FIELD_BYTES 40
+
+// Both limb layouts span R = 2^260, which leaves room for the lazily
+// reduced values (< 2p) produced by the Montgomery multiplication.
+#define RADIX26_BITS 26
+#define RADIX26_LIMBS 10
+#define RADIX52_BITS 52
+#define RADIX52_LIMBS 5
+#define MONT_R_BITS 260
+
+struct field_ctx {
+	enum field_backend backend;
+	int lanes;
+	int limb_bits;
+	int num_limbs;
+	uint64_t limb_mask;
+	uint64_t p[FIELD_MAX_LIMBS];
+	uint64_t pinv;
+	fe_t r2;
+	fe_t one;
+	fe_t plain_one;
+	BIGNUM *prime;
+	BIGNUM *exp_inv;
+	BIGNUM *exp_sqrt;
+	void (*mul)(const struct field_ctx *fctx, fe_t * r, const fe_t * a,
+		    const fe_t * b);
+};
+
+static inline uint64_t *limb_at(fe_t *a, const struct field_ctx *fctx,
+				int k, int lane)
+{
+	return &a->v[k * fctx->lanes + lane];
+}
+
+static inline uint64_t limb_get(const fe_t *a, const struct field_ctx *fctx,
+				int k, int lane)
+{
+	return a->v[k * fctx->lanes + lane];
+}
+
+// Montgomery multiplication with 26-bit limbs, one lane at a time
+static void mul_scalar(const struct field_ctx *fctx, fe_t *r, const fe_t *a,
+		       const fe_t *b)
+{
+	const uint64_t mask = fctx->limb_mask;
+
+	for (int l = 0; l < fctx->lanes; l++) {
+		uint64_t t[RADIX26_LIMBS] = { 0 };
+
+		for (int i = 0; i < RADIX26_LIMBS; i++) {
+			uint64_t ai = limb_get(a, fctx, i, l);
+			for (int j = 0; j < RADIX26_LIMBS; j++)
+				t[j] += ai * limb_get(b, fctx, j, l);
+
+			uint64_t m = ((t[0] & mask) * fctx->pinv) & mask;
+			for (int j = 0; j < RADIX26_LIMBS; j++)
+				t[j] += m * fctx->p[j];
+
+			uint64_t carry = t[0] >> RADIX26_BITS;
+			for (int j = 0; j < RADIX26_LIMBS - 1; j++)
+				t[j] = t[j + 1];
+			t[RADIX26_LIMBS - 1] = 0;
+			t[0] += carry;
+		}
+
+		for (int j = 0; j < RADIX26_LIMBS - 1; j++) {
+			t[j + 1] += t[j] >> RADIX26_BITS;
+			t[j] &= mask;
+		}
+
+		for (int j = 0; j < RADIX26_LIMBS; j++)
+			*limb_at(r, fctx, j, l) = t[j];
+	}
+}
+
+#ifdef FIELD_X86
+// Same algorithm as mul_scalar on four lanes at once
+__attribute__((target("avx2")))
+static void mul_avx2(const struct field_ctx *fctx, fe_t *r, const fe_t *a,
+		     const fe_t *b)
+{
+	const __m256i mask = _mm256_set1_epi64x(fctx->limb_mask);
+	const __m256i pinv = _mm256_set1_epi64x(fctx->pinv);
+	__m256i t[RADIX26_LIMBS], bv[RADIX26_LIMBS], pv[RADIX26_LIMBS];
+
+	for (int j = 0; j < RADIX26_LIMBS; j++) {
+		bv[j] = _mm256_load_si256((const __m256i *)&b->v[j * 4]);
+		pv[j] = _mm256_set1_epi64x(fctx->p[j]);
+		t[j] = _mm256_setzero_si256();
+	}
+
+	for (int i = 0; i < RADIX26_LIMBS; i++) {
+		__m256i ai = _mm256_load_si256((const __m256i *)&a->v[i * 4]);
+		for (int j = 0; j < RADIX26_LIMBS; j++)
+			t[j] = _mm256_add_epi64(t[j],
+						_mm256_mul_epu32(ai, bv[j]));
+
+		__m256i m = _mm256_and_si256(t[0], mask);
+		m = _mm256_and_si256(_mm256_mul_epu32(m, pinv), mask);
+		for (int j = 0; j < RADIX26_LIMBS; j++)
+			t[j] = _mm256_add_epi64(t[j],
+						_mm256_mul_epu32(m, pv[j]));
+
+		__m256i carry = _mm256_srli_epi64(t[0], RADIX26_BITS);
+		for (int j = 0; j < RADIX26_LIMBS - 1; j++)
+			t[j] = t[j + 1];
+		t[RADIX26_LIMBS - 1] = _mm256_setzero_si256();
+		t[0] = _mm256_add_epi64(t[0], carry);
+	}
+
+	for (int j = 0; j < RADIX26_LIMBS - 1; j++) {
+		t[j + 1] = _mm256_add_epi64(t[j + 1],
+					    _mm256_srli_epi64(t[j],
+							      RADIX26_BITS));
+		t[j] = _mm256_and_si256(t[j], mask);
+	}
+
+	for (int j = 0; j < RADIX26_LIMBS; j++)
+		_mm256_store_si256((__m256i *)&r->v[j * 4], t[j]);
+}
+
+// Montgomery multiplication with 52-bit limbs on eight lanes, using the
+// 52-bit multiply-accumulate instructions of AVX-512 IFMA
+__attribute__((target("avx512f,avx512ifma")))
+static void mul_avx512ifma(const struct field_ctx *fctx, fe_t *r,
+			   const fe_t *a, const fe_t *b)
+{
+	const __m512i zero = _mm512_setzero_si512();
+	const __m512i mask = _mm512_set1_epi64(fctx->limb_mask);
+	const __m512i pinv = _mm512_set1_epi64(fctx->pinv);
+	__m512i t[RADIX52_LIMBS + 1], bv[RADIX52_LIMBS], pv[RADIX52_LIMBS];
+
+	for (int j = 0; j < RADIX52_LIMBS; j++) {
+		bv[j] = _mm512_load_si512((const void *)&b->v[j * 8]);
+		pv[j] = _mm512_set1_epi64(fctx->p[j]);
+	}
+	for (int j = 0; j <= RADIX52_LIMBS; j++)
+		t[j] = zero;
+
+	for (int i = 0; i < RADIX52_LIMBS; i++) {
+		__m512i ai = _mm512_load_si512((const void *)&a->v[i * 8]);
+		for (int j = 0; j < RADIX52_LIMBS; j++) {
+			t[j] = _mm512_madd52lo_epu64(t[j], ai, bv[j]);
+			t[j + 1] = _mm512_madd52hi_epu64(t[j + 1], ai, bv[j]);
+		}
+
+		__m512i m = _mm512_madd52lo_epu64(zero, t[0], pinv);
+		for (int j = 0; j < RADIX52_LIMBS; j++) {
+			t[j] = _mm512_madd52lo_epu64(t[j], m, pv[j]);
+			t[j + 1] = _mm512_madd52hi_epu64(t[j + 1], m, pv[j]);
+		}
+
+		__m512i carry = _mm512_srli_epi64(t[0], RADIX52_BITS);
+		for (int j = 0; j < RADIX52_LIMBS; j++)
+			t[j] = t[j + 1];
+		t[RADIX52_LIMBS] = zero;
+		t[0] = _mm512_add_epi64(t[0], carry);
+	}
+
+	for (int j = 0; j < RADIX52_LIMBS - 1; j++) {
+		t[j + 1] = _mm512_add_epi64(t[j + 1],
+					    _mm512_srli_epi64(t[j],
+							      RADIX52_BITS));
+		t[j] = _mm512_and_si512(t[j], mask);
+	}
+
+	for (int j = 0; j < RADIX52_LIMBS; j++)
+		_mm512_store_si512((void *)&r->v[j * 8], t[j]);
+}
+#endif
+
+int field_backend_supported(enum field_backend backend)
+{
+	switch (backend) {
+	case FIELD_BACKEND_SCALAR:
+		return 1;
+#ifdef FIELD_X86
+	case FIELD_BACKEND_AVX2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+	case FIELD_BACKEND_AVX512IFMA:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx512f")
+		    && __builtin_cpu_supports("avx512ifma");
+#endif
+	default:
+		return 0;
+	}
+}
+
+const char *field_backend_name(enum field_backend backend)
+{
+	switch (backend) {
+	case FIELD_BACKEND_SCALAR:
+		return "scalar";
+	case FIELD_BACKEND_AVX2:
+		return "avx2";
+	case FIELD_BACKEND_AVX512IFMA:
+		return "avx512ifma";
+	}
+	return "unknown";
+}
+
+enum field_backend field_detect_backend(void)
+{
+	const char *forced = getenv("DECOYAUTH_FIELD_BACKEND");
+	if (forced != NULL) {
+		for (int b = FIELD_BACKEND_SCALAR; b <= FIELD_BACKEND_AVX512IFMA;
+		     b++) {
+			if (strcasecmp(forced, field_backend_name(b)) == 0
+			    && field_backend_supported(b))
+				return b;
+		}
+	}
+
+	if (field_backend_supported(FIELD_BACKEND_AVX512IFMA))
+		return FIELD_BACKEND_AVX512IFMA;
+	if (field_backend_supported(FIELD_BACKEND_AVX2))
+		return FIELD_BACKEND_AVX2;
+	return FIELD_BACKEND_SCALAR;
+}
+
+static void bytes_to_limbs(const struct field_ctx *fctx, const uint8_t *le,
+			   uint64_t *limbs)
+{
+	for (int k = 0; k < fctx->num_limbs; k++) {
+		int off = k * fctx->limb_bits;
+		uint64_t w = 0;
+		for (int i = 7; i >= 0; i--)
+			w = (w << 8) | le[off / 8 + i];
+		limbs[k] = (w >> (off % 8)) & fctx->limb_mask;
+	}
+}
+
+static void limbs_to_bytes(const struct field_ctx *fctx,
+			   const uint64_t *limbs, uint8_t *le)
+{
+	memset(le, 0, FIELD_BYTES);
+	for (int k = 0; k < fctx->num_limbs; k++) {
+		int off = k * fctx->limb_bits;
+		uint64_t w = limbs[k] << (off % 8);
+		for (int i = 0; i < 8 && off / 8 + i < FIELD_BYTES; i++)
+			le[off / 8 + i] |= (uint8_t) (w >> (8 * i));
+	}
+}
+
+// Writes the plain limbs of a (0 <= a < p) into every lane of r
+static void fe_set_plain(const struct field_ctx *fctx, fe_t *r,
+			 const BIGNUM *a)
+{
+	uint8_t le[FIELD_BYTES] = { 0 };
+	uint64_t limbs[FIELD_MAX_LIMBS];
+
+	BN_bn2lebinpad(a, le, FIELD_BYTES);
+	bytes_to_limbs(fctx, le, limbs);
+
+	memset(r, 0, sizeof(*r));
+	for (int k = 0; k < fctx->num_limbs; k++)
+		for (int l = 0; l < fctx->lanes; l++)
+			*limb_at(r, fctx, k, l) = limbs[k];
+}
+
+// Brings a lane from [0, 2p) into [0, p)
+static void reduce_lane(const struct field_ctx *fctx, fe_t *a, int lane)
+{
+	uint64_t d[FIELD_MAX_LIMBS];
+	int64_t borrow = 0;
+
+	for (int k = 0; k < fctx->num_limbs; k++) {
+		int64_t x = (int64_t) limb_get(a, fctx, k, lane)
+		    - (int64_t) fctx->p[k] + borrow;
+		d[k] = (uint64_t) x & fctx->limb_mask;
+		borrow = x >> fctx->limb_bits;
+	}
+
+	if (borrow == 0) {
+		for (int k = 0; k < fctx->num_limbs; k++)
+			*limb_at(a, fctx, k, lane) = d[k];
+	}
+}
+
+static void reduce(const struct field_ctx *fctx, fe_t *a)
+{
+	for (int l = 0; l < fctx->lanes; l++)
+		reduce_lane(fctx, a, l);
+}
+
+struct field_ctx *field_ctx_new_backend(const BIGNUM *prime,
+					enum field_backend backend)
+{
+	if (prime == NULL || BN_is_negative(prime) || BN_num_bits(prime) > 256
+	    || !BN_is_bit_set(prime, 0) || !BN_is_bit_set(prime, 1))
+		return NULL;
+
+	if (!field_backend_supported(backend))
+		return NULL;
+
+	struct field_ctx *fctx = NULL;
+	if (posix_memalign((void **)&fctx, 64, sizeof(*fctx)) != 0)
+		return NULL;
+	memset(fctx, 0, sizeof(*fctx));
+
+	fctx->backend = backend;
+	switch (backend) {
+#ifdef FIELD_X86
+	case FIELD_BACKEND_AVX512IFMA:
+		fctx->lanes = 8;
+		fctx->limb_bits = RADIX52_BITS;
+		fctx->num_limbs = RADIX52_LIMBS;
+		fctx->mul = mul_avx512ifma;
+		break;
+	case FIELD_BACKEND_AVX2:
+		fctx->lanes = 4;
+		fctx->limb_bits = RADIX26_BITS;
+		fctx->num_limbs = RADIX26_LIMBS;
+		fctx->mul = mul_avx2;
+		break;
+#endif
+	default:
+		fctx->lanes = 4;
+		fctx->limb_bits = RADIX26_BITS;
+		fctx->num_limbs = RADIX26_LIMBS;
+		fctx->mul = mul_scalar;
+		break;
+	}
+	fctx->limb_mask = (1ULL << fctx->limb_bits) - 1;
+
+	uint8_t le[FIELD_BYTES] = { 0 };
+	BN_bn2lebinpad(prime, le, FIELD_BYTES);
+	bytes_to_limbs(fctx, le, fctx->p);
+
+	// -p^-1 mod 2^limb_bits through Newton iteration on the lowest word
+	uint64_t p0 = 0;
+	for (int i = 7; i >= 0; i--)
+		p0 = (p0 << 8) | le[i];
+	uint64_t inv = p0;
+	for (int i = 0; i < 5; i++)
+		inv *= 2 - p0 * inv;
+	fctx->pinv = (0 - inv) & fctx->limb_mask;
+
+	BN_CTX *ctx = BN_CTX_new();
+	BIGNUM *tmp = BN_new();
+	fctx->prime = BN_dup(prime);
+	fctx->exp_inv = BN_dup(prime);
+	fctx->exp_sqrt = BN_dup(prime);
+	if (ctx == NULL || tmp == NULL || fctx->prime == NULL
+	    || fctx->exp_inv == NULL || fctx->exp_sqrt == NULL)
+		goto fail;
+
+	BN_sub_word(fctx->exp_inv, 2);
+	BN_add_word(fctx->exp_sqrt, 1);
+	BN_rshift(fctx->exp_sqrt, fctx->exp_sqrt, 2);
+
+	BN_one(tmp);
+	BN_lshift(tmp, tmp, 2 * MONT_R_BITS);
+	BN_mod(tmp, tmp, prime, ctx);
+	fe_set_plain(fctx, &fctx->r2, tmp);
+
+	BN_one(tmp);
+	BN_lshift(tmp, tmp, MONT_R_BITS);
+	BN_mod(tmp, tmp, prime, ctx);
+	fe_set_plain(fctx, &fctx->one, tmp);
+
+	BN_one(tmp);
+	fe_set_plain(fctx, &fctx->plain_one, tmp);
+
+	BN_free(tmp);
+	BN_CTX_free(ctx);
+	return fctx;
+
+fail:
+	BN_free(tmp);
+	BN_CTX_free(ctx);
+	field_ctx_free(fctx);
+	return NULL;
+}
+
+struct field_ctx *field_ctx_new(const BIGNUM *prime)
+{
+	return field_ctx_new_backend(prime, field_detect_backend());
+}
+
+void field_ctx_free(struct field_ctx *fctx)
+{
+	if (fctx == NULL)
+		return;
+	BN_free(fctx->prime);
+	BN_free(fctx->exp_inv);
+	BN_free(fctx->exp_sqrt);
+	free(fctx);
+}
+
+enum field_backend field_ctx_backend(const struct field_ctx *fctx)
+{
+	return fctx->backend;
+}
+
+int field_lanes(const struct field_ctx *fctx)
+{
+	return fctx->lanes;
+}
+
+void fe_load(const struct field_ctx *fctx, fe_t *r, BIGNUM *const *a, int n)
+{
+	uint8_t le[FIELD_BYTES];
+	uint64_t limbs[FIELD_MAX_LIMBS];
+	fe_t plain;
+	BIGNUM *reduced = NULL;
+
+	memset(&plain, 0, sizeof(plain));
+	for (int l = 0; l < n && l < fctx->lanes; l++) {
+		const BIGNUM *val = a[l];
+
+		if (BN_is_negative(val) || BN_ucmp(val, fctx->prime) >= 0) {
+			BN_CTX *ctx = BN_CTX_new();
+			if (reduced == NULL)
+				reduced = BN_new();
+			BN_nnmod(reduced, val, fctx->prime, ctx);
+			BN_CTX_free(ctx);
+			val = reduced;
+		}
+
+		memset(le, 0, sizeof(le));
+		BN_bn2lebinpad(val, le, FIELD_BYTES);
+		bytes_to_limbs(fctx, le, limbs);
+		for (int k = 0; k < fctx->num_limbs; k++)
+			*limb_at(&plain, fctx, k, l) = limbs[k];
+	}
+	BN_free(reduced);
+
+	fctx->mul(fctx, r, &plain, &fctx->r2);
+	reduce(fctx, r);
+}
+
+void fe_set(const struct field_ctx *fctx, fe_t *r, const BIGNUM *a)
+{
+	BIGNUM *val = (BIGNUM *) a;
+	BIGNUM *reduced = NULL;
+
+	if (BN_is_negative(a) || BN_ucmp(a, fctx->prime) >= 0) {
+		BN_CTX *ctx = BN_CTX_new();
+		reduced = BN_new();
+		BN_nnmod(reduced, a, fctx->prime, ctx);
+		BN_CTX_free(ctx);
+		val = reduced;
+	}
+
+	fe_t plain;
+	fe_set_plain(fctx, &plain, val);
+	BN_free(reduced);
+
+	fctx->mul(fctx, r, &plain, &fctx->r2);
+	reduce(fctx, r);
+}
+
+int fe_store(const struct field_ctx *fctx, BIGNUM **r, const fe_t *a, int n)
+{
+	uint8_t le[FIELD_BYTES];
+	uint64_t limbs[FIELD_MAX_LIMBS];
+	fe_t plain;
+
+	fctx->mul(fctx, &plain, a, &fctx->plain_one);
+	reduce(fctx, &plain);
+
+	for (int l = 0; l < n && l < fctx->lanes; l++) {
+		for (int k = 0; k < fctx->num_limbs; k++)
+			limbs[k] = limb_get(&plain, fctx, k, l);
+		limbs_to_bytes(fctx, limbs, le);
+		if (BN_lebin2bn(le, FIELD_BYTES, r[l]) == NULL)
+			return -1;
+	}
+	return 0;
+}
+
+void fe_mul(const struct field_ctx *fctx, fe_t *r, const fe_t *a,
+	    const fe_t *b)
+{
+	fctx->mul(fctx, r, a, b);
+	reduce(fctx, r);
+}
+
+void fe_sqr(const struct field_ctx *fctx, fe_t *r, const fe_t *a)
+{
+	fctx->mul(fctx, r, a, a);
+	reduce(fctx, r);
+}
+
+void fe_add(const struct field_ctx *fctx, fe_t *r, const fe_t *a,
+	    const fe_t *b)
+{
+	for (int l = 0; l < fctx->lanes; l++) {
+		uint64_t carry = 0;
+		for (int k = 0; k < fctx->num_limbs; k++) {
+			uint64_t x = limb_get(a, fctx, k, l)
+			    + limb_get(b, fctx, k, l) + carry;
+			if (k == fctx->num_limbs - 1) {
+				*limb_at(r, fctx, k, l) = x;
+			} else {
+				*limb_at(r, fctx, k, l) = x & fctx->limb_mask;
+				carry = x >> fctx->limb_bits;
+			}
+		}
+		reduce_lane(fctx, r, l);
+	}
+}
+
+void fe_sub(const struct field_ctx *fctx, fe_t *r, const fe_t *a,
+	    const fe_t *b)
+{
+	// a - b + p lies in (0, 2p) for canonical inputs
+	for (int l = 0; l < fctx->lanes; l++) {
+		int64_t borrow = 0;
+		for (int k = 0; k < fctx->num_limbs; k++) {
+			int64_t x = (int64_t) limb_get(a, fctx, k, l)
+			    - (int64_t) limb_get(b, fctx, k, l)
+			    + (int64_t) fctx->p[k] + borrow;
+			if (k == fctx->num_limbs - 1) {
+				*limb_at(r, fctx, k, l) = (uint64_t) x;
+			} else {
+				*limb_at(r, fctx, k, l) =
+				    (uint64_t) x & fctx->limb_mask;
+				borrow = x >> fctx->limb_bits;
+			}
+		}
+		reduce_lane(fctx, r, l);
+	}
+}
+
+void fe_neg(const struct field_ctx *fctx, fe_t *r, const fe_t *a)
+{
+	fe_t zero;
+	memset(&zero, 0, sizeof(zero));
+	fe_sub(fctx, r, &zero, a);
+}
+
+// Fixed 4-bit window exponentiation by a public exponent. The intermediate
+// values stay below 2p, only the result is fully reduced.
+static void fe_exp(const struct field_ctx *fctx, fe_t *r, const fe_t *a,
+		   const BIGNUM *e)
+{
+	fe_t table[16];
+	fe_t acc;
+
+	table[0] = fctx->one;
+	table[1] = *a;
+	for (int i = 2; i < 16; i++)
+		fctx->mul(fctx, &table[i], &table[i - 1], a);
+
+	acc = fctx->one;
+	int top = (BN_num_bits(e) + 3) / 4 * 4;
+	for (int i = top - 4; i >= 0; i -= 4) {
+		if (i != top - 4) {
+			for (int s = 0; s < 4; s++)
+				fctx->mul(fctx, &acc, &acc, &acc);
+		}
+
+		int nibble = (BN_is_bit_set(e, i + 3) << 3)
+		    | (BN_is_bit_set(e, i + 2) << 2)
+		    | (BN_is_bit_set(e, i + 1) << 1)
+		    | BN_is_bit_set(e, i);
+		if (nibble)
+			fctx->mul(fctx, &acc, &acc, &table[nibble]);
+	}
+
+	reduce(fctx, &acc);
+	*r = acc;
+}
+
+void fe_inv(const struct field_ctx *fctx, fe_t *r, const fe_t *a)
+{
+	fe_exp(fctx, r, a, fctx->exp_inv);
+}
+
+unsigned int fe_sqrt(const struct field_ctx *fctx, fe_t *r, const fe_t *a)
+{
+	fe_t root, check;
+
+	fe_exp(fctx, &root, a, fctx->exp_sqrt);
+	fe_sqr(fctx, &check, &root);
+	unsigned int mask = fe_eq(fctx, &check, a);
+	*r = root;
+	return mask;
+}
+
+unsigned int fe_eq(const struct field_ctx *fctx, const fe_t *a,
+		   const fe_t *b)
+{
+	unsigned int mask = 0;
+	for (int l = 0; l < fctx->lanes; l++) {
+		uint64_t diff = 0;
+		for (int k = 0; k < fctx->num_limbs; k++)
+			diff |= limb_get(a, fctx, k, l) ^ limb_get(b, fctx, k,
+								    l);
+		if (diff == 0)
+			mask |= 1u << l;
+	}
+	return mask;
+}
+
+unsigned int fe_is_zero(const struct field_ctx *fctx, const fe_t *a)
+{
+	fe_t zero;
+	memset(&zero, 0, sizeof(zero));
+	return fe_eq(fctx, a, &zero);
+}
+
+void fe_select(const struct field_ctx *fctx, fe_t *r, unsigned int mask,
+	       const fe_t *a, const fe_t *b)
+{
+	for (int l = 0; l < fctx->lanes; l++) {
+		const fe_t *src = (mask & (1u << l)) ? a : b;
+		for (int k = 0; k < fctx->num_limbs; k++)
+			*limb_at(r, fctx, k, l) = limb_get(src, fctx, k, l);
+	}
+}
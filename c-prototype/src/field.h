@@ -0,0 +1,95 @@
+#include <openssl/bn.h>
+#include <stdint.h>
+
+#pragma once
+
+#ifndef FIELD_H
+#define FIELD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lane-parallel arithmetic modulo a prime p of at most 256 bits with
+// p = 3 mod 4 (this covers P-256). Every element of type fe_t holds
+// field_lanes() independent values in the Montgomery domain, so one call
+// performs the same operation on all lanes at once.
+
+#define FIELD_MAX_WORDS 40
+
+	enum field_backend {
+		FIELD_BACKEND_SCALAR,
+		FIELD_BACKEND_AVX2,
+		FIELD_BACKEND_AVX512IFMA,
+	};
+
+	typedef struct {
+		uint64_t v[FIELD_MAX_WORDS];
+	} __attribute__((aligned(64))) fe_t;
+
+	struct field_ctx;
+
+	// Fastest backend supported by this CPU. The choice can be overridden
+	// with DECOYAUTH_FIELD_BACKEND=scalar|avx2|avx512ifma.
+	enum field_backend field_detect_backend(void);
+
+	int field_backend_supported(enum field_backend backend);
+
+	const char *field_backend_name(enum field_backend backend);
+
+	// Returns NULL if the prime is not supported by the lane backends.
+	struct field_ctx *field_ctx_new(const BIGNUM * prime);
+
+	struct field_ctx *field_ctx_new_backend(const BIGNUM * prime,
+						enum field_backend backend);
+
+	void field_ctx_free(struct field_ctx *fctx);
+
+	enum field_backend field_ctx_backend(const struct field_ctx *fctx);
+
+	int field_lanes(const struct field_ctx *fctx);
+
+	// Loads a[0..n-1] into the first n lanes, the other lanes become zero
+	void fe_load(const struct field_ctx *fctx, fe_t * r, BIGNUM * const *a,
+		     int n);
+
+	void fe_set(const struct field_ctx *fctx, fe_t * r, const BIGNUM * a);
+
+	// Stores the first n lanes into the caller allocated r[0..n-1]
+	int fe_store(const struct field_ctx *fctx, BIGNUM ** r, const fe_t * a,
+		     int n);
+
+	void fe_mul(const struct field_ctx *fctx, fe_t * r, const fe_t * a,
+		    const fe_t * b);
+
+	void fe_sqr(const struct field_ctx *fctx, fe_t * r, const fe_t * a);
+
+	void fe_add(const struct field_ctx *fctx, fe_t * r, const fe_t * a,
+		    const fe_t * b);
+
+	void fe_sub(const struct field_ctx *fctx, fe_t * r, const fe_t * a,
+		    const fe_t * b);
+
+	void fe_neg(const struct field_ctx *fctx, fe_t * r, const fe_t * a);
+
+	// Inverse through Fermat's little theorem, zero maps to zero.
+	void fe_inv(const struct field_ctx *fctx, fe_t * r, const fe_t * a);
+
+	// Computes a^((p+1)/4) like BN_mod_sqrt does for p = 3 mod 4 and
+	// returns a bitmask of the lanes where this actually is a square root.
+	unsigned int fe_sqrt(const struct field_ctx *fctx, fe_t * r,
+			     const fe_t * a);
+
+	unsigned int fe_eq(const struct field_ctx *fctx, const fe_t * a,
+			   const fe_t * b);
+
+	unsigned int fe_is_zero(const struct field_ctx *fctx, const fe_t * a);
+
+	// r = lanes set in mask taken from a, the others from b
+	void fe_select(const struct field_ctx *fctx, fe_t * r,
+		       unsigned int mask, const fe_t * a, const fe_t * b);
+
+#ifdef __cplusplus
+}
+#endif
+#endif				// FIELD_H
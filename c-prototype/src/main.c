@@ -31,6 +31,7 @@ int measure_operations(int num_points, int num_iterations, int num_warmup)
 {
 	EC_GROUP *group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
 	BN_CTX *ctx = BN_CTX_new();
+	int ret = -1;
 
 	char filename[256] = { 0 };
 #ifdef CONFIG_PRECOMPUTE
@@ -82,20 +83,27 @@ int measure_operations(int num_points, int num_iterations, int num_warmup)
 		struct timespec start_time, end_time;
 		double time_spent;
 
-		for (int j = 0; j < num_warmup; j++)
-			es_encode(points[0], group, a, b, prime);
+		for (int j = 0; j < num_warmup; j++) {
+			BIGNUM **warmup = es_encode(points[0], group, a, b,
+						    prime);
+			if (warmup != NULL) {
+				BN_free(warmup[0]);
+				BN_free(warmup[1]);
+				free(warmup);
+			}
+		}
 
 		// Encoding         (FOR ALL POINTS)
 		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start_time);
 		for (int x = 0; x < scaling_correction; x++) {
-			for (int j = 0; j < num_points; j++) {
-				BIGNUM **pair =
-				    es_encode(points[j], group, a, b,
-					      prime);
-				u_values[j] = pair[0];
-				v_values[j] = pair[1];
-				free(pair);
-			}
+			// Only the values of the last round are kept
+			if (x > 0)
+				for (int j = 0; j < num_points; j++) {
+					BN_free(u_values[j]);
+					BN_free(v_values[j]);
+				}
+			es_encode_batch(points, num_points, u_values,
+					v_values, group, a, b, prime);
 		}
 		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end_time);
 		time_spent = elapsed_ns(start_time, end_time);
@@ -154,10 +162,12 @@ int measure_operations(int num_points, int num_iterations, int num_warmup)
 
 		// Decoding         (FOR ONE POINT)
 		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start_time);
-		EC_POINT *recovered_point;
-		for (int x = 0; x < MAX_NUM_POINTS; x++)
+		EC_POINT *recovered_point = NULL;
+		for (int x = 0; x < MAX_NUM_POINTS; x++) {
+			EC_POINT_free(recovered_point);
 			recovered_point =
 			    es_decode(pair, group, a, b, prime);
+		}
 		BN_free(pair[0]);
 		BN_free(pair[1]);
 		free(pair);
@@ -189,6 +199,7 @@ int measure_operations(int num_points, int num_iterations, int num_warmup)
 
 		free(pairs);
 	}
+	ret = 0;
 
 	BN_free(a);
 	BN_free(b);
@@ -200,6 +211,7 @@ int measure_operations(int num_points, int num_iterations, int num_warmup)
 return_free_group_ctx:
 	EC_GROUP_free(group);
 	BN_CTX_free(ctx);
+	return ret;
 }
 
 int generate_encoded_points()
@@ -223,21 +235,29 @@ int generate_encoded_points()
 
 	printf("Encoding points in points.txt and saving them to encoded_points.txt ...\n");
 
-	for (int i = 0; i < 10000; i++) {
-		BIGNUM **pair = es_encode(points[i], group, a, b, prime);
+	BIGNUM **u_values = (BIGNUM **) malloc(10000 * sizeof(BIGNUM *));
+	BIGNUM **v_values = (BIGNUM **) malloc(10000 * sizeof(BIGNUM *));
+	if (es_encode_batch(points, 10000, u_values, v_values, group, a, b,
+			    prime) < 0) {
+		printf("Error encoding points\n");
+		fclose(fp);
+		return 1;
+	}
 
-		char *u_str = BN_bn2dec(pair[0]);
-		char *v_str = BN_bn2dec(pair[1]);
+	for (int i = 0; i < 10000; i++) {
+		char *u_str = BN_bn2dec(u_values[i]);
+		char *v_str = BN_bn2dec(v_values[i]);
 
 		fprintf(fp, "%s\n", u_str);
 		fprintf(fp, "%s\n", v_str);
 
 		OPENSSL_free(u_str);
 		OPENSSL_free(v_str);
-		BN_free(pair[0]);
-		BN_free(pair[1]);
-		free(pair);
+		BN_free(u_values[i]);
+		BN_free(v_values[i]);
 	}
+	free(u_values);
+	free(v_values);
 
 	fclose(fp);
 }
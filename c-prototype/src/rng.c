@@ -0,0 +1,143 @@
+#include "rng.h"
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <string.h>
+#include <unistd.h>
+
+struct rng_stream {
+	uint8_t buf[RNG_BLOCK_SIZE];
+	size_t pos;
+	size_t len;
+	// A forked child must not reuse the bytes buffered by its parent
+	pid_t pid;
+	rng_source_fn source;
+	void *arg;
+	uint64_t seed;
+	uint64_t counter;
+};
+
+static __thread struct rng_stream stream;
+
+static int rand_source(void *arg, uint8_t *buf, size_t len)
+{
+	(void)arg;
+	return RAND_bytes(buf, (int)len);
+}
+
+// SHA-256 of seed || counter, only meant for reproducible test runs
+static int seeded_source(void *arg, uint8_t *buf, size_t len)
+{
+	struct rng_stream *s = (struct rng_stream *)arg;
+	uint8_t block[16], digest[SHA256_DIGEST_LENGTH];
+
+	for (size_t off = 0; off < len; off += sizeof(digest)) {
+		memcpy(block, &s->seed, sizeof(s->seed));
+		memcpy(block + 8, &s->counter, sizeof(s->counter));
+		s->counter++;
+		SHA256(block, sizeof(block), digest);
+
+		size_t n = len - off < sizeof(digest) ? len - off : sizeof(digest);
+		memcpy(buf + off, digest, n);
+	}
+	return 1;
+}
+
+static void discard(struct rng_stream *s)
+{
+	OPENSSL_cleanse(s->buf, sizeof(s->buf));
+	s->pos = 0;
+	s->len = 0;
+}
+
+void rng_set_source(rng_source_fn source, void *arg)
+{
+	discard(&stream);
+	stream.source = source;
+	stream.arg = arg;
+}
+
+void rng_seed(uint64_t seed)
+{
+	stream.seed = seed;
+	stream.counter = 0;
+	rng_set_source(seeded_source, &stream);
+}
+
+static int refill(struct rng_stream *s)
+{
+	rng_source_fn source = s->source ? s->source : rand_source;
+
+	discard(s);
+	if (source(s->arg, s->buf, sizeof(s->buf)) != 1)
+		return 0;
+	s->len = sizeof(s->buf);
+	s->pid = getpid();
+	return 1;
+}
+
+int rng_bytes(uint8_t *buf, size_t len)
+{
+	struct rng_stream *s = &stream;
+
+	if (s->len != 0 && s->pid != getpid())
+		discard(s);
+
+	while (len > 0) {
+		if (s->pos == s->len && !refill(s))
+			return 0;
+
+		size_t n = s->len - s->pos < len ? s->len - s->pos : len;
+		memcpy(buf, s->buf + s->pos, n);
+		// Handed out bytes do not stay around in the buffer
+		OPENSSL_cleanse(s->buf + s->pos, n);
+		s->pos += n;
+		buf += n;
+		len -= n;
+	}
+	return 1;
+}
+
+int rng_range(BIGNUM *r, const BIGNUM *range)
+{
+	int bits = BN_num_bits(range);
+	int num_bytes = (bits + 7) / 8;
+	uint8_t bytes[512];
+
+	if (bits == 0 || BN_is_negative(range) || num_bytes > (int)sizeof(bytes))
+		return 0;
+
+	// Each draw succeeds with probability above 1/2, bail out like
+	// BN_rand_range does when the stream is obviously broken
+	for (int i = 0; i < 100; i++) {
+		if (!rng_bytes(bytes, num_bytes))
+			return 0;
+		if (bits % 8)
+			bytes[0] &= (1 << (bits % 8)) - 1;
+
+		if (BN_bin2bn(bytes, num_bytes, r) == NULL)
+			break;
+		if (BN_cmp(r, range) < 0) {
+			OPENSSL_cleanse(bytes, num_bytes);
+			return 1;
+		}
+	}
+	OPENSSL_cleanse(bytes, num_bytes);
+	return 0;
+}
+
+int rng_below(unsigned int bound)
+{
+	uint8_t byte;
+
+	if (bound == 0 || bound > 256)
+		return -1;
+
+	// Largest multiple of bound that fits into a byte
+	unsigned int limit = 256 - 256 % bound;
+	do {
+		if (!rng_bytes(&byte, 1))
+			return -1;
+	} while (byte >= limit);
+	return byte % bound;
+}
@@ -0,0 +1,43 @@
+#include <openssl/bn.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#pragma once
+
+#ifndef RNG_H
+#define RNG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Buffered random stream. Every thread owns a stream that is refilled in
+// blocks of RNG_BLOCK_SIZE bytes, so the rejection sampling of the encoder
+// costs one call into the DRBG per block instead of one per attempt.
+
+#define RNG_BLOCK_SIZE 4096
+
+	// Fills buf with len random bytes, returns 1 on success and 0 on
+	// failure like RAND_bytes
+	typedef int (*rng_source_fn)(void *arg, uint8_t * buf, size_t len);
+
+	// Replaces the source of the calling thread's stream, NULL restores
+	// RAND_bytes. Bytes already buffered are discarded.
+	void rng_set_source(rng_source_fn source, void *arg);
+
+	// Makes the calling thread's stream deterministic, for reproducible
+	// benchmarks and test vectors. Never use this outside of tests.
+	void rng_seed(uint64_t seed);
+
+	int rng_bytes(uint8_t * buf, size_t len);
+
+	// Uniform value in [0, range) by rejection on the buffered bytes
+	int rng_range(BIGNUM * r, const BIGNUM * range);
+
+	// Uniform value in [0, bound) for 0 < bound <= 256, -1 on failure
+	int rng_below(unsigned int bound);
+
+#ifdef __cplusplus
+}
+#endif
+#endif				// RNG_H
@@ -2,6 +2,42 @@
 #include <openssl/bn.h>
 #include <openssl/ec.h>
 #include <openssl/obj_mac.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void put_be32(uint8_t *buf, uint32_t value)
+{
+	buf[0] = value >> 24;
+	buf[1] = value >> 16;
+	buf[2] = value >> 8;
+	buf[3] = value;
+}
+
+static uint32_t get_be32(const uint8_t *buf)
+{
+	return ((uint32_t) buf[0] << 24) | ((uint32_t) buf[1] << 16) |
+	    ((uint32_t) buf[2] << 8) | buf[3];
+}
+
+// Whether filename starts with the magic of a binary fixture, the loaders
+// below use this to accept both the text and the binary files
+static int has_magic(const char *filename, const char *magic)
+{
+	char buf[4];
+	FILE *fp = fopen(filename, "rb");
+	if (fp == NULL)
+		return 0;
+
+	int ret = fread(buf, sizeof(buf), 1, fp) == 1 &&
+	    memcmp(buf, magic, sizeof(buf)) == 0;
+	fclose(fp);
+	return ret;
+}
 
 void print_bignum(const BIGNUM *bn)
 {
@@ -41,13 +77,16 @@ BIGNUM **read_hashes(const char *filename, const int num_points)
 	FILE *file;
 	int i = 0;
 
+	if (has_magic(filename, BIGNUMS_BIN_MAGIC))
+		return import_bignums_bin(filename, num_points);
+
 	file = fopen(filename, "r");
 	if (file == NULL) {
 		printf("Could not open file %s\n", filename);
 		return NULL;
 	}
 
-	hashes = (BIGNUM **) malloc(num_points * sizeof(BIGNUM *));
+	hashes = (BIGNUM **) calloc(num_points, sizeof(BIGNUM *));
 	if (hashes == NULL) {
 		fprintf(stderr, "Error allocating memory for points\n");
 		fclose(file);
@@ -83,10 +122,14 @@ EC_POINT **read_points(const char *filename, EC_GROUP *group,
 		       const int num_points)
 {
 	EC_POINT **points;
+	BN_CTX *ctx;
 	FILE *file;
 	char buffer[1024];
 	int i = 0;
 
+	if (has_magic(filename, POINTS_BIN_MAGIC))
+		return import_points_bin(filename, group, num_points);
+
 	file = fopen(filename, "r");
 	if (file == NULL) {
 		printf("Could not open file %s\n", filename);
@@ -100,6 +143,9 @@ EC_POINT **read_points(const char *filename, EC_GROUP *group,
 		return NULL;
 	}
 
+	// Without a context every point would set up its own for the
+	// on-curve check
+	ctx = BN_CTX_new();
 	while (fgets(buffer, sizeof(buffer), file)) {
 		char *x_str = strtok(buffer, " ");
 		char *y_str = strtok(NULL, " ");
@@ -113,7 +159,7 @@ EC_POINT **read_points(const char *filename, EC_GROUP *group,
 
 			EC_POINT *point = EC_POINT_new(group);
 			EC_POINT_set_affine_coordinates(group, point, x,
-							y, NULL);
+							y, ctx);
 
 			points[i] = point;
 
@@ -126,6 +172,7 @@ EC_POINT **read_points(const char *filename, EC_GROUP *group,
 		}
 	}
 
+	BN_CTX_free(ctx);
 	fclose(file);
 	return points;
 }
@@ -261,3 +308,240 @@ BIGNUM **import_bignums(const char *filename, int count)
 
 	return bignums;
 }
+
+int export_bignums_bin(const char *filename, BIGNUM **bignums, int count,
+		       int width)
+{
+	uint8_t header[BIGNUMS_BIN_HEADER];
+	uint8_t *buf;
+	FILE *fp;
+	int ret = -1;
+
+	buf = (uint8_t *) malloc((size_t)count * width);
+	if (buf == NULL) {
+		fprintf(stderr, "Error allocating memory for %s\n", filename);
+		return -1;
+	}
+
+	for (int i = 0; i < count; i++) {
+		if (BN_bn2binpad(bignums[i], buf + (size_t)i * width,
+				 width) < 0) {
+			fprintf(stderr, "BIGNUM %d does not fit in %d bytes\n",
+				i, width);
+			free(buf);
+			return -1;
+		}
+	}
+
+	fp = fopen(filename, "wb");
+	if (fp == NULL) {
+		fprintf(stderr, "Could not open file %s for writing\n",
+			filename);
+		free(buf);
+		return -1;
+	}
+
+	memcpy(header, BIGNUMS_BIN_MAGIC, 4);
+	put_be32(header + 4, count);
+	put_be32(header + 8, width);
+	if (fwrite(header, sizeof(header), 1, fp) == 1 &&
+	    fwrite(buf, width, count, fp) == (size_t)count)
+		ret = 0;
+	else
+		fprintf(stderr, "Error writing %s\n", filename);
+
+	if (fclose(fp) != 0)
+		ret = -1;
+	free(buf);
+	return ret;
+}
+
+struct fixture *fixture_open(const char *filename, const char *magic)
+{
+	struct fixture *fx;
+	struct stat st;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Could not open file %s for reading\n",
+			filename);
+		return NULL;
+	}
+
+	fx = (struct fixture *)calloc(1, sizeof(*fx));
+	if (fx == NULL || fstat(fd, &st) < 0 ||
+	    (size_t)st.st_size < BIGNUMS_BIN_HEADER)
+		goto fail;
+
+	fx->map_len = st.st_size;
+	fx->map = mmap(NULL, fx->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (fx->map == MAP_FAILED) {
+		fx->map = NULL;
+		goto fail;
+	}
+	close(fd);
+	fd = -1;
+
+	const uint8_t *header = (const uint8_t *)fx->map;
+	fx->count = get_be32(header + 4);
+	fx->width = get_be32(header + 8);
+	fx->data = header + BIGNUMS_BIN_HEADER;
+	if (memcmp(header, magic, 4) != 0 || fx->width == 0 ||
+	    (fx->map_len - BIGNUMS_BIN_HEADER) / fx->width < fx->count)
+		goto fail;
+
+	return fx;
+
+fail:
+	fprintf(stderr, "%s is not a valid %.4s fixture\n", filename, magic);
+	if (fd >= 0)
+		close(fd);
+	fixture_close(fx);
+	return NULL;
+}
+
+void fixture_close(struct fixture *fx)
+{
+	if (fx == NULL)
+		return;
+	if (fx->map != NULL)
+		munmap(fx->map, fx->map_len);
+	free(fx);
+}
+
+BIGNUM *fixture_bignum(const struct fixture *fx, int i)
+{
+	return BN_bin2bn(fx->data + (size_t)i * fx->width, fx->width, NULL);
+}
+
+EC_POINT *fixture_point(const struct fixture *fx, int i,
+			const EC_GROUP *group, BN_CTX *ctx)
+{
+	EC_POINT *point = EC_POINT_new(group);
+	if (point == NULL)
+		return NULL;
+
+	if (!EC_POINT_oct2point(group, point,
+				fx->data + (size_t)i * fx->width, fx->width,
+				ctx)) {
+		EC_POINT_free(point);
+		return NULL;
+	}
+	return point;
+}
+
+BIGNUM **import_bignums_bin(const char *filename, int count)
+{
+	struct fixture *fx = fixture_open(filename, BIGNUMS_BIN_MAGIC);
+	if (fx == NULL)
+		return NULL;
+
+	BIGNUM **bignums = NULL;
+	if (fx->count < (uint32_t) count) {
+		fprintf(stderr, "%s holds %u BIGNUMs, %d requested\n",
+			filename, fx->count, count);
+		goto out;
+	}
+
+	bignums = (BIGNUM **) calloc(count, sizeof(BIGNUM *));
+	if (bignums == NULL)
+		goto out;
+	for (int i = 0; i < count; i++) {
+		bignums[i] = fixture_bignum(fx, i);
+		if (bignums[i] == NULL) {
+			free_hashes(bignums, count);
+			bignums = NULL;
+			break;
+		}
+	}
+
+out:
+	fixture_close(fx);
+	return bignums;
+}
+
+int export_points_bin(const char *filename, EC_POINT **points, int count,
+		      const EC_GROUP *group, point_conversion_form_t form)
+{
+	uint8_t header[BIGNUMS_BIN_HEADER];
+	BN_CTX *ctx = BN_CTX_new();
+	size_t width = EC_POINT_point2oct(group, points[0], form, NULL, 0, ctx);
+	uint8_t *buf = (uint8_t *) malloc((size_t)count * width);
+	FILE *fp = NULL;
+	int ret = -1;
+
+	if (width == 0 || buf == NULL)
+		goto out;
+
+	for (int i = 0; i < count; i++) {
+		if (EC_POINT_point2oct(group, points[i], form,
+				       buf + (size_t)i * width, width,
+				       ctx) != width) {
+			fprintf(stderr, "Could not encode point %d\n", i);
+			goto out;
+		}
+	}
+
+	fp = fopen(filename, "wb");
+	if (fp == NULL) {
+		fprintf(stderr, "Could not open file %s for writing\n",
+			filename);
+		goto out;
+	}
+
+	memcpy(header, POINTS_BIN_MAGIC, 4);
+	put_be32(header + 4, count);
+	put_be32(header + 8, width);
+	if (fwrite(header, sizeof(header), 1, fp) == 1 &&
+	    fwrite(buf, width, count, fp) == (size_t)count)
+		ret = 0;
+	else
+		fprintf(stderr, "Error writing %s\n", filename);
+	if (fclose(fp) != 0)
+		ret = -1;
+
+out:
+	free(buf);
+	BN_CTX_free(ctx);
+	return ret;
+}
+
+EC_POINT **import_points_bin(const char *filename, EC_GROUP *group,
+			     int count)
+{
+	struct fixture *fx = fixture_open(filename, POINTS_BIN_MAGIC);
+	if (fx == NULL)
+		return NULL;
+
+	EC_POINT **points = NULL;
+	if (fx->count < (uint32_t) count) {
+		fprintf(stderr, "%s holds %u points, %d requested\n",
+			filename, fx->count, count);
+		goto out;
+	}
+
+	points = (EC_POINT **) calloc(count, sizeof(EC_POINT *));
+	if (points == NULL)
+		goto out;
+
+	// One context for all points, the on-curve checks share its scratch
+	BN_CTX *ctx = BN_CTX_new();
+	for (int i = 0; i < count; i++) {
+		points[i] = fixture_point(fx, i, group, ctx);
+		if (points[i] == NULL) {
+			fprintf(stderr, "Invalid point %d in %s\n", i,
+				filename);
+			for (int j = 0; j < i; j++)
+				EC_POINT_free(points[j]);
+			free(points);
+			points = NULL;
+			break;
+		}
+	}
+	BN_CTX_free(ctx);
+
+out:
+	fixture_close(fx);
+	return points;
+}
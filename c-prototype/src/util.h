@@ -1,5 +1,6 @@
 #include <openssl/bn.h>
 #include <openssl/ec.h>
+#include <stdint.h>
 
 #pragma once
 
@@ -31,6 +32,48 @@ void export_bignums(const char *filename, BIGNUM ** bignums, int count);
 
 BIGNUM **import_bignums(const char *filename, int count);
 
+// Binary fixtures: the magic "DABN", the number of values and the width of a
+// value as big-endian 32 bit integers, followed by the values big-endian and
+// zero padded to that width. Returns 0 on success and -1 on failure.
+#define BIGNUMS_BIN_MAGIC "DABN"
+#define BIGNUMS_BIN_HEADER 12
+
+int export_bignums_bin(const char *filename, BIGNUM ** bignums, int count,
+		       int width);
+
+// Reads the first count values of a binary fixture, NULL if it holds fewer
+BIGNUM **import_bignums_bin(const char *filename, int count);
+
+// Binary point fixtures have the same header with the magic "DAPT", followed
+// by SEC1 encoded points, compressed or uncompressed. read_points and
+// read_hashes accept these files as well as the text files.
+#define POINTS_BIN_MAGIC "DAPT"
+
+int export_points_bin(const char *filename, EC_POINT ** points, int count,
+		      const EC_GROUP * group, point_conversion_form_t form);
+
+EC_POINT **import_points_bin(const char *filename, EC_GROUP * group,
+			     int count);
+
+// Read-only view of a binary fixture mapped into memory, so that entries
+// can be turned into BIGNUMs and points on first use instead of up front
+struct fixture {
+	const uint8_t *data;
+	uint32_t count;
+	uint32_t width;
+	void *map;
+	size_t map_len;
+};
+
+struct fixture *fixture_open(const char *filename, const char *magic);
+
+void fixture_close(struct fixture *fx);
+
+BIGNUM *fixture_bignum(const struct fixture *fx, int i);
+
+EC_POINT *fixture_point(const struct fixture *fx, int i,
+			const EC_GROUP * group, BN_CTX * ctx);
+
 #ifdef __cplusplus
 }
 #endif
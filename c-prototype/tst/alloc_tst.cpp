@@ -0,0 +1,208 @@
+#include "gtest/gtest.h"
+#include <openssl/ec.h>
+#include <openssl/obj_mac.h>
+#include "alloc_stats.h"
+#include "decoyauth.hpp"
+#include "rng.h"
+#include "util.h"
+
+using namespace decoyauth;
+
+// Allocation budgets of the hot paths. Every operation is measured on its
+// own, with the inputs set up and the outputs freed around it, so live has
+// to be zero. The budgets leave some headroom over what OpenSSL 3 needs
+// today, they are there to catch new allocations per call, not to pin
+// OpenSSL internals.
+
+#define EXPECT_NO_LEAKS(delta) \
+    EXPECT_EQ(alloc_stats_live(&(delta)), 0) << (delta).allocs << " allocations, " \
+                                              << (delta).frees << " frees"
+
+class alloc_budget : public ::testing::Test {
+protected:
+    static const int n = 10;
+
+    curve c{NID_X9_62_prime256v1};
+    ctx_guard ctx;
+    point_array points;
+    bignum_array hashes;
+
+    void SetUp() override {
+        points = point_array(read_points("points.txt", c.group, n), n);
+        ASSERT_TRUE(points);
+        hashes = bignum_array(read_hashes("hashes.txt", n), n);
+        ASSERT_TRUE(hashes);
+        rng_seed(43);
+
+        // OpenSSL sets up tables and per thread state on first use, which
+        // is kept until exit
+        bignum_array uv = es_encode(points[0], c);
+        ASSERT_TRUE(uv);
+        es_decode(uv, c);
+    }
+
+    void TearDown() override {
+        rng_set_source(NULL, NULL);
+    }
+};
+
+TEST_F(alloc_budget, counts_allocations)
+{
+    alloc_scope scope;
+    void* ptr = malloc(100);
+    ptr = realloc(ptr, 1 << 20);
+    free(ptr);
+    bignum value(BN_new());
+    BN_set_word(value, 1);
+    value.reset();
+    struct alloc_stats delta = scope.delta();
+
+    EXPECT_GE(delta.allocs, 3u);
+    EXPECT_GE(delta.bytes, 100u + (1 << 20));
+    EXPECT_GE(delta.openssl_allocs, 1u);
+    EXPECT_NO_LEAKS(delta);
+}
+
+TEST_F(alloc_budget, f)
+{
+    for (int i = 0; i < n; i++)
+    {
+        alloc_scope scope;
+        ec_point point(f(hashes[i], c.group, c.a, c.b, c.prime));
+        point.reset();
+        struct alloc_stats delta = scope.delta();
+
+        EXPECT_LE(delta.allocs, 300u) << "index " << i;
+        EXPECT_NO_LEAKS(delta) << "index " << i;
+    }
+}
+
+TEST_F(alloc_budget, calc_v)
+{
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            alloc_scope scope;
+            bignum v(calc_v(points[i], j, c.group, c.a, c.b, c.prime));
+            v.reset();
+            struct alloc_stats delta = scope.delta();
+
+            EXPECT_LE(delta.allocs, 100u) << "index " << i << ", j " << j;
+            EXPECT_NO_LEAKS(delta) << "index " << i << ", j " << j;
+        }
+    }
+}
+
+TEST_F(alloc_budget, es_encode)
+{
+    uint64_t total = 0;
+    for (int i = 0; i < n; i++)
+    {
+        alloc_scope scope;
+        bignum_array uv = es_encode(points[i], c);
+        ASSERT_TRUE(uv);
+        uv = bignum_array();
+        struct alloc_stats delta = scope.delta();
+
+        total += delta.allocs;
+        EXPECT_NO_LEAKS(delta) << "index " << i;
+    }
+
+    // Every attempt costs a call of f() and calc_v(), and the seeded
+    // stream makes the number of attempts, about 3 per point, repeatable
+    EXPECT_LE(total, (uint64_t) 400 * 4 * n);
+}
+
+TEST_F(alloc_budget, es_decode)
+{
+    bignum_array encoded(2 * n);
+    for (int i = 0; i < n; i++)
+    {
+        bignum_array pair = es_encode(points[i], c);
+        ASSERT_TRUE(pair);
+        encoded.set(2 * i, BN_dup(pair[0]));
+        encoded.set(2 * i + 1, BN_dup(pair[1]));
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        alloc_scope scope;
+        ec_point decoded = es_decode(encoded.view().subspan(2 * i, 2), c);
+        ASSERT_TRUE(decoded);
+        decoded.reset();
+        struct alloc_stats delta = scope.delta();
+
+        EXPECT_LE(delta.allocs, 120u) << "index " << i;
+        EXPECT_NO_LEAKS(delta) << "index " << i;
+    }
+}
+
+TEST_F(alloc_budget, bytes_api_does_not_allocate)
+{
+    struct es_ctx* es = es_ctx_new(c.group, c.a, c.b, c.prime);
+    ASSERT_NE(es, nullptr);
+    bignum x(BN_new()), y(BN_new());
+
+    for (int i = 0; i < n; i++)
+    {
+        uint8_t point[ES_BYTES], uv[ES_BYTES], decoded[ES_BYTES];
+        EC_POINT_get_affine_coordinates(c.group, points[i], x, y, ctx);
+        BN_bn2binpad(x, point, ES_COORD_BYTES);
+        BN_bn2binpad(y, point + ES_COORD_BYTES, ES_COORD_BYTES);
+
+        // The first calls warm up the random stream of the thread and the
+        // scratch values of the context
+        ASSERT_EQ(es_encode_bytes(point, uv, es), 0);
+        ASSERT_EQ(es_decode_bytes(uv, decoded, es), 0);
+
+        alloc_scope scope;
+        int encoded = es_encode_bytes(point, uv, es);
+        int ret = es_decode_bytes(uv, decoded, es);
+        struct alloc_stats delta = scope.delta();
+
+        ASSERT_EQ(encoded, 0);
+        ASSERT_EQ(ret, 0);
+        EXPECT_EQ(delta.allocs, 0u) << "index " << i;
+        EXPECT_EQ(delta.frees, 0u) << "index " << i;
+    }
+
+    es_ctx_free(es);
+}
+
+TEST_F(alloc_budget, weaver)
+{
+    bignum_span u_values = hashes;
+
+    // Grows ctx to what the functions need, it keeps that memory
+    weave(u_values, precompute(hashes, c.prime, ctx), c.prime, ctx);
+
+    alloc_scope scope;
+    bignum_array matrix = precompute(hashes, c.prime, ctx);
+    ASSERT_TRUE(matrix);
+    struct alloc_stats precompute_delta = scope.delta();
+
+    bignum_array vals = weave(u_values, matrix, c.prime, ctx);
+    ASSERT_TRUE(vals);
+    bignum u = evaluate(vals, hashes[0], c.prime, ctx);
+    EXPECT_EQ(BN_cmp(u, hashes[0]), 0);
+    u.reset();
+    vals = bignum_array();
+    matrix = bignum_array();
+    struct alloc_stats delta = scope.delta();
+
+    // The matrix itself is n * n BIGNUMs plus the array
+    EXPECT_LE(precompute_delta.allocs, (uint64_t) 12 * n * n);
+    EXPECT_LE(delta.allocs, (uint64_t) 15 * n * n);
+    EXPECT_NO_LEAKS(delta);
+}
+
+TEST_F(alloc_budget, read_points)
+{
+    alloc_scope scope;
+    free_points(read_points("points.txt", c.group, n), n);
+    free_hashes(read_hashes("hashes.txt", n), n);
+    struct alloc_stats delta = scope.delta();
+
+    EXPECT_NO_LEAKS(delta);
+}
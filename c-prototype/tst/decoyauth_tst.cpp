@@ -0,0 +1,114 @@
+#include "gtest/gtest.h"
+#include <openssl/ec.h>
+#include <openssl/obj_mac.h>
+#include <utility>
+#include "util.h"
+#include "decoyauth.hpp"
+
+using namespace decoyauth;
+
+TEST(handles, move_transfers_ownership)
+{
+    bignum a(BN_new());
+    BN_set_word(a, 42);
+    BIGNUM* raw = a.get();
+
+    bignum b(std::move(a));
+    EXPECT_FALSE(a);
+    EXPECT_EQ(b.get(), raw);
+
+    bignum c;
+    c = std::move(b);
+    EXPECT_FALSE(b);
+    EXPECT_TRUE(BN_is_word(c, 42));
+
+    BIGNUM* released = c.release();
+    EXPECT_FALSE(c);
+    BN_free(released);
+}
+
+TEST(handles, array_views)
+{
+    bignum_array values(6);
+    for (int i = 0; i < 6; i++)
+    {
+        values.set(i, BN_new());
+        BN_set_word(values[i], i);
+    }
+
+    // A pair inside the flat array, without copying the pointers
+    bignum_span pair = values.view().subspan(2, 2);
+    EXPECT_EQ(pair.size(), 2u);
+    EXPECT_EQ(pair.data(), values.data() + 2);
+    EXPECT_TRUE(BN_is_word(pair[1], 3));
+
+    // Replacing a slot frees the previous value
+    values.set(0, BN_new());
+    EXPECT_TRUE(BN_is_zero(values[0]));
+
+    bignum_array moved = std::move(values);
+    EXPECT_FALSE(values);
+    EXPECT_EQ(moved.size(), 6u);
+}
+
+TEST(handles, ctx_guard_reuses_contexts)
+{
+    BN_CTX* first;
+    {
+        ctx_guard ctx;
+        first = ctx;
+        ctx_guard nested;
+        EXPECT_NE(nested.get(), first);
+    }
+    // Returned last, so handed out first
+    ctx_guard again;
+    EXPECT_EQ(again.get(), first);
+}
+
+TEST(handles, full_cycle)
+{
+    const int n = 10;
+    curve c(NID_X9_62_prime256v1);
+    ctx_guard ctx;
+    point_array points(read_points("points.txt", c.group, n), n);
+    ASSERT_TRUE(points);
+    bignum_array hashes(read_hashes("hashes.txt", n), n);
+    ASSERT_TRUE(hashes);
+
+    bignum_array encoded(2 * n);
+    for (int i = 0; i < n; i++)
+    {
+        bignum_array pair = es_encode(points[i], c);
+        ASSERT_TRUE(pair);
+        encoded.set(2 * i, BN_dup(pair[0]));
+        encoded.set(2 * i + 1, BN_dup(pair[1]));
+    }
+
+    std::vector<BIGNUM*> u_values;
+    for (int i = 0; i < n; i++)
+        u_values.push_back(encoded[2 * i]);
+
+    bignum_array matrix = precompute(hashes, c.prime, ctx);
+    EXPECT_EQ(matrix.size(), (size_t) n * n);
+    bignum_array vals = weave(u_values, matrix, c.prime, ctx);
+    EXPECT_EQ(vals.size(), (size_t) n);
+
+    for (int i = 0; i < n; i++)
+    {
+        bignum u = evaluate(vals, hashes[i], c.prime, ctx);
+        EXPECT_EQ(BN_cmp(u, u_values[i]), 0) << "index " << i;
+
+        ec_point decoded = es_decode(encoded.view().subspan(2 * i, 2), c);
+        ASSERT_TRUE(decoded);
+        EXPECT_EQ(EC_POINT_cmp(c.group, decoded, points[i], ctx), 0) << "index " << i;
+    }
+}
+
+TEST(handles, curve_copy)
+{
+    curve c(NID_secp384r1);
+    curve copy(c.group);
+    EXPECT_NE(copy.group.get(), c.group.get());
+    EXPECT_EQ(BN_cmp(copy.prime, c.prime), 0);
+    EXPECT_EQ(copy.coord_bytes(), 48);
+}
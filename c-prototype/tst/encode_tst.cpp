@@ -470,3 +470,115 @@ TEST(encode, encode_decode)
 
     EXPECT_EQ(cmp, 0);
 }
+
+TEST(encode, decode_bytes)
+{
+    BIGNUM* a = BN_new();
+    BN_dec2bn(&a, A);
+    BIGNUM* b = BN_new();
+    BN_dec2bn(&b, B);
+    BIGNUM* prime = BN_new();
+    BN_dec2bn(&prime, P);
+    EC_GROUP* group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+
+    BIGNUM* u = BN_new();
+    BN_dec2bn(&u, "97945056622653298015081862479932987806690569858371314855998309191291337515864");
+    BIGNUM* v = BN_new();
+    BN_dec2bn(&v, "18052566651904244286302490488482292752139620615679439020636077745050056827647");
+    BIGNUM* expected_x = BN_new();
+    BN_dec2bn(&expected_x, "65806355583802351726491629782483873926370084931339497194066072319463673170168");
+    BIGNUM* expected_y = BN_new();
+    BN_dec2bn(&expected_y, "82644964625339147662735488253695614323153588769978943963476249488026677744124");
+
+    uint8_t uv[ES_BYTES], point[ES_BYTES], expected[ES_BYTES];
+    BN_bn2binpad(u, uv, ES_COORD_BYTES);
+    BN_bn2binpad(v, uv + ES_COORD_BYTES, ES_COORD_BYTES);
+    BN_bn2binpad(expected_x, expected, ES_COORD_BYTES);
+    BN_bn2binpad(expected_y, expected + ES_COORD_BYTES, ES_COORD_BYTES);
+
+    struct es_ctx* ctx = es_ctx_new(group, a, b, prime);
+    ASSERT_NE(ctx, nullptr);
+    EXPECT_EQ(es_decode_bytes(uv, point, ctx), 0);
+    EXPECT_EQ(memcmp(point, expected, ES_BYTES), 0);
+
+    // Values outside of the field are rejected
+    memset(uv, 0xff, ES_COORD_BYTES);
+    EXPECT_EQ(es_decode_bytes(uv, point, ctx), -1);
+
+    es_ctx_free(ctx);
+    BN_free(u);
+    BN_free(v);
+    BN_free(expected_x);
+    BN_free(expected_y);
+    EC_GROUP_free(group);
+    BN_free(a);
+    BN_free(b);
+    BN_free(prime);
+}
+
+static void encode_decode_bytes(const char* backend)
+{
+    BIGNUM* a = BN_new();
+    BN_dec2bn(&a, A);
+    BIGNUM* b = BN_new();
+    BN_dec2bn(&b, B);
+    BIGNUM* prime = BN_new();
+    BN_dec2bn(&prime, P);
+    EC_GROUP* group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+    BIGNUM* x = BN_new();
+    BIGNUM* y = BN_new();
+
+    // The backend is picked when the context is created
+    if (backend != NULL)
+        setenv("DECOYAUTH_FIELD_BACKEND", backend, 1);
+    struct es_ctx* ctx = es_ctx_new(group, a, b, prime);
+    unsetenv("DECOYAUTH_FIELD_BACKEND");
+    ASSERT_NE(ctx, nullptr);
+
+    const int n = 10;
+    EC_POINT** points = read_points("points.txt", group, n);
+    ASSERT_NE(points, nullptr);
+
+    for (int i = 0; i < n; i++)
+    {
+        uint8_t point[ES_BYTES], uv[ES_BYTES], decoded[ES_BYTES];
+        EC_POINT_get_affine_coordinates(group, points[i], x, y, NULL);
+        BN_bn2binpad(x, point, ES_COORD_BYTES);
+        BN_bn2binpad(y, point + ES_COORD_BYTES, ES_COORD_BYTES);
+
+        ASSERT_EQ(es_encode_bytes(point, uv, ctx), 0);
+        ASSERT_EQ(es_decode_bytes(uv, decoded, ctx), 0);
+        EXPECT_EQ(memcmp(point, decoded, ES_BYTES), 0) << "index " << i;
+
+        // The pair is also accepted by the BIGNUM based decoder
+        BIGNUM** pair = (BIGNUM**) malloc(2 * sizeof(BIGNUM*));
+        pair[0] = BN_bin2bn(uv, ES_COORD_BYTES, NULL);
+        pair[1] = BN_bin2bn(uv + ES_COORD_BYTES, ES_COORD_BYTES, NULL);
+        EC_POINT* result = es_decode(pair, group, a, b, prime);
+        ASSERT_NE(result, nullptr);
+        EXPECT_EQ(EC_POINT_cmp(group, result, points[i], NULL), 0) << "index " << i;
+        EC_POINT_free(result);
+        BN_free(pair[0]);
+        BN_free(pair[1]);
+        free(pair);
+    }
+
+    free_points(points, n);
+    es_ctx_free(ctx);
+    BN_free(x);
+    BN_free(y);
+    EC_GROUP_free(group);
+    BN_free(a);
+    BN_free(b);
+    BN_free(prime);
+}
+
+TEST(encode, encode_decode_bytes)
+{
+    encode_decode_bytes(NULL);
+}
+
+TEST(encode, encode_decode_bytes_bn)
+{
+    encode_decode_bytes("scalar");
+}
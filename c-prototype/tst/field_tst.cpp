@@ -0,0 +1,296 @@
+#include "gtest/gtest.h"
+#include <openssl/ec.h>
+#include <openssl/obj_mac.h>
+#include <openssl/err.h>
+#include "util.h"
+#include "encode.h"
+#include "field.h"
+#include "rng.h"
+
+#define A   "115792089210356248762697446949407573530086143415290314195533631308867097853948"
+#define B   "41058363725152142129326129780047268409114441015993725554835256314039467401291"
+#define P   "115792089210356248762697446949407573530086143415290314195533631308867097853951"
+
+static void check_backend(enum field_backend backend)
+{
+    if (!field_backend_supported(backend))
+        GTEST_SKIP() << field_backend_name(backend) << " not supported on this CPU";
+
+    BIGNUM* prime = BN_new();
+    BN_dec2bn(&prime, P);
+    BN_CTX* ctx = BN_CTX_new();
+
+    struct field_ctx* fctx = field_ctx_new_backend(prime, backend);
+    ASSERT_NE(fctx, nullptr);
+    int lanes = field_lanes(fctx);
+
+    BIGNUM* x[8];
+    BIGNUM* y[8];
+    BIGNUM* r[8];
+    rng_seed(backend);
+    for (int l = 0; l < lanes; l++)
+    {
+        x[l] = BN_new();
+        y[l] = BN_new();
+        r[l] = BN_new();
+        rng_range(x[l], prime);
+        rng_range(y[l], prime);
+    }
+    rng_set_source(NULL, NULL);
+    // Edge values that stress the reductions
+    BN_zero(x[0]);
+    BN_sub(y[1], prime, BN_value_one());
+
+    fe_t fx, fy, fr;
+    fe_load(fctx, &fx, x, lanes);
+    fe_load(fctx, &fy, y, lanes);
+
+    BIGNUM* expected = BN_new();
+    for (int op = 0; op < 5; op++)
+    {
+        switch (op)
+        {
+        case 0: fe_mul(fctx, &fr, &fx, &fy); break;
+        case 1: fe_add(fctx, &fr, &fx, &fy); break;
+        case 2: fe_sub(fctx, &fr, &fx, &fy); break;
+        case 3: fe_neg(fctx, &fr, &fy); break;
+        case 4: fe_inv(fctx, &fr, &fy); break;
+        }
+        ASSERT_EQ(fe_store(fctx, r, &fr, lanes), 0);
+
+        for (int l = 0; l < lanes; l++)
+        {
+            switch (op)
+            {
+            case 0: BN_mod_mul(expected, x[l], y[l], prime, ctx); break;
+            case 1: BN_mod_add(expected, x[l], y[l], prime, ctx); break;
+            case 2: BN_mod_sub(expected, x[l], y[l], prime, ctx); break;
+            case 3: BN_mod_sub(expected, prime, y[l], prime, ctx); break;
+            case 4: BN_mod_inverse(expected, y[l], prime, ctx); break;
+            }
+            EXPECT_EQ(BN_cmp(r[l], expected), 0) << "op " << op << " lane " << l;
+        }
+    }
+
+    // Square roots must agree with BN_mod_sqrt wherever one exists
+    unsigned int mask = fe_sqrt(fctx, &fr, &fx);
+    ASSERT_EQ(fe_store(fctx, r, &fr, lanes), 0);
+    for (int l = 0; l < lanes; l++)
+    {
+        BIGNUM* root = BN_mod_sqrt(expected, x[l], prime, ctx);
+        ERR_clear_error();
+        EXPECT_EQ(root != NULL, (mask & (1u << l)) != 0) << "lane " << l;
+        if (root != NULL)
+        {
+            EXPECT_EQ(BN_cmp(r[l], expected), 0) << "lane " << l;
+        }
+    }
+
+    BN_free(expected);
+    for (int l = 0; l < lanes; l++)
+    {
+        BN_free(x[l]);
+        BN_free(y[l]);
+        BN_free(r[l]);
+    }
+    field_ctx_free(fctx);
+    BN_CTX_free(ctx);
+    BN_free(prime);
+}
+
+TEST(field, scalar)
+{
+    check_backend(FIELD_BACKEND_SCALAR);
+}
+
+TEST(field, avx2)
+{
+    check_backend(FIELD_BACKEND_AVX2);
+}
+
+TEST(field, avx512ifma)
+{
+    check_backend(FIELD_BACKEND_AVX512IFMA);
+}
+
+TEST(field, unsupported_prime)
+{
+    BIGNUM* prime = BN_new();
+    // 1 mod 4, sqrt by exponentiation does not apply
+    BN_dec2bn(&prime, "13");
+    EXPECT_EQ(field_ctx_new(prime), nullptr);
+    BN_free(prime);
+}
+
+TEST(batch, f_matches_scalar)
+{
+    BIGNUM* a = BN_new();
+    BN_dec2bn(&a, A);
+    BIGNUM* b = BN_new();
+    BN_dec2bn(&b, B);
+    BIGNUM* prime = BN_new();
+    BN_dec2bn(&prime, P);
+    EC_GROUP* group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+
+    const int n = 11;
+    BIGNUM* u[n];
+    EC_POINT* batch[n];
+    rng_seed(n);
+    for (int i = 0; i < n; i++)
+    {
+        u[i] = BN_new();
+        rng_range(u[i], prime);
+    }
+    rng_set_source(NULL, NULL);
+    BN_dec2bn(&u[0], "107698393190582369789940241844786910414546117189221584948777358459955759916154");
+    BN_dec2bn(&u[1], "24998129243780766980572089171172925592606352632077101700409213790009970587439");
+    BN_one(u[2]);
+
+    ASSERT_EQ(f_batch(u, batch, n, group, a, b, prime), 0);
+    for (int i = 0; i < n; i++)
+    {
+        EC_POINT* expected = f(u[i], group, a, b, prime);
+        ASSERT_EQ(expected == NULL, batch[i] == NULL) << "index " << i;
+        if (expected != NULL)
+        {
+            EXPECT_EQ(EC_POINT_cmp(group, expected, batch[i], NULL), 0) << "index " << i;
+        }
+        EC_POINT_free(expected);
+        EC_POINT_free(batch[i]);
+        BN_free(u[i]);
+    }
+
+    EC_GROUP_free(group);
+    BN_free(a);
+    BN_free(b);
+    BN_free(prime);
+}
+
+TEST(batch, calc_v_matches_scalar)
+{
+    BIGNUM* a = BN_new();
+    BN_dec2bn(&a, A);
+    BIGNUM* b = BN_new();
+    BN_dec2bn(&b, B);
+    BIGNUM* prime = BN_new();
+    BN_dec2bn(&prime, P);
+    EC_GROUP* group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+
+    const int n = 12;
+    EC_POINT** points = read_points("points.txt", group, n);
+    ASSERT_NE(points, nullptr);
+
+    int j[n];
+    BIGNUM* batch[n];
+    for (int i = 0; i < n; i++)
+        j[i] = i % 4;
+
+    ASSERT_EQ(calc_v_batch(points, j, batch, n, group, a, b, prime), 0);
+    for (int i = 0; i < n; i++)
+    {
+        BIGNUM* expected = calc_v(points[i], j[i], group, a, b, prime);
+        ASSERT_EQ(expected == NULL, batch[i] == NULL) << "index " << i;
+        if (expected != NULL)
+        {
+            EXPECT_EQ(BN_cmp(expected, batch[i]), 0) << "index " << i;
+        }
+        BN_free(expected);
+        BN_free(batch[i]);
+    }
+
+    free_points(points, n);
+    EC_GROUP_free(group);
+    BN_free(a);
+    BN_free(b);
+    BN_free(prime);
+}
+
+TEST(batch, missing_lanes)
+{
+    BIGNUM* a = BN_new();
+    BN_dec2bn(&a, A);
+    BIGNUM* b = BN_new();
+    BN_dec2bn(&b, B);
+    BIGNUM* prime = BN_new();
+    BN_dec2bn(&prime, P);
+    EC_GROUP* group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+
+    // A NULL input has no image and leaves the other lanes alone
+    const int n = 9;
+    EC_POINT** points = read_points("points.txt", group, n);
+    ASSERT_NE(points, nullptr);
+    BIGNUM* u[n];
+    EC_POINT* q[n];
+    EC_POINT* f_out[n];
+    BIGNUM* v_out[n];
+    int j[n];
+    for (int i = 0; i < n; i++)
+    {
+        u[i] = NULL;
+        if (i % 3 != 0)
+            BN_dec2bn(&u[i], "24998129243780766980572089171172925592606352632077101700409213790009970587439");
+        q[i] = i % 3 != 1 ? points[i] : NULL;
+        j[i] = i % 4;
+    }
+
+    ASSERT_EQ(f_batch(u, f_out, n, group, a, b, prime), 0);
+    ASSERT_EQ(calc_v_batch(q, j, v_out, n, group, a, b, prime), 0);
+    for (int i = 0; i < n; i++)
+    {
+        EXPECT_EQ(f_out[i] == NULL, u[i] == NULL) << "index " << i;
+        BIGNUM* expected = q[i] != NULL ? calc_v(q[i], j[i], group, a, b, prime) : NULL;
+        ASSERT_EQ(expected == NULL, v_out[i] == NULL) << "index " << i;
+        if (expected != NULL)
+        {
+            EXPECT_EQ(BN_cmp(expected, v_out[i]), 0) << "index " << i;
+        }
+        BN_free(expected);
+        BN_free(v_out[i]);
+        EC_POINT_free(f_out[i]);
+        BN_free(u[i]);
+    }
+
+    free_points(points, n);
+    EC_GROUP_free(group);
+    BN_free(a);
+    BN_free(b);
+    BN_free(prime);
+}
+
+TEST(batch, encode_decode)
+{
+    BIGNUM* a = BN_new();
+    BN_dec2bn(&a, A);
+    BIGNUM* b = BN_new();
+    BN_dec2bn(&b, B);
+    BIGNUM* prime = BN_new();
+    BN_dec2bn(&prime, P);
+    EC_GROUP* group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+    BN_CTX* ctx = BN_CTX_new();
+
+    const int n = 20;
+    EC_POINT** points = read_points("points.txt", group, n);
+    ASSERT_NE(points, nullptr);
+
+    BIGNUM* u_values[n];
+    BIGNUM* v_values[n];
+    ASSERT_EQ(es_encode_batch(points, n, u_values, v_values, group, a, b, prime), 0);
+
+    for (int i = 0; i < n; i++)
+    {
+        BIGNUM* pair[2] = { u_values[i], v_values[i] };
+        EC_POINT* decoded = es_decode(pair, group, a, b, prime);
+        ASSERT_NE(decoded, nullptr);
+        EXPECT_EQ(EC_POINT_cmp(group, decoded, points[i], ctx), 0) << "index " << i;
+        EC_POINT_free(decoded);
+        BN_free(u_values[i]);
+        BN_free(v_values[i]);
+    }
+
+    free_points(points, n);
+    BN_CTX_free(ctx);
+    EC_GROUP_free(group);
+    BN_free(a);
+    BN_free(b);
+    BN_free(prime);
+}
@@ -1,6 +1,9 @@
 #include "gtest/gtest.h"
+#include "alloc_stats.h"
 
 int main(int argc, char **argv) {
+    // Has to run before OpenSSL allocates anything
+    alloc_stats_install();
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
 }
\ No newline at end of file
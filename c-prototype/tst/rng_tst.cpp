@@ -0,0 +1,114 @@
+#include "gtest/gtest.h"
+#include <openssl/ec.h>
+#include <openssl/obj_mac.h>
+#include <cstring>
+#include "encode.h"
+#include "rng.h"
+
+#define A   "115792089210356248762697446949407573530086143415290314195533631308867097853948"
+#define B   "41058363725152142129326129780047268409114441015993725554835256314039467401291"
+#define P   "115792089210356248762697446949407573530086143415290314195533631308867097853951"
+
+TEST(rng, seeded_is_reproducible)
+{
+    uint8_t first[100], second[100], other[100];
+
+    rng_seed(42);
+    ASSERT_EQ(rng_bytes(first, sizeof(first)), 1);
+    rng_seed(42);
+    ASSERT_EQ(rng_bytes(second, sizeof(second)), 1);
+    rng_seed(43);
+    ASSERT_EQ(rng_bytes(other, sizeof(other)), 1);
+    rng_set_source(NULL, NULL);
+
+    EXPECT_EQ(memcmp(first, second, sizeof(first)), 0);
+    EXPECT_NE(memcmp(first, other, sizeof(first)), 0);
+}
+
+static int counting_source(void* arg, uint8_t* buf, size_t len)
+{
+    (*(int*) arg)++;
+    memset(buf, 0x5a, len);
+    return 1;
+}
+
+TEST(rng, refills_in_blocks)
+{
+    int calls = 0;
+    uint8_t byte;
+
+    rng_set_source(counting_source, &calls);
+    for (int i = 0; i < RNG_BLOCK_SIZE + 1; i++)
+    {
+        ASSERT_EQ(rng_bytes(&byte, 1), 1);
+        EXPECT_EQ(byte, 0x5a);
+    }
+    rng_set_source(NULL, NULL);
+
+    EXPECT_EQ(calls, 2);
+}
+
+TEST(rng, range_is_bounded)
+{
+    BIGNUM* range = BN_new();
+    BN_set_word(range, 11);
+    BIGNUM* r = BN_new();
+    int seen[11] = { 0 };
+
+    rng_seed(1);
+    for (int i = 0; i < 1000; i++)
+    {
+        ASSERT_EQ(rng_range(r, range), 1);
+        ASSERT_LT(BN_cmp(r, range), 0);
+        seen[BN_get_word(r)]++;
+    }
+    for (int i = 0; i < 1000; i++)
+    {
+        int j = rng_below(4);
+        ASSERT_GE(j, 0);
+        ASSERT_LT(j, 4);
+    }
+    rng_set_source(NULL, NULL);
+
+    for (int i = 0; i < 11; i++)
+        EXPECT_GT(seen[i], 0) << "value " << i;
+
+    BN_free(r);
+    BN_free(range);
+}
+
+TEST(rng, seeded_encoding)
+{
+    BIGNUM* a = BN_new();
+    BN_dec2bn(&a, A);
+    BIGNUM* b = BN_new();
+    BN_dec2bn(&b, B);
+    BIGNUM* prime = BN_new();
+    BN_dec2bn(&prime, P);
+    EC_GROUP* group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+    const EC_POINT* point = EC_GROUP_get0_generator(group);
+
+    // The same seed yields the same test vector
+    rng_seed(7);
+    BIGNUM** first = es_encode((EC_POINT*) point, group, a, b, prime);
+    rng_seed(7);
+    BIGNUM** second = es_encode((EC_POINT*) point, group, a, b, prime);
+    rng_set_source(NULL, NULL);
+
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+    EXPECT_EQ(BN_cmp(first[0], second[0]), 0);
+    EXPECT_EQ(BN_cmp(first[1], second[1]), 0);
+
+    for (int i = 0; i < 2; i++)
+    {
+        BN_free(first[i]);
+        BN_free(second[i]);
+    }
+    free(first);
+    free(second);
+    EC_GROUP_free(group);
+    BN_free(a);
+    BN_free(b);
+    BN_free(prime);
+}
@@ -0,0 +1,109 @@
+#include "gtest/gtest.h"
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/obj_mac.h>
+#include <cstdio>
+#include "util.h"
+
+TEST(util, bignums_bin_round_trip)
+{
+    const int count = 5;
+    const char* filename = "bignums_tst.bin";
+    BIGNUM* values[count];
+    for (int i = 0; i < count; i++)
+        values[i] = BN_new();
+    BN_zero(values[0]);
+    BN_set_word(values[1], 1);
+    BN_dec2bn(&values[2], "115792089210356248762697446949407573530086143415290314195533631308867097853951");
+    BN_set_word(values[3], 0xdeadbeef);
+    BN_dec2bn(&values[4], "41058363725152142129326129780047268409114441015993725554835256314039467401291");
+
+    ASSERT_EQ(export_bignums_bin(filename, values, count, 32), 0);
+
+    BIGNUM** imported = import_bignums_bin(filename, count);
+    ASSERT_NE(imported, nullptr);
+    for (int i = 0; i < count; i++)
+        EXPECT_EQ(BN_cmp(imported[i], values[i]), 0) << "index " << i;
+    free_hashes(imported, count);
+
+    // A prefix can be read, more values than stored cannot
+    imported = import_bignums_bin(filename, 2);
+    ASSERT_NE(imported, nullptr);
+    EXPECT_EQ(BN_cmp(imported[1], values[1]), 0);
+    free_hashes(imported, 2);
+    EXPECT_EQ(import_bignums_bin(filename, count + 1), nullptr);
+
+    // Values wider than the fixture are rejected
+    EXPECT_EQ(export_bignums_bin(filename, values, count, 16), -1);
+
+    remove(filename);
+    for (int i = 0; i < count; i++)
+        BN_free(values[i]);
+}
+
+static void points_bin_round_trip(point_conversion_form_t form)
+{
+    const int count = 16;
+    const char* filename = "points_tst.bin";
+    EC_GROUP* group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+    BN_CTX* ctx = BN_CTX_new();
+
+    EC_POINT** points = read_points("points.txt", group, count);
+    ASSERT_NE(points, nullptr);
+    ASSERT_EQ(export_points_bin(filename, points, count, group, form), 0);
+
+    // read_points recognizes the binary fixture
+    EC_POINT** imported = read_points(filename, group, count);
+    ASSERT_NE(imported, nullptr);
+    for (int i = 0; i < count; i++)
+        EXPECT_EQ(EC_POINT_cmp(group, imported[i], points[i], ctx), 0) << "index " << i;
+    free_points(imported, count);
+
+    // Entries can also be materialized one at a time
+    struct fixture* fx = fixture_open(filename, POINTS_BIN_MAGIC);
+    ASSERT_NE(fx, nullptr);
+    EXPECT_EQ(fx->count, (uint32_t) count);
+    EXPECT_EQ(fx->width, form == POINT_CONVERSION_COMPRESSED ? 33u : 65u);
+    EC_POINT* point = fixture_point(fx, count - 1, group, ctx);
+    ASSERT_NE(point, nullptr);
+    EXPECT_EQ(EC_POINT_cmp(group, point, points[count - 1], ctx), 0);
+    EC_POINT_free(point);
+    fixture_close(fx);
+
+    // A point fixture is not a BIGNUM fixture
+    EXPECT_EQ(fixture_open(filename, BIGNUMS_BIN_MAGIC), nullptr);
+    EXPECT_EQ(read_points(filename, group, count + 1), nullptr);
+
+    remove(filename);
+    free_points(points, count);
+    BN_CTX_free(ctx);
+    EC_GROUP_free(group);
+}
+
+TEST(util, points_bin_uncompressed)
+{
+    points_bin_round_trip(POINT_CONVERSION_UNCOMPRESSED);
+}
+
+TEST(util, points_bin_compressed)
+{
+    points_bin_round_trip(POINT_CONVERSION_COMPRESSED);
+}
+
+TEST(util, hashes_bin)
+{
+    const int count = 8;
+    const char* filename = "hashes_tst.bin";
+    BIGNUM** hashes = read_hashes("hashes.txt", count);
+    ASSERT_NE(hashes, nullptr);
+    ASSERT_EQ(export_bignums_bin(filename, hashes, count, 32), 0);
+
+    BIGNUM** imported = read_hashes(filename, count);
+    ASSERT_NE(imported, nullptr);
+    for (int i = 0; i < count; i++)
+        EXPECT_EQ(BN_cmp(imported[i], hashes[i]), 0) << "index " << i;
+
+    remove(filename);
+    free_hashes(imported, count);
+    free_hashes(hashes, count);
+}
@@ -4,6 +4,7 @@
 #include <cstring>
 #include "gtest/gtest.h"
 #include "weaver.h"
+#include "rng.h"
 
 TEST(weave, test1)
 {
@@ -65,3 +66,50 @@ TEST(weave, test1)
         EXPECT_EQ(cmp_values[i], 0);
     }
 }
+
+TEST(weave, random_vectors)
+{
+    const int n = 20;
+    BN_CTX* ctx = BN_CTX_new();
+    BIGNUM* prime = BN_new();
+    BN_dec2bn(&prime, "115792089210356248762697446949407573530086143415290314195533631308867097853951");
+
+    // A seeded stream makes failures reproducible
+    rng_seed(2024);
+    BIGNUM** x_values = (BIGNUM**) malloc(n * sizeof(BIGNUM*));
+    BIGNUM** y_values = (BIGNUM**) malloc(n * sizeof(BIGNUM*));
+    for (int i = 0; i < n; i++)
+    {
+        x_values[i] = BN_new();
+        y_values[i] = BN_new();
+        ASSERT_EQ(rng_range(x_values[i], prime), 1);
+        ASSERT_EQ(rng_range(y_values[i], prime), 1);
+    }
+    rng_set_source(NULL, NULL);
+
+    BIGNUM** matrix = precompute(x_values, n, prime, ctx);
+    BIGNUM** vals = weave(y_values, matrix, n, prime, ctx);
+
+    for (int i = 0; i < n; i++)
+    {
+        BIGNUM* y = evaluate(vals, x_values[i], n, prime, ctx);
+        EXPECT_EQ(BN_cmp(y, y_values[i]), 0) << "index " << i;
+        BN_free(y);
+    }
+
+    for (int i = 0; i < n * n; i++)
+        BN_free(matrix[i]);
+    free(matrix);
+    for (int i = 0; i < n; i++)
+    {
+        BN_free(vals[i]);
+        BN_free(x_values[i]);
+        BN_free(y_values[i]);
+    }
+    free(vals);
+    free(x_values);
+    free(y_values);
+
+    BN_free(prime);
+    BN_CTX_free(ctx);
+}
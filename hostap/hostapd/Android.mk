@@ -257,6 +257,7 @@ endif
 ifdef CONFIG_SAE
 L_CFLAGS += -DCONFIG_SAE
 OBJS += src/common/sae.c
+OBJS += src/crypto/sha256-mb.c
 ifdef CONFIG_SAE_PK
 L_CFLAGS += -DCONFIG_SAE_PK
 NEED_AES_SIV=y
@@ -1062,6 +1063,8 @@ ifdef NEED_AP_MLME
 OBJS += src/ap/wmm.c
 OBJS += src/ap/ap_list.c
 OBJS += src/ap/comeback_token.c
+OBJS += src/ap/decoy_alert.c
+OBJS += src/ap/decoy_table.c
 OBJS += src/pasn/pasn_responder.c
 OBJS += src/pasn/pasn_common.c
 OBJS += src/ap/ieee802_11.c
@@ -4649,6 +4649,23 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		bss->anti_clogging_threshold = atoi(pos);
 	} else if (os_strcmp(buf, "sae_sync") == 0) {
 		bss->sae_sync = atoi(pos);
+	} else if (os_strcmp(buf, "sae_pool_size") == 0) {
+		bss->sae_pool_size = atoi(pos);
+	} else if (os_strcmp(buf, "sae_cpu_budget") == 0) {
+		bss->sae_cpu_budget = atoi(pos);
+	} else if (os_strcmp(buf, "decoy_alert_socket") == 0) {
+		os_free(bss->decoy_alert_socket);
+		bss->decoy_alert_socket = os_strdup(pos);
+	} else if (os_strcmp(buf, "sae_queue_cpu_share") == 0) {
+		int val = atoi(pos);
+
+		if (val < 1 || val > 100) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: Invalid sae_queue_cpu_share %d",
+				   line, val);
+			return 1;
+		}
+		bss->sae_queue_cpu_share = val;
 	} else if (os_strcmp(buf, "sae_groups") == 0) {
 		if (hostapd_parse_intlist(&bss->sae_groups, pos)) {
 			wpa_printf(MSG_ERROR,
@@ -126,6 +126,9 @@ void hostapd_config_defaults_bss(struct hostapd_bss_config *bss)
 
 	bss->anti_clogging_threshold = 5;
 	bss->sae_sync = 3;
+	bss->sae_pool_size = 4;
+	bss->sae_cpu_budget = 500;
+	bss->sae_queue_cpu_share = 50;
 
 	bss->gas_frag_limit = 1400;
 
@@ -962,6 +965,7 @@ void hostapd_config_free_bss(struct hostapd_bss_config *conf)
 	wpabuf_free(conf->assocresp_elements);
 
 	os_free(conf->sae_groups);
+	os_free(conf->decoy_alert_socket);
 #ifdef CONFIG_OWE
 	os_free(conf->owe_groups);
 #endif /* CONFIG_OWE */
@@ -683,6 +683,10 @@ struct hostapd_bss_config {
 
 	unsigned int anti_clogging_threshold;
 	unsigned int sae_sync;
+	unsigned int sae_pool_size;
+	unsigned int sae_cpu_budget; /* msec of SAE work per second, 0 = off */
+	unsigned int sae_queue_cpu_share; /* percent */
+	char *decoy_alert_socket;
 	int sae_require_mfp;
 	int sae_confirm_immediate;
 	enum sae_pwe sae_pwe;
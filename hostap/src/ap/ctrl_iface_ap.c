@@ -1112,6 +1112,26 @@ int hostapd_ctrl_iface_status(struct hostapd_data *hapd, char *buf,
 			len += ret;
 		}
 #endif /* CONFIG_IEEE80211BE */
+
+#ifdef CONFIG_SAE
+		if (bss->sae_pool) {
+			struct sae_ap_pool_stats stats;
+
+			sae_ap_pool_stats(bss->sae_pool, &stats);
+			ret = os_snprintf(buf + len, buflen - len,
+					  "sae_pool_len[%d]=%u\n"
+					  "sae_pool_size[%d]=%u\n"
+					  "sae_pool_hits[%d]=%u\n"
+					  "sae_pool_misses[%d]=%u\n",
+					  (int) i, stats.len,
+					  (int) i, stats.size,
+					  (int) i, stats.hits,
+					  (int) i, stats.misses);
+			if (os_snprintf_error(buflen - len, ret))
+				return len;
+			len += ret;
+		}
+#endif /* CONFIG_SAE */
 	}
 
 	if (hapd->conf->chan_util_avg_period) {
@@ -0,0 +1,245 @@
+/*
+ * hostapd / DecoyAuth hit alert stream
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * Matches of the confirmed SAE password index are recorded into a bounded
+ * single-producer/single-consumer ring on the handshake path. Formatting the
+ * DECOY-AUTH-HIT event and delivering it to ctrl_iface monitors (and
+ * optionally to a UNIX datagram socket in batches) is deferred to an eloop
+ * timeout so that the authentication path never blocks on log output.
+ */
+
+#include "utils/includes.h"
+#include <fcntl.h>
+#include <sys/un.h>
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "common/wpa_ctrl.h"
+#include "decoy_alert.h"
+
+#define DECOY_ALERT_RING_SIZE 256 /* must be a power of two */
+#define DECOY_ALERT_BATCH_LEN 4096
+
+struct decoy_alert {
+	u8 addr[ETH_ALEN];
+	u8 bssid[ETH_ALEN];
+	int password_index;
+	u8 real;
+	u8 cached;
+	struct os_time ts;
+};
+
+struct decoy_alert_ring {
+	void *msg_ctx;
+	int sock;
+	struct sockaddr_un dst;
+	unsigned int head; /* written by the producer only */
+	unsigned int tail; /* written by the consumer only */
+	unsigned int dropped;
+	int scheduled;
+	struct decoy_alert entry[DECOY_ALERT_RING_SIZE];
+};
+
+
+static void decoy_alert_drain(void *eloop_ctx, void *timeout_ctx);
+
+
+static int decoy_alert_open_socket(struct decoy_alert_ring *ring,
+				   const char *path)
+{
+	if (os_strlen(path) >= sizeof(ring->dst.sun_path)) {
+		wpa_printf(MSG_ERROR, "DecoyAuth: Too long alert socket path");
+		return -1;
+	}
+
+	ring->sock = socket(PF_UNIX, SOCK_DGRAM, 0);
+	if (ring->sock < 0) {
+		wpa_printf(MSG_ERROR, "DecoyAuth: socket(PF_UNIX): %s",
+			   strerror(errno));
+		return -1;
+	}
+	if (fcntl(ring->sock, F_SETFL, O_NONBLOCK) < 0) {
+		wpa_printf(MSG_ERROR, "DecoyAuth: fcntl(O_NONBLOCK): %s",
+			   strerror(errno));
+		close(ring->sock);
+		ring->sock = -1;
+		return -1;
+	}
+
+	ring->dst.sun_family = AF_UNIX;
+	os_strlcpy(ring->dst.sun_path, path, sizeof(ring->dst.sun_path));
+	return 0;
+}
+
+
+/**
+ * decoy_alert_init - Allocate a DecoyAuth hit alert ring
+ * @msg_ctx: Context for wpa_msg() when delivering events to monitors
+ * @sock_path: UNIX datagram socket to copy events to or %NULL
+ * Returns: Pointer to the ring or %NULL on failure
+ */
+struct decoy_alert_ring * decoy_alert_init(void *msg_ctx,
+					   const char *sock_path)
+{
+	struct decoy_alert_ring *ring;
+
+	ring = os_zalloc(sizeof(*ring));
+	if (!ring)
+		return NULL;
+	ring->msg_ctx = msg_ctx;
+	ring->sock = -1;
+
+	if (sock_path && sock_path[0] &&
+	    decoy_alert_open_socket(ring, sock_path) < 0) {
+		os_free(ring);
+		return NULL;
+	}
+
+	return ring;
+}
+
+
+/**
+ * decoy_alert_deinit - Deliver pending alerts and free the ring
+ * @ring: Ring from decoy_alert_init() or %NULL
+ */
+void decoy_alert_deinit(struct decoy_alert_ring *ring)
+{
+	if (!ring)
+		return;
+	decoy_alert_flush(ring);
+	eloop_cancel_timeout(decoy_alert_drain, ring, NULL);
+	if (ring->sock >= 0)
+		close(ring->sock);
+	os_free(ring);
+}
+
+
+/**
+ * decoy_alert_post - Record a confirmed password index match
+ * @ring: Ring from decoy_alert_init()
+ * @addr: STA address
+ * @bssid: BSSID of the BSS that authenticated the STA
+ * @password_index: Index of the password that the STA confirmed
+ * @real: Whether @password_index is the real password
+ * @cached: Whether the match was recovered from a PMKSA cache entry
+ * Returns: 0 on success or -1 if the ring is full and the alert was dropped
+ *
+ * This does not format or send anything; it only copies the record into the
+ * ring and makes sure a drain is scheduled.
+ */
+int decoy_alert_post(struct decoy_alert_ring *ring, const u8 *addr,
+		     const u8 *bssid, int password_index, int real,
+		     int cached)
+{
+	struct decoy_alert *a;
+	unsigned int head, tail;
+
+	if (!ring)
+		return -1;
+
+	head = ring->head;
+	tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	if (head - tail >= DECOY_ALERT_RING_SIZE) {
+		__atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+		return -1;
+	}
+
+	a = &ring->entry[head & (DECOY_ALERT_RING_SIZE - 1)];
+	os_memcpy(a->addr, addr, ETH_ALEN);
+	os_memcpy(a->bssid, bssid, ETH_ALEN);
+	a->password_index = password_index;
+	a->real = !!real;
+	a->cached = !!cached;
+	os_get_time(&a->ts);
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+	if (!ring->scheduled) {
+		ring->scheduled = 1;
+		eloop_register_timeout(0, 0, decoy_alert_drain, ring, NULL);
+	}
+
+	return 0;
+}
+
+
+static void decoy_alert_send(struct decoy_alert_ring *ring, const char *buf,
+			     size_t len)
+{
+	if (ring->sock < 0 || len == 0)
+		return;
+	if (sendto(ring->sock, buf, len, MSG_DONTWAIT,
+		   (struct sockaddr *) &ring->dst, sizeof(ring->dst)) < 0)
+		wpa_printf(MSG_DEBUG, "DecoyAuth: Alert sendto(%s): %s",
+			   ring->dst.sun_path, strerror(errno));
+}
+
+
+/**
+ * decoy_alert_flush - Deliver all pending alerts
+ * @ring: Ring from decoy_alert_init()
+ *
+ * Each record becomes a DECOY-AUTH-HIT event for ctrl_iface monitors. When an
+ * alert socket is configured, the same lines are sent to it newline separated,
+ * packed into as few datagrams as possible.
+ */
+void decoy_alert_flush(struct decoy_alert_ring *ring)
+{
+	char batch[DECOY_ALERT_BATCH_LEN];
+	char line[128];
+	size_t batch_len = 0;
+	unsigned int head, tail, dropped;
+	int len;
+
+	if (!ring)
+		return;
+
+	tail = ring->tail;
+	head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	while (tail != head) {
+		const struct decoy_alert *a;
+
+		a = &ring->entry[tail & (DECOY_ALERT_RING_SIZE - 1)];
+		len = os_snprintf(line, sizeof(line), DECOY_AUTH_HIT MACSTR
+				  " bssid=" MACSTR
+				  " index=%d class=%s pmksa=%d ts=%ld.%06ld",
+				  MAC2STR(a->addr), MAC2STR(a->bssid),
+				  a->password_index,
+				  a->real ? "real" : "decoy", a->cached,
+				  (long) a->ts.sec, (long) a->ts.usec);
+		tail++;
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+		if (os_snprintf_error(sizeof(line), len))
+			continue;
+
+		wpa_msg(ring->msg_ctx, MSG_INFO, "%s", line);
+
+		if (ring->sock < 0)
+			continue;
+		if (batch_len + len + 1 > sizeof(batch)) {
+			decoy_alert_send(ring, batch, batch_len);
+			batch_len = 0;
+		}
+		os_memcpy(batch + batch_len, line, len);
+		batch_len += len;
+		batch[batch_len++] = '\n';
+	}
+	decoy_alert_send(ring, batch, batch_len);
+
+	dropped = __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+	if (dropped)
+		wpa_printf(MSG_INFO, "DecoyAuth: Dropped %u alerts (ring full)",
+			   dropped);
+}
+
+
+static void decoy_alert_drain(void *eloop_ctx, void *timeout_ctx)
+{
+	struct decoy_alert_ring *ring = eloop_ctx;
+
+	ring->scheduled = 0;
+	decoy_alert_flush(ring);
+}
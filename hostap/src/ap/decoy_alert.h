@@ -0,0 +1,21 @@
+/*
+ * hostapd / DecoyAuth hit alert stream
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef DECOY_ALERT_H
+#define DECOY_ALERT_H
+
+struct decoy_alert_ring;
+
+struct decoy_alert_ring * decoy_alert_init(void *msg_ctx,
+					   const char *sock_path);
+void decoy_alert_deinit(struct decoy_alert_ring *ring);
+int decoy_alert_post(struct decoy_alert_ring *ring, const u8 *addr,
+		     const u8 *bssid, int password_index, int real,
+		     int cached);
+void decoy_alert_flush(struct decoy_alert_ring *ring);
+
+#endif /* DECOY_ALERT_H */
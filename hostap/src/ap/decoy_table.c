@@ -0,0 +1,208 @@
+/*
+ * hostapd / Shared DecoyAuth password tables
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * The tables derived from a DecoyAuth password set (password hashes and the
+ * interpolation matrix) are read-only and grow quadratically with the number
+ * of passwords. BSSes that use the same password set and group share a single
+ * copy from a registry in struct hapd_interfaces, keyed by a digest of the
+ * password set. A BSS holds one reference per group it has used; on reload it
+ * takes a reference to the table for its new password set before dropping the
+ * old one so that an unchanged set is never rebuilt and a changed set gets a
+ * new table while other BSSes keep using the old one.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "utils/list.h"
+#include "crypto/sha256.h"
+#include "common/sae.h"
+#include "hostapd.h"
+#include "decoy_table.h"
+
+
+struct hostapd_decoy_table {
+	struct dl_list list; /* in hapd_interfaces::decoy_tables */
+	u8 digest[SHA256_MAC_LEN];
+	int group;
+	unsigned int refcount;
+	struct sae_decoy_table *table;
+};
+
+
+/* The built-in DecoyAuth password set, the real password at index 0 */
+static int hostapd_decoy_passwords(struct hostapd_data *hapd,
+				   char passwords[][20], size_t *lens,
+				   int num_passwords)
+{
+	int i, res;
+
+	for (i = 0; i < num_passwords; i++) {
+		res = os_snprintf(passwords[i], 20, "PASSWORD_%d", i);
+		if (os_snprintf_error(20, res))
+			return -1;
+		lens[i] = res;
+	}
+	return 0;
+}
+
+
+static int hostapd_decoy_digest(int group, char passwords[][20],
+				const size_t *lens, int num_passwords,
+				u8 *digest)
+{
+	const u8 *addr[1 + 2 * SAE_AP_NUM_PASSWORDS];
+	size_t len[1 + 2 * SAE_AP_NUM_PASSWORDS];
+	u8 group_buf[2], len_buf[SAE_AP_NUM_PASSWORDS][2];
+	int i;
+
+	WPA_PUT_LE16(group_buf, group);
+	addr[0] = group_buf;
+	len[0] = sizeof(group_buf);
+	for (i = 0; i < num_passwords; i++) {
+		WPA_PUT_LE16(len_buf[i], lens[i]);
+		addr[1 + 2 * i] = len_buf[i];
+		len[1 + 2 * i] = 2;
+		addr[2 + 2 * i] = (const u8 *) passwords[i];
+		len[2 + 2 * i] = lens[i];
+	}
+	return sha256_vector(1 + 2 * num_passwords, addr, len, digest);
+}
+
+
+static void hostapd_decoy_table_put(struct hostapd_decoy_table *entry)
+{
+	if (!entry || --entry->refcount > 0)
+		return;
+	wpa_printf(MSG_DEBUG, "DecoyAuth: Free table for group %d",
+		   entry->group);
+	if (entry->list.next)
+		dl_list_del(&entry->list);
+	sae_decoy_table_deinit(entry->table);
+	os_free(entry);
+}
+
+
+static struct hostapd_decoy_table *
+hostapd_decoy_table_get(struct hostapd_data *hapd, int group)
+{
+	struct hapd_interfaces *interfaces = hapd->iface->interfaces;
+	char passwords[SAE_AP_NUM_PASSWORDS][20];
+	const u8 *pw[SAE_AP_NUM_PASSWORDS];
+	size_t lens[SAE_AP_NUM_PASSWORDS];
+	struct hostapd_decoy_table *entry;
+	u8 digest[SHA256_MAC_LEN];
+	int i;
+
+	if (hostapd_decoy_passwords(hapd, passwords, lens,
+				    SAE_AP_NUM_PASSWORDS) < 0 ||
+	    hostapd_decoy_digest(group, passwords, lens, SAE_AP_NUM_PASSWORDS,
+				 digest) < 0)
+		return NULL;
+
+	if (interfaces) {
+		dl_list_for_each(entry, &interfaces->decoy_tables,
+				 struct hostapd_decoy_table, list) {
+			if (entry->group == group &&
+			    os_memcmp(entry->digest, digest,
+				      SHA256_MAC_LEN) == 0) {
+				entry->refcount++;
+				return entry;
+			}
+		}
+	}
+
+	entry = os_zalloc(sizeof(*entry));
+	if (!entry)
+		return NULL;
+	for (i = 0; i < SAE_AP_NUM_PASSWORDS; i++)
+		pw[i] = (const u8 *) passwords[i];
+	entry->table = sae_decoy_table_init(group, pw, lens,
+					    SAE_AP_NUM_PASSWORDS);
+	forced_memzero(passwords, sizeof(passwords));
+	if (!entry->table) {
+		os_free(entry);
+		return NULL;
+	}
+	os_memcpy(entry->digest, digest, SHA256_MAC_LEN);
+	entry->group = group;
+	entry->refcount = 1;
+	/* wpa_supplicant AP mode has no registry; keep the table private */
+	if (interfaces)
+		dl_list_add(&interfaces->decoy_tables, &entry->list);
+	wpa_printf(MSG_DEBUG, "DecoyAuth: Built table for group %d", group);
+	return entry;
+}
+
+
+/**
+ * hostapd_decoy_table - Get the DecoyAuth table of a BSS for a group
+ * @hapd: BSS data
+ * @group: Finite cyclic group of the SAE exchange
+ * Returns: Shared table or %NULL on failure
+ *
+ * The BSS keeps its reference until hostapd_decoy_tables_release().
+ */
+const struct sae_decoy_table * hostapd_decoy_table(struct hostapd_data *hapd,
+						   int group)
+{
+	struct hostapd_decoy_table *entry, **tables;
+	size_t i;
+
+	for (i = 0; i < hapd->num_sae_decoys; i++) {
+		if (hapd->sae_decoys[i]->group == group)
+			return hapd->sae_decoys[i]->table;
+	}
+
+	tables = os_realloc_array(hapd->sae_decoys, hapd->num_sae_decoys + 1,
+				  sizeof(*tables));
+	if (!tables)
+		return NULL;
+	hapd->sae_decoys = tables;
+	entry = hostapd_decoy_table_get(hapd, group);
+	if (!entry)
+		return NULL;
+	hapd->sae_decoys[hapd->num_sae_decoys++] = entry;
+	return entry->table;
+}
+
+
+/**
+ * hostapd_decoy_tables_reload - Switch a BSS to its current password set
+ * @hapd: BSS data
+ *
+ * Called after a configuration reload. Tables of other BSSes are not touched.
+ */
+void hostapd_decoy_tables_reload(struct hostapd_data *hapd)
+{
+	struct hostapd_decoy_table *entry;
+	size_t i;
+
+	for (i = 0; i < hapd->num_sae_decoys; i++) {
+		entry = hostapd_decoy_table_get(hapd,
+						hapd->sae_decoys[i]->group);
+		if (!entry)
+			continue; /* keep the old table */
+		hostapd_decoy_table_put(hapd->sae_decoys[i]);
+		hapd->sae_decoys[i] = entry;
+	}
+}
+
+
+/**
+ * hostapd_decoy_tables_release - Drop all DecoyAuth table references of a BSS
+ * @hapd: BSS data
+ */
+void hostapd_decoy_tables_release(struct hostapd_data *hapd)
+{
+	size_t i;
+
+	for (i = 0; i < hapd->num_sae_decoys; i++)
+		hostapd_decoy_table_put(hapd->sae_decoys[i]);
+	os_free(hapd->sae_decoys);
+	hapd->sae_decoys = NULL;
+	hapd->num_sae_decoys = 0;
+}
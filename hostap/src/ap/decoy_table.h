@@ -0,0 +1,18 @@
+/*
+ * hostapd / Shared DecoyAuth password tables
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef DECOY_TABLE_H
+#define DECOY_TABLE_H
+
+struct sae_decoy_table;
+
+const struct sae_decoy_table * hostapd_decoy_table(struct hostapd_data *hapd,
+						   int group);
+void hostapd_decoy_tables_reload(struct hostapd_data *hapd);
+void hostapd_decoy_tables_release(struct hostapd_data *hapd);
+
+#endif /* DECOY_TABLE_H */
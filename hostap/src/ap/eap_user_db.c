@@ -8,10 +8,12 @@
 
 #include "includes.h"
 #ifdef CONFIG_SQLITE
+#include <sys/stat.h>
 #include <sqlite3.h>
 #endif /* CONFIG_SQLITE */
 
 #include "common.h"
+#include "utils/list.h"
 #include "eap_common/eap_wsc_common.h"
 #include "eap_server/eap_methods.h"
 #include "eap_server/eap.h"
@@ -76,68 +78,476 @@ static void set_user_methods(struct hostapd_eap_user *user, const char *methods)
 }
 
 
-static int get_user_cb(void *ctx, int argc, char *argv[], char *col[])
+/*
+ * The database connection is kept open for the lifetime of the BSS. Resolved
+ * lookups, including misses, are kept in a small LRU cache and the wildcard
+ * rules are kept in memory in a prefix tree. Both are dropped whenever
+ * another connection, of another process or of the RADIUS server of this
+ * process, commits a change, so that it is picked up on the next lookup.
+ * Changes are detected with PRAGMA data_version, which also covers commits
+ * into the write-ahead log that leave the database file itself untouched.
+ * stat() only detects the file being replaced.
+ */
+
+#define EAP_USER_DB_CACHE_SIZE 1024
+#define EAP_USER_DB_HASH_SIZE 256
+
+struct eap_user_db_entry {
+	struct dl_list list; /* LRU order, most recently used first */
+	struct dl_list hash;
+	u8 *key;
+	size_t key_len;
+	int phase2;
+	int found;
+	struct hostapd_eap_user user;
+};
+
+struct eap_user_wildcard {
+	char *identity;
+	char *methods;
+};
+
+/* Prefix tree node of the wildcard rules, linked by index into db->nodes */
+struct eap_user_trie_node {
+	int child;
+	int sibling;
+	int wildcard; /* index into db->wildcards, -1 if no rule ends here */
+	u8 c;
+};
+
+struct eap_user_db {
+	char *fname;
+	sqlite3 *db;
+	sqlite3_stmt *user_stmt;
+	sqlite3_stmt *version_stmt;
+	sqlite3_int64 data_version;
+
+	dev_t dev;
+	ino_t ino;
+
+	struct dl_list lru;
+	struct dl_list hash[EAP_USER_DB_HASH_SIZE];
+	size_t cache_count;
+
+	struct eap_user_wildcard *wildcards;
+	size_t num_wildcards;
+	struct eap_user_trie_node *nodes;
+	size_t num_nodes;
+};
+
+
+static void eap_user_db_entry_free(struct eap_user_db_entry *entry)
 {
-	struct hostapd_eap_user *user = ctx;
-	int i;
+	dl_list_del(&entry->list);
+	dl_list_del(&entry->hash);
+	os_free(entry->key);
+	bin_clear_free(entry->user.identity, entry->user.identity_len);
+	bin_clear_free(entry->user.password, entry->user.password_len);
+	os_free(entry);
+}
 
-	for (i = 0; i < argc; i++) {
-		if (os_strcmp(col[i], "password") == 0 && argv[i]) {
-			bin_clear_free(user->password, user->password_len);
-			user->password_len = os_strlen(argv[i]);
-			user->password = (u8 *) os_strdup(argv[i]);
-			user->next = (void *) 1;
-		} else if (os_strcmp(col[i], "methods") == 0 && argv[i]) {
-			set_user_methods(user, argv[i]);
-		} else if (os_strcmp(col[i], "remediation") == 0 && argv[i]) {
-			user->remediation = strlen(argv[i]) > 0;
-		} else if (os_strcmp(col[i], "t_c_timestamp") == 0 && argv[i]) {
-			user->t_c_timestamp = strtol(argv[i], NULL, 10);
+
+static void eap_user_db_flush(struct eap_user_db *db)
+{
+	struct eap_user_db_entry *entry, *tmp;
+	size_t i;
+
+	dl_list_for_each_safe(entry, tmp, &db->lru, struct eap_user_db_entry,
+			      list)
+		eap_user_db_entry_free(entry);
+	db->cache_count = 0;
+
+	for (i = 0; i < db->num_wildcards; i++) {
+		os_free(db->wildcards[i].identity);
+		os_free(db->wildcards[i].methods);
+	}
+	os_free(db->wildcards);
+	db->wildcards = NULL;
+	db->num_wildcards = 0;
+	os_free(db->nodes);
+	db->nodes = NULL;
+	db->num_nodes = 0;
+}
+
+
+static void eap_user_db_free(struct eap_user_db *db)
+{
+	if (!db)
+		return;
+	eap_user_db_flush(db);
+	sqlite3_finalize(db->user_stmt);
+	sqlite3_finalize(db->version_stmt);
+	sqlite3_close(db->db);
+	os_free(db->fname);
+	os_free(db);
+}
+
+
+static int eap_user_trie_add_node(struct eap_user_db *db, u8 c)
+{
+	struct eap_user_trie_node *nodes, *node;
+
+	nodes = os_realloc_array(db->nodes, db->num_nodes + 1, sizeof(*nodes));
+	if (!nodes)
+		return -1;
+	db->nodes = nodes;
+	node = &nodes[db->num_nodes];
+	node->child = -1;
+	node->sibling = -1;
+	node->wildcard = -1;
+	node->c = c;
+	return db->num_nodes++;
+}
+
+
+static int eap_user_trie_insert(struct eap_user_db *db, const char *identity,
+				int wildcard)
+{
+	const u8 *pos = (const u8 *) identity;
+	int node = 0, next;
+
+	if (!db->nodes && eap_user_trie_add_node(db, 0) < 0)
+		return -1;
+
+	for (; *pos; pos++) {
+		for (next = db->nodes[node].child; next >= 0;
+		     next = db->nodes[next].sibling) {
+			if (db->nodes[next].c == *pos)
+				break;
+		}
+		if (next < 0) {
+			next = eap_user_trie_add_node(db, *pos);
+			if (next < 0)
+				return -1;
+			db->nodes[next].sibling = db->nodes[node].child;
+			db->nodes[node].child = next;
 		}
+		node = next;
 	}
 
+	/* With duplicate rules, the first one in the table is used */
+	if (db->nodes[node].wildcard < 0)
+		db->nodes[node].wildcard = wildcard;
 	return 0;
 }
 
 
-static int get_wildcard_cb(void *ctx, int argc, char *argv[], char *col[])
+/* The rule with the longest identity prefix of the identity, if any */
+static const struct eap_user_wildcard *
+eap_user_trie_match(struct eap_user_db *db, const u8 *identity,
+		    size_t identity_len)
 {
-	struct hostapd_eap_user *user = ctx;
-	int i, id = -1, methods = -1;
-	size_t len;
-
-	for (i = 0; i < argc; i++) {
-		if (os_strcmp(col[i], "identity") == 0 && argv[i])
-			id = i;
-		else if (os_strcmp(col[i], "methods") == 0 && argv[i])
-			methods = i;
+	int node = 0, match;
+	size_t i;
+
+	if (!db->nodes)
+		return NULL;
+
+	match = db->nodes[0].wildcard;
+	for (i = 0; i < identity_len; i++) {
+		for (node = db->nodes[node].child; node >= 0;
+		     node = db->nodes[node].sibling) {
+			if (db->nodes[node].c == identity[i])
+				break;
+		}
+		if (node < 0)
+			break;
+		if (db->nodes[node].wildcard >= 0)
+			match = db->nodes[node].wildcard;
+	}
+
+	return match >= 0 ? &db->wildcards[match] : NULL;
+}
+
+
+static void eap_user_db_load_wildcards(struct eap_user_db *db)
+{
+	const char *sql = "SELECT identity,methods FROM wildcards;";
+	sqlite3_stmt *stmt;
+
+	wpa_printf(MSG_DEBUG, "DB: %s", sql);
+	if (sqlite3_prepare_v2(db->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+		wpa_printf(MSG_DEBUG,
+			   "DB: Failed to complete SQL operation: %s  db: %s",
+			   sqlite3_errmsg(db->db), db->fname);
+		return;
+	}
+
+	while (sqlite3_step(stmt) == SQLITE_ROW) {
+		const char *identity, *methods;
+		struct eap_user_wildcard *wildcards, *wildcard;
+
+		identity = (const char *) sqlite3_column_text(stmt, 0);
+		methods = (const char *) sqlite3_column_text(stmt, 1);
+		if (!identity || !methods)
+			continue;
+
+		wildcards = os_realloc_array(db->wildcards,
+					     db->num_wildcards + 1,
+					     sizeof(*wildcards));
+		if (!wildcards)
+			break;
+		db->wildcards = wildcards;
+		wildcard = &wildcards[db->num_wildcards];
+		wildcard->identity = os_strdup(identity);
+		wildcard->methods = os_strdup(methods);
+		if (!wildcard->identity || !wildcard->methods ||
+		    eap_user_trie_insert(db, identity, db->num_wildcards) < 0) {
+			os_free(wildcard->identity);
+			os_free(wildcard->methods);
+			break;
+		}
+		db->num_wildcards++;
+	}
+
+	sqlite3_finalize(stmt);
+}
+
+
+/* Returns 1 if the file was replaced or removed since the previous call */
+static int eap_user_db_replaced(struct eap_user_db *db)
+{
+	struct stat st;
+	int replaced;
+
+	if (stat(db->fname, &st) < 0) {
+		/* Reopened, and so created again, as before the first lookup */
+		return 1;
+	}
+
+	replaced = st.st_dev != db->dev || st.st_ino != db->ino;
+	db->dev = st.st_dev;
+	db->ino = st.st_ino;
+	return replaced;
+}
+
+
+/*
+ * Returns the data version of the connection, which changes with every commit
+ * of another connection, or -1 if it cannot be read
+ */
+static sqlite3_int64 eap_user_db_data_version(struct eap_user_db *db)
+{
+	sqlite3_int64 version = -1;
+
+	if (!db->version_stmt)
+		return -1;
+	if (sqlite3_step(db->version_stmt) == SQLITE_ROW)
+		version = sqlite3_column_int64(db->version_stmt, 0);
+	sqlite3_reset(db->version_stmt);
+	return version;
+}
+
+
+static int eap_user_db_open(struct eap_user_db *db)
+{
+	const char *sql = "SELECT * FROM users WHERE identity=? AND phase2=?;";
+
+	sqlite3_finalize(db->user_stmt);
+	db->user_stmt = NULL;
+	sqlite3_finalize(db->version_stmt);
+	db->version_stmt = NULL;
+	sqlite3_close(db->db);
+	db->db = NULL;
+
+	if (sqlite3_open(db->fname, &db->db)) {
+		wpa_printf(MSG_INFO, "DB: Failed to open database %s: %s",
+			   db->fname, sqlite3_errmsg(db->db));
+		sqlite3_close(db->db);
+		db->db = NULL;
+		return -1;
+	}
+
+	if (sqlite3_prepare_v2(db->db, sql, -1, &db->user_stmt, NULL) !=
+	    SQLITE_OK) {
+		wpa_printf(MSG_DEBUG,
+			   "DB: Failed to complete SQL operation: %s  db: %s",
+			   sqlite3_errmsg(db->db), db->fname);
+		db->user_stmt = NULL;
 	}
 
-	if (id < 0 || methods < 0)
-		return 0;
-
-	len = os_strlen(argv[id]);
-	if (len <= user->identity_len &&
-	    os_memcmp(argv[id], user->identity, len) == 0 &&
-	    (user->password == NULL || len > user->password_len)) {
-		bin_clear_free(user->password, user->password_len);
-		user->password_len = os_strlen(argv[id]);
-		user->password = (u8 *) os_strdup(argv[id]);
-		user->next = (void *) 1;
-		set_user_methods(user, argv[methods]);
+	if (sqlite3_prepare_v2(db->db, "PRAGMA data_version;", -1,
+			       &db->version_stmt, NULL) != SQLITE_OK) {
+		wpa_printf(MSG_DEBUG,
+			   "DB: Failed to complete SQL operation: %s  db: %s",
+			   sqlite3_errmsg(db->db), db->fname);
+		db->version_stmt = NULL;
 	}
 
 	return 0;
 }
 
 
+/* Returns the connection of the BSS with the caches valid for the file */
+static struct eap_user_db * eap_user_db_get(struct hostapd_data *hapd)
+{
+	struct eap_user_db *db = hapd->eap_user_db;
+	sqlite3_int64 version = -1;
+	int changed = 0, replaced;
+
+	if (db && os_strcmp(db->fname, hapd->conf->eap_user_sqlite) != 0) {
+		eap_user_db_free(db);
+		db = hapd->eap_user_db = NULL;
+	}
+
+	if (!db) {
+		size_t i;
+
+		db = os_zalloc(sizeof(*db));
+		if (!db)
+			return NULL;
+		db->fname = os_strdup(hapd->conf->eap_user_sqlite);
+		if (!db->fname) {
+			os_free(db);
+			return NULL;
+		}
+		dl_list_init(&db->lru);
+		for (i = 0; i < EAP_USER_DB_HASH_SIZE; i++)
+			dl_list_init(&db->hash[i]);
+		hapd->eap_user_db = db;
+	}
+
+	replaced = eap_user_db_replaced(db);
+	if (db->db && !replaced) {
+		/* Without a version, nothing can be cached */
+		version = eap_user_db_data_version(db);
+		changed = version < 0 || version != db->data_version;
+	}
+
+	if (!db->db || replaced || (changed && !db->user_stmt)) {
+		eap_user_db_flush(db);
+		if (eap_user_db_open(db) < 0)
+			return NULL;
+		/* sqlite3_open() creates a missing file */
+		eap_user_db_replaced(db);
+		db->data_version = eap_user_db_data_version(db);
+		eap_user_db_load_wildcards(db);
+	} else if (changed) {
+		wpa_printf(MSG_DEBUG, "DB: %s changed - flush cached users",
+			   db->fname);
+		eap_user_db_flush(db);
+		db->data_version = version;
+		eap_user_db_load_wildcards(db);
+	}
+
+	return db;
+}
+
+
+static unsigned int eap_user_db_hash(const u8 *identity, size_t identity_len,
+				     int phase2)
+{
+	u32 hash = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < identity_len; i++)
+		hash = (hash ^ identity[i]) * 16777619U;
+	hash = (hash ^ !!phase2) * 16777619U;
+	return hash % EAP_USER_DB_HASH_SIZE;
+}
+
+
+static struct eap_user_db_entry *
+eap_user_db_cache_get(struct eap_user_db *db, const u8 *identity,
+		      size_t identity_len, int phase2)
+{
+	struct eap_user_db_entry *entry;
+	unsigned int hash = eap_user_db_hash(identity, identity_len, phase2);
+
+	dl_list_for_each(entry, &db->hash[hash], struct eap_user_db_entry,
+			 hash) {
+		if (entry->phase2 == phase2 &&
+		    entry->key_len == identity_len &&
+		    os_memcmp(entry->key, identity, identity_len) == 0) {
+			dl_list_del(&entry->list);
+			dl_list_add(&db->lru, &entry->list);
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+
+static void eap_user_db_cache_add(struct eap_user_db *db, const u8 *identity,
+				  size_t identity_len, int phase2,
+				  const struct hostapd_eap_user *user)
+{
+	struct eap_user_db_entry *entry;
+
+	if (db->cache_count >= EAP_USER_DB_CACHE_SIZE) {
+		entry = dl_list_last(&db->lru, struct eap_user_db_entry, list);
+		eap_user_db_entry_free(entry);
+		db->cache_count--;
+	}
+
+	entry = os_zalloc(sizeof(*entry));
+	if (!entry)
+		return;
+	entry->key = os_memdup(identity, identity_len);
+	entry->key_len = identity_len;
+	entry->phase2 = phase2;
+	if (user) {
+		entry->found = 1;
+		entry->user = *user;
+		entry->user.identity = os_memdup(user->identity,
+						 user->identity_len + 1);
+		entry->user.password = user->password ?
+			os_memdup(user->password, user->password_len + 1) :
+			NULL;
+	}
+	if (!entry->key ||
+	    (user && (!entry->user.identity ||
+		      (user->password && !entry->user.password)))) {
+		os_free(entry->key);
+		bin_clear_free(entry->user.identity, entry->user.identity_len);
+		bin_clear_free(entry->user.password, entry->user.password_len);
+		os_free(entry);
+		return;
+	}
+
+	dl_list_add(&db->lru, &entry->list);
+	dl_list_add(&db->hash[eap_user_db_hash(identity, identity_len, phase2)],
+		    &entry->hash);
+	db->cache_count++;
+}
+
+
+static void get_user_row(struct hostapd_eap_user *user, sqlite3_stmt *stmt)
+{
+	int i;
+
+	for (i = 0; i < sqlite3_column_count(stmt); i++) {
+		const char *col = sqlite3_column_name(stmt, i);
+		const char *val = (const char *) sqlite3_column_text(stmt, i);
+
+		if (!col || !val)
+			continue;
+		if (os_strcmp(col, "password") == 0) {
+			bin_clear_free(user->password, user->password_len);
+			user->password_len = os_strlen(val);
+			user->password = (u8 *) os_strdup(val);
+			user->next = (void *) 1;
+		} else if (os_strcmp(col, "methods") == 0) {
+			set_user_methods(user, val);
+		} else if (os_strcmp(col, "remediation") == 0) {
+			user->remediation = strlen(val) > 0;
+		} else if (os_strcmp(col, "t_c_timestamp") == 0) {
+			user->t_c_timestamp = strtol(val, NULL, 10);
+		}
+	}
+}
+
+
 static const struct hostapd_eap_user *
 eap_user_sqlite_get(struct hostapd_data *hapd, const u8 *identity,
 		    size_t identity_len, int phase2)
 {
-	sqlite3 *db;
+	struct eap_user_db *db;
+	struct eap_user_db_entry *entry;
 	struct hostapd_eap_user *user = NULL;
-	char id_str[256], cmd[300];
+	const struct eap_user_wildcard *wildcard;
+	char id_str[256];
 	size_t i;
 	int res;
 
@@ -170,6 +580,33 @@ eap_user_sqlite_get(struct hostapd_data *hapd, const u8 *identity,
 	bin_clear_free(hapd->tmp_eap_user.password,
 		       hapd->tmp_eap_user.password_len);
 	os_memset(&hapd->tmp_eap_user, 0, sizeof(hapd->tmp_eap_user));
+
+	db = eap_user_db_get(hapd);
+	if (!db)
+		return NULL;
+
+	entry = eap_user_db_cache_get(db, identity, identity_len, phase2);
+	if (entry) {
+		if (!entry->found)
+			return NULL;
+		hapd->tmp_eap_user = entry->user;
+		hapd->tmp_eap_user.identity =
+			os_memdup(entry->user.identity,
+				  entry->user.identity_len + 1);
+		hapd->tmp_eap_user.password = entry->user.password ?
+			os_memdup(entry->user.password,
+				  entry->user.password_len + 1) : NULL;
+		if (!hapd->tmp_eap_user.identity ||
+		    (entry->user.password && !hapd->tmp_eap_user.password)) {
+			bin_clear_free(hapd->tmp_eap_user.identity,
+				       hapd->tmp_eap_user.identity_len);
+			os_memset(&hapd->tmp_eap_user, 0,
+				  sizeof(hapd->tmp_eap_user));
+			return NULL;
+		}
+		return &hapd->tmp_eap_user;
+	}
+
 	hapd->tmp_eap_user.phase2 = phase2;
 	hapd->tmp_eap_user.identity = os_zalloc(identity_len + 1);
 	if (hapd->tmp_eap_user.identity == NULL)
@@ -177,54 +614,58 @@ eap_user_sqlite_get(struct hostapd_data *hapd, const u8 *identity,
 	os_memcpy(hapd->tmp_eap_user.identity, identity, identity_len);
 	hapd->tmp_eap_user.identity_len = identity_len;
 
-	if (sqlite3_open(hapd->conf->eap_user_sqlite, &db)) {
-		wpa_printf(MSG_INFO, "DB: Failed to open database %s: %s",
-			   hapd->conf->eap_user_sqlite, sqlite3_errmsg(db));
-		sqlite3_close(db);
-		return NULL;
-	}
-
-	res = os_snprintf(cmd, sizeof(cmd),
-			  "SELECT * FROM users WHERE identity='%s' AND phase2=%d;",
-			  id_str, phase2);
-	if (os_snprintf_error(sizeof(cmd), res))
-		goto fail;
-
-	wpa_printf(MSG_DEBUG, "DB: %s", cmd);
-	if (sqlite3_exec(db, cmd, get_user_cb, &hapd->tmp_eap_user, NULL) !=
-	    SQLITE_OK) {
+	if (db->user_stmt) {
 		wpa_printf(MSG_DEBUG,
-			   "DB: Failed to complete SQL operation: %s  db: %s",
-			   sqlite3_errmsg(db), hapd->conf->eap_user_sqlite);
-	} else if (hapd->tmp_eap_user.next)
-		user = &hapd->tmp_eap_user;
-
-	if (user == NULL && !phase2) {
-		os_snprintf(cmd, sizeof(cmd),
-			    "SELECT identity,methods FROM wildcards;");
-		wpa_printf(MSG_DEBUG, "DB: %s", cmd);
-		if (sqlite3_exec(db, cmd, get_wildcard_cb, &hapd->tmp_eap_user,
-				 NULL) != SQLITE_OK) {
+			   "DB: SELECT * FROM users WHERE identity='%s' AND phase2=%d;",
+			   id_str, phase2);
+		sqlite3_bind_text(db->user_stmt, 1, id_str, identity_len,
+				  SQLITE_STATIC);
+		sqlite3_bind_int(db->user_stmt, 2, phase2);
+		while ((res = sqlite3_step(db->user_stmt)) == SQLITE_ROW)
+			get_user_row(&hapd->tmp_eap_user, db->user_stmt);
+		if (res != SQLITE_DONE)
 			wpa_printf(MSG_DEBUG,
 				   "DB: Failed to complete SQL operation: %s  db: %s",
-				   sqlite3_errmsg(db),
-				   hapd->conf->eap_user_sqlite);
-		} else if (hapd->tmp_eap_user.next) {
+				   sqlite3_errmsg(db->db), db->fname);
+		else if (hapd->tmp_eap_user.next)
 			user = &hapd->tmp_eap_user;
-			os_free(user->identity);
-			user->identity = user->password;
-			user->identity_len = user->password_len;
+		sqlite3_reset(db->user_stmt);
+		sqlite3_clear_bindings(db->user_stmt);
+		if (res != SQLITE_DONE)
+			return user;
+	}
+
+	if (user == NULL && !phase2) {
+		wildcard = eap_user_trie_match(db, identity, identity_len);
+		if (wildcard) {
+			user = &hapd->tmp_eap_user;
+			bin_clear_free(user->password, user->password_len);
 			user->password = NULL;
 			user->password_len = 0;
+			os_free(user->identity);
+			user->identity_len = os_strlen(wildcard->identity);
+			user->identity = (u8 *) os_strdup(wildcard->identity);
+			if (!user->identity) {
+				user->identity_len = 0;
+				return NULL;
+			}
+			user->next = (void *) 1;
+			set_user_methods(user, wildcard->methods);
 		}
 	}
 
-fail:
-	sqlite3_close(db);
+	eap_user_db_cache_add(db, identity, identity_len, phase2, user);
 
 	return user;
 }
 
+
+void hostapd_eap_user_db_deinit(struct hostapd_data *hapd)
+{
+	eap_user_db_free(hapd->eap_user_db);
+	hapd->eap_user_db = NULL;
+}
+
 #endif /* CONFIG_SQLITE */
 
 
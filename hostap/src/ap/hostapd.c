@@ -38,6 +38,8 @@
 #include "nan_usd_ap.h"
 #include "gas_query_ap.h"
 #include "hw_features.h"
+#include "decoy_alert.h"
+#include "decoy_table.h"
 #include "wpa_auth_glue.h"
 #include "ap_drv_ops.h"
 #include "ap_config.h"
@@ -156,6 +158,9 @@ static void hostapd_reload_bss(struct hostapd_data *hapd)
 		wpa_printf(MSG_ERROR, "Failed to re-configure WPA PSK "
 			   "after reloading configuration");
 	}
+#ifdef CONFIG_SAE
+	hostapd_decoy_tables_reload(hapd);
+#endif /* CONFIG_SAE */
 
 	if (hapd->conf->ieee802_1x || hapd->conf->wpa)
 		hostapd_set_drv_ieee8021x(hapd, hapd->conf->iface, 1);
@@ -568,6 +573,7 @@ void hostapd_free_hapd_data(struct hostapd_data *hapd)
 	x_snoop_deinit(hapd);
 
 #ifdef CONFIG_SQLITE
+	hostapd_eap_user_db_deinit(hapd);
 	bin_clear_free(hapd->tmp_eap_user.identity,
 		       hapd->tmp_eap_user.identity_len);
 	bin_clear_free(hapd->tmp_eap_user.password,
@@ -592,17 +598,11 @@ void hostapd_free_hapd_data(struct hostapd_data *hapd)
 #endif /* CONFIG_OCV */
 
 #ifdef CONFIG_SAE
-	{
-		struct hostapd_sae_commit_queue *q;
-
-		while ((q = dl_list_first(&hapd->sae_commit_queue,
-					  struct hostapd_sae_commit_queue,
-					  list))) {
-			dl_list_del(&q->list);
-			os_free(q);
-		}
-	}
-	eloop_cancel_timeout(auth_sae_process_commit, hapd, NULL);
+	auth_sae_queue_flush(hapd);
+	auth_sae_pool_stop(hapd);
+	decoy_alert_deinit(hapd->decoy_alerts);
+	hapd->decoy_alerts = NULL;
+	hostapd_decoy_tables_release(hapd);
 #endif /* CONFIG_SAE */
 
 #ifdef CONFIG_IEEE80211AX
@@ -1745,6 +1745,17 @@ setup_mld:
 	if (hapd->wpa_auth && wpa_init_keys(hapd->wpa_auth) < 0)
 		return -1;
 
+	auth_sae_pool_start(hapd);
+
+#ifdef CONFIG_SAE
+	hapd->decoy_alerts = decoy_alert_init(hapd->msg_ctx,
+					      conf->decoy_alert_socket);
+	if (!hapd->decoy_alerts) {
+		wpa_printf(MSG_ERROR, "Could not set up DecoyAuth alerts");
+		return -1;
+	}
+#endif /* CONFIG_SAE */
+
 	return 0;
 }
 
@@ -2943,6 +2954,9 @@ hostapd_alloc_bss_data(struct hostapd_iface *hapd_iface,
 		       struct hostapd_bss_config *bss)
 {
 	struct hostapd_data *hapd;
+#ifdef CONFIG_SAE
+	int i;
+#endif /* CONFIG_SAE */
 
 	hapd = os_zalloc(sizeof(*hapd));
 	if (hapd == NULL)
@@ -2963,7 +2977,8 @@ hostapd_alloc_bss_data(struct hostapd_iface *hapd_iface,
 	dl_list_init(&hapd->l2_oui_queue);
 #endif /* CONFIG_IEEE80211R_AP */
 #ifdef CONFIG_SAE
-	dl_list_init(&hapd->sae_commit_queue);
+	for (i = 0; i < SAE_QUEUE_PRIOS; i++)
+		dl_list_init(&hapd->sae_commit_queue[i]);
 #endif /* CONFIG_SAE */
 
 	return hapd;
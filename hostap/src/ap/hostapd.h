@@ -45,6 +45,7 @@ struct mesh_conf;
 
 struct hostapd_iface;
 struct hostapd_mld;
+struct eap_user_db;
 
 struct hapd_interfaces {
 	int (*reload_config)(struct hostapd_iface *iface);
@@ -73,6 +74,10 @@ struct hapd_interfaces {
 #ifdef CONFIG_ETH_P_OUI
 	struct dl_list eth_p_oui; /* OUI Extended EtherType handlers */
 #endif /* CONFIG_ETH_P_OUI */
+#ifdef CONFIG_SAE
+	/* struct hostapd_decoy_table shared by all BSSes */
+	struct dl_list decoy_tables;
+#endif /* CONFIG_SAE */
 	int eloop_initialized;
 
 #ifdef CONFIG_DPP
@@ -162,13 +167,32 @@ struct hostapd_neighbor_entry {
 	u8 bss_parameters;
 };
 
-struct hostapd_sae_commit_queue {
-	struct dl_list list;
+struct hostapd_sae_frame {
 	int rssi;
 	size_t len;
 	u8 msg[];
 };
 
+/* Priorities of the SAE message queue, lowest value is processed first. They
+ * only depend on state the AP has verified, not on the queued frames. */
+#define SAE_QUEUE_PRIO_CONFIRM 0 /* STA in Committed or Confirmed state */
+#define SAE_QUEUE_PRIO_RETURNING 1 /* STA with a PMKSA cache entry */
+#define SAE_QUEUE_PRIO_NEW 2
+#define SAE_QUEUE_PRIOS 3
+
+/* Maximum number of stations with queued SAE messages */
+#define SAE_QUEUE_MAX_STA 128
+
+/* Queued SAE Authentication frames of one station */
+struct hostapd_sae_commit_queue {
+	struct dl_list list; /* in hapd->sae_commit_queue[prio] */
+	struct hostapd_sae_commit_queue *hnext; /* next in the hash bucket */
+	u8 addr[ETH_ALEN];
+	int prio; /* SAE_QUEUE_PRIO_* */
+	struct hostapd_sae_frame *commit;
+	struct hostapd_sae_frame *confirm;
+};
+
 struct mld_link_info {
 	u8 valid:1;
 	u8 nstr_bitmap_len:2;
@@ -373,6 +397,7 @@ struct hostapd_data {
 
 #ifdef CONFIG_SQLITE
 	struct hostapd_eap_user tmp_eap_user;
+	struct eap_user_db *eap_user_db;
 #endif /* CONFIG_SQLITE */
 
 #ifdef CONFIG_SAE
@@ -386,7 +411,21 @@ struct hostapd_data {
 	u16 comeback_idx;
 	u16 comeback_pending_idx[COMEBACK_PENDING_IDX_SIZE];
 	int dot11RSNASAERetransPeriod; /* msec */
-	struct dl_list sae_commit_queue; /* struct hostapd_sae_commit_queue */
+	/* struct hostapd_sae_commit_queue per priority, also hashed by STA */
+	struct dl_list sae_commit_queue[SAE_QUEUE_PRIOS];
+	struct hostapd_sae_commit_queue *sae_queue_hash[STA_HASH_SIZE];
+	unsigned int sae_queue_len; /* number of stations in the queue */
+	struct os_reltime sae_queue_resume; /* do not process before this */
+	struct sae_ap_pool *sae_pool; /* pregenerated AP commit material */
+	struct decoy_alert_ring *decoy_alerts; /* DECOY-AUTH-HIT events */
+	/* References to shared DecoyAuth tables, one per group in use */
+	struct hostapd_decoy_table **sae_decoys;
+	size_t num_sae_decoys;
+	/* Measured SAE work for the CPU budget of the anti-clogging check */
+	unsigned int sae_prepare_us; /* moving average of a commit build */
+	unsigned int sae_process_us; /* moving average of commit processing */
+	struct os_reltime sae_budget_start; /* start of the current second */
+	unsigned int sae_budget_used_us; /* SAE work done in that second */
 #endif /* CONFIG_SAE */
 
 #ifdef CONFIG_TESTING_OPTIONS
@@ -836,6 +875,7 @@ void hostapd_acs_channel_selected(struct hostapd_data *hapd,
 const struct hostapd_eap_user *
 hostapd_get_eap_user(struct hostapd_data *hapd, const u8 *identity,
 		     size_t identity_len, int phase2);
+void hostapd_eap_user_db_deinit(struct hostapd_data *hapd);
 
 struct hostapd_data * hostapd_get_iface(struct hapd_interfaces *interfaces,
 					const char *ifname);
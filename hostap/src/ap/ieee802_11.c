@@ -13,6 +13,7 @@
 
 #include "utils/common.h"
 #include "utils/eloop.h"
+#include "utils/usdt.h"
 #include "crypto/crypto.h"
 #include "crypto/sha256.h"
 #include "crypto/sha384.h"
@@ -58,6 +59,8 @@
 #include "dpp_hostapd.h"
 #include "gas_query_ap.h"
 #include "comeback_token.h"
+#include "decoy_alert.h"
+#include "decoy_table.h"
 #include "nan_usd_ap.h"
 #include "pasn/pasn_common.h"
 
@@ -539,6 +542,18 @@ static void handle_auth_ft_finish(void *ctx, const u8 *dst,
 
 #ifdef CONFIG_SAE
 
+/* Signal a possible credential breach when a decoy password was used */
+static void sae_report_decoy_auth(struct hostapd_data *hapd, const u8 *addr,
+				  int password_index, int cached)
+{
+	if (password_index < 0)
+		return;
+	decoy_alert_post(hapd->decoy_alerts, addr, hapd->own_addr,
+			 password_index,
+			 password_index == SAE_AP_REAL_PASSWORD_INDEX, cached);
+}
+
+
 static void sae_set_state(struct sta_info *sta, enum sae_state state,
 			  const char *reason)
 {
@@ -546,6 +561,7 @@ static void sae_set_state(struct sta_info *sta, enum sae_state state,
 		   sae_state_txt(sta->sae->state), sae_state_txt(state),
 		   MAC2STR(sta->addr), reason);
 	sta->sae->state = state;
+	sae_ap_state_changed(sta->sae);
 }
 
 
@@ -603,6 +619,150 @@ const char * sae_get_password(struct hostapd_data *hapd,
 }
 
 
+/* Cost assumed per password and phase until it has been measured (usec) */
+#define SAE_COST_DEFAULT_PER_PASSWORD 2500
+
+static void sae_cost_account(struct hostapd_data *hapd, unsigned int *avg,
+			     struct os_reltime *start)
+{
+	struct os_reltime now, diff;
+	unsigned int us;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	us = diff.sec * 1000000 + diff.usec;
+	*avg = *avg ? (7 * *avg + us) / 8 : us;
+
+	if (os_reltime_expired(&now, &hapd->sae_budget_start, 1)) {
+		hapd->sae_budget_start = now;
+		hapd->sae_budget_used_us = 0;
+	}
+	hapd->sae_budget_used_us += us;
+}
+
+
+static unsigned int sae_cost_estimate(struct hostapd_data *hapd)
+{
+	unsigned int def = SAE_AP_NUM_PASSWORDS *
+		SAE_COST_DEFAULT_PER_PASSWORD;
+
+	return (hapd->sae_prepare_us ? hapd->sae_prepare_us : def) +
+		(hapd->sae_process_us ? hapd->sae_process_us : def);
+}
+
+
+static int sae_over_cpu_budget(struct hostapd_data *hapd)
+{
+	struct os_reltime now;
+	u64 projected;
+
+	if (!hapd->conf->sae_cpu_budget)
+		return 0;
+
+	os_get_reltime(&now);
+	projected = os_reltime_expired(&now, &hapd->sae_budget_start, 1) ?
+		0 : hapd->sae_budget_used_us;
+	projected += (u64) (hapd->sae_queue_len + 1) *
+		sae_cost_estimate(hapd);
+	if (projected <= hapd->conf->sae_cpu_budget * 1000ULL)
+		return 0;
+
+	wpa_printf(MSG_DEBUG,
+		   "SAE: Projected work %llu usec exceeds CPU budget of %u msec",
+		   (unsigned long long) projected, hapd->conf->sae_cpu_budget);
+	return 1;
+}
+
+
+/* Number of passwords of an AP side handshake, for the decoyauth probes */
+static inline int sae_probe_num_passwords(const struct sae_data *sae)
+{
+	return sae->tmp ? sae->tmp->num_passwords : 0;
+}
+
+
+static int auth_sae_process_own_commit(struct hostapd_data *hapd,
+				       struct sta_info *sta)
+{
+	struct os_reltime start;
+	int ret;
+
+	USDT_PROBE2(decoyauth, process_commit_entry, sta->addr,
+		    sae_probe_num_passwords(sta->sae));
+	os_get_reltime(&start);
+	ret = sae_ap_process_commit(sta->sae);
+	sae_cost_account(hapd, &hapd->sae_process_us, &start);
+	USDT_PROBE2(decoyauth, process_commit_return, sta->addr, ret);
+	return ret;
+}
+
+
+/* Interval between two pool entries while the BSS is otherwise idle (usec) */
+#define SAE_POOL_REFILL_INTERVAL 20000
+
+static void auth_sae_pool_refill(void *eloop_ctx, void *user_ctx)
+{
+	struct hostapd_data *hapd = eloop_ctx;
+	int res;
+
+	if (hapd->sae_queue_len) {
+		/* Queued commits have priority, try again later */
+		eloop_register_timeout(0, SAE_POOL_REFILL_INTERVAL,
+				       auth_sae_pool_refill, hapd, NULL);
+		return;
+	}
+
+	res = sae_ap_pool_fill(hapd->sae_pool);
+	if (res < 0)
+		wpa_printf(MSG_DEBUG, "SAE: Failed to fill commit pool");
+	else if (res > 0)
+		eloop_register_timeout(0, SAE_POOL_REFILL_INTERVAL,
+				       auth_sae_pool_refill, hapd, NULL);
+}
+
+
+static void auth_sae_pool_kick(struct hostapd_data *hapd)
+{
+	if (!hapd->sae_pool ||
+	    eloop_is_timeout_registered(auth_sae_pool_refill, hapd, NULL))
+		return;
+	eloop_register_timeout(0, SAE_POOL_REFILL_INTERVAL,
+			       auth_sae_pool_refill, hapd, NULL);
+}
+
+
+void auth_sae_pool_start(struct hostapd_data *hapd)
+{
+	struct hostapd_bss_config *conf = hapd->conf;
+	int group = conf->sae_groups ? conf->sae_groups[0] : 19;
+
+	auth_sae_pool_stop(hapd);
+	if (!conf->sae_pool_size || group <= 0 ||
+	    !wpa_key_mgmt_sae(conf->wpa_key_mgmt |
+			      conf->rsn_override_key_mgmt |
+			      conf->rsn_override_key_mgmt_2))
+		return;
+
+	hapd->sae_pool = sae_ap_pool_init(group, conf->sae_pool_size);
+	if (!hapd->sae_pool) {
+		wpa_printf(MSG_DEBUG,
+			   "SAE: No commit pool for group %d", group);
+		return;
+	}
+	wpa_printf(MSG_DEBUG, "SAE: Commit pool of %u entries for group %d",
+		   conf->sae_pool_size, group);
+	auth_sae_pool_kick(hapd);
+}
+
+
+void auth_sae_pool_stop(struct hostapd_data *hapd)
+{
+	eloop_cancel_timeout(auth_sae_pool_refill, hapd, NULL);
+	sae_ap_pool_deinit(hapd->sae_pool);
+	hapd->sae_pool = NULL;
+}
+
+
 static struct wpabuf * auth_build_sae_commit(struct hostapd_data *hapd,
 					     struct sta_info *sta, int update,
 					     int status_code)
@@ -650,12 +810,26 @@ static struct wpabuf * auth_build_sae_commit(struct hostapd_data *hapd,
 				  NULL, pk) < 0)
 		return NULL;
 
-	if (update && !use_pt &&
-	    sae_ap_prepare_commit(own_addr, sta->addr,
-			       (u8 *) password, os_strlen(password),
-			       sta->sae) < 0) {
-		wpa_printf(MSG_DEBUG, "SAE: Could not pick PWE");
-		return NULL;
+	if (update && !use_pt) {
+		struct os_reltime start;
+		int ret;
+
+		USDT_PROBE2(decoyauth, prepare_commit_entry, sta->addr,
+			    sae_probe_num_passwords(sta->sae));
+		os_get_reltime(&start);
+		ret = sae_ap_prepare_commit(own_addr, sta->addr,
+					    (u8 *) password,
+					    os_strlen(password), sta->sae,
+					    hapd->sae_pool,
+					    hostapd_decoy_table(
+						    hapd, sta->sae->group));
+		USDT_PROBE2(decoyauth, prepare_commit_return, sta->addr, ret);
+		if (ret < 0) {
+			wpa_printf(MSG_DEBUG, "SAE: Could not pick PWE");
+			return NULL;
+		}
+		sae_cost_account(hapd, &hapd->sae_prepare_us, &start);
+		auth_sae_pool_kick(hapd);
 	}
 
 	if (pw && pw->vlan_id) {
@@ -799,9 +973,14 @@ static int use_anti_clogging(struct hostapd_data *hapd)
 	/* In addition to already existing open SAE sessions, check whether
 	 * there are enough pending commit messages in the processing queue to
 	 * potentially result in too many open sessions. */
-	if (open + dl_list_len(&hapd->sae_commit_queue) >=
+	if (open + hapd->sae_queue_len >=
 	    hapd->conf->anti_clogging_threshold)
 		return 1;
+
+	/* The sessions are not equally expensive, so check the CPU time they
+	 * are expected to take as well. */
+	if (sae_over_cpu_budget(hapd))
+		return 1;
 #endif /* CONFIG_SAE */
 
 	return 0;
@@ -974,9 +1153,11 @@ void sae_accept_sta(struct hostapd_data *hapd, struct sta_info *sta)
 	crypto_bignum_deinit(sta->sae->peer_commit_scalar_accepted, 0);
 	sta->sae->peer_commit_scalar_accepted = sta->sae->peer_commit_scalar;
 	sta->sae->peer_commit_scalar = NULL;
-	wpa_auth_pmksa_add_sae(hapd->wpa_auth, sta->addr,
-			       sta->sae->pmk, sta->sae->pmk_len,
-			       sta->sae->pmkid, sta->sae->akmp);
+	wpa_auth_pmksa_add_decoy_auth(hapd->wpa_auth, sta->addr,
+				      sta->sae->pmk, sta->sae->pmk_len,
+				      sta->sae->pmkid, sta->sae->akmp,
+				      sta->sae->password_index);
+	sae_report_decoy_auth(hapd, sta->addr, sta->sae->password_index, 0);
 	sae_sme_send_external_auth_status(hapd, sta, WLAN_STATUS_SUCCESS);
 }
 
@@ -1034,7 +1215,7 @@ static int sae_sm_step(struct hostapd_data *hapd, struct sta_info *sta,
 
 			sae_set_state(sta, SAE_COMMITTED, "Sent Commit");
 
-			if (sae_ap_process_commit(sta->sae) < 0)
+			if (auth_sae_process_own_commit(hapd, sta) < 0)
 				return WLAN_STATUS_UNSPECIFIED_FAILURE;
 
 			/*
@@ -1081,7 +1262,7 @@ static int sae_sm_step(struct hostapd_data *hapd, struct sta_info *sta,
 	case SAE_COMMITTED:
 		sae_clear_retransmit_timer(hapd, sta);
 		if (auth_transaction == 1) {
-			if (sae_ap_process_commit(sta->sae) < 0)
+			if (auth_sae_process_own_commit(hapd, sta) < 0)
 				return WLAN_STATUS_UNSPECIFIED_FAILURE;
 
 			ret = auth_sae_send_confirm(hapd, sta);
@@ -1136,7 +1317,7 @@ static int sae_sm_step(struct hostapd_data *hapd, struct sta_info *sta,
 			if (ret)
 				return ret;
 
-			if (sae_ap_process_commit(sta->sae) < 0)
+			if (auth_sae_process_own_commit(hapd, sta) < 0)
 				return WLAN_STATUS_UNSPECIFIED_FAILURE;
 
 			ret = auth_sae_send_confirm(hapd, sta);
@@ -1165,7 +1346,7 @@ static int sae_sm_step(struct hostapd_data *hapd, struct sta_info *sta,
 				return ret;
 			sae_set_state(sta, SAE_COMMITTED, "Sent Commit");
 
-			if (sae_ap_process_commit(sta->sae) < 0)
+			if (auth_sae_process_own_commit(hapd, sta) < 0)
 				return WLAN_STATUS_UNSPECIFIED_FAILURE;
 			sta->sae->sync = 0;
 			sae_set_retransmit_timer(hapd, sta);
@@ -1598,6 +1779,7 @@ static void handle_auth_sae(struct hostapd_data *hapd, struct sta_info *sta,
 			const u8 *var;
 			size_t var_len;
 			u16 peer_send_confirm;
+			int res;
 
 			var = mgmt->u.auth.variable;
 			var_len = ((u8 *) mgmt) + len - mgmt->u.auth.variable;
@@ -1620,8 +1802,13 @@ static void handle_auth_sae(struct hostapd_data *hapd, struct sta_info *sta,
 				return;
 			}
 
-			if (sae_ap_check_confirm(sta->sae, var, var_len,
-					      NULL) < 0) {
+			USDT_PROBE2(decoyauth, check_confirm_entry, sta->addr,
+				    sae_probe_num_passwords(sta->sae));
+			res = sae_ap_check_confirm(sta->sae, var, var_len,
+						   NULL);
+			USDT_PROBE3(decoyauth, check_confirm_return, sta->addr,
+				    res, res < 0 ? -1 : sta->sae->password_index);
+			if (res < 0) {
 				resp = WLAN_STATUS_CHALLENGE_FAIL;
 				goto reply;
 			}
@@ -1705,102 +1892,228 @@ int auth_sae_init_committed(struct hostapd_data *hapd, struct sta_info *sta)
 }
 
 
-void auth_sae_process_commit(void *eloop_ctx, void *user_ctx)
+static struct hostapd_sae_commit_queue *
+auth_sae_queue_get(struct hostapd_data *hapd, const u8 *addr)
 {
-	struct hostapd_data *hapd = eloop_ctx;
 	struct hostapd_sae_commit_queue *q;
-	unsigned int queue_len;
 
-	q = dl_list_first(&hapd->sae_commit_queue,
-			  struct hostapd_sae_commit_queue, list);
-	if (!q)
-		return;
-	wpa_printf(MSG_DEBUG,
-		   "SAE: Process next available message from queue");
+	q = hapd->sae_queue_hash[STA_HASH(addr)];
+	while (q && !ether_addr_equal(q->addr, addr))
+		q = q->hnext;
+	return q;
+}
+
+
+static void auth_sae_queue_unlink(struct hostapd_data *hapd,
+				  struct hostapd_sae_commit_queue *q)
+{
+	struct hostapd_sae_commit_queue **pos;
+
+	pos = &hapd->sae_queue_hash[STA_HASH(q->addr)];
+	while (*pos && *pos != q)
+		pos = &(*pos)->hnext;
+	if (*pos)
+		*pos = q->hnext;
 	dl_list_del(&q->list);
-	handle_auth(hapd, (const struct ieee80211_mgmt *) q->msg, q->len,
-		    q->rssi, 1);
+	hapd->sae_queue_len--;
+}
+
+
+static void auth_sae_queue_free(struct hostapd_sae_commit_queue *q)
+{
+	os_free(q->commit);
+	os_free(q->confirm);
 	os_free(q);
+}
+
+
+void auth_sae_queue_flush(struct hostapd_data *hapd)
+{
+	struct hostapd_sae_commit_queue *q;
+	int prio;
+
+	for (prio = 0; prio < SAE_QUEUE_PRIOS; prio++) {
+		while ((q = dl_list_first(&hapd->sae_commit_queue[prio],
+					  struct hostapd_sae_commit_queue,
+					  list))) {
+			auth_sae_queue_unlink(hapd, q);
+			auth_sae_queue_free(q);
+		}
+	}
+	eloop_cancel_timeout(auth_sae_process_commit, hapd, NULL);
+}
 
-	if (eloop_is_timeout_registered(auth_sae_process_commit, hapd, NULL))
+
+static void auth_sae_queue_schedule(struct hostapd_data *hapd)
+{
+	struct os_reltime now, delay;
+
+	if (!hapd->sae_queue_len ||
+	    eloop_is_timeout_registered(auth_sae_process_commit, hapd, NULL))
 		return;
-	queue_len = dl_list_len(&hapd->sae_commit_queue);
-	eloop_register_timeout(0, queue_len * 10000, auth_sae_process_commit,
+
+	os_get_reltime(&now);
+	if (os_reltime_before(&now, &hapd->sae_queue_resume))
+		os_reltime_sub(&hapd->sae_queue_resume, &now, &delay);
+	else
+		delay.sec = delay.usec = 0;
+	eloop_register_timeout(delay.sec, delay.usec, auth_sae_process_commit,
 			       hapd, NULL);
 }
 
 
+void auth_sae_process_commit(void *eloop_ctx, void *user_ctx)
+{
+	struct hostapd_data *hapd = eloop_ctx;
+	struct hostapd_sae_commit_queue *q = NULL;
+	struct os_reltime start, now, used;
+	unsigned int share;
+	u64 us;
+	int prio;
+
+	for (prio = 0; !q && prio < SAE_QUEUE_PRIOS; prio++)
+		q = dl_list_first(&hapd->sae_commit_queue[prio],
+				  struct hostapd_sae_commit_queue, list);
+	if (!q)
+		return;
+	wpa_printf(MSG_DEBUG,
+		   "SAE: Process next available message from queue (STA "
+		   MACSTR " priority %d)", MAC2STR(q->addr), q->prio);
+	auth_sae_queue_unlink(hapd, q);
+
+	os_get_reltime(&start);
+	/* Keep the order of the frames within the same exchange */
+	if (q->commit)
+		handle_auth(hapd, (const struct ieee80211_mgmt *) q->commit->msg,
+			    q->commit->len, q->commit->rssi, 1);
+	if (q->confirm)
+		handle_auth(hapd,
+			    (const struct ieee80211_mgmt *) q->confirm->msg,
+			    q->confirm->len, q->confirm->rssi, 1);
+	auth_sae_queue_free(q);
+
+	/* Stay idle long enough to keep SAE within its share of the CPU */
+	os_get_reltime(&now);
+	os_reltime_sub(&now, &start, &used);
+	share = hapd->conf->sae_queue_cpu_share;
+	if (share == 0 || share > 100)
+		share = 100;
+	us = ((u64) used.sec * 1000000 + used.usec) * (100 - share) / share;
+	hapd->sae_queue_resume = now;
+	hapd->sae_queue_resume.sec += us / 1000000;
+	hapd->sae_queue_resume.usec += us % 1000000;
+	if (hapd->sae_queue_resume.usec >= 1000000) {
+		hapd->sae_queue_resume.sec++;
+		hapd->sae_queue_resume.usec -= 1000000;
+	}
+
+	auth_sae_queue_schedule(hapd);
+}
+
+
+static int auth_sae_queue_prio(struct hostapd_data *hapd, const u8 *addr)
+{
+	struct sta_info *sta = ap_get_sta(hapd, addr);
+
+	/* Anyone can send a Commit and a Confirm from a spoofed address, so
+	 * only an exchange in which the AP already accepted a Commit counts as
+	 * being in the Confirm phase */
+	if (sta && sta->sae &&
+	    (sta->sae->state == SAE_COMMITTED ||
+	     sta->sae->state == SAE_CONFIRMED))
+		return SAE_QUEUE_PRIO_CONFIRM;
+	if (wpa_auth_pmksa_get(hapd->wpa_auth, addr, NULL))
+		return SAE_QUEUE_PRIO_RETURNING;
+	return SAE_QUEUE_PRIO_NEW;
+}
+
+
 static void auth_sae_queue(struct hostapd_data *hapd,
 			   const struct ieee80211_mgmt *mgmt, size_t len,
 			   int rssi)
 {
-	struct hostapd_sae_commit_queue *q, *q2;
-	unsigned int queue_len;
-	const struct ieee80211_mgmt *mgmt2;
+	struct hostapd_sae_commit_queue *q;
+	struct hostapd_sae_frame *frame, **slot;
+	int confirm = le_to_host16(mgmt->u.auth.auth_transaction) == 2;
+	int prio = auth_sae_queue_prio(hapd, mgmt->sa);
 
-	queue_len = dl_list_len(&hapd->sae_commit_queue);
-	if (queue_len >= 15) {
-		wpa_printf(MSG_DEBUG,
-			   "SAE: No more room in message queue - drop the new frame from "
-			   MACSTR, MAC2STR(mgmt->sa));
+	frame = os_malloc(sizeof(*frame) + len);
+	if (!frame)
 		return;
+	frame->rssi = rssi;
+	frame->len = len;
+	os_memcpy(frame->msg, mgmt, len);
+
+	q = auth_sae_queue_get(hapd, mgmt->sa);
+	if (!q) {
+		if (hapd->sae_queue_len >= SAE_QUEUE_MAX_STA) {
+			struct hostapd_sae_commit_queue *victim = NULL;
+			int i;
+
+			/* Make room by dropping the most recent station of a
+			 * lower priority, if there is one */
+			for (i = SAE_QUEUE_PRIOS - 1; !victim && i > prio; i--)
+				victim = dl_list_last(
+					&hapd->sae_commit_queue[i],
+					struct hostapd_sae_commit_queue, list);
+			if (!victim) {
+				wpa_printf(MSG_DEBUG,
+					   "SAE: No more room in message queue - drop the new frame from "
+					   MACSTR, MAC2STR(mgmt->sa));
+				os_free(frame);
+				return;
+			}
+			wpa_printf(MSG_DEBUG,
+				   "SAE: Message queue full - drop queued frames from "
+				   MACSTR " (priority %d)",
+				   MAC2STR(victim->addr), victim->prio);
+			auth_sae_queue_unlink(hapd, victim);
+			auth_sae_queue_free(victim);
+		}
+
+		q = os_zalloc(sizeof(*q));
+		if (!q) {
+			os_free(frame);
+			return;
+		}
+		os_memcpy(q->addr, mgmt->sa, ETH_ALEN);
+		q->prio = prio;
+		q->hnext = hapd->sae_queue_hash[STA_HASH(q->addr)];
+		hapd->sae_queue_hash[STA_HASH(q->addr)] = q;
+		dl_list_add_tail(&hapd->sae_commit_queue[prio], &q->list);
+		hapd->sae_queue_len++;
 	}
 
 	wpa_printf(MSG_DEBUG, "SAE: Queue Authentication message from "
 		   MACSTR " for processing (queue_len %u)", MAC2STR(mgmt->sa),
-		   queue_len);
-	q = os_zalloc(sizeof(*q) + len);
-	if (!q)
-		return;
-	q->rssi = rssi;
-	q->len = len;
-	os_memcpy(q->msg, mgmt, len);
-
-	/* Check whether there is already a queued Authentication frame from the
-	 * same station with the same transaction number and if so, replace that
-	 * queue entry with the new one. This avoids issues with a peer that
-	 * sends multiple times (e.g., due to frequent SAE retries). There is no
-	 * point in us trying to process the old attempts after a new one has
+		   hapd->sae_queue_len);
+
+	/* A newer frame from the same station with the same transaction number
+	 * replaces the queued one. This avoids issues with a peer that sends
+	 * multiple times (e.g., due to frequent SAE retries). There is no point
+	 * in us trying to process the old attempts after a new one has
 	 * obsoleted them. */
-	dl_list_for_each(q2, &hapd->sae_commit_queue,
-			 struct hostapd_sae_commit_queue, list) {
-		mgmt2 = (const struct ieee80211_mgmt *) q2->msg;
-		if (ether_addr_equal(mgmt->sa, mgmt2->sa) &&
-		    mgmt->u.auth.auth_transaction ==
-		    mgmt2->u.auth.auth_transaction) {
-			wpa_printf(MSG_DEBUG,
-				   "SAE: Replace queued message from same STA with same transaction number");
-			dl_list_add(&q2->list, &q->list);
-			dl_list_del(&q2->list);
-			os_free(q2);
-			goto queued;
-		}
-	}
+	slot = confirm ? &q->confirm : &q->commit;
+	if (*slot)
+		wpa_printf(MSG_DEBUG,
+			   "SAE: Replace queued message from same STA with same transaction number");
+	os_free(*slot);
+	*slot = frame;
 
-	/* No pending identical entry, so add to the end of the queue */
-	dl_list_add_tail(&hapd->sae_commit_queue, &q->list);
+	if (q->prio != prio) {
+		/* The state of the STA changed since its frames were queued */
+		dl_list_del(&q->list);
+		q->prio = prio;
+		dl_list_add_tail(&hapd->sae_commit_queue[q->prio], &q->list);
+	}
 
-queued:
-	if (eloop_is_timeout_registered(auth_sae_process_commit, hapd, NULL))
-		return;
-	eloop_register_timeout(0, queue_len * 10000, auth_sae_process_commit,
-			       hapd, NULL);
+	auth_sae_queue_schedule(hapd);
 }
 
 
 static int auth_sae_queued_addr(struct hostapd_data *hapd, const u8 *addr)
 {
-	struct hostapd_sae_commit_queue *q;
-	const struct ieee80211_mgmt *mgmt;
-
-	dl_list_for_each(q, &hapd->sae_commit_queue,
-			 struct hostapd_sae_commit_queue, list) {
-		mgmt = (const struct ieee80211_mgmt *) q->msg;
-		if (ether_addr_equal(addr, mgmt->sa))
-			return 1;
-	}
-
-	return 0;
+	return auth_sae_queue_get(hapd, addr) != NULL;
 }
 
 #endif /* CONFIG_SAE */
@@ -4259,6 +4572,8 @@ static int __check_assoc_ies(struct hostapd_data *hapd, struct sta_info *sta,
 			}
 			wpa_printf(MSG_DEBUG, "SAE: " MACSTR
 				   " using PMKSA caching", MAC2STR(sta->addr));
+			sae_report_decoy_auth(hapd, sta->addr,
+					      sa->decoy_auth_index, 1);
 		} else if (wpa_auth_uses_sae(sta->wpa_sm) &&
 			   sta->auth_alg != WLAN_AUTH_SAE &&
 			   !(sta->auth_alg == WLAN_AUTH_FT &&
@@ -157,11 +157,21 @@ int auth_sae_init_committed(struct hostapd_data *hapd, struct sta_info *sta);
 void sae_clear_retransmit_timer(struct hostapd_data *hapd,
 				struct sta_info *sta);
 void sae_accept_sta(struct hostapd_data *hapd, struct sta_info *sta);
+void auth_sae_pool_start(struct hostapd_data *hapd);
+void auth_sae_pool_stop(struct hostapd_data *hapd);
 #else /* CONFIG_SAE */
 static inline void sae_clear_retransmit_timer(struct hostapd_data *hapd,
 					      struct sta_info *sta)
 {
 }
+
+static inline void auth_sae_pool_start(struct hostapd_data *hapd)
+{
+}
+
+static inline void auth_sae_pool_stop(struct hostapd_data *hapd)
+{
+}
 #endif /* CONFIG_SAE */
 
 #ifdef CONFIG_MBO
@@ -226,6 +236,7 @@ int get_tx_parameters(struct sta_info *sta, int ap_max_chanwidth,
 		      int ap_seg1_idx, int *bandwidth, int *seg1_idx);
 
 void auth_sae_process_commit(void *eloop_ctx, void *user_ctx);
+void auth_sae_queue_flush(struct hostapd_data *hapd);
 u8 * hostapd_eid_rsnxe(struct hostapd_data *hapd, u8 *eid, size_t len);
 u16 check_ext_capab(struct hostapd_data *hapd, struct sta_info *sta,
 		    const u8 *ext_capab_ie, size_t ext_capab_ie_len);
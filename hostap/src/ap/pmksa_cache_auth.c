@@ -353,6 +353,7 @@ pmksa_cache_auth_create_entry(const u8 *pmk, size_t pmk_len, const u8 *pmkid,
 	else
 		entry->expiration += dot11RSNAConfigPMKLifetime;
 	entry->akmp = akmp;
+	entry->decoy_auth_index = -1;
 	os_memcpy(entry->spa, spa, ETH_ALEN);
 	pmksa_cache_from_eapol_data(entry, eapol);
 
@@ -412,6 +413,7 @@ pmksa_cache_add_okc(struct rsn_pmksa_cache *pmksa,
 	entry->pmk_len = old_entry->pmk_len;
 	entry->expiration = old_entry->expiration;
 	entry->akmp = old_entry->akmp;
+	entry->decoy_auth_index = old_entry->decoy_auth_index;
 	os_memcpy(entry->spa, old_entry->spa, ETH_ALEN);
 	entry->opportunistic = 1;
 	if (old_entry->identity) {
@@ -34,6 +34,7 @@ struct rsn_pmksa_cache_entry {
 	u8 eap_type_authsrv;
 	struct vlan_description *vlan_desc;
 	int opportunistic;
+	int decoy_auth_index; /* DecoyAuth password index, -1 if not used */
 
 	u64 acct_multi_session_id;
 };
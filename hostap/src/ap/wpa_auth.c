@@ -6479,17 +6479,46 @@ int wpa_auth_pmksa_add_sae(struct wpa_authenticator *wpa_auth, const u8 *addr,
 			   const u8 *pmk, size_t pmk_len, const u8 *pmkid,
 			   int akmp)
 {
+	return wpa_auth_pmksa_add_decoy_auth(wpa_auth, addr, pmk, pmk_len,
+					     pmkid, akmp, -1);
+}
+
+
+/**
+ * wpa_auth_pmksa_add_decoy_auth - Cache a PMK from a DecoyAuth handshake
+ * @wpa_auth: Pointer to WPA authenticator data
+ * @addr: Station address
+ * @pmk: PMK from the SAE handshake
+ * @pmk_len: Length of @pmk
+ * @pmkid: PMKID of the matched password
+ * @akmp: WPA_KEY_MGMT_* or 0 for WPA_KEY_MGMT_SAE
+ * @password_index: Index of the password the station confirmed, or -1 for
+ *	a regular SAE PMK
+ * Returns: 0 on success, -1 on failure
+ *
+ * The index is kept with the entry so that an association that reuses a
+ * decoy PMKSA is still reported even though no SAE exchange takes place.
+ */
+int wpa_auth_pmksa_add_decoy_auth(struct wpa_authenticator *wpa_auth,
+				  const u8 *addr, const u8 *pmk,
+				  size_t pmk_len, const u8 *pmkid, int akmp,
+				  int password_index)
+{
+	struct rsn_pmksa_cache_entry *entry;
+
 	if (wpa_auth->conf.disable_pmksa_caching)
 		return -1;
 
 	wpa_hexdump_key(MSG_DEBUG, "RSN: Cache PMK from SAE", pmk, pmk_len);
 	if (!akmp)
 		akmp = WPA_KEY_MGMT_SAE;
-	if (pmksa_cache_auth_add(wpa_auth->pmksa, pmk, pmk_len, pmkid,
-				 NULL, 0, wpa_auth->addr, addr, 0, NULL, akmp))
-		return 0;
-
-	return -1;
+	entry = pmksa_cache_auth_add(wpa_auth->pmksa, pmk, pmk_len, pmkid,
+				     NULL, 0, wpa_auth->addr, addr, 0, NULL,
+				     akmp);
+	if (!entry)
+		return -1;
+	entry->decoy_auth_index = password_index;
+	return 0;
 }
 
 
@@ -507,6 +507,10 @@ int wpa_auth_pmksa_add_preauth(struct wpa_authenticator *wpa_auth,
 int wpa_auth_pmksa_add_sae(struct wpa_authenticator *wpa_auth, const u8 *addr,
 			   const u8 *pmk, size_t pmk_len, const u8 *pmkid,
 			   int akmp);
+int wpa_auth_pmksa_add_decoy_auth(struct wpa_authenticator *wpa_auth,
+				  const u8 *addr, const u8 *pmk,
+				  size_t pmk_len, const u8 *pmkid, int akmp,
+				  int password_index);
 void wpa_auth_add_sae_pmkid(struct wpa_state_machine *sm, const u8 *pmkid);
 int wpa_auth_pmksa_add2(struct wpa_authenticator *wpa_auth, const u8 *addr,
 			const u8 *pmk, size_t pmk_len, const u8 *pmkid,
@@ -515,6 +515,87 @@ fail:
 }
 
 
+static int sae_ap_commit_tests(void)
+{
+#ifdef CONFIG_SAE
+	struct sae_data sae;
+	struct sae_decoy_table *decoys;
+	const u8 *passwords[SAE_AP_NUM_PASSWORDS];
+	size_t password_lens[SAE_AP_NUM_PASSWORDS];
+	char pw[SAE_AP_NUM_PASSWORDS][12];
+	const u8 addr1[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x01, 0x00 };
+	const u8 addr2[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x02, 0x00 };
+	struct wpabuf *token, *first = NULL, *buf = NULL;
+	int i, ret = -1;
+
+	wpa_printf(MSG_INFO, "SAE AP commit tests");
+
+	for (i = 0; i < SAE_AP_NUM_PASSWORDS; i++) {
+		os_snprintf(pw[i], sizeof(pw[i]), "decoy%02d", i);
+		passwords[i] = (const u8 *) pw[i];
+		password_lens[i] = os_strlen(pw[i]);
+	}
+
+	os_memset(&sae, 0, sizeof(sae));
+	decoys = sae_decoy_table_init(19, passwords, password_lens,
+				      SAE_AP_NUM_PASSWORDS);
+	token = wpabuf_alloc_copy("token", 5);
+	first = wpabuf_alloc(SAE_COMMIT_MAX_LEN);
+	buf = wpabuf_alloc(SAE_COMMIT_MAX_LEN);
+	if (!decoys || !token || !first || !buf ||
+	    sae_set_group(&sae, 19) < 0 ||
+	    sae_ap_prepare_commit(addr1, addr2, passwords[3],
+				  password_lens[3], &sae, NULL, decoys) < 0 ||
+	    sae_ap_write_commit(&sae, first, NULL, NULL) < 0)
+		goto fail;
+	sae.state = SAE_COMMITTED;
+	sae_ap_state_changed(&sae);
+
+	/* Retransmission with an Anti-Clogging Token */
+	if (sae_ap_write_commit(&sae, buf, token, NULL) < 0 ||
+	    wpabuf_len(buf) != wpabuf_len(first) + wpabuf_len(token) ||
+	    os_memcmp(wpabuf_head(buf), wpabuf_head(first), 2) != 0 ||
+	    os_memcmp(wpabuf_head_u8(buf) + 2 + wpabuf_len(token),
+		      wpabuf_head_u8(first) + 2, wpabuf_len(first) - 2) != 0) {
+		wpa_printf(MSG_ERROR, "SAE: Commit not resent with token");
+		goto fail;
+	}
+
+	/* Peer restarted with the same group (allow_reuse) */
+	sae.state = SAE_NOTHING;
+	sae_ap_state_changed(&sae);
+	wpabuf_free(buf);
+	buf = wpabuf_alloc(SAE_COMMIT_MAX_LEN);
+	if (!buf || sae_ap_write_commit(&sae, buf, NULL, NULL) < 0 ||
+	    wpabuf_cmp(buf, first) != 0) {
+		wpa_printf(MSG_ERROR, "SAE: Commit not resent after reuse");
+		goto fail;
+	}
+
+	/* Not needed once confirmed */
+	sae.state = SAE_CONFIRMED;
+	sae_ap_state_changed(&sae);
+	wpabuf_free(buf);
+	buf = wpabuf_alloc(SAE_COMMIT_MAX_LEN);
+	if (!buf || sae_ap_write_commit(&sae, buf, NULL, NULL) == 0) {
+		wpa_printf(MSG_ERROR, "SAE: Commit kept after confirm");
+		goto fail;
+	}
+
+	ret = 0;
+fail:
+	sae_clear_data(&sae);
+	sae_decoy_table_deinit(decoys);
+	wpabuf_free(token);
+	wpabuf_free(first);
+	wpabuf_free(buf);
+	return ret;
+#else /* CONFIG_SAE */
+	return 0;
+#endif /* CONFIG_SAE */
+}
+
+
 static int sae_pk_tests(void)
 {
 #ifdef CONFIG_SAE_PK
@@ -785,6 +866,7 @@ int common_module_tests(void)
 	if (ieee802_11_parse_tests() < 0 ||
 	    gas_tests() < 0 ||
 	    sae_tests() < 0 ||
+	    sae_ap_commit_tests() < 0 ||
 	    sae_pk_tests() < 0 ||
 	    pasn_tests() < 0 ||
 	    rsn_ie_parse_tests() < 0)
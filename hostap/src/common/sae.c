@@ -9,9 +9,11 @@
 #include "includes.h"
 
 #include "common.h"
+#include "utils/list.h"
 #include "common/defs.h"
 #include "common/wpa_common.h"
 #include "utils/const_time.h"
+#include "utils/usdt.h"
 #include "crypto/crypto.h"
 #include "crypto/sha256.h"
 #include "crypto/sha384.h"
@@ -43,7 +45,7 @@ int sae_set_group(struct sae_data *sae, int group)
 	if (tmp == NULL)
 		return -1;
 
-	tmp->num_passwords = 16;
+	tmp->num_passwords = SAE_AP_NUM_PASSWORDS;
 	tmp->pwe_eccs = (struct crypto_ec_point **) os_zalloc(tmp->num_passwords * sizeof(struct crypto_ec_point *));
 	tmp->own_commit_element_eccs = (struct crypto_ec_point **) os_zalloc(tmp->num_passwords * sizeof(struct crypto_ec_point *));
 
@@ -99,6 +101,21 @@ int sae_set_group(struct sae_data *sae, int group)
 }
 
 
+static void sae_ap_free_coefficients(struct sae_temporary_data *tmp)
+{
+	for (int i = 0; i < tmp->num_passwords; i++) {
+		if (tmp->u_coefficients)
+			crypto_bignum_deinit(tmp->u_coefficients[i], 1);
+		if (tmp->v_coefficients)
+			crypto_bignum_deinit(tmp->v_coefficients[i], 1);
+	}
+	os_free(tmp->u_coefficients);
+	tmp->u_coefficients = NULL;
+	os_free(tmp->v_coefficients);
+	tmp->v_coefficients = NULL;
+}
+
+
 void sae_clear_temp_data(struct sae_data *sae)
 {
 	struct sae_temporary_data *tmp;
@@ -117,6 +134,8 @@ void sae_clear_temp_data(struct sae_data *sae)
 	crypto_ec_point_deinit(tmp->own_commit_element_ecc, 0);
 	crypto_ec_point_deinit(tmp->peer_commit_element_ecc, 0);
 	wpabuf_free(tmp->anti_clogging_token);
+	wpabuf_free(tmp->own_commit);
+	sae_ap_free_coefficients(tmp);
 	wpabuf_free(tmp->own_rejected_groups);
 	wpabuf_free(tmp->peer_rejected_groups);
 	os_free(tmp->pw_id);
@@ -138,6 +157,7 @@ void sae_clear_data(struct sae_data *sae)
 	no_pw_id = sae->no_pw_id;
 	os_memset(sae, 0, sizeof(*sae));
 	sae->no_pw_id = no_pw_id;
+	sae->password_index = -1;
 }
 
 
@@ -564,6 +584,24 @@ static int hkdf_extract(size_t hash_len, const u8 *salt, size_t salt_len,
 }
 
 
+/* hkdf_extract() for lanes salts and data vectors with the same lengths */
+static int hkdf_extract_mb(size_t hash_len, size_t lanes, const u8 *salt[],
+			   size_t salt_len, size_t num_elem, const u8 *addr[],
+			   const size_t len[], u8 *prk[])
+{
+	size_t i;
+
+	if (hash_len == 32)
+		return hmac_sha256_vector_mb(lanes, salt, salt_len, num_elem,
+					     addr, len, prk);
+	for (i = 0; i < lanes; i++)
+		if (hkdf_extract(hash_len, salt[i], salt_len, num_elem,
+				 &addr[i * num_elem], len, prk[i]) < 0)
+			return -1;
+	return 0;
+}
+
+
 static int hkdf_expand(size_t hash_len, const u8 *prk, size_t prk_len,
 		       const char *info, u8 *okm, size_t okm_len)
 {
@@ -1439,47 +1477,352 @@ int crypto_ec_point_clone(struct crypto_ec *ec, struct crypto_ec_point *point, s
 }
 
 
+/*
+ * Encoding candidates generated per pool entry, see
+ * crypto_ec_values_candidate(). About one in four candidates can encode a
+ * given element, so this covers all passwords with high probability.
+ */
+#define SAE_AP_POOL_CANDIDATES (8 * SAE_AP_NUM_PASSWORDS)
+
+struct sae_ap_material {
+	struct dl_list list;
+	struct crypto_bignum *sae_rand;
+	struct crypto_bignum *mask;
+	struct crypto_bignum *commit_scalar;
+	unsigned int num_candidates;
+	unsigned int next_candidate;
+	u8 *u; /* num_candidates * prime_len octets */
+	struct crypto_ec_point *neg_f_u[SAE_AP_POOL_CANDIDATES];
+};
+
+struct sae_ap_pool {
+	struct dl_list entries;
+	struct crypto_ec *ec;
+	int group;
+	size_t prime_len;
+	unsigned int size;
+	unsigned int len;
+	unsigned int hits;
+	unsigned int misses;
+};
+
+
+static void sae_ap_material_free(struct sae_ap_material *m)
+{
+	unsigned int i;
+
+	if (!m)
+		return;
+	crypto_bignum_deinit(m->sae_rand, 1);
+	crypto_bignum_deinit(m->mask, 1);
+	crypto_bignum_deinit(m->commit_scalar, 1);
+	for (i = 0; i < m->num_candidates; i++)
+		crypto_ec_point_deinit(m->neg_f_u[i], 1);
+	bin_clear_free(m->u, SAE_AP_POOL_CANDIDATES * SAE_MAX_ECC_PRIME_LEN);
+	os_free(m);
+}
+
+
+struct sae_ap_pool * sae_ap_pool_init(int group, unsigned int size)
+{
+	struct sae_ap_pool *pool;
+
+	pool = os_zalloc(sizeof(*pool));
+	if (!pool)
+		return NULL;
+	dl_list_init(&pool->entries);
+	pool->group = group;
+	pool->size = size;
+	pool->ec = crypto_ec_init(group);
+	if (!pool->ec) {
+		/* Only the ECC groups use the encoded commit */
+		os_free(pool);
+		return NULL;
+	}
+	pool->prime_len = crypto_ec_prime_len(pool->ec);
+	return pool;
+}
+
+
+void sae_ap_pool_deinit(struct sae_ap_pool *pool)
+{
+	struct sae_ap_material *m, *tmp;
+
+	if (!pool)
+		return;
+	dl_list_for_each_safe(m, tmp, &pool->entries, struct sae_ap_material,
+			      list) {
+		dl_list_del(&m->list);
+		sae_ap_material_free(m);
+	}
+	crypto_ec_deinit(pool->ec);
+	os_free(pool);
+}
+
+
+/**
+ * sae_ap_pool_fill - Generate one pool entry
+ * @pool: Pool from sae_ap_pool_init()
+ * Returns: 1 if an entry was added, 0 if the pool is full, -1 on failure
+ */
+int sae_ap_pool_fill(struct sae_ap_pool *pool)
+{
+	struct sae_ap_material *m;
+	unsigned int i;
+
+	if (!pool)
+		return -1;
+	if (pool->len >= pool->size)
+		return 0;
+
+	m = os_zalloc(sizeof(*m));
+	if (!m)
+		return -1;
+	m->sae_rand = crypto_bignum_init();
+	m->mask = crypto_bignum_init();
+	m->commit_scalar = crypto_bignum_init();
+	m->u = os_malloc(SAE_AP_POOL_CANDIDATES * SAE_MAX_ECC_PRIME_LEN);
+	if (!m->sae_rand || !m->mask || !m->commit_scalar || !m->u ||
+	    dragonfly_generate_scalar(crypto_ec_get_order(pool->ec),
+				      m->sae_rand, m->mask,
+				      m->commit_scalar) < 0)
+		goto fail;
+
+	for (i = 0; i < SAE_AP_POOL_CANDIDATES; i++) {
+		m->neg_f_u[i] = crypto_ec_point_init(pool->ec);
+		if (!m->neg_f_u[i])
+			goto fail;
+		m->num_candidates++;
+		if (crypto_ec_values_candidate(pool->ec,
+					       m->u + i * pool->prime_len,
+					       m->neg_f_u[i]) < 0)
+			goto fail;
+	}
+
+	dl_list_add_tail(&pool->entries, &m->list);
+	pool->len++;
+	return 1;
+fail:
+	sae_ap_material_free(m);
+	return -1;
+}
+
+
+void sae_ap_pool_stats(const struct sae_ap_pool *pool,
+		       struct sae_ap_pool_stats *stats)
+{
+	os_memset(stats, 0, sizeof(*stats));
+	if (!pool)
+		return;
+	stats->size = pool->size;
+	stats->len = pool->len;
+	stats->hits = pool->hits;
+	stats->misses = pool->misses;
+}
+
+
+static struct sae_ap_material * sae_ap_pool_take(struct sae_ap_pool *pool,
+						 int group)
+{
+	struct sae_ap_material *m;
+
+	if (!pool || pool->group != group)
+		return NULL;
+	m = dl_list_first(&pool->entries, struct sae_ap_material, list);
+	if (!m) {
+		pool->misses++;
+		return NULL;
+	}
+	dl_list_del(&m->list);
+	pool->len--;
+	pool->hits++;
+	return m;
+}
+
+
+/* Encode the commit element with the pooled candidates if one fits */
+static int sae_ap_encode_element(struct sae_data *sae,
+				 struct sae_ap_material *m,
+				 const struct crypto_ec_point *element, u8 *uv)
+{
+	int ret;
+
+	while (m && m->next_candidate < m->num_candidates) {
+		unsigned int i = m->next_candidate++;
+
+		ret = crypto_ec_point_to_values_candidate(
+			sae->tmp->ec, element, m->u + i * sae->tmp->prime_len,
+			m->neg_f_u[i], uv);
+		if (ret <= 0)
+			return ret;
+	}
+
+	return crypto_ec_point_to_values_bin(sae->tmp->ec, element, uv);
+}
+
+
+struct sae_decoy_table {
+	int group;
+	int num_passwords;
+	u8 **passwords;
+	size_t *password_lens;
+	struct crypto_bignum **hash_values; /* H(password) per index */
+	struct crypto_bignum **matrix; /* num_passwords^2 interpolation terms */
+};
+
+
+/**
+ * sae_decoy_table_init - Derive the peer independent DecoyAuth tables
+ * @group: Finite cyclic group
+ * @passwords: AP passwords, the real one at SAE_AP_REAL_PASSWORD_INDEX
+ * @password_lens: Length of each password
+ * @num_passwords: Number of passwords
+ * Returns: Table for sae_ap_prepare_commit() or %NULL on failure
+ *
+ * The table only depends on the password set and the group and is never
+ * modified after this, so it can be shared by any number of BSSes.
+ */
+struct sae_decoy_table * sae_decoy_table_init(int group,
+					      const u8 * const *passwords,
+					      const size_t *password_lens,
+					      int num_passwords)
+{
+	struct sae_decoy_table *table;
+	struct crypto_ec *ec;
+	int i;
+
+	if (num_passwords < 2)
+		return NULL;
+	ec = crypto_ec_init(group);
+	if (!ec)
+		return NULL;
+
+	table = os_zalloc(sizeof(*table));
+	if (!table)
+		goto fail;
+	table->group = group;
+	table->num_passwords = num_passwords;
+	table->passwords = os_calloc(num_passwords, sizeof(u8 *));
+	table->password_lens = os_calloc(num_passwords, sizeof(size_t));
+	table->hash_values = os_calloc(num_passwords,
+				       sizeof(struct crypto_bignum *));
+	if (!table->passwords || !table->password_lens || !table->hash_values)
+		goto fail;
+
+	for (i = 0; i < num_passwords; i++) {
+		u8 hash[SHA256_MAC_LEN];
+		const u8 *addr = passwords[i];
+		size_t len = password_lens[i];
+
+		table->passwords[i] = os_memdup(passwords[i], len);
+		table->password_lens[i] = len;
+		if (!table->passwords[i] ||
+		    sha256_vector(1, &addr, &len, hash) < 0)
+			goto fail;
+		table->hash_values[i] = crypto_bignum_init_set(hash,
+							       sizeof(hash));
+		forced_memzero(hash, sizeof(hash));
+		if (!table->hash_values[i])
+			goto fail;
+	}
+
+	table->matrix = crypto_precompute(table->hash_values, num_passwords,
+					  ec);
+	if (!table->matrix)
+		goto fail;
+
+	crypto_ec_deinit(ec);
+	return table;
+fail:
+	crypto_ec_deinit(ec);
+	sae_decoy_table_deinit(table);
+	return NULL;
+}
+
+
+/**
+ * sae_decoy_table_deinit - Free a table from sae_decoy_table_init()
+ * @table: Table or %NULL
+ */
+void sae_decoy_table_deinit(struct sae_decoy_table *table)
+{
+	int i;
+
+	if (!table)
+		return;
+	for (i = 0; i < table->num_passwords; i++) {
+		if (table->passwords)
+			bin_clear_free(table->passwords[i],
+				       table->password_lens[i]);
+		if (table->hash_values)
+			crypto_bignum_deinit(table->hash_values[i], 1);
+	}
+	if (table->matrix) {
+		for (i = 0; i < table->num_passwords * table->num_passwords;
+		     i++)
+			crypto_bignum_deinit(table->matrix[i], 1);
+	}
+	os_free(table->matrix);
+	os_free(table->hash_values);
+	os_free(table->password_lens);
+	os_free(table->passwords);
+	os_free(table);
+}
+
+
 int sae_ap_prepare_commit(const u8 *addr1, const u8 *addr2,
 		       const u8 *password, size_t password_len,
-		       struct sae_data *sae)
+		       struct sae_data *sae, struct sae_ap_pool *pool,
+		       const struct sae_decoy_table *decoys)
 {
-	int selected_index = 1;
-	const u8 **passwords = (const u8 **) os_malloc(sae->tmp->num_passwords * sizeof(u8 *));
-	for (int i = 0; i < sae->tmp->num_passwords; i++) {
-		char* buffer = (char*) os_malloc(20 * sizeof(char));
-		snprintf(buffer, 20, "PASSWORD_%d", i);
-		passwords[i] = (const u8 *) buffer;
-	}
+	struct sae_ap_material *m;
+	struct crypto_bignum *mask;
+	struct crypto_bignum **u_values = NULL, **v_values = NULL;
+	int ret = -1;
 
-	size_t* password_lens = (size_t*) os_malloc(sae->tmp->num_passwords * sizeof(size_t));
-	for (int i = 0; i < sae->tmp->num_passwords; i++)
-		password_lens[i] = os_strlen(passwords[i]);
+	if (!sae->tmp || !decoys || decoys->group != sae->group ||
+	    decoys->num_passwords != sae->tmp->num_passwords)
+		return -1;
 
-	struct crypto_bignum *mask = crypto_bignum_init();
-	if (!sae->tmp->sae_rand)
-		sae->tmp->sae_rand = crypto_bignum_init();
-	if (!sae->tmp->own_commit_scalar)
-		sae->tmp->own_commit_scalar = crypto_bignum_init();
-	
-	int ret = !mask || !sae->tmp->sae_rand || !sae->tmp->own_commit_scalar ||
-			dragonfly_generate_scalar(sae->tmp->order, sae->tmp->sae_rand, mask, sae->tmp->own_commit_scalar) < 0;
+	m = sae_ap_pool_take(pool, sae->group);
+	if (m) {
+		/* Take over the pregenerated scalar */
+		crypto_bignum_deinit(sae->tmp->sae_rand, 1);
+		crypto_bignum_deinit(sae->tmp->own_commit_scalar, 1);
+		sae->tmp->sae_rand = m->sae_rand;
+		sae->tmp->own_commit_scalar = m->commit_scalar;
+		mask = m->mask;
+		m->sae_rand = m->commit_scalar = m->mask = NULL;
+	} else {
+		mask = crypto_bignum_init();
+		if (!sae->tmp->sae_rand)
+			sae->tmp->sae_rand = crypto_bignum_init();
+		if (!sae->tmp->own_commit_scalar)
+			sae->tmp->own_commit_scalar = crypto_bignum_init();
+		if (!mask || !sae->tmp->sae_rand ||
+		    !sae->tmp->own_commit_scalar ||
+		    dragonfly_generate_scalar(sae->tmp->order,
+					      sae->tmp->sae_rand, mask,
+					      sae->tmp->own_commit_scalar) < 0) {
+			crypto_bignum_deinit(mask, 1);
+			return -1;
+		}
+	}
 
 	for (int i = 0; i < sae->tmp->num_passwords; i++) {
 		if (sae->tmp == NULL ||
-			(sae->tmp->ec && sae_derive_pwe_ecc(sae, addr1, addr2, passwords[i], password_lens[i]) < 0) ||
-			(sae->tmp->dh && sae_derive_pwe_ffc(sae, addr1, addr2, passwords[i], password_lens[i]) < 0))
-				return -1;
+			(sae->tmp->ec && sae_derive_pwe_ecc(sae, addr1, addr2, decoys->passwords[i], decoys->password_lens[i]) < 0) ||
+			(sae->tmp->dh && sae_derive_pwe_ffc(sae, addr1, addr2, decoys->passwords[i], decoys->password_lens[i]) < 0))
+			goto fail;
 
 		sae->h2e = 0;
 		sae->pk = 0;
 
-		ret = (sae->tmp->ec &&
-				  sae_derive_commit_element_ecc(sae, mask) < 0) ||
-			  (sae->tmp->dh &&
-				  sae_derive_commit_element_ffc(sae, mask) < 0);
-		
-		if (ret < 0)
-			return -1;
+		if ((sae->tmp->ec &&
+		     sae_derive_commit_element_ecc(sae, mask) < 0) ||
+		    (sae->tmp->dh &&
+		     sae_derive_commit_element_ffc(sae, mask) < 0))
+			goto fail;
 
 		sae->tmp->pwe_eccs[i] = crypto_ec_point_init(sae->tmp->ec);
 		crypto_ec_point_clone(sae->tmp->ec, sae->tmp->pwe_ecc, sae->tmp->pwe_eccs[i]);
@@ -1487,41 +1830,43 @@ int sae_ap_prepare_commit(const u8 *addr1, const u8 *addr2,
 		crypto_ec_point_clone(sae->tmp->ec, sae->tmp->own_commit_element_ecc, sae->tmp->own_commit_element_eccs[i]);
 	}
 
-	crypto_bignum_deinit(mask, 1);
+	u_values = os_calloc(sae->tmp->num_passwords, sizeof(*u_values));
+	v_values = os_calloc(sae->tmp->num_passwords, sizeof(*v_values));
+	if (!u_values || !v_values)
+		goto fail;
 
-	struct crypto_bignum **hash_values = (struct crypto_bignum **) os_malloc(sae->tmp->num_passwords * sizeof(struct crypto_bignum *));
 	for (int i = 0; i < sae->tmp->num_passwords; i++) {
-		u8 hash[32];
-		if (sha256_vector(1, &passwords[i], &password_lens[i], hash) < 0)
-			wpa_printf(MSG_DEBUG, "SAE: Failed to hash password");
-		struct crypto_bignum *bn = crypto_bignum_init_set(hash, sizeof(hash));
-		hash_values[i] = bn;
+		u8 uv[2 * SAE_MAX_ECC_PRIME_LEN];
+
+		if (sae_ap_encode_element(sae, m, sae->tmp->own_commit_element_eccs[i], uv) < 0)
+			goto fail;
+		u_values[i] = crypto_bignum_init_set(uv, sae->tmp->prime_len);
+		v_values[i] = crypto_bignum_init_set(uv + sae->tmp->prime_len, sae->tmp->prime_len);
+		if (!u_values[i] || !v_values[i])
+			goto fail;
 	}
 
-	struct crypto_bignum **u_values = (struct crypto_bignum **) os_malloc(sae->tmp->num_passwords * sizeof(struct crypto_bignum *));
-	struct crypto_bignum **v_values = (struct crypto_bignum **) os_malloc(sae->tmp->num_passwords * sizeof(struct crypto_bignum *));
+	sae_ap_free_coefficients(sae->tmp);
+	sae->tmp->u_coefficients = crypto_weave(u_values, decoys->matrix, sae->tmp->num_passwords, sae->tmp->ec);
+	sae->tmp->v_coefficients = crypto_weave(v_values, decoys->matrix, sae->tmp->num_passwords, sae->tmp->ec);
+	if (!sae->tmp->u_coefficients || !sae->tmp->v_coefficients) {
+		sae_ap_free_coefficients(sae->tmp);
+		goto fail;
+	}
 
+	ret = 0;
+fail:
+	crypto_bignum_deinit(mask, 1);
+	sae_ap_material_free(m);
 	for (int i = 0; i < sae->tmp->num_passwords; i++) {
-		struct crypto_bignum **encoded_point = crypto_point_to_values(sae->tmp->own_commit_element_eccs[i], sae->tmp->ec);
-		u_values[i] = encoded_point[0];
-		v_values[i] = encoded_point[1];
-		os_free(encoded_point);
+		if (u_values)
+			crypto_bignum_deinit(u_values[i], 1);
+		if (v_values)
+			crypto_bignum_deinit(v_values[i], 1);
 	}
-
-	struct crypto_bignum **matrix = (struct crypto_bignum **) os_malloc(sae->tmp->num_passwords * sae->tmp->num_passwords * sizeof(struct crypto_bignum *));
-	matrix = crypto_precompute(hash_values, sae->tmp->num_passwords, sae->tmp->ec);
-	os_free(hash_values);
-
-	sae->tmp->u_coefficients = (struct crypto_bignum **) os_zalloc(sae->tmp->num_passwords * sizeof(struct crypto_bignum *));
-	sae->tmp->u_coefficients = crypto_weave(u_values, matrix, sae->tmp->num_passwords, sae->tmp->ec);
-	sae->tmp->v_coefficients = (struct crypto_bignum **) os_zalloc(sae->tmp->num_passwords * sizeof(struct crypto_bignum *));
-	sae->tmp->v_coefficients = crypto_weave(v_values, matrix, sae->tmp->num_passwords, sae->tmp->ec);
-
-	os_free(matrix);
-	os_free(password_lens);
-	os_free(passwords);
-
-	return 0;
+	os_free(u_values);
+	os_free(v_values);
+	return ret;
 }
 
 
@@ -1716,6 +2061,24 @@ static int sae_kdf_hash(size_t hash_len, const u8 *k, const char *label,
 }
 
 
+/* sae_kdf_hash() for lanes keys with the same label and context */
+static int sae_kdf_hash_mb(size_t hash_len, size_t lanes, const u8 *k[],
+			   const char *label, const u8 *context,
+			   size_t context_len, u8 *out[], size_t out_len)
+{
+	size_t i;
+
+	if (hash_len == 32)
+		return sha256_prf_mb(lanes, k, hash_len, label, context,
+				     context_len, out, out_len);
+	for (i = 0; i < lanes; i++)
+		if (sae_kdf_hash(hash_len, k[i], label, context, context_len,
+				 out[i], out_len) < 0)
+			return -1;
+	return 0;
+}
+
+
 static int sae_derive_keys(struct sae_data *sae, const u8 *k)
 {
 	u8 zero[SAE_MAX_HASH_LEN], val[SAE_MAX_PRIME_LEN];
@@ -1858,24 +2221,30 @@ fail:
 }
 
 
-static int sae_ap_derive_keys(struct sae_data *sae, const u8 *k, int index)
-{
-	wpa_printf(MSG_DEBUG, "SAE: Deriving keys for index %d", index);
+/* Length of KCK || PMK (|| KEK) of one password */
+#define SAE_AP_KEYS_LEN (2 * SAE_MAX_HASH_LEN + SAE_PMK_LEN_MAX)
 
+static int sae_ap_derive_keys(struct sae_data *sae, const u8 *k)
+{
 	u8 zero[SAE_MAX_HASH_LEN], val[SAE_MAX_PRIME_LEN];
 	const u8 *salt;
 	struct wpabuf *rejected_groups = NULL;
-	u8 keyseed[SAE_MAX_HASH_LEN];
-	u8 keys[2 * SAE_MAX_HASH_LEN + SAE_PMK_LEN_MAX];
+	u8 *keyseeds = NULL, *keys = NULL;
+	const u8 **in = NULL;
+	u8 **out = NULL;
+	const char *label;
 	struct crypto_bignum *tmp;
 	int ret = -1;
+	int i, num = sae->tmp->num_passwords;
 	size_t hash_len, salt_len, prime_len = sae->tmp->prime_len;
-	size_t pmk_len;
-	const u8 *addr[1];
-	size_t len[1];
+	size_t pmk_len, keys_len;
 
 	tmp = crypto_bignum_init();
-	if (tmp == NULL)
+	keyseeds = os_malloc(num * SAE_MAX_HASH_LEN);
+	keys = os_malloc(num * SAE_AP_KEYS_LEN);
+	in = os_calloc(2 * num, sizeof(*in));
+	out = os_calloc(2 * num, sizeof(*out));
+	if (!tmp || !keyseeds || !keys || !in || !out)
 		goto fail;
 
 	/* keyseed = H(salt, k)
@@ -1885,6 +2254,9 @@ static int sae_ap_derive_keys(struct sae_data *sae, const u8 *k, int index)
 	 *
 	 * When SAE-PK is used,
 	 * KCK || PMK || KEK = KDF-Hash-Length(keyseed, "SAE-PK keys", context)
+	 *
+	 * Only k differs between the passwords, so the keys of all passwords
+	 * are derived together with the multi-buffer hash functions.
 	 */
 	if (!sae->h2e)
 		hash_len = SHA256_MAC_LEN;
@@ -1934,11 +2306,17 @@ static int sae_ap_derive_keys(struct sae_data *sae, const u8 *k, int index)
 	}
 	wpa_hexdump(MSG_DEBUG, "SAE: salt for keyseed derivation",
 		    salt, salt_len);
-	addr[0] = k;
-	len[0] = prime_len;
-	if (hkdf_extract(hash_len, salt, salt_len, 1, addr, len, keyseed) < 0)
+	for (i = 0; i < num; i++) {
+		in[i] = salt;
+		in[num + i] = &k[i * SAE_MAX_PRIME_LEN];
+		out[i] = &keyseeds[i * SAE_MAX_HASH_LEN];
+		out[num + i] = &keys[i * SAE_AP_KEYS_LEN];
+	}
+	if (hkdf_extract_mb(hash_len, num, in, salt_len, 1, &in[num],
+			    &prime_len, out) < 0)
 		goto fail;
-	wpa_hexdump_key(MSG_DEBUG, "SAE: keyseed", keyseed, hash_len);
+	for (i = 0; i < num; i++)
+		in[i] = out[i];
 
 	if (crypto_bignum_add(sae->tmp->own_commit_scalar,
 			      sae->peer_commit_scalar, tmp) < 0 ||
@@ -1955,24 +2333,17 @@ static int sae_ap_derive_keys(struct sae_data *sae, const u8 *k, int index)
 		goto fail;
 	wpa_hexdump(MSG_DEBUG, "SAE: PMKID", val, SAE_PMKID_LEN);
 
+	label = "SAE KCK and PMK";
+	keys_len = hash_len + pmk_len;
 #ifdef CONFIG_SAE_PK
 	if (sae->pk) {
-		if (sae_kdf_hash(hash_len, keyseed, "SAE-PK keys",
-				 val, sae->tmp->order_len,
-				 keys, 2 * hash_len + pmk_len) < 0)
-			goto fail;
-	} else {
-		if (sae_kdf_hash(hash_len, keyseed, "SAE KCK and PMK",
-				 val, sae->tmp->order_len,
-				 keys, hash_len + pmk_len) < 0)
-			goto fail;
+		label = "SAE-PK keys";
+		keys_len = 2 * hash_len + pmk_len;
 	}
-#else /* CONFIG_SAE_PK */
-	if (sae_kdf_hash(hash_len, keyseed, "SAE KCK and PMK",
-			 val, sae->tmp->order_len,
-			 keys, hash_len + pmk_len) < 0)
+#endif /* CONFIG_SAE_PK */
+	if (sae_kdf_hash_mb(hash_len, num, in, label, val, sae->tmp->order_len,
+			    &out[num], keys_len) < 0)
 		goto fail;
-#endif /* !CONFIG_SAE_PK */
 
 	if (!sae->tmp->kcks) {
 		sae->tmp->kcks = (u8 **) os_malloc(sae->tmp->num_passwords * sizeof(u8 *));
@@ -1999,30 +2370,34 @@ static int sae_ap_derive_keys(struct sae_data *sae, const u8 *k, int index)
 	if (!sae->tmp->pmk_lens) {
 		sae->tmp->pmk_lens = (size_t *) os_malloc(sae->tmp->num_passwords * sizeof(size_t));
 	}
-	
-	forced_memzero(keyseed, sizeof(keyseed));
-	os_memcpy(sae->tmp->kcks[index], keys, hash_len);
-	sae->tmp->kck_lens[index] = hash_len;
-	os_memcpy(sae->tmp->pmks[index], keys + hash_len, pmk_len);
-	sae->tmp->pmk_lens[index] = pmk_len;
-	os_memcpy(sae->tmp->pmkids[index], val, SAE_PMKID_LEN);
+
+	for (i = 0; i < num; i++) {
+		os_memcpy(sae->tmp->kcks[i], out[num + i], hash_len);
+		sae->tmp->kck_lens[i] = hash_len;
+		os_memcpy(sae->tmp->pmks[i], out[num + i] + hash_len, pmk_len);
+		sae->tmp->pmk_lens[i] = pmk_len;
+		os_memcpy(sae->tmp->pmkids[i], val, SAE_PMKID_LEN);
+		wpa_hexdump_key(MSG_DEBUG, "SAE: KCK",
+				sae->tmp->kcks[i], sae->tmp->kck_lens[i]);
+		wpa_hexdump_key(MSG_DEBUG, "SAE: PMK",
+				sae->tmp->pmks[i], sae->tmp->pmk_lens[i]);
+	}
 #ifdef CONFIG_SAE_PK
 	if (sae->pk) {
-		os_memcpy(sae->tmp->kek, keys + hash_len + SAE_PMK_LEN,
-			  hash_len);
+		os_memcpy(sae->tmp->kek,
+			  out[2 * num - 1] + hash_len + SAE_PMK_LEN, hash_len);
 		sae->tmp->kek_len = hash_len;
 		wpa_hexdump_key(MSG_DEBUG, "SAE: KEK for SAE-PK",
 				sae->tmp->kek, sae->tmp->kek_len);
 	}
 #endif /* CONFIG_SAE_PK */
-	forced_memzero(keys, sizeof(keys));
-	wpa_hexdump_key(MSG_DEBUG, "SAE: KCK",
-			sae->tmp->kcks[index], sae->tmp->kck_lens[index]	);
-	wpa_hexdump_key(MSG_DEBUG, "SAE: PMK",
-			sae->tmp->pmks[index], sae->tmp->pmk_lens[index]);
 
 	ret = 0;
 fail:
+	bin_clear_free(keyseeds, num * SAE_MAX_HASH_LEN);
+	bin_clear_free(keys, num * SAE_AP_KEYS_LEN);
+	os_free(in);
+	os_free(out);
 	wpabuf_free(rejected_groups);
 	crypto_bignum_deinit(tmp, 0);
 	return ret;
@@ -2043,16 +2418,25 @@ int sae_process_commit(struct sae_data *sae)
 
 int sae_ap_process_commit(struct sae_data *sae)
 {
-	u8 k[SAE_MAX_PRIME_LEN];
-	for (int i = 0; i < sae->tmp->num_passwords; i++) {
-		if (sae->tmp == NULL ||
-			(sae->tmp->ec && sae_ap_derive_k_ecc(sae, k, i) < 0) ||
-			(sae->tmp->dh && sae_derive_k_ffc(sae, k) < 0) ||
-			sae_ap_derive_keys(sae, k, i) < 0) {
-			return -1;
-		}
+	u8 *k;
+	int i, ret = -1;
+
+	if (sae->tmp == NULL)
+		return -1;
+	k = os_malloc(sae->tmp->num_passwords * SAE_MAX_PRIME_LEN);
+	if (!k)
+		return -1;
+	for (i = 0; i < sae->tmp->num_passwords; i++) {
+		u8 *k_i = &k[i * SAE_MAX_PRIME_LEN];
+
+		if ((sae->tmp->ec && sae_ap_derive_k_ecc(sae, k_i, i) < 0) ||
+		    (sae->tmp->dh && sae_derive_k_ffc(sae, k_i) < 0))
+			goto fail;
 	}
-	return 0;
+	ret = sae_ap_derive_keys(sae, k);
+fail:
+	bin_clear_free(k, sae->tmp->num_passwords * SAE_MAX_PRIME_LEN);
+	return ret;
 }
 
 
@@ -2145,6 +2529,7 @@ int sae_ap_write_commit(struct sae_data *sae, struct wpabuf *buf,
 		     const struct wpabuf *token, const char *identifier)
 {
 	u8 *pos;
+	size_t start;
 
 	if (sae->tmp == NULL)
 		return -1;
@@ -2155,6 +2540,20 @@ int sae_ap_write_commit(struct sae_data *sae, struct wpabuf *buf,
 		wpa_hexdump(MSG_DEBUG, "SAE: Anti-clogging token",
 			    wpabuf_head(token), wpabuf_len(token));
 	}
+
+	if (!sae->tmp->u_coefficients || !sae->tmp->v_coefficients) {
+		/*
+		 * The coefficients are released once serialized, so a
+		 * retransmission resends the same commit-scalar and elements
+		 * from the copy kept below.
+		 */
+		if (!sae->tmp->own_commit)
+			return -1;
+		wpabuf_put_buf(buf, sae->tmp->own_commit);
+		wpa_printf(MSG_DEBUG, "SAE: Reuse serialized commit");
+		return 0;
+	}
+	start = wpabuf_len(buf);
 	pos = wpabuf_put(buf, sae->tmp->prime_len);
 	if (crypto_bignum_to_bin(sae->tmp->own_commit_scalar, pos,
 				 sae->tmp->prime_len, sae->tmp->prime_len) < 0)
@@ -2176,6 +2575,7 @@ int sae_ap_write_commit(struct sae_data *sae, struct wpabuf *buf,
 		crypto_bignum_deinit(sae->tmp->u_coefficients[i], 1);
 	}
 	os_free(sae->tmp->u_coefficients);
+	sae->tmp->u_coefficients = NULL;
 
 	/* v coëfficients */
 	for (int i = 0; i < sae->tmp->num_passwords; i++) {
@@ -2186,6 +2586,7 @@ int sae_ap_write_commit(struct sae_data *sae, struct wpabuf *buf,
 		crypto_bignum_deinit(sae->tmp->v_coefficients[i], 1);
 	}
 	os_free(sae->tmp->v_coefficients);
+	sae->tmp->v_coefficients = NULL;
 
 	if (identifier) {
 		/* Password Identifier element */
@@ -2228,12 +2629,36 @@ int sae_ap_write_commit(struct sae_data *sae, struct wpabuf *buf,
 		sae->own_akm_suite_selector = suite;
 	}
 
+	wpabuf_free(sae->tmp->own_commit);
+	sae->tmp->own_commit = wpabuf_alloc_copy(wpabuf_head_u8(buf) + start,
+						 wpabuf_len(buf) - start);
+	if (!sae->tmp->own_commit)
+		return -1;
+
 	wpa_hexdump(MSG_DEBUG, "SAE: data",
 			    wpabuf_head(buf), wpabuf_len(buf));
 	return 0;
 }
 
 
+/**
+ * sae_ap_state_changed - Release AP commit data after a state change
+ * @sae: SAE data with the new state already set
+ *
+ * The serialized commit is resent unchanged on retransmission, with an
+ * Anti-Clogging Token, and when a peer restarts with the same group from
+ * Nothing state. It is released once the exchange has reached Confirmed.
+ */
+void sae_ap_state_changed(struct sae_data *sae)
+{
+	if (!sae->tmp ||
+	    (sae->state != SAE_CONFIRMED && sae->state != SAE_ACCEPTED))
+		return;
+	wpabuf_free(sae->tmp->own_commit);
+	sae->tmp->own_commit = NULL;
+}
+
+
 u16 sae_group_allowed(struct sae_data *sae, int *allowed_groups, u16 group)
 {
 	if (allowed_groups) {
@@ -2382,6 +2807,7 @@ static u16 sae_parse_coefficient(struct sae_data *sae, const u8 **pos, const u8
 	    crypto_bignum_cmp(*coefficient, sae->tmp->order) >= 0) {
 		wpa_printf(MSG_DEBUG, "SAE: Invalid coefficient");
 		crypto_bignum_deinit(*coefficient, 0);
+		*coefficient = NULL;
 		return WLAN_STATUS_UNSPECIFIED_FAILURE;
 	}
 
@@ -2779,9 +3205,164 @@ u16 sae_parse_commit(struct sae_data *sae, const u8 *data, size_t len,
 	return SAE_SILENTLY_DISCARD;
 }
 
-u16 sae_ap_parse_commit(struct sae_data *sae, const u8 *password, size_t password_len,
-			 const u8 *data, size_t len, const u8 **token, size_t *token_len,
-			 int *allowed_groups, int h2e, int *ie_offset)
+struct sae_pw_cache {
+	int group;
+	u8 *password;
+	size_t password_len;
+	struct crypto_bignum **powers; /* hash^i mod p, i = 0..num_powers-1 */
+	int num_powers;
+};
+
+
+/**
+ * sae_pw_cache_deinit - Free a STA password cache
+ * @cache: Cache from sae_ap_parse_commit() or %NULL
+ */
+void sae_pw_cache_deinit(struct sae_pw_cache *cache)
+{
+	int i;
+
+	if (!cache)
+		return;
+	for (i = 0; i < cache->num_powers; i++)
+		crypto_bignum_deinit(cache->powers[i], 1);
+	os_free(cache->powers);
+	bin_clear_free(cache->password, cache->password_len);
+	os_free(cache);
+}
+
+
+static struct sae_pw_cache * sae_pw_cache_init(struct sae_data *sae,
+					       const u8 *password,
+					       size_t password_len)
+{
+	struct sae_pw_cache *cache;
+	struct crypto_bignum *hash_bn = NULL, *x;
+	u8 hash[SHA256_MAC_LEN];
+
+	cache = os_zalloc(sizeof(*cache));
+	if (!cache)
+		return NULL;
+	cache->group = sae->group;
+	cache->password = os_memdup(password, password_len);
+	cache->password_len = password_len;
+	cache->powers = os_calloc(2, sizeof(struct crypto_bignum *));
+	if (!cache->password || !cache->powers)
+		goto fail;
+
+	/* x = H(password) reduced into the field */
+	if (sha256_vector(1, &password, &password_len, hash) < 0)
+		goto fail;
+	hash_bn = crypto_bignum_init_set(hash, sizeof(hash));
+	x = crypto_bignum_init();
+	cache->powers[0] = crypto_bignum_init_uint(1);
+	cache->powers[1] = x;
+	cache->num_powers = 2;
+	if (!hash_bn || !x || !cache->powers[0] ||
+	    crypto_bignum_mod(hash_bn, crypto_ec_get_prime(sae->tmp->ec),
+			      x) < 0)
+		goto fail;
+	crypto_bignum_deinit(hash_bn, 1);
+	forced_memzero(hash, sizeof(hash));
+	debug_print_bignum("SAE: hash", x, sae->tmp->prime_len);
+	return cache;
+fail:
+	crypto_bignum_deinit(hash_bn, 1);
+	forced_memzero(hash, sizeof(hash));
+	sae_pw_cache_deinit(cache);
+	return NULL;
+}
+
+
+/*
+ * Make sure *pw_cache matches the password and the group of this exchange and
+ * has at least num_powers powers of x.
+ */
+static int sae_pw_cache_get(struct sae_data *sae, struct sae_pw_cache **pw_cache,
+			    const u8 *password, size_t password_len,
+			    int num_powers)
+{
+	struct sae_pw_cache *cache = *pw_cache;
+	struct crypto_bignum **powers;
+	const struct crypto_bignum *prime;
+
+	if (cache &&
+	    (cache->group != sae->group ||
+	     cache->password_len != password_len ||
+	     os_memcmp_const(cache->password, password, password_len) != 0)) {
+		wpa_printf(MSG_DEBUG, "SAE: Password or group changed - flush password cache");
+		sae_pw_cache_deinit(cache);
+		cache = *pw_cache = NULL;
+	}
+	if (!cache) {
+		cache = *pw_cache = sae_pw_cache_init(sae, password,
+						      password_len);
+		if (!cache)
+			return -1;
+	}
+
+	if (num_powers <= cache->num_powers)
+		return 0;
+
+	powers = os_realloc_array(cache->powers, num_powers,
+				  sizeof(struct crypto_bignum *));
+	if (!powers)
+		return -1;
+	cache->powers = powers;
+	prime = crypto_ec_get_prime(sae->tmp->ec);
+	while (cache->num_powers < num_powers) {
+		struct crypto_bignum *p = crypto_bignum_init();
+
+		if (!p ||
+		    crypto_bignum_mulmod(powers[cache->num_powers - 1],
+					 powers[1], prime, p) < 0) {
+			crypto_bignum_deinit(p, 1);
+			return -1;
+		}
+		powers[cache->num_powers++] = p;
+	}
+	return 0;
+}
+
+
+/* sum(poly[i] * x^i) mod p with the powers of x from the password cache */
+static struct crypto_bignum *
+sae_evaluate_powers(struct sae_data *sae, struct crypto_bignum **poly,
+		    const struct sae_pw_cache *cache, int num_elements)
+{
+	const struct crypto_bignum *prime = crypto_ec_get_prime(sae->tmp->ec);
+	struct crypto_bignum *res, *tmp;
+	int i;
+
+	USDT_PROBE1(decoyauth, evaluate_entry, num_elements);
+	res = crypto_bignum_init_uint(0);
+	tmp = crypto_bignum_init();
+	if (!res || !tmp)
+		goto fail;
+	for (i = 0; i < num_elements; i++) {
+		if (crypto_bignum_mulmod(poly[i], cache->powers[i], prime,
+					 tmp) < 0 ||
+		    crypto_bignum_addmod(res, tmp, prime, res) < 0)
+			goto fail;
+	}
+	crypto_bignum_deinit(tmp, 1);
+	USDT_PROBE1(decoyauth, evaluate_return, num_elements);
+	return res;
+fail:
+	crypto_bignum_deinit(res, 1);
+	crypto_bignum_deinit(tmp, 1);
+	USDT_PROBE1(decoyauth, evaluate_return, num_elements);
+	return NULL;
+}
+
+
+static u16 sae_ap_parse_commit_frame(struct sae_data *sae, const u8 *password,
+				     size_t password_len,
+				     struct sae_pw_cache **pw_cache,
+				     const u8 *data, size_t len,
+				     const u8 **token, size_t *token_len,
+				     int *allowed_groups, int h2e,
+				     int *ie_offset)
 {
 	wpa_hexdump(MSG_DEBUG, "SAE: data",
 			    data, len);
@@ -2822,45 +3403,75 @@ u16 sae_ap_parse_commit(struct sae_data *sae, const u8 *password, size_t passwor
 	pos += sizeof(int);
 	wpa_printf(MSG_DEBUG, "SAE: num_passwords: %d", sae->tmp->num_passwords);
 
-	sae->tmp->u_coefficients = (struct crypto_bignum **) os_malloc(sae->tmp->num_passwords * sizeof(struct crypto_bignum *));
-	sae->tmp->v_coefficients = (struct crypto_bignum **) os_malloc(sae->tmp->num_passwords * sizeof(struct crypto_bignum *));
+	/*
+	 * The peer coefficients are only needed to decode the element, keep
+	 * them apart from the own ones that sae_ap_write_commit() sends.
+	 */
+	struct crypto_bignum **u_coefficients = (struct crypto_bignum **) os_calloc(sae->tmp->num_passwords, sizeof(struct crypto_bignum *));
+	struct crypto_bignum **v_coefficients = (struct crypto_bignum **) os_calloc(sae->tmp->num_passwords, sizeof(struct crypto_bignum *));
+	if (!u_coefficients || !v_coefficients) {
+		os_free(u_coefficients);
+		os_free(v_coefficients);
+		return WLAN_STATUS_UNSPECIFIED_FAILURE;
+	}
 
 	/* u coëfficients */
 	for (int i = 0; i < sae->tmp->num_passwords; i++) {
-		res = sae_parse_coefficient(sae, &pos, end, &(sae->tmp->u_coefficients[i]));
-		debug_print_bignum("SAE: u_coefficients[i]", sae->tmp->u_coefficients[i], sae->tmp->prime_len);
+		res = sae_parse_coefficient(sae, &pos, end, &u_coefficients[i]);
 		if (res != WLAN_STATUS_SUCCESS)
-			return res;
+			goto fail_coefficients;
+		debug_print_bignum("SAE: u_coefficients[i]", u_coefficients[i], sae->tmp->prime_len);
 	}
 
 	/* v coëfficients */
 	for (int i = 0; i < sae->tmp->num_passwords; i++) {
-		res = sae_parse_coefficient(sae, &pos, end, &(sae->tmp->v_coefficients[i]));
-		debug_print_bignum("SAE: v_coefficients[i]", sae->tmp->v_coefficients[i], sae->tmp->prime_len);
+		res = sae_parse_coefficient(sae, &pos, end, &v_coefficients[i]);
 		if (res != WLAN_STATUS_SUCCESS)
-			return res;
+			goto fail_coefficients;
+		debug_print_bignum("SAE: v_coefficients[i]", v_coefficients[i], sae->tmp->prime_len);
+	}
+
+	/* The hashed password and its powers only change with the network */
+	struct sae_pw_cache *local_cache = NULL;
+	if (!pw_cache)
+		pw_cache = &local_cache;
+	if (sae_pw_cache_get(sae, pw_cache, password, password_len,
+			     sae->tmp->num_passwords) < 0) {
+		sae_pw_cache_deinit(local_cache);
+		res = WLAN_STATUS_UNSPECIFIED_FAILURE;
+		goto fail_coefficients;
+	}
+
+	/* u | v of the peer commit element, decoded in place */
+	u8 uv[2 * SAE_MAX_ECC_PRIME_LEN];
+	struct crypto_bignum *u = sae_evaluate_powers(sae, u_coefficients, *pw_cache, sae->tmp->num_passwords);
+	struct crypto_bignum *v = sae_evaluate_powers(sae, v_coefficients, *pw_cache, sae->tmp->num_passwords);
+	sae_pw_cache_deinit(local_cache);
+	res = WLAN_STATUS_SUCCESS;
+	if (!u || !v ||
+	    crypto_bignum_to_bin(u, uv, sae->tmp->prime_len, sae->tmp->prime_len) < 0 ||
+	    crypto_bignum_to_bin(v, uv + sae->tmp->prime_len, sae->tmp->prime_len, sae->tmp->prime_len) < 0)
+		res = WLAN_STATUS_UNSPECIFIED_FAILURE;
+	crypto_bignum_deinit(u, 1);
+	crypto_bignum_deinit(v, 1);
+fail_coefficients:
+	for (int i = 0; i < sae->tmp->num_passwords; i++) {
+		crypto_bignum_deinit(u_coefficients[i], 0);
+		crypto_bignum_deinit(v_coefficients[i], 0);
 	}
+	os_free(u_coefficients);
+	os_free(v_coefficients);
+	if (res != WLAN_STATUS_SUCCESS)
+		return res;
+	wpa_hexdump(MSG_DEBUG, "SAE: encoded point", uv, 2 * sae->tmp->prime_len);
 
-	u8 hash[32];
-	if (sha256_vector(1, &password, &password_len, hash) < 0)
-		wpa_printf(MSG_DEBUG, "SAE: Failed to hash password");
-	struct crypto_bignum *hash_bn = crypto_bignum_init_set(hash, sizeof(hash));
-	debug_print_bignum("SAE: hash", hash_bn, sae->tmp->prime_len);
-
-	struct crypto_bignum **encoded_point = (struct crypto_bignum **) os_malloc(2 * sizeof(struct crypto_bignum *));
-	encoded_point[0] = crypto_evaluate(sae->tmp->u_coefficients, hash_bn, sae->tmp->num_passwords, sae->tmp->ec);
-	debug_print_bignum("SAE: encoded_point[0]",
-			    encoded_point[0], sae->tmp->prime_len);
-
-	encoded_point[1] = crypto_evaluate(sae->tmp->v_coefficients, hash_bn, sae->tmp->num_passwords, sae->tmp->ec);
-	debug_print_bignum("SAE: encoded_point[1]",
-			    encoded_point[1], sae->tmp->prime_len);
-
-	struct crypto_ec_point *peer_commit_element_ecc = crypto_values_to_point(encoded_point, sae->tmp->ec);
-	os_free(encoded_point);
-
+	crypto_ec_point_deinit(sae->tmp->peer_commit_element_ecc, 0);
 	sae->tmp->peer_commit_element_ecc = crypto_ec_point_init(sae->tmp->ec);
-	crypto_ec_point_clone(sae->tmp->ec, peer_commit_element_ecc, sae->tmp->peer_commit_element_ecc);
+	if (!sae->tmp->peer_commit_element_ecc ||
+	    crypto_ec_point_from_values_bin(sae->tmp->ec, uv, sae->tmp->peer_commit_element_ecc) < 0) {
+		wpa_printf(MSG_DEBUG, "SAE: Could not decode peer element");
+		return WLAN_STATUS_UNSPECIFIED_FAILURE;
+	}
 
 	/* Optional Password Identifier element */
 	res = sae_parse_password_identifier(sae, h2e, &pos, end);
@@ -2933,6 +3544,22 @@ u16 sae_ap_parse_commit(struct sae_data *sae, const u8 *password, size_t passwor
 }
 
 
+u16 sae_ap_parse_commit(struct sae_data *sae, const u8 *password, size_t password_len,
+			 struct sae_pw_cache **pw_cache, const u8 *data, size_t len, const u8 **token, size_t *token_len,
+			 int *allowed_groups, int h2e, int *ie_offset)
+{
+	u16 res;
+
+	USDT_PROBE0(decoyauth, parse_commit_entry);
+	res = sae_ap_parse_commit_frame(sae, password, password_len, pw_cache,
+					data, len, token, token_len,
+					allowed_groups, h2e, ie_offset);
+	USDT_PROBE2(decoyauth, parse_commit_return, res,
+		    sae->tmp ? sae->tmp->num_passwords : 0);
+	return res;
+}
+
+
 static int sae_cn_confirm(struct sae_data *sae, const u8 *sc,
 			  const struct crypto_bignum *scalar1,
 			  const u8 *element1, size_t element1_len,
@@ -3123,96 +3750,183 @@ int sae_check_confirm(struct sae_data *sae, const u8 *data, size_t len,
 }
 
 
+/*
+ * verifier = CN(KCK, peer-send-confirm, peer-commit-scalar,
+ *               PEER-COMMIT-ELEMENT, commit-scalar, COMMIT-ELEMENT)
+ * for all passwords of the AP at once. Only KCK and COMMIT-ELEMENT differ
+ * between the passwords and they have the same length.
+ */
+static int sae_ap_cn_confirm_ecc(struct sae_data *sae, const u8 *sc,
+				 u8 *verifiers)
+{
+	u8 scalar_b1[SAE_MAX_PRIME_LEN], scalar_b2[SAE_MAX_PRIME_LEN];
+	u8 element_b1[2 * SAE_MAX_ECC_PRIME_LEN];
+	u8 *elements_b2;
+	const u8 **addr;
+	u8 **out;
+	size_t len[5];
+	size_t prime_len = sae->tmp->prime_len;
+	int i, num = sae->tmp->num_passwords;
+	int ret = -1;
+
+	elements_b2 = os_malloc(num * 2 * prime_len);
+	addr = os_calloc(num * 6, sizeof(*addr));
+	out = os_calloc(num, sizeof(*out));
+	if (!elements_b2 || !addr || !out)
+		goto fail;
+
+	if (crypto_bignum_to_bin(sae->peer_commit_scalar, scalar_b1,
+				 sizeof(scalar_b1), prime_len) < 0 ||
+	    crypto_ec_point_to_bin(sae->tmp->ec,
+				   sae->tmp->peer_commit_element_ecc,
+				   element_b1, element_b1 + prime_len) < 0 ||
+	    crypto_bignum_to_bin(sae->tmp->own_commit_scalar, scalar_b2,
+				 sizeof(scalar_b2), prime_len) < 0)
+		goto fail;
+
+	len[0] = 2;
+	len[1] = prime_len;
+	len[2] = 2 * prime_len;
+	len[3] = prime_len;
+	len[4] = 2 * prime_len;
+	for (i = 0; i < num; i++) {
+		u8 *element_b2 = &elements_b2[i * 2 * prime_len];
+
+		if (!sae->tmp->own_commit_element_eccs[i] ||
+		    sae->tmp->kck_lens[i] != sae->tmp->kck_lens[0] ||
+		    crypto_ec_point_to_bin(sae->tmp->ec,
+					   sae->tmp->own_commit_element_eccs[i],
+					   element_b2, element_b2 + prime_len) < 0)
+			goto fail;
+		addr[5 * i] = sc;
+		addr[5 * i + 1] = scalar_b1;
+		addr[5 * i + 2] = element_b1;
+		addr[5 * i + 3] = scalar_b2;
+		addr[5 * i + 4] = element_b2;
+		addr[5 * num + i] = sae->tmp->kcks[i];
+		out[i] = &verifiers[i * SAE_MAX_HASH_LEN];
+	}
+
+	ret = hkdf_extract_mb(sae->tmp->kck_lens[0], num, &addr[5 * num],
+			      sae->tmp->kck_lens[0], 5, addr, len, out);
+fail:
+	os_free(elements_b2);
+	os_free(addr);
+	os_free(out);
+	return ret;
+}
+
+
 int sae_ap_check_confirm(struct sae_data *sae, const u8 *data, size_t len,
 		      int *ie_offset)
 {
+	u8 *verifiers;
 	size_t hash_len;
-	for (int i = 0; i < sae->tmp->num_passwords; i++) {
-		u8 verifier[SAE_MAX_HASH_LEN];
+	int i, num, ret = -1;
 
-		if (!sae->tmp)
-			return -1;
+	if (!sae->tmp)
+		return -1;
+	num = sae->tmp->num_passwords;
 
+	wpa_printf(MSG_DEBUG, "SAE: peer-send-confirm %u", WPA_GET_LE16(data));
+
+	if (!sae->peer_commit_scalar || !sae->tmp->own_commit_scalar) {
+		wpa_printf(MSG_DEBUG, "SAE: Temporary data not yet available");
+		return -1;
+	}
+
+	verifiers = os_malloc(num * SAE_MAX_HASH_LEN);
+	if (!verifiers)
+		return -1;
+
+	if (sae->tmp->ec) {
+		if (!sae->tmp->peer_commit_element_ecc ||
+		    sae_ap_cn_confirm_ecc(sae, data, verifiers) < 0)
+			goto fail;
+	} else {
+		for (i = 0; i < num; i++) {
+			sae->tmp->kck_len = sae->tmp->kck_lens[i];
+			os_memcpy(sae->tmp->kck, sae->tmp->kcks[i],
+				  sae->tmp->kck_len);
+			if (!sae->tmp->peer_commit_element_ffc ||
+			    !sae->tmp->own_commit_element_ffc ||
+			    sae_cn_confirm_ffc(sae, data,
+					       sae->peer_commit_scalar,
+					       sae->tmp->peer_commit_element_ffc,
+					       sae->tmp->own_commit_scalar,
+					       sae->tmp->own_commit_element_ffc,
+					       &verifiers[i * SAE_MAX_HASH_LEN])
+			    < 0)
+				goto fail;
+		}
+	}
+
+	for (i = 0; i < num; i++) {
 		hash_len = sae->tmp->kck_lens[i];
 		if (len < 2 + hash_len) {
 			wpa_printf(MSG_DEBUG, "SAE: Too short confirm message");
 			continue;
 		}
+		if (os_memcmp_const(&verifiers[i * SAE_MAX_HASH_LEN], data + 2,
+				    hash_len) == 0)
+			break;
+	}
+	if (i == num) {
+		wpa_printf(MSG_DEBUG, "SAE: Confirmation failed");
+		goto fail;
+	}
 
-		sae->tmp->kck_len = sae->tmp->kck_lens[i];
-		os_memcpy(sae->tmp->kck, sae->tmp->kcks[i], sae->tmp->kck_len);
-		sae->pmk_len = sae->tmp->pmk_lens[i];
-		os_memcpy(sae->pmk, sae->tmp->pmks[i], sae->pmk_len);
-		os_memcpy(sae->pmkid, sae->tmp->pmkids[i], SAE_PMKID_LEN);
+	wpa_printf(MSG_DEBUG, "SAE: Confirmation successful for index %d", i);
+	sae->password_index = i;
+	hash_len = sae->tmp->kck_lens[i];
+	sae->tmp->kck_len = hash_len;
+	os_memcpy(sae->tmp->kck, sae->tmp->kcks[i], sae->tmp->kck_len);
+	sae->pmk_len = sae->tmp->pmk_lens[i];
+	os_memcpy(sae->pmk, sae->tmp->pmks[i], sae->pmk_len);
+	os_memcpy(sae->pmkid, sae->tmp->pmkids[i], SAE_PMKID_LEN);
+	if (sae->tmp->ec) {
+		crypto_ec_point_deinit(sae->tmp->pwe_ecc, 1);
 		sae->tmp->pwe_ecc = crypto_ec_point_init(sae->tmp->ec);
-		crypto_ec_point_clone(sae->tmp->ec, sae->tmp->pwe_eccs[i], sae->tmp->pwe_ecc);
-		sae->tmp->own_commit_element_ecc = crypto_ec_point_init(sae->tmp->ec);
-		crypto_ec_point_clone(sae->tmp->ec, sae->tmp->own_commit_element_eccs[i], sae->tmp->own_commit_element_ecc);
-	
-		wpa_printf(MSG_DEBUG, "SAE: peer-send-confirm %u", WPA_GET_LE16(data));
-
-		if (!sae->peer_commit_scalar || !sae->tmp->own_commit_scalar) {
-			wpa_printf(MSG_DEBUG, "SAE: Temporary data not yet available");
-			continue;
-		}
+		crypto_ec_point_clone(sae->tmp->ec, sae->tmp->pwe_eccs[i],
+				      sae->tmp->pwe_ecc);
+		crypto_ec_point_deinit(sae->tmp->own_commit_element_ecc, 0);
+		sae->tmp->own_commit_element_ecc =
+			crypto_ec_point_init(sae->tmp->ec);
+		crypto_ec_point_clone(sae->tmp->ec,
+				      sae->tmp->own_commit_element_eccs[i],
+				      sae->tmp->own_commit_element_ecc);
+	}
 
-		if (sae->tmp->ec) {
-			if (!sae->tmp->peer_commit_element_ecc ||
-				!sae->tmp->own_commit_element_ecc ||
-				sae_cn_confirm_ecc(sae, data, sae->peer_commit_scalar,
-						sae->tmp->peer_commit_element_ecc,
-						sae->tmp->own_commit_scalar,
-						sae->tmp->own_commit_element_ecc,
-						verifier) < 0)
-				continue;
-		} else {
-			if (!sae->tmp->peer_commit_element_ffc ||
-				!sae->tmp->own_commit_element_ffc ||
-				sae_cn_confirm_ffc(sae, data, sae->peer_commit_scalar,
-						sae->tmp->peer_commit_element_ffc,
-						sae->tmp->own_commit_scalar,
-						sae->tmp->own_commit_element_ffc,
-						verifier) < 0)
-				return -1;
-		}
+	for (int j = 0; j < sae->tmp->num_passwords; j++) {
+		os_free(sae->tmp->kcks[j]);
+		os_free(sae->tmp->pmks[j]);
+		os_free(sae->tmp->pmkids[j]);
+		crypto_ec_point_deinit(sae->tmp->pwe_eccs[j], 1);
+		crypto_ec_point_deinit(sae->tmp->own_commit_element_eccs[j], 1);
+	}
 
-		if (os_memcmp_const(verifier, data + 2, hash_len) != 0) {
-			continue;
-		} else {
-			wpa_printf(MSG_DEBUG, "SAE: Confirmation successful");
-
-			for (int j = 0; j < sae->tmp->num_passwords; j++) {
-				os_free(sae->tmp->kcks[j]);
-				os_free(sae->tmp->pmks[j]);
-				os_free(sae->tmp->pmkids[j]);
-				crypto_ec_point_deinit(sae->tmp->pwe_eccs[j], 1);
-				crypto_ec_point_deinit(sae->tmp->own_commit_element_eccs[j], 1);
-			}
-
-			os_free(sae->tmp->kck_lens);
-			os_free(sae->tmp->kcks);
-			os_free(sae->tmp->pmk_lens);
-			os_free(sae->tmp->pmks);
-			os_free(sae->tmp->pmkids);
-			os_free(sae->tmp->pwe_eccs);
-			os_free(sae->tmp->own_commit_element_eccs);
+	os_free(sae->tmp->kck_lens);
+	os_free(sae->tmp->kcks);
+	os_free(sae->tmp->pmk_lens);
+	os_free(sae->tmp->pmks);
+	os_free(sae->tmp->pmkids);
+	os_free(sae->tmp->pwe_eccs);
+	os_free(sae->tmp->own_commit_element_eccs);
 
 #ifdef CONFIG_SAE_PK
-			if (sae_check_confirm_pk(sae, data + 2 + hash_len,
-						len - 2 - hash_len) < 0)
-				return -1;
+	if (sae_check_confirm_pk(sae, data + 2 + hash_len,
+				 len - 2 - hash_len) < 0)
+		goto fail;
 #endif /* CONFIG_SAE_PK */
 
-			/* 2 bytes are for send-confirm, then the hash, followed by IEs */
-			if (ie_offset)
-				*ie_offset = 2 + hash_len;
-
-			return 0;
-		}
-	}
+	/* 2 bytes are for send-confirm, then the hash, followed by IEs */
+	if (ie_offset)
+		*ie_offset = 2 + hash_len;
 
-	wpa_printf(MSG_DEBUG, "SAE: Confirmation failed");
-	return -1;
+	ret = 0;
+fail:
+	bin_clear_free(verifiers, num * SAE_MAX_HASH_LEN);
+	return ret;
 }
 
 
@@ -24,6 +24,11 @@
 #endif /* CONFIG_SAE_PK */
 #define SAE_PK_M_LEN 16
 
+/* Number of (decoy) passwords an AP commit is built over */
+#define SAE_AP_NUM_PASSWORDS 16
+/* Index of the real password, all other indices are decoys */
+#define SAE_AP_REAL_PASSWORD_INDEX 0
+
 /* Special value returned by sae_parse_commit() */
 #define SAE_SILENTLY_DISCARD 65535
 
@@ -70,6 +75,7 @@ struct sae_temporary_data {
 	struct crypto_bignum *prime_buf;
 	struct crypto_bignum *order_buf;
 	struct wpabuf *anti_clogging_token;
+	struct wpabuf *own_commit; /* serialized AP commit after the token */
 	char *pw_id;
 	char *parsed_pw_id;
 	int vlan_id;
@@ -134,9 +140,53 @@ struct sae_data {
 	unsigned int h2e:1;
 	unsigned int pk:1;
 	unsigned int no_pw_id:1;
+	int password_index; /* AP password confirmed by the peer, -1 if none */
 	struct sae_temporary_data *tmp;
 };
 
+/*
+ * Pool of AP commit material that does not depend on the peer: the commit
+ * scalar with its rand/mask pair and the random halves of the point
+ * encodings. It is filled while idle so that a commit only has to do the
+ * per-peer work.
+ */
+struct sae_ap_pool;
+
+struct sae_ap_pool_stats {
+	unsigned int size; /* maximum number of entries */
+	unsigned int len; /* entries currently available */
+	unsigned int hits; /* commits built from a pool entry */
+	unsigned int misses; /* commits that had to generate inline */
+};
+
+struct sae_ap_pool * sae_ap_pool_init(int group, unsigned int size);
+void sae_ap_pool_deinit(struct sae_ap_pool *pool);
+int sae_ap_pool_fill(struct sae_ap_pool *pool);
+void sae_ap_pool_stats(const struct sae_ap_pool *pool,
+		       struct sae_ap_pool_stats *stats);
+
+/*
+ * Read-only AP tables derived from the DecoyAuth password set for one group:
+ * the passwords, their hashes and the interpolation matrix that turns the
+ * encoded commit elements into polynomial coefficients.
+ */
+struct sae_decoy_table;
+
+struct sae_decoy_table * sae_decoy_table_init(int group,
+					      const u8 * const *passwords,
+					      const size_t *password_lens,
+					      int num_passwords);
+void sae_decoy_table_deinit(struct sae_decoy_table *table);
+
+/*
+ * Per-network STA state that only depends on the password and the group: the
+ * password hash reduced into the field and its powers for evaluating the AP
+ * commit polynomials. It is kept across reconnects and roams within an ESS.
+ */
+struct sae_pw_cache;
+
+void sae_pw_cache_deinit(struct sae_pw_cache *cache);
+
 int sae_set_group(struct sae_data *sae, int group);
 void sae_clear_temp_data(struct sae_data *sae);
 void sae_clear_data(struct sae_data *sae);
@@ -146,7 +196,8 @@ int sae_prepare_commit(const u8 *addr1, const u8 *addr2,
 		       struct sae_data *sae);
 int sae_ap_prepare_commit(const u8 *addr1, const u8 *addr2,
 			   const u8 *password, size_t password_len,
-			   struct sae_data *sae);
+			   struct sae_data *sae, struct sae_ap_pool *pool,
+			   const struct sae_decoy_table *decoys);
 int sae_prepare_commit_pt(struct sae_data *sae, const struct sae_pt *pt,
 			  const u8 *addr1, const u8 *addr2,
 			  int *rejected_groups, const struct sae_pk *pk);
@@ -156,11 +207,12 @@ int sae_write_commit(struct sae_data *sae, struct wpabuf *buf,
 		     const struct wpabuf *token, const char *identifier);
 int sae_ap_write_commit(struct sae_data *sae, struct wpabuf *buf,
 		     const struct wpabuf *token, const char *identifier);
+void sae_ap_state_changed(struct sae_data *sae);
 u16 sae_parse_commit(struct sae_data *sae, const u8 *data, size_t len,
 		     const u8 **token, size_t *token_len, int *allowed_groups,
 		     int h2e, int *ie_offset);
 u16 sae_ap_parse_commit(struct sae_data *sae, const u8 *password, size_t password_len,
-			 const u8 *data, size_t len, const u8 **token, size_t *token_len,
+			 struct sae_pw_cache **pw_cache, const u8 *data, size_t len, const u8 **token, size_t *token_len,
 			 int *allowed_groups, int h2e, int *ie_offset);
 int sae_write_confirm(struct sae_data *sae, struct wpabuf *buf);
 int sae_check_confirm(struct sae_data *sae, const u8 *data, size_t len,
@@ -367,6 +367,8 @@ extern "C" {
 #define AP_STA_DISCONNECTED "AP-STA-DISCONNECTED "
 #define AP_STA_POSSIBLE_PSK_MISMATCH "AP-STA-POSSIBLE-PSK-MISMATCH "
 #define AP_STA_POLL_OK "AP-STA-POLL-OK "
+/* A station authenticated with a DecoyAuth decoy password */
+#define DECOY_AUTH_HIT "DECOY-AUTH-HIT "
 
 #define AP_REJECTED_MAX_STA "AP-REJECTED-MAX-STA "
 #define AP_REJECTED_BLOCKED_STA "AP-REJECTED-BLOCKED-STA "
@@ -174,23 +174,24 @@ int aes_ccm_ae(const u8 *key, size_t key_len, const u8 *nonce,
 }
 
 
-/* AES-CCM with fixed L=2 and aad_len <= 30 assumption */
-int aes_ccm_ad(const u8 *key, size_t key_len, const u8 *nonce,
-	       size_t M, const u8 *crypt, size_t crypt_len,
-	       const u8 *aad, size_t aad_len, const u8 *auth, u8 *plain)
+/**
+ * aes_ccm_ad_ctx - AES-CCM decryption with an initialized AES context
+ * @aes: Context from aes_encrypt_init()
+ *
+ * This allows the key schedule to be reused over multiple messages. Otherwise,
+ * the same as aes_ccm_ad().
+ */
+int aes_ccm_ad_ctx(void *aes, const u8 *nonce, size_t M, const u8 *crypt,
+		   size_t crypt_len, const u8 *aad, size_t aad_len,
+		   const u8 *auth, u8 *plain)
 {
 	const size_t L = 2;
-	void *aes;
 	u8 x[AES_BLOCK_SIZE], a[AES_BLOCK_SIZE];
 	u8 t[AES_BLOCK_SIZE];
 
 	if (aad_len > 30 || M > AES_BLOCK_SIZE)
 		return -1;
 
-	aes = aes_encrypt_init(key, key_len);
-	if (aes == NULL)
-		return -1;
-
 	/* Decryption */
 	aes_ccm_encr_start(L, nonce, a);
 	aes_ccm_decr_auth(aes, M, a, auth, t);
@@ -201,8 +202,6 @@ int aes_ccm_ad(const u8 *key, size_t key_len, const u8 *nonce,
 	aes_ccm_auth_start(aes, M, L, nonce, aad, aad_len, crypt_len, x);
 	aes_ccm_auth(aes, plain, crypt_len, x);
 
-	aes_encrypt_deinit(aes);
-
 	if (os_memcmp_const(x, t, M) != 0) {
 		wpa_printf(MSG_EXCESSIVE, "CCM: Auth mismatch");
 		return -1;
@@ -210,3 +209,24 @@ int aes_ccm_ad(const u8 *key, size_t key_len, const u8 *nonce,
 
 	return 0;
 }
+
+
+/* AES-CCM with fixed L=2 and aad_len <= 30 assumption */
+int aes_ccm_ad(const u8 *key, size_t key_len, const u8 *nonce,
+	       size_t M, const u8 *crypt, size_t crypt_len,
+	       const u8 *aad, size_t aad_len, const u8 *auth, u8 *plain)
+{
+	void *aes;
+	int ret;
+
+	aes = aes_encrypt_init(key, key_len);
+	if (aes == NULL)
+		return -1;
+
+	ret = aes_ccm_ad_ctx(aes, nonce, M, crypt, crypt_len, aad, aad_len,
+			     auth, plain);
+
+	aes_encrypt_deinit(aes);
+
+	return ret;
+}
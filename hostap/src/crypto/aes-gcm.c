@@ -282,6 +282,32 @@ int aes_gcm_ae(const u8 *key, size_t key_len, const u8 *iv, size_t iv_len,
 }
 
 
+static int aes_gcm_ad_h(void *aes, const u8 *H, const u8 *iv, size_t iv_len,
+			const u8 *crypt, size_t crypt_len,
+			const u8 *aad, size_t aad_len, const u8 *tag, u8 *plain)
+{
+	u8 J0[AES_BLOCK_SIZE];
+	u8 S[16], T[16];
+
+	aes_gcm_prepare_j0(iv, iv_len, H, J0);
+
+	/* P = GCTR_K(inc_32(J_0), C) */
+	aes_gcm_gctr(aes, J0, crypt, crypt_len, plain);
+
+	aes_gcm_ghash(H, aad, aad_len, crypt, crypt_len, S);
+
+	/* T' = MSB_t(GCTR_K(J_0, S)) */
+	aes_gctr(aes, J0, S, sizeof(S), T);
+
+	if (os_memcmp_const(tag, T, 16) != 0) {
+		wpa_printf(MSG_EXCESSIVE, "GCM: Tag mismatch");
+		return -1;
+	}
+
+	return 0;
+}
+
+
 /**
  * aes_gcm_ad - GCM-AD_K(IV, C, A, T)
  */
@@ -290,32 +316,42 @@ int aes_gcm_ad(const u8 *key, size_t key_len, const u8 *iv, size_t iv_len,
 	       const u8 *aad, size_t aad_len, const u8 *tag, u8 *plain)
 {
 	u8 H[AES_BLOCK_SIZE];
-	u8 J0[AES_BLOCK_SIZE];
-	u8 S[16], T[16];
 	void *aes;
+	int ret;
 
 	aes = aes_gcm_init_hash_subkey(key, key_len, H);
 	if (aes == NULL)
 		return -1;
 
-	aes_gcm_prepare_j0(iv, iv_len, H, J0);
+	ret = aes_gcm_ad_h(aes, H, iv, iv_len, crypt, crypt_len, aad, aad_len,
+			   tag, plain);
 
-	/* P = GCTR_K(inc_32(J_0), C) */
-	aes_gcm_gctr(aes, J0, crypt, crypt_len, plain);
+	aes_encrypt_deinit(aes);
 
-	aes_gcm_ghash(H, aad, aad_len, crypt, crypt_len, S);
+	return ret;
+}
 
-	/* T' = MSB_t(GCTR_K(J_0, S)) */
-	aes_gctr(aes, J0, S, sizeof(S), T);
 
-	aes_encrypt_deinit(aes);
+/**
+ * aes_gcm_ad_ctx - GCM-AD_K(IV, C, A, T) with an initialized AES context
+ * @aes: Context from aes_encrypt_init()
+ *
+ * This allows the key schedule to be reused over multiple messages. Otherwise,
+ * the same as aes_gcm_ad().
+ */
+int aes_gcm_ad_ctx(void *aes, const u8 *iv, size_t iv_len,
+		   const u8 *crypt, size_t crypt_len,
+		   const u8 *aad, size_t aad_len, const u8 *tag, u8 *plain)
+{
+	u8 H[AES_BLOCK_SIZE];
 
-	if (os_memcmp_const(tag, T, 16) != 0) {
-		wpa_printf(MSG_EXCESSIVE, "GCM: Tag mismatch");
+	/* Generate hash subkey H = AES_K(0^128) */
+	os_memset(H, 0, AES_BLOCK_SIZE);
+	if (aes_encrypt(aes, H, H) < 0)
 		return -1;
-	}
 
-	return 0;
+	return aes_gcm_ad_h(aes, H, iv, iv_len, crypt, crypt_len, aad, aad_len,
+			    tag, plain);
 }
 
 
@@ -1390,6 +1390,61 @@ struct crypto_bignum **crypto_point_to_values(struct crypto_ec_point *point, str
 
 struct crypto_ec_point *crypto_values_to_point(struct crypto_bignum **point, struct crypto_ec *ec);
 
+/**
+ * crypto_ec_point_to_values_bin - Encode a point as two field elements
+ * @e: EC context from crypto_ec_init()
+ * @point: Point to encode
+ * @uv: Buffer for u | v, 2 * crypto_ec_prime_len() octets
+ * Returns: 0 on success, -1 on failure
+ *
+ * Unlike crypto_point_to_values(), this does not allocate per call. The
+ * scratch values are kept in the EC context, so the context must not be
+ * shared between threads.
+ */
+int crypto_ec_point_to_values_bin(struct crypto_ec *e,
+				  const struct crypto_ec_point *point, u8 *uv);
+
+/**
+ * crypto_ec_values_candidate - Pick the first half of a point encoding
+ * @e: EC context from crypto_ec_init()
+ * @u: Buffer for the random field element u, crypto_ec_prime_len() octets
+ * @neg_f_u: Point from crypto_ec_point_init() for -f(u)
+ * Returns: 0 on success, -1 on failure
+ *
+ * The candidate does not depend on the point that is going to be encoded,
+ * so it can be computed ahead of time and completed later with
+ * crypto_ec_point_to_values_candidate(). Each candidate must be used for at
+ * most one encoding.
+ */
+int crypto_ec_values_candidate(struct crypto_ec *e, u8 *u,
+			       struct crypto_ec_point *neg_f_u);
+
+/**
+ * crypto_ec_point_to_values_candidate - Encode a point with a given u
+ * @e: EC context from crypto_ec_init()
+ * @point: Point to encode
+ * @u: u from crypto_ec_values_candidate()
+ * @neg_f_u: -f(u) from crypto_ec_values_candidate()
+ * @uv: Buffer for u | v, 2 * crypto_ec_prime_len() octets (may start at @u)
+ * Returns: 0 on success, 1 if this candidate cannot encode @point and
+ * another one has to be tried, -1 on failure
+ */
+int crypto_ec_point_to_values_candidate(struct crypto_ec *e,
+					const struct crypto_ec_point *point,
+					const u8 *u,
+					const struct crypto_ec_point *neg_f_u,
+					u8 *uv);
+
+/**
+ * crypto_ec_point_from_values_bin - Decode a point from two field elements
+ * @e: EC context from crypto_ec_init()
+ * @uv: u | v, 2 * crypto_ec_prime_len() octets
+ * @point: Point from crypto_ec_point_init() for the result
+ * Returns: 0 on success, -1 on failure
+ */
+int crypto_ec_point_from_values_bin(struct crypto_ec *e, const u8 *uv,
+				    struct crypto_ec_point *point);
+
 struct crypto_bignum **crypto_precompute(struct crypto_bignum **x_values, int num_elements, struct crypto_ec *ec);
 
 struct crypto_bignum **crypto_weave(struct crypto_bignum **y_values, struct crypto_bignum **matrix, int num_elements, struct crypto_ec *ec);
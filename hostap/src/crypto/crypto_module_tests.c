@@ -1942,6 +1942,88 @@ static int test_sha256(void)
 }
 
 
+static int test_sha256_mb(void)
+{
+#ifdef CONFIG_SAE
+	/* More lanes than the engine has, so that the last group is partial */
+	const size_t lanes = 2 * SHA256_MB_MAX_LANES + 3;
+	u8 hash[2 * SHA256_MB_MAX_LANES + 3][48], expected[48];
+	u8 *out[2 * SHA256_MB_MAX_LANES + 3];
+	const u8 *key[2 * SHA256_MB_MAX_LANES + 3];
+	const u8 *addr[2 * (2 * SHA256_MB_MAX_LANES + 3)];
+	size_t len[2], l;
+	unsigned int i;
+	int errors = 0;
+
+	wpa_printf(MSG_INFO, "Multi-buffer SHA256 tests (%zu lanes)",
+		   sha256_mb_lanes());
+	for (l = 0; l < lanes; l++)
+		out[l] = hash[l];
+
+	for (i = 0; i < ARRAY_SIZE(tests); i++) {
+		len[0] = strlen(tests[i].data) / 2;
+		len[1] = strlen(tests[i].data) - len[0];
+		for (l = 0; l < lanes; l++) {
+			addr[2 * l] = (const u8 *) tests[i].data;
+			addr[2 * l + 1] = (const u8 *) tests[i].data + len[0];
+		}
+		if (sha256_vector_mb(lanes, 2, addr, len, out) < 0)
+			errors++;
+		for (l = 0; l < lanes; l++) {
+			if (os_memcmp(hash[l], tests[i].hash, 32) != 0) {
+				wpa_printf(MSG_INFO,
+					   "SHA256-MB test case %d lane %zu: FAIL",
+					   i + 1, l);
+				errors++;
+			}
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(hmac_tests); i++) {
+		const struct hmac_test *t = &hmac_tests[i];
+
+		len[0] = t->data_len;
+		for (l = 0; l < lanes; l++) {
+			key[l] = t->key;
+			addr[l] = t->data;
+		}
+		if (hmac_sha256_vector_mb(lanes, key, t->key_len, 1, addr, len,
+					  out) < 0)
+			errors++;
+		for (l = 0; l < lanes; l++) {
+			if (os_memcmp(hash[l], t->hash, 32) != 0) {
+				wpa_printf(MSG_INFO,
+					   "HMAC-SHA256-MB test case %d lane %zu: FAIL",
+					   i + 1, l);
+				errors++;
+			}
+		}
+	}
+
+	/* Different keys per lane against the single buffer PRF */
+	for (l = 0; l < lanes; l++)
+		key[l] = hmac_tests[l % ARRAY_SIZE(hmac_tests)].hash;
+	if (sha256_prf_mb(lanes, key, 32, "KDF test", (u8 *) "data", 4, out,
+			  sizeof(expected)) < 0)
+		errors++;
+	for (l = 0; l < lanes; l++) {
+		if (sha256_prf(key[l], 32, "KDF test", (u8 *) "data", 4,
+			       expected, sizeof(expected)) < 0 ||
+		    os_memcmp(hash[l], expected, sizeof(expected)) != 0) {
+			wpa_printf(MSG_INFO, "SHA256-PRF-MB lane %zu: FAIL", l);
+			errors++;
+		}
+	}
+
+	if (!errors)
+		wpa_printf(MSG_INFO, "Multi-buffer SHA256 test cases passed");
+	return errors;
+#else /* CONFIG_SAE */
+	return 0;
+#endif /* CONFIG_SAE */
+}
+
+
 static int test_sha384(void)
 {
 #ifdef CONFIG_SHA384
@@ -2587,6 +2669,7 @@ int crypto_module_tests(void)
 	    test_md5() ||
 	    test_sha1() ||
 	    test_sha256() ||
+	    test_sha256_mb() ||
 	    test_sha384() ||
 	    test_fips186_2_prf() ||
 	    test_extract_expand_hkdf() ||
@@ -39,6 +39,7 @@
 
 #include "common.h"
 #include "utils/const_time.h"
+#include "utils/usdt.h"
 #include "wpabuf.h"
 #include "dh_group5.h"
 #include "sha1.h"
@@ -2249,8 +2250,11 @@ struct crypto_ec {
 	BIGNUM *order;
 	BIGNUM *a;
 	BIGNUM *b;
+	struct crypto_ec_es *es;
 };
 
+static void crypto_ec_es_free(struct crypto_ec_es *es);
+
 
 static int crypto_ec_group_2_nid(int group)
 {
@@ -2363,6 +2367,7 @@ void crypto_ec_deinit(struct crypto_ec *e)
 {
 	if (e == NULL)
 		return;
+	crypto_ec_es_free(e->es);
 	BN_clear_free(e->b);
 	BN_clear_free(e->a);
 	BN_clear_free(e->order);
@@ -6093,6 +6098,7 @@ struct crypto_bignum **crypto_point_to_values(struct crypto_ec_point *point, str
 	struct crypto_bignum **output = (struct crypto_bignum **) os_malloc(2 * sizeof(struct crypto_bignum *));
 	output[0] = (struct crypto_bignum *) result[0];
 	output[1] = (struct crypto_bignum *) result[1];
+	free(result);
 	return output;
 }
 
@@ -6101,10 +6107,352 @@ struct crypto_ec_point *crypto_values_to_point(struct crypto_bignum **point, str
 	input[0] = (BIGNUM *) point[0];
 	input[1] = (BIGNUM *) point[1];
 	struct crypto_ec_point *result = (struct crypto_ec_point *) values_to_point(input, ec->group, ec->a, ec->b, ec->prime);
+	if (result)
+		os_free(input);
 	return result;
 }
 
+
+/*
+ * Constants of the encoding map and scratch values, allocated on first use
+ * so that the byte oriented encoder does not allocate per call.
+ */
+struct crypto_ec_es {
+	BN_MONT_CTX *mont;
+	BIGNUM *minus_one;
+	BIGNUM *exp_sqrt;
+	BIGNUM *inv_two;
+	BIGNUM *neg_b_div_a;
+	BIGNUM *a_div_b;
+	BIGNUM *u;
+	BIGNUM *v;
+	EC_POINT *point;
+	EC_POINT *f_u;
+	EC_POINT *f_v;
+};
+
+
+static void crypto_ec_es_free(struct crypto_ec_es *es)
+{
+	if (!es)
+		return;
+	BN_MONT_CTX_free(es->mont);
+	BN_free(es->minus_one);
+	BN_free(es->exp_sqrt);
+	BN_free(es->inv_two);
+	BN_free(es->neg_b_div_a);
+	BN_free(es->a_div_b);
+	BN_clear_free(es->u);
+	BN_clear_free(es->v);
+	EC_POINT_clear_free(es->point);
+	EC_POINT_clear_free(es->f_u);
+	EC_POINT_clear_free(es->f_v);
+	os_free(es);
+}
+
+
+static struct crypto_ec_es * crypto_ec_es_get(struct crypto_ec *e)
+{
+	struct crypto_ec_es *es;
+
+	if (e->es)
+		return e->es;
+
+	es = os_zalloc(sizeof(*es));
+	if (!es)
+		return NULL;
+	es->mont = BN_MONT_CTX_new();
+	es->minus_one = BN_new();
+	es->exp_sqrt = BN_new();
+	es->inv_two = BN_new();
+	es->neg_b_div_a = BN_new();
+	es->a_div_b = BN_new();
+	es->u = BN_new();
+	es->v = BN_new();
+	es->point = EC_POINT_new(e->group);
+	es->f_u = EC_POINT_new(e->group);
+	es->f_v = EC_POINT_new(e->group);
+	if (!es->mont || !es->minus_one || !es->exp_sqrt || !es->inv_two ||
+	    !es->neg_b_div_a || !es->a_div_b || !es->u || !es->v ||
+	    !es->point || !es->f_u || !es->f_v ||
+	    !BN_is_bit_set(e->prime, 0) || !BN_is_bit_set(e->prime, 1) ||
+	    !BN_MONT_CTX_set(es->mont, e->prime, e->bnctx) ||
+	    !BN_sub(es->minus_one, e->prime, BN_value_one()) ||
+	    !BN_add(es->inv_two, e->prime, BN_value_one()) ||
+	    !BN_rshift1(es->inv_two, es->inv_two) ||
+	    !BN_rshift1(es->exp_sqrt, es->inv_two) ||
+	    !BN_mod_inverse(es->neg_b_div_a, e->a, e->prime, e->bnctx) ||
+	    !BN_mod_mul(es->neg_b_div_a, es->neg_b_div_a, e->b, e->prime,
+			e->bnctx) ||
+	    !BN_sub(es->neg_b_div_a, e->prime, es->neg_b_div_a) ||
+	    !BN_mod_inverse(es->a_div_b, e->b, e->prime, e->bnctx) ||
+	    !BN_mod_mul(es->a_div_b, es->a_div_b, e->a, e->prime, e->bnctx)) {
+		/* The square roots below need p = 3 mod 4 */
+		crypto_ec_es_free(es);
+		return NULL;
+	}
+
+	e->es = es;
+	return es;
+}
+
+
+/* r = -r mod p for 0 <= r < p */
+static int crypto_ec_es_neg(struct crypto_ec *e, BIGNUM *r)
+{
+	return BN_is_zero(r) || BN_sub(r, e->prime, r);
+}
+
+
+/* r = a^((p+1)/4), returns 1 if that is a square root of a (0 <= a < p) */
+static int crypto_ec_es_sqrt(struct crypto_ec *e, BIGNUM *r, const BIGNUM *a)
+{
+	BIGNUM *check;
+	int ret;
+
+	BN_CTX_start(e->bnctx);
+	check = BN_CTX_get(e->bnctx);
+	ret = check &&
+		BN_mod_exp_mont(r, a, e->es->exp_sqrt, e->prime, e->bnctx,
+				e->es->mont) &&
+		BN_mod_sqr(check, r, e->prime, e->bnctx) &&
+		BN_cmp(check, a) == 0;
+	BN_CTX_end(e->bnctx);
+	return ret;
+}
+
+
+/* r = x^3 + a * x + b */
+static int crypto_ec_es_g(struct crypto_ec *e, BIGNUM *r, const BIGNUM *x)
+{
+	BIGNUM *t;
+	int ret;
+
+	BN_CTX_start(e->bnctx);
+	t = BN_CTX_get(e->bnctx);
+	ret = t &&
+		BN_mod_sqr(r, x, e->prime, e->bnctx) &&
+		BN_mod_mul(r, r, x, e->prime, e->bnctx) &&
+		BN_mod_mul(t, e->a, x, e->prime, e->bnctx) &&
+		BN_mod_add(r, r, t, e->prime, e->bnctx) &&
+		BN_mod_add(r, r, e->b, e->prime, e->bnctx);
+	BN_CTX_end(e->bnctx);
+	return ret;
+}
+
+
+/* Same map as calc_f() with the temporaries taken from the BN_CTX */
+static int crypto_ec_es_f(struct crypto_ec *e, const BIGNUM *u, EC_POINT *out)
+{
+	BIGNUM *u_square, *t, *x, *y;
+	int ret = -1;
+
+	if (BN_is_zero(u) || BN_is_one(u) || BN_cmp(u, e->es->minus_one) == 0)
+		return EC_POINT_set_to_infinity(e->group, out) ? 0 : -1;
+
+	BN_CTX_start(e->bnctx);
+	u_square = BN_CTX_get(e->bnctx);
+	t = BN_CTX_get(e->bnctx);
+	x = BN_CTX_get(e->bnctx);
+	y = BN_CTX_get(e->bnctx);
+	if (!y)
+		goto fail;
+
+	/* x_0 = -(b / a) * (1 + 1 / (u^4 - u^2)) */
+	if (!BN_mod_sqr(u_square, u, e->prime, e->bnctx) ||
+	    !BN_mod_sqr(t, u_square, e->prime, e->bnctx) ||
+	    !BN_mod_sub(t, t, u_square, e->prime, e->bnctx) ||
+	    !BN_mod_inverse(t, t, e->prime, e->bnctx) ||
+	    !BN_mod_add(t, t, BN_value_one(), e->prime, e->bnctx) ||
+	    !BN_mod_mul(x, e->es->neg_b_div_a, t, e->prime, e->bnctx) ||
+	    !crypto_ec_es_g(e, t, x))
+		goto fail;
+
+	if (!crypto_ec_es_sqrt(e, y, t)) {
+		/* x_1 = -u^2 * x_0 with y = -sqrt(g(x_1)) */
+		if (!BN_mod_mul(x, u_square, x, e->prime, e->bnctx) ||
+		    !crypto_ec_es_neg(e, x) ||
+		    !crypto_ec_es_g(e, t, x) ||
+		    !crypto_ec_es_sqrt(e, y, t) ||
+		    !crypto_ec_es_neg(e, y))
+			goto fail;
+	}
+
+	if (EC_POINT_set_affine_coordinates(e->group, out, x, y, e->bnctx))
+		ret = 0;
+fail:
+	BN_CTX_end(e->bnctx);
+	return ret;
+}
+
+
+/* Same as calc_v() with the temporaries taken from the BN_CTX */
+static int crypto_ec_es_calc_v(struct crypto_ec *e, const EC_POINT *q, int j,
+			       BIGNUM *v)
+{
+	BIGNUM *x, *y, *omega, *sqrt, *t;
+	int ret = -1;
+
+	BN_CTX_start(e->bnctx);
+	x = BN_CTX_get(e->bnctx);
+	y = BN_CTX_get(e->bnctx);
+	omega = BN_CTX_get(e->bnctx);
+	sqrt = BN_CTX_get(e->bnctx);
+	t = BN_CTX_get(e->bnctx);
+	if (!t || !EC_POINT_get_affine_coordinates(e->group, q, x, y,
+						   e->bnctx))
+		goto fail;
+
+	/* omega = (a / b) * x + 1, sqrt = +-sqrt(omega^2 - 4 * omega) */
+	if (!BN_mod_mul(omega, e->es->a_div_b, x, e->prime, e->bnctx) ||
+	    !BN_mod_add(omega, omega, BN_value_one(), e->prime, e->bnctx) ||
+	    !BN_mod_sqr(sqrt, omega, e->prime, e->bnctx) ||
+	    !BN_mod_lshift(t, omega, 2, e->prime, e->bnctx) ||
+	    !BN_mod_sub(t, sqrt, t, e->prime, e->bnctx) ||
+	    !crypto_ec_es_sqrt(e, sqrt, t) ||
+	    (j != 0 && j != 1 && !crypto_ec_es_neg(e, sqrt)))
+		goto fail;
+
+	/*
+	 * t = (omega + sqrt) / (2 * omega) if y is a square and
+	 * (omega + sqrt) / 2 otherwise
+	 */
+	if (crypto_ec_es_sqrt(e, t, y)) {
+		if (!BN_mod_lshift1(t, omega, e->prime, e->bnctx) ||
+		    !BN_mod_inverse(t, t, e->prime, e->bnctx))
+			goto fail;
+	} else if (!BN_copy(t, e->es->inv_two)) {
+		goto fail;
+	}
+	if (!BN_mod_add(omega, omega, sqrt, e->prime, e->bnctx) ||
+	    !BN_mod_mul(t, omega, t, e->prime, e->bnctx) ||
+	    !crypto_ec_es_sqrt(e, v, t) ||
+	    (j != 0 && j != 2 && !crypto_ec_es_neg(e, v)))
+		goto fail;
+
+	ret = 0;
+fail:
+	BN_CTX_end(e->bnctx);
+	return ret;
+}
+
+
+int crypto_ec_values_candidate(struct crypto_ec *e, u8 *u,
+			       struct crypto_ec_point *neg_f_u)
+{
+	struct crypto_ec_es *es = crypto_ec_es_get(e);
+	int len = BN_num_bytes(e->prime);
+	int i;
+
+	if (!es || !neg_f_u)
+		return -1;
+
+	for (i = 0; i < 1000; i++) {
+		if (!BN_rand_range(es->u, e->prime))
+			return -1;
+		if (BN_is_zero(es->u) || BN_is_one(es->u) ||
+		    BN_cmp(es->u, es->minus_one) == 0)
+			continue;
+		if (crypto_ec_es_f(e, es->u, (EC_POINT *) neg_f_u) < 0)
+			continue;
+		if (!EC_POINT_invert(e->group, (EC_POINT *) neg_f_u,
+				     e->bnctx) ||
+		    BN_bn2binpad(es->u, u, len) < 0)
+			return -1;
+		return 0;
+	}
+
+	return -1;
+}
+
+
+int crypto_ec_point_to_values_candidate(struct crypto_ec *e,
+					const struct crypto_ec_point *point,
+					const u8 *u,
+					const struct crypto_ec_point *neg_f_u,
+					u8 *uv)
+{
+	struct crypto_ec_es *es = crypto_ec_es_get(e);
+	int len = BN_num_bytes(e->prime);
+	int j;
+
+	if (!es || !point || !neg_f_u)
+		return -1;
+
+	/* f_v = point - f(u) */
+	if (!EC_POINT_add(e->group, es->f_v, (const EC_POINT *) point,
+			  (const EC_POINT *) neg_f_u, e->bnctx))
+		return -1;
+	if (EC_POINT_is_at_infinity(e->group, es->f_v))
+		return 1;
+
+	j = generate_j();
+	if (j < 0)
+		return -1;
+	if (crypto_ec_es_calc_v(e, es->f_v, j, es->v) < 0)
+		return 1;
+
+	if (uv != u)
+		os_memcpy(uv, u, len);
+	if (BN_bn2binpad(es->v, uv + len, len) < 0)
+		return -1;
+	return 0;
+}
+
+
+int crypto_ec_point_to_values_bin(struct crypto_ec *e,
+				  const struct crypto_ec_point *point, u8 *uv)
+{
+	struct crypto_ec_es *es = crypto_ec_es_get(e);
+	int i, ret = -1;
+
+	if (!es || !point)
+		return -1;
+
+	USDT_PROBE0(decoyauth, point_to_values_entry);
+	for (i = 0; i < 1000; i++) {
+		if (crypto_ec_values_candidate(e, uv,
+					       (struct crypto_ec_point *)
+					       es->f_u) < 0)
+			break;
+		ret = crypto_ec_point_to_values_candidate(
+			e, point, uv, (struct crypto_ec_point *) es->f_u, uv);
+		if (ret <= 0)
+			break;
+		ret = -1;
+	}
+	USDT_PROBE1(decoyauth, point_to_values_return, ret == 0 ? i + 1 : 0);
+
+	return ret;
+}
+
+
+int crypto_ec_point_from_values_bin(struct crypto_ec *e, const u8 *uv,
+				    struct crypto_ec_point *point)
+{
+	struct crypto_ec_es *es = crypto_ec_es_get(e);
+	int len = BN_num_bytes(e->prime);
+
+	int ret = -1;
+
+	if (!es || !point)
+		return -1;
+
+	USDT_PROBE0(decoyauth, values_to_point_entry);
+	if (BN_bin2bn(uv, len, es->u) && BN_cmp(es->u, e->prime) < 0 &&
+	    BN_bin2bn(uv + len, len, es->v) && BN_cmp(es->v, e->prime) < 0 &&
+	    crypto_ec_es_f(e, es->u, es->f_u) == 0 &&
+	    crypto_ec_es_f(e, es->v, es->f_v) == 0 &&
+	    EC_POINT_add(e->group, (EC_POINT *) point, es->f_u, es->f_v,
+			 e->bnctx))
+		ret = 0;
+	USDT_PROBE1(decoyauth, values_to_point_return, ret == 0);
+
+	return ret;
+}
+
 struct crypto_bignum **crypto_precompute(struct crypto_bignum **x_values, int num_elements, struct crypto_ec *ec) {
+	USDT_PROBE1(decoyauth, precompute_entry, num_elements);
 	BIGNUM **input = (BIGNUM **) os_malloc(num_elements * sizeof(BIGNUM *));
 	for (int i = 0; i < num_elements; i++)
 		input[i] = (BIGNUM *) x_values[i];
@@ -6116,10 +6464,12 @@ struct crypto_bignum **crypto_precompute(struct crypto_bignum **x_values, int nu
 			output[i * num_elements + j] = (struct crypto_bignum *) matrix[i * num_elements + j];
 		}
 	}
+	USDT_PROBE1(decoyauth, precompute_return, num_elements);
 	return output;
 }
 
 struct crypto_bignum **crypto_weave(struct crypto_bignum **y_values, struct crypto_bignum **matrix, int num_elements, struct crypto_ec *ec) {
+	USDT_PROBE1(decoyauth, weave_entry, num_elements);
 	BIGNUM **input = (BIGNUM **) os_malloc(num_elements * sizeof(BIGNUM *));
 	for (int i = 0; i < num_elements; i++)
 		input[i] = (BIGNUM *) y_values[i];
@@ -6133,6 +6483,7 @@ struct crypto_bignum **crypto_weave(struct crypto_bignum **y_values, struct cryp
 	for (int i = 0; i < num_elements; i++)
 		output[i] = (struct crypto_bignum *) poly[i];
 
+	USDT_PROBE1(decoyauth, weave_return, num_elements);
 	return output;
 }
 
@@ -0,0 +1,521 @@
+/*
+ * Multi-buffer SHA256, HMAC-SHA256 and SHA256-based PRF
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * Hashes several independent messages of the same length at once, one
+ * message per SIMD lane: 8 lanes with AVX2, 4 lanes with SSE2 and one lane
+ * at a time in portable C. Since all the messages have the same length,
+ * they have the same block and padding layout and the lanes never diverge.
+ * The DecoyAuth AP uses this to derive the keys and confirm verifiers of
+ * all of its passwords together.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "sha256.h"
+#include "sha256_i.h"
+#include "crypto.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SHA256_MB_X86
+#include <immintrin.h>
+#endif /* __GNUC__ && __x86_64__ */
+
+/* Elements of a message vector, HMAC adds one for the padded key */
+#define SHA256_MB_MAX_ELEM 8
+
+struct sha256_mb_engine {
+	const char *name;
+	size_t lanes;
+	/* state[word][lane], one block per lane */
+	void (*compress)(u32 state[8][SHA256_MB_MAX_LANES],
+			 u8 blocks[SHA256_MB_MAX_LANES][SHA256_BLOCK_SIZE]);
+};
+
+static const u32 sha256_mb_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b,
+	0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01,
+	0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7,
+	0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152,
+	0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+	0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+	0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819,
+	0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08,
+	0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f,
+	0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const u32 sha256_mb_h0[8] = {
+	0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+	0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+
+static inline u32 ror32(u32 x, int n)
+{
+	return (x >> n) | (x << (32 - n));
+}
+
+
+static void sha256_mb_compress_c(u32 state[8][SHA256_MB_MAX_LANES],
+				 u8 blocks[SHA256_MB_MAX_LANES][SHA256_BLOCK_SIZE])
+{
+	u32 s[8], w[64], t0, t1;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		s[i] = state[i][0];
+	for (i = 0; i < 16; i++)
+		w[i] = WPA_GET_BE32(&blocks[0][4 * i]);
+	for (i = 16; i < 64; i++)
+		w[i] = (ror32(w[i - 2], 17) ^ ror32(w[i - 2], 19) ^
+			(w[i - 2] >> 10)) + w[i - 7] +
+			(ror32(w[i - 15], 7) ^ ror32(w[i - 15], 18) ^
+			 (w[i - 15] >> 3)) + w[i - 16];
+
+	for (i = 0; i < 64; i++) {
+		t0 = s[7] + (ror32(s[4], 6) ^ ror32(s[4], 11) ^
+			     ror32(s[4], 25)) +
+			(s[6] ^ (s[4] & (s[5] ^ s[6]))) + sha256_mb_k[i] + w[i];
+		t1 = (ror32(s[0], 2) ^ ror32(s[0], 13) ^ ror32(s[0], 22)) +
+			(((s[0] | s[1]) & s[2]) | (s[0] & s[1]));
+		s[7] = s[6];
+		s[6] = s[5];
+		s[5] = s[4];
+		s[4] = s[3] + t0;
+		s[3] = s[2];
+		s[2] = s[1];
+		s[1] = s[0];
+		s[0] = t0 + t1;
+	}
+
+	for (i = 0; i < 8; i++)
+		state[i][0] += s[i];
+}
+
+
+#ifdef SHA256_MB_X86
+
+/*
+ * The SSE2 and AVX2 kernels are the same code on vectors of 4 and 8 words.
+ * V, VADD, VXOR, VAND, VOR, VSRL, VSLL, VSET1, VLOAD, VSTORE and VLANES are
+ * defined before each expansion.
+ */
+#define VROR(x, n) VOR(VSRL((x), (n)), VSLL((x), 32 - (n)))
+
+#define SHA256_MB_COMPRESS_BODY						\
+	V s[8], w[64], t0, t1;						\
+	u32 word[VLANES];						\
+	int i, l;							\
+									\
+	for (i = 0; i < 8; i++)						\
+		s[i] = VLOAD(state[i]);					\
+	for (i = 0; i < 16; i++) {					\
+		for (l = 0; l < VLANES; l++)				\
+			word[l] = WPA_GET_BE32(&blocks[l][4 * i]);	\
+		w[i] = VLOAD(word);					\
+	}								\
+	for (i = 16; i < 64; i++)					\
+		w[i] = VADD(VADD(VXOR(VXOR(VROR(w[i - 2], 17),		\
+					   VROR(w[i - 2], 19)),		\
+				      VSRL(w[i - 2], 10)),		\
+				 w[i - 7]),				\
+			    VADD(VXOR(VXOR(VROR(w[i - 15], 7),		\
+					   VROR(w[i - 15], 18)),	\
+				      VSRL(w[i - 15], 3)),		\
+				 w[i - 16]));				\
+									\
+	for (i = 0; i < 64; i++) {					\
+		t0 = VADD(VADD(s[7],					\
+			       VXOR(VXOR(VROR(s[4], 6), VROR(s[4], 11)), \
+				    VROR(s[4], 25))),			\
+			  VADD(VXOR(s[6], VAND(s[4], VXOR(s[5], s[6]))), \
+			       VADD(VSET1(sha256_mb_k[i]), w[i])));	\
+		t1 = VADD(VXOR(VXOR(VROR(s[0], 2), VROR(s[0], 13)),	\
+			       VROR(s[0], 22)),				\
+			  VOR(VAND(VOR(s[0], s[1]), s[2]),		\
+			      VAND(s[0], s[1])));			\
+		s[7] = s[6];						\
+		s[6] = s[5];						\
+		s[5] = s[4];						\
+		s[4] = VADD(s[3], t0);					\
+		s[3] = s[2];						\
+		s[2] = s[1];						\
+		s[1] = s[0];						\
+		s[0] = VADD(t0, t1);					\
+	}								\
+									\
+	for (i = 0; i < 8; i++)						\
+		VSTORE(state[i], VADD(VLOAD(state[i]), s[i]))
+
+#define V __m128i
+#define VADD _mm_add_epi32
+#define VXOR _mm_xor_si128
+#define VAND _mm_and_si128
+#define VOR _mm_or_si128
+#define VSRL _mm_srli_epi32
+#define VSLL _mm_slli_epi32
+#define VSET1(x) _mm_set1_epi32((int) (x))
+#define VLOAD(p) _mm_loadu_si128((const __m128i *) (p))
+#define VSTORE(p, x) _mm_storeu_si128((__m128i *) (p), (x))
+#define VLANES 4
+
+static void sha256_mb_compress_sse2(u32 state[8][SHA256_MB_MAX_LANES],
+				    u8 blocks[SHA256_MB_MAX_LANES][SHA256_BLOCK_SIZE])
+{
+	SHA256_MB_COMPRESS_BODY;
+}
+
+#undef V
+#undef VADD
+#undef VXOR
+#undef VAND
+#undef VOR
+#undef VSRL
+#undef VSLL
+#undef VSET1
+#undef VLOAD
+#undef VSTORE
+#undef VLANES
+
+#define V __m256i
+#define VADD _mm256_add_epi32
+#define VXOR _mm256_xor_si256
+#define VAND _mm256_and_si256
+#define VOR _mm256_or_si256
+#define VSRL _mm256_srli_epi32
+#define VSLL _mm256_slli_epi32
+#define VSET1(x) _mm256_set1_epi32((int) (x))
+#define VLOAD(p) _mm256_loadu_si256((const __m256i *) (p))
+#define VSTORE(p, x) _mm256_storeu_si256((__m256i *) (p), (x))
+#define VLANES 8
+
+__attribute__((target("avx2")))
+static void sha256_mb_compress_avx2(u32 state[8][SHA256_MB_MAX_LANES],
+				    u8 blocks[SHA256_MB_MAX_LANES][SHA256_BLOCK_SIZE])
+{
+	SHA256_MB_COMPRESS_BODY;
+}
+
+#undef V
+#undef VADD
+#undef VXOR
+#undef VAND
+#undef VOR
+#undef VSRL
+#undef VSLL
+#undef VSET1
+#undef VLOAD
+#undef VSTORE
+#undef VLANES
+
+#endif /* SHA256_MB_X86 */
+
+
+static const struct sha256_mb_engine sha256_mb_engines[] = {
+#ifdef SHA256_MB_X86
+	{ "avx2", 8, sha256_mb_compress_avx2 },
+	{ "sse2", 4, sha256_mb_compress_sse2 },
+#endif /* SHA256_MB_X86 */
+	{ "c", 1, sha256_mb_compress_c },
+};
+
+
+static const struct sha256_mb_engine * sha256_mb_engine(void)
+{
+	static const struct sha256_mb_engine *engine;
+
+	if (engine)
+		return engine;
+
+	engine = &sha256_mb_engines[ARRAY_SIZE(sha256_mb_engines) - 1];
+#ifdef SHA256_MB_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		engine = &sha256_mb_engines[0];
+	else
+		engine = &sha256_mb_engines[1];
+#endif /* SHA256_MB_X86 */
+	wpa_printf(MSG_DEBUG, "SHA256-MB: Using %s, %zu lanes",
+		   engine->name, engine->lanes);
+	return engine;
+}
+
+
+/**
+ * sha256_mb_lanes - Number of messages hashed at once
+ * Returns: The number of lanes of the SHA256 engine picked for this CPU
+ *
+ * Callers get the best throughput with a multiple of this many messages.
+ */
+size_t sha256_mb_lanes(void)
+{
+	return sha256_mb_engine()->lanes;
+}
+
+
+/*
+ * Hashes the messages of up to engine->lanes lanes. addr has num_elem
+ * pointers per lane, len is shared by all lanes. Unused lanes of the engine
+ * hash the message of lane 0 again and their result is dropped.
+ */
+static void sha256_mb_group(const struct sha256_mb_engine *engine,
+			    size_t lanes, size_t num_elem,
+			    const u8 *addr[], const size_t *len,
+			    u8 *mac[])
+{
+	u32 state[8][SHA256_MB_MAX_LANES];
+	u8 blocks[SHA256_MB_MAX_LANES][SHA256_BLOCK_SIZE];
+	const u8 **msg[SHA256_MB_MAX_LANES];
+	size_t elem = 0, off = 0, fill = 0, total = 0, chunk, i, l;
+
+	for (l = 0; l < engine->lanes; l++)
+		msg[l] = &addr[(l < lanes ? l : 0) * num_elem];
+	for (i = 0; i < 8; i++)
+		for (l = 0; l < engine->lanes; l++)
+			state[i][l] = sha256_mb_h0[i];
+	for (i = 0; i < num_elem; i++)
+		total += len[i];
+
+	/* All lanes are at the same position of their message */
+	while (elem < num_elem) {
+		chunk = len[elem] - off;
+		if (chunk > SHA256_BLOCK_SIZE - fill)
+			chunk = SHA256_BLOCK_SIZE - fill;
+		for (l = 0; l < engine->lanes; l++)
+			os_memcpy(&blocks[l][fill], msg[l][elem] + off, chunk);
+		fill += chunk;
+		off += chunk;
+		if (off == len[elem]) {
+			elem++;
+			off = 0;
+		}
+		if (fill == SHA256_BLOCK_SIZE) {
+			engine->compress(state, blocks);
+			fill = 0;
+		}
+	}
+
+	for (l = 0; l < engine->lanes; l++)
+		blocks[l][fill] = 0x80;
+	fill++;
+	if (fill > SHA256_BLOCK_SIZE - 8) {
+		for (l = 0; l < engine->lanes; l++)
+			os_memset(&blocks[l][fill], 0,
+				  SHA256_BLOCK_SIZE - fill);
+		engine->compress(state, blocks);
+		fill = 0;
+	}
+	for (l = 0; l < engine->lanes; l++) {
+		os_memset(&blocks[l][fill], 0, SHA256_BLOCK_SIZE - 8 - fill);
+		WPA_PUT_BE64(&blocks[l][SHA256_BLOCK_SIZE - 8], (u64) total * 8);
+	}
+	engine->compress(state, blocks);
+
+	for (l = 0; l < lanes; l++)
+		for (i = 0; i < 8; i++)
+			WPA_PUT_BE32(&mac[l][4 * i], state[i][l]);
+	forced_memzero(blocks, sizeof(blocks));
+	forced_memzero(state, sizeof(state));
+}
+
+
+/**
+ * sha256_vector_mb - SHA256 hash of several data vectors of the same length
+ * @lanes: Number of data vectors
+ * @num_elem: Number of elements in each data vector
+ * @addr: Pointers to the data areas, num_elem per vector one vector after
+ *	the other
+ * @len: Lengths of the data blocks, the same for all vectors
+ * @mac: Buffers for the hashes, one per vector
+ * Returns: 0 on success, -1 on failure
+ */
+int sha256_vector_mb(size_t lanes, size_t num_elem, const u8 *addr[],
+		     const size_t *len, u8 *mac[])
+{
+	const struct sha256_mb_engine *engine = sha256_mb_engine();
+	size_t l, group;
+
+	if (TEST_FAIL())
+		return -1;
+
+	for (l = 0; l < lanes; l += group) {
+		group = lanes - l;
+		if (group > engine->lanes)
+			group = engine->lanes;
+		sha256_mb_group(engine, group, num_elem, &addr[l * num_elem],
+				len, &mac[l]);
+	}
+	return 0;
+}
+
+
+/**
+ * hmac_sha256_vector_mb - HMAC-SHA256 over several data vectors
+ * @lanes: Number of data vectors
+ * @key: Keys for the HMAC operations, one per vector
+ * @key_len: Length of the keys in bytes
+ * @num_elem: Number of elements in each data vector
+ * @addr: Pointers to the data areas, num_elem per vector one vector after
+ *	the other
+ * @len: Lengths of the data blocks, the same for all vectors
+ * @mac: Buffers for the hashes, one per vector
+ * Returns: 0 on success, -1 on failure
+ *
+ * The same as calling hmac_sha256_vector() for each vector. The keys may
+ * all point to the same buffer.
+ */
+int hmac_sha256_vector_mb(size_t lanes, const u8 *key[], size_t key_len,
+			  size_t num_elem, const u8 *addr[],
+			  const size_t *len, u8 *mac[])
+{
+	u8 k_pad[SHA256_MB_MAX_LANES][SHA256_BLOCK_SIZE];
+	u8 tk[SHA256_MB_MAX_LANES][SHA256_MAC_LEN];
+	u8 inner[SHA256_MB_MAX_LANES][SHA256_MAC_LEN];
+	const u8 *_addr[SHA256_MB_MAX_LANES * (SHA256_MB_MAX_ELEM + 1)];
+	size_t _len[SHA256_MB_MAX_ELEM + 1];
+	u8 *out[SHA256_MB_MAX_LANES];
+	size_t group, klen, i, l, g;
+	int ret = -1;
+
+	if (num_elem > SHA256_MB_MAX_ELEM)
+		return -1;
+
+	for (l = 0; l < lanes; l += group) {
+		group = lanes - l;
+		if (group > SHA256_MB_MAX_LANES)
+			group = SHA256_MB_MAX_LANES;
+
+		/* if key is longer than 64 bytes reset it to key = SHA256(key)
+		 */
+		klen = key_len;
+		for (g = 0; g < group; g++) {
+			_addr[g] = key[l + g];
+			out[g] = tk[g];
+		}
+		if (key_len > SHA256_BLOCK_SIZE) {
+			if (sha256_vector_mb(group, 1, _addr, &key_len,
+					     out) < 0)
+				goto out;
+			for (g = 0; g < group; g++)
+				_addr[g] = tk[g];
+			klen = SHA256_MAC_LEN;
+		}
+
+		/* H(K XOR ipad, text) */
+		for (g = 0; g < group; g++) {
+			os_memset(k_pad[g], 0, sizeof(k_pad[g]));
+			os_memcpy(k_pad[g], _addr[g], klen);
+			for (i = 0; i < SHA256_BLOCK_SIZE; i++)
+				k_pad[g][i] ^= 0x36;
+		}
+		_len[0] = SHA256_BLOCK_SIZE;
+		for (i = 0; i < num_elem; i++)
+			_len[i + 1] = len[i];
+		for (g = 0; g < group; g++) {
+			_addr[g * (num_elem + 1)] = k_pad[g];
+			for (i = 0; i < num_elem; i++)
+				_addr[g * (num_elem + 1) + i + 1] =
+					addr[(l + g) * num_elem + i];
+			out[g] = inner[g];
+		}
+		if (sha256_vector_mb(group, num_elem + 1, _addr, _len,
+				     out) < 0)
+			goto out;
+
+		/* H(K XOR opad, H(K XOR ipad, text)) */
+		for (g = 0; g < group; g++) {
+			for (i = 0; i < SHA256_BLOCK_SIZE; i++)
+				k_pad[g][i] ^= 0x36 ^ 0x5c;
+			_addr[2 * g] = k_pad[g];
+			_addr[2 * g + 1] = inner[g];
+			out[g] = mac[l + g];
+		}
+		_len[1] = SHA256_MAC_LEN;
+		if (sha256_vector_mb(group, 2, _addr, _len, out) < 0)
+			goto out;
+	}
+	ret = 0;
+out:
+	forced_memzero(k_pad, sizeof(k_pad));
+	forced_memzero(tk, sizeof(tk));
+	forced_memzero(inner, sizeof(inner));
+	return ret;
+}
+
+
+/**
+ * sha256_prf_mb - sha256_prf() with several keys
+ * @lanes: Number of keys
+ * @key: Keys for PRF
+ * @key_len: Length of the keys in bytes
+ * @label: A unique label for each purpose of the PRF
+ * @data: Extra data to bind into the keys
+ * @data_len: Length of the data
+ * @buf: Buffers for the generated pseudo-random keys, one per key
+ * @buf_len: Number of bytes of key to generate
+ * Returns: 0 on success, -1 on failure
+ *
+ * The same as calling sha256_prf() for each key with the same label and
+ * data.
+ */
+int sha256_prf_mb(size_t lanes, const u8 *key[], size_t key_len,
+		  const char *label, const u8 *data, size_t data_len,
+		  u8 *buf[], size_t buf_len)
+{
+	u8 hash[SHA256_MB_MAX_LANES][SHA256_MAC_LEN];
+	const u8 *addr[SHA256_MB_MAX_LANES * 4];
+	size_t len[4];
+	u8 *out[SHA256_MB_MAX_LANES];
+	u8 counter_le[2], length_le[2];
+	size_t group, pos, plen, l, g;
+	u16 counter;
+	int ret = -1;
+
+	len[0] = sizeof(counter_le);
+	len[1] = os_strlen(label);
+	len[2] = data_len;
+	len[3] = sizeof(length_le);
+	for (g = 0; g < SHA256_MB_MAX_LANES; g++) {
+		addr[4 * g] = counter_le;
+		addr[4 * g + 1] = (const u8 *) label;
+		addr[4 * g + 2] = data;
+		addr[4 * g + 3] = length_le;
+	}
+	WPA_PUT_LE16(length_le, buf_len * 8);
+
+	for (l = 0; l < lanes; l += group) {
+		group = lanes - l;
+		if (group > SHA256_MB_MAX_LANES)
+			group = SHA256_MB_MAX_LANES;
+
+		counter = 1;
+		for (pos = 0; pos < buf_len; pos += plen) {
+			plen = buf_len - pos;
+			if (plen > SHA256_MAC_LEN)
+				plen = SHA256_MAC_LEN;
+			for (g = 0; g < group; g++)
+				out[g] = plen == SHA256_MAC_LEN ?
+					&buf[l + g][pos] : hash[g];
+			WPA_PUT_LE16(counter_le, counter);
+			if (hmac_sha256_vector_mb(group, &key[l], key_len, 4,
+						  addr, len, out) < 0)
+				goto out;
+			if (plen < SHA256_MAC_LEN)
+				for (g = 0; g < group; g++)
+					os_memcpy(&buf[l + g][pos], hash[g],
+						  plen);
+			counter++;
+		}
+	}
+	ret = 0;
+out:
+	forced_memzero(hash, sizeof(hash));
+	return ret;
+}
@@ -27,4 +27,17 @@ int hmac_sha256_kdf(const u8 *secret, size_t secret_len,
 		    const char *label, const u8 *seed, size_t seed_len,
 		    u8 *out, size_t outlen);
 
+/* Multi-buffer variants in sha256-mb.c */
+#define SHA256_MB_MAX_LANES 8
+
+size_t sha256_mb_lanes(void);
+int sha256_vector_mb(size_t lanes, size_t num_elem, const u8 *addr[],
+		     const size_t *len, u8 *mac[]);
+int hmac_sha256_vector_mb(size_t lanes, const u8 *key[], size_t key_len,
+			  size_t num_elem, const u8 *addr[],
+			  const size_t *len, u8 *mac[]);
+int sha256_prf_mb(size_t lanes, const u8 *key[], size_t key_len,
+		  const char *label, const u8 *data, size_t data_len,
+		  u8 *buf[], size_t buf_len);
+
 #endif /* SHA256_H */
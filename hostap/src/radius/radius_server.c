@@ -223,6 +223,7 @@ struct radius_server_data {
 
 #ifdef CONFIG_SQLITE
 	sqlite3 *db;
+	struct radius_db_log *db_log;
 #endif /* CONFIG_SQLITE */
 
 	const struct eap_config *eap_cfg;
@@ -243,6 +244,333 @@ static void radius_server_session_timeout(void *eloop_ctx, void *timeout_ctx);
 static void radius_server_session_remove_timeout(void *eloop_ctx,
 						 void *timeout_ctx);
 
+#ifdef CONFIG_SQLITE
+
+/*
+ * authlog rows of the request path are queued and written from an eloop
+ * timeout in a single transaction, so that the responses do not wait for the
+ * commit of each row. The timeout runs in the event loop like everything else,
+ * so the commit and its fsync still stall request processing, only once per
+ * batch instead of once per row.
+ *
+ * State that is read right after the response (pending_tc, current_sessions,
+ * last_msk, CoA results) may not be dropped. Queuing it flushes the queue
+ * immediately, so it is committed before the response is sent. Reads of the
+ * tables written here must call radius_db_log_flush() first.
+ */
+
+/**
+ * RADIUS_DB_LOG_QUEUE_LEN - Maximum number of queued database writes
+ */
+#define RADIUS_DB_LOG_QUEUE_LEN 256
+
+/**
+ * RADIUS_DB_LOG_FLUSH_USEC - Maximum time a write stays in the queue
+ */
+#define RADIUS_DB_LOG_FLUSH_USEC 100000
+
+#define RADIUS_DB_LOG_MAX_PARAMS 5
+
+enum radius_db_log_type {
+	RADIUS_DB_LOG_AUTHLOG,
+	RADIUS_DB_LOG_PENDING_TC,
+	RADIUS_DB_LOG_SESSION,
+	RADIUS_DB_LOG_LAST_MSK,
+	RADIUS_DB_LOG_COA_ACK,
+	RADIUS_DB_LOG_COA_NAK,
+	NUM_RADIUS_DB_LOG_TYPES
+};
+
+/* Parameter types: 's' text or NULL, 'i' int, 'u' unsigned int */
+static const struct {
+	const char *name;
+	const char *sql;
+	const char *params;
+} radius_db_log_stmts[NUM_RADIUS_DB_LOG_TYPES] = {
+	{ "authlog entry",
+	  "INSERT INTO authlog(timestamp,session,nas_ip,username,note) VALUES (?,?,?,?,?)",
+	  "susss" },
+	{ "pending_tc entry",
+	  "INSERT OR REPLACE INTO pending_tc (mac_addr,identity) VALUES (?,?)",
+	  "ss" },
+	{ "current_sessions entry",
+	  "INSERT OR REPLACE INTO current_sessions(mac_addr,identity,start_time,nas,hs20_t_c_filtering) VALUES (?,?,?,?,?)",
+	  "ssisu" },
+	{ "last_msk",
+	  "UPDATE users SET last_msk=? WHERE identity=?",
+	  "ss" },
+	{ "current_sessions CoA ACK",
+	  "UPDATE current_sessions SET hs20_t_c_filtering=0, waiting_coa_ack=0, coa_ack_received=1 WHERE mac_addr=?",
+	  "s" },
+	{ "current_sessions CoA NAK",
+	  "UPDATE current_sessions SET waiting_coa_ack=0 WHERE mac_addr=?",
+	  "s" },
+};
+
+struct radius_db_log_record {
+	enum radius_db_log_type type;
+	int may_drop;
+	char *text[RADIUS_DB_LOG_MAX_PARAMS];
+	s64 val[RADIUS_DB_LOG_MAX_PARAMS];
+};
+
+struct radius_db_log {
+	struct radius_db_log_record records[RADIUS_DB_LOG_QUEUE_LEN];
+	size_t head;
+	size_t count;
+	sqlite3_stmt *stmts[NUM_RADIUS_DB_LOG_TYPES];
+
+	u32 queued;
+	u32 written;
+	u32 failed;
+	u32 dropped;
+	u32 blocked;
+	u32 transactions;
+};
+
+
+static void radius_db_log_timeout(void *eloop_ctx, void *timeout_ctx);
+
+
+static sqlite3_stmt * radius_db_log_stmt(struct radius_server_data *data,
+					 enum radius_db_log_type type)
+{
+	struct radius_db_log *log = data->db_log;
+
+	/* Not cached on failure, the table may be created later */
+	if (!log->stmts[type] &&
+	    sqlite3_prepare_v2(data->db, radius_db_log_stmts[type].sql, -1,
+			       &log->stmts[type], NULL) != SQLITE_OK) {
+		RADIUS_ERROR("Failed to add %s into sqlite database: %s",
+			     radius_db_log_stmts[type].name,
+			     sqlite3_errmsg(data->db));
+		log->stmts[type] = NULL;
+	}
+
+	return log->stmts[type];
+}
+
+
+static int radius_db_log_write(struct radius_server_data *data,
+			       struct radius_db_log_record *rec)
+{
+	const char *params = radius_db_log_stmts[rec->type].params;
+	sqlite3_stmt *stmt;
+	int i, ret = 0;
+
+	stmt = radius_db_log_stmt(data, rec->type);
+	if (!stmt)
+		return -1;
+
+	for (i = 0; params[i]; i++) {
+		if (params[i] == 's')
+			sqlite3_bind_text(stmt, i + 1, rec->text[i], -1,
+					  SQLITE_STATIC);
+		else
+			sqlite3_bind_int64(stmt, i + 1, rec->val[i]);
+	}
+	if (sqlite3_step(stmt) != SQLITE_DONE) {
+		RADIUS_ERROR("Failed to add %s into sqlite database: %s",
+			     radius_db_log_stmts[rec->type].name,
+			     sqlite3_errmsg(data->db));
+		ret = -1;
+	}
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+	return ret;
+}
+
+
+static struct radius_db_log_record *
+radius_db_log_record(struct radius_db_log *log, size_t i)
+{
+	return &log->records[(log->head + i) % RADIUS_DB_LOG_QUEUE_LEN];
+}
+
+
+static void radius_db_log_flush(struct radius_server_data *data)
+{
+	struct radius_db_log *log = data->db_log;
+	u8 ok[RADIUS_DB_LOG_QUEUE_LEN];
+	size_t n, kept = 0;
+	int in_transaction, committed = 1;
+	int i;
+
+	if (!log || !log->count)
+		return;
+	eloop_cancel_timeout(radius_db_log_timeout, data, NULL);
+
+	in_transaction = sqlite3_exec(data->db, "BEGIN", NULL, NULL, NULL) ==
+		SQLITE_OK;
+	if (!in_transaction)
+		RADIUS_ERROR("Failed to start sqlite transaction: %s",
+			     sqlite3_errmsg(data->db));
+
+	for (n = 0; n < log->count; n++)
+		ok[n] = radius_db_log_write(data,
+					    radius_db_log_record(log, n)) == 0;
+
+	if (in_transaction) {
+		if (sqlite3_exec(data->db, "COMMIT", NULL, NULL, NULL) !=
+		    SQLITE_OK) {
+			RADIUS_ERROR("Failed to commit sqlite transaction: %s",
+				     sqlite3_errmsg(data->db));
+			sqlite3_exec(data->db, "ROLLBACK", NULL, NULL, NULL);
+			committed = 0;
+		}
+		log->transactions++;
+	}
+
+	/*
+	 * Without a commit, nothing of the batch was written. The state that
+	 * may not be dropped stays queued, at the head, for one more attempt
+	 * from the timeout.
+	 */
+	for (n = 0; n < log->count; n++) {
+		struct radius_db_log_record *rec = radius_db_log_record(log, n);
+
+		if (!committed && ok[n] && !rec->may_drop) {
+			struct radius_db_log_record *keep =
+				radius_db_log_record(log, kept++);
+
+			if (keep != rec) {
+				*keep = *rec;
+				os_memset(rec->text, 0, sizeof(rec->text));
+			}
+			keep->may_drop = 1;
+			continue;
+		}
+
+		if (committed && ok[n])
+			log->written++;
+		else
+			log->failed++;
+		for (i = 0; i < RADIUS_DB_LOG_MAX_PARAMS; i++) {
+			os_free(rec->text[i]);
+			rec->text[i] = NULL;
+		}
+	}
+
+	if (!kept)
+		log->head = (log->head + log->count) % RADIUS_DB_LOG_QUEUE_LEN;
+	log->count = kept;
+	if (kept)
+		eloop_register_timeout(0, RADIUS_DB_LOG_FLUSH_USEC,
+				       radius_db_log_timeout, data, NULL);
+}
+
+
+static void radius_db_log_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	radius_db_log_flush(eloop_ctx);
+}
+
+
+/**
+ * radius_db_log_add - Queue a database write
+ * @data: RADIUS server context
+ * @type: Statement to execute
+ * @may_drop: Whether the write can be dropped when the queue is full
+ * Returns: 0 if the write was queued, -1 if not
+ *
+ * The parameters of the statement follow, as described by the params string
+ * of the statement. Writes that may not be dropped are committed, together
+ * with the queued ones, before this returns. If that commit fails, they are
+ * tried once more from the timeout.
+ */
+static int radius_db_log_add(struct radius_server_data *data,
+			     enum radius_db_log_type type, int may_drop, ...)
+{
+	struct radius_db_log *log = data->db_log;
+	const char *params = radius_db_log_stmts[type].params;
+	struct radius_db_log_record *rec;
+	va_list ap;
+	int i;
+
+	if (!log)
+		return -1;
+
+	if (log->count == RADIUS_DB_LOG_QUEUE_LEN) {
+		if (may_drop) {
+			log->dropped++;
+			return -1;
+		}
+		log->blocked++;
+		radius_db_log_flush(data);
+		if (log->count == RADIUS_DB_LOG_QUEUE_LEN) {
+			log->dropped++;
+			return -1;
+		}
+	}
+
+	rec = radius_db_log_record(log, log->count);
+	rec->type = type;
+	rec->may_drop = may_drop;
+	va_start(ap, may_drop);
+	for (i = 0; params[i]; i++) {
+		const char *str;
+
+		switch (params[i]) {
+		case 's':
+			str = va_arg(ap, const char *);
+			rec->text[i] = str ? os_strdup(str) : NULL;
+			if (str && !rec->text[i]) {
+				va_end(ap);
+				while (i-- > 0) {
+					os_free(rec->text[i]);
+					rec->text[i] = NULL;
+				}
+				log->dropped++;
+				return -1;
+			}
+			break;
+		case 'i':
+			rec->val[i] = va_arg(ap, int);
+			break;
+		case 'u':
+			rec->val[i] = va_arg(ap, unsigned int);
+			break;
+		}
+	}
+	va_end(ap);
+
+	log->count++;
+	log->queued++;
+	if (!may_drop) {
+		radius_db_log_flush(data);
+	} else if (log->count == RADIUS_DB_LOG_QUEUE_LEN / 2) {
+		/* Commit a burst of writes without waiting for the timeout */
+		eloop_cancel_timeout(radius_db_log_timeout, data, NULL);
+		eloop_register_timeout(0, 0, radius_db_log_timeout, data, NULL);
+	} else if (log->count == 1) {
+		eloop_register_timeout(0, RADIUS_DB_LOG_FLUSH_USEC,
+				       radius_db_log_timeout, data, NULL);
+	}
+
+	return 0;
+}
+
+
+static void radius_db_log_deinit(struct radius_server_data *data)
+{
+	struct radius_db_log *log = data->db_log;
+	int i;
+
+	if (!log)
+		return;
+	/* A second failure drops the writes that were kept for a retry */
+	while (log->count)
+		radius_db_log_flush(data);
+	eloop_cancel_timeout(radius_db_log_timeout, data, NULL);
+	for (i = 0; i < NUM_RADIUS_DB_LOG_TYPES; i++)
+		sqlite3_finalize(log->stmts[i]);
+	os_free(log);
+	data->db_log = NULL;
+}
+
+#endif /* CONFIG_SQLITE */
+
+
 #ifdef CONFIG_SQLITE
 #ifdef CONFIG_HS20
 
@@ -305,21 +633,20 @@ void srv_log(struct radius_session *sess, const char *fmt, ...)
 
 #ifdef CONFIG_SQLITE
 	if (sess->server->db) {
-		char *sql;
-		sql = sqlite3_mprintf("INSERT INTO authlog"
-				      "(timestamp,session,nas_ip,username,note)"
-				      " VALUES ("
-				      "strftime('%%Y-%%m-%%d %%H:%%M:%%f',"
-				      "'now'),%u,%Q,%Q,%Q)",
-				      sess->sess_id, sess->nas_ip,
-				      sess->username, buf);
-		if (sql) {
-			if (sqlite3_exec(sess->server->db, sql, NULL, NULL,
-					 NULL) != SQLITE_OK) {
-				RADIUS_ERROR("Failed to add authlog entry into sqlite database: %s",
-					     sqlite3_errmsg(sess->server->db));
-			}
-			sqlite3_free(sql);
+		struct os_time now;
+		struct os_tm tm;
+		char timestamp[30];
+
+		/* The time of the event, as strftime('%Y-%m-%d %H:%M:%f') */
+		os_get_time(&now);
+		if (os_gmtime(now.sec, &tm) == 0) {
+			os_snprintf(timestamp, sizeof(timestamp),
+				    "%04d-%02d-%02d %02d:%02d:%02d.%03d",
+				    tm.year, tm.month, tm.day, tm.hour,
+				    tm.min, tm.sec, (int) (now.usec / 1000));
+			radius_db_log_add(sess->server, RADIUS_DB_LOG_AUTHLOG,
+					  1, timestamp, sess->sess_id,
+					  sess->nas_ip, sess->username, buf);
 		}
 	}
 #endif /* CONFIG_SQLITE */
@@ -665,7 +992,6 @@ radius_server_get_new_session(struct radius_server_data *data,
 static void radius_srv_hs20_t_c_pending(struct radius_session *sess)
 {
 #ifdef CONFIG_SQLITE
-	char *sql;
 	char addr[3 * ETH_ALEN], *id_str;
 	const u8 *id;
 	size_t id_len;
@@ -685,18 +1011,9 @@ static void radius_srv_hs20_t_c_pending(struct radius_session *sess)
 	os_memcpy(id_str, id, id_len);
 	id_str[id_len] = '\0';
 
-	sql = sqlite3_mprintf("INSERT OR REPLACE INTO pending_tc (mac_addr,identity) VALUES (%Q,%Q)",
-			      addr, id_str);
+	radius_db_log_add(sess->server, RADIUS_DB_LOG_PENDING_TC, 0,
+			  addr, id_str);
 	os_free(id_str);
-	if (!sql)
-		return;
-
-	if (sqlite3_exec(sess->server->db, sql, NULL, NULL, NULL) !=
-	    SQLITE_OK) {
-		RADIUS_ERROR("Failed to add pending_tc entry into sqlite database: %s",
-			     sqlite3_errmsg(sess->server->db));
-	}
-	sqlite3_free(sql);
 #endif /* CONFIG_SQLITE */
 }
 #endif /* CONFIG_HS20 */
@@ -705,7 +1022,6 @@ static void radius_srv_hs20_t_c_pending(struct radius_session *sess)
 static void radius_server_add_session(struct radius_session *sess)
 {
 #ifdef CONFIG_SQLITE
-	char *sql;
 	char addr_txt[ETH_ALEN * 3];
 	struct os_time now;
 
@@ -717,17 +1033,9 @@ static void radius_server_add_session(struct radius_session *sess)
 		    MAC2STR(sess->mac_addr));
 
 	os_get_time(&now);
-	sql = sqlite3_mprintf("INSERT OR REPLACE INTO current_sessions(mac_addr,identity,start_time,nas,hs20_t_c_filtering) VALUES (%Q,%Q,%d,%Q,%u)",
-			      addr_txt, sess->username, now.sec,
-			      sess->nas_ip, sess->t_c_filtering);
-	if (sql) {
-			if (sqlite3_exec(sess->server->db, sql, NULL, NULL,
-					 NULL) != SQLITE_OK) {
-				RADIUS_ERROR("Failed to add current_sessions entry into sqlite database: %s",
-					     sqlite3_errmsg(sess->server->db));
-			}
-			sqlite3_free(sql);
-	}
+	radius_db_log_add(sess->server, RADIUS_DB_LOG_SESSION, 0,
+			  addr_txt, sess->username, (int) now.sec,
+			  sess->nas_ip, (unsigned int) sess->t_c_filtering);
 #endif /* CONFIG_SQLITE */
 }
 
@@ -736,7 +1044,6 @@ static void db_update_last_msk(struct radius_session *sess, const char *msk)
 {
 #ifdef CONFIG_RADIUS_TEST
 #ifdef CONFIG_SQLITE
-	char *sql = NULL;
 	char *id_str = NULL;
 	const u8 *id;
 	size_t id_len;
@@ -763,18 +1070,9 @@ static void db_update_last_msk(struct radius_session *sess, const char *msk)
 		id_str[id_len] = '\0';
 	}
 
-	sql = sqlite3_mprintf("UPDATE users SET last_msk=%Q WHERE identity=%Q",
-			      msk, id_str);
+	radius_db_log_add(sess->server, RADIUS_DB_LOG_LAST_MSK, 0,
+			  msk, id_str);
 	os_free(id_str);
-	if (!sql)
-		return;
-
-	if (sqlite3_exec(sess->server->db, sql, NULL, NULL, NULL) !=
-	    SQLITE_OK) {
-		RADIUS_DEBUG("Failed to update last_msk: %s",
-			     sqlite3_errmsg(sess->server->db));
-	}
-	sqlite3_free(sql);
 #endif /* CONFIG_SQLITE */
 #endif /* CONFIG_RADIUS_TEST */
 }
@@ -1602,8 +1900,6 @@ static void radius_server_receive_coa_resp(struct radius_server_data *data,
 	struct radius_hdr *hdr;
 #ifdef CONFIG_SQLITE
 	char addrtxt[3 * ETH_ALEN];
-	char *sql;
-	int res;
 #endif /* CONFIG_SQLITE */
 
 	if (!client->pending_dac_coa_req) {
@@ -1644,23 +1940,8 @@ static void radius_server_receive_coa_resp(struct radius_server_data *data,
 	os_snprintf(addrtxt, sizeof(addrtxt), MACSTR,
 		    MAC2STR(client->pending_dac_coa_addr));
 
-	if (ack) {
-		sql = sqlite3_mprintf("UPDATE current_sessions SET hs20_t_c_filtering=0, waiting_coa_ack=0, coa_ack_received=1 WHERE mac_addr=%Q",
-				      addrtxt);
-	} else {
-		sql = sqlite3_mprintf("UPDATE current_sessions SET waiting_coa_ack=0 WHERE mac_addr=%Q",
-				      addrtxt);
-	}
-	if (!sql)
-		return;
-
-	res = sqlite3_exec(data->db, sql, NULL, NULL, NULL);
-	sqlite3_free(sql);
-	if (res != SQLITE_OK) {
-		RADIUS_ERROR("Failed to update current_sessions entry: %s",
-			     sqlite3_errmsg(data->db));
-		return;
-	}
+	radius_db_log_add(data, ack ? RADIUS_DB_LOG_COA_ACK :
+			  RADIUS_DB_LOG_COA_NAK, 0, addrtxt);
 #endif /* CONFIG_SQLITE */
 }
 
@@ -2258,6 +2539,9 @@ radius_server_init(struct radius_server_conf *conf)
 				     conf->sqlite_file);
 			goto fail;
 		}
+		data->db_log = os_zalloc(sizeof(*data->db_log));
+		if (!data->db_log)
+			goto fail;
 	}
 #endif /* CONFIG_SQLITE */
 
@@ -2364,6 +2648,7 @@ void radius_server_deinit(struct radius_server_data *data)
 	os_free(data->t_c_server_url);
 
 #ifdef CONFIG_SQLITE
+	radius_db_log_deinit(data);
 	if (data->db)
 		sqlite3_close(data->db);
 #endif /* CONFIG_SQLITE */
@@ -2453,6 +2738,36 @@ int radius_server_get_mib(struct radius_server_data *data, char *buf,
 	}
 	pos += ret;
 
+#ifdef CONFIG_SQLITE
+	if (data->db_log) {
+		/*
+		 * Not part of RFC 2619; the queued SQLite writes. They are
+		 * committed from an eloop timeout, not a separate thread, so
+		 * each commit blocks the processing of requests.
+		 */
+		ret = os_snprintf(pos, end - pos,
+				  "radiusServDbLogPending=%u\n"
+				  "radiusServDbLogQueued=%u\n"
+				  "radiusServDbLogWritten=%u\n"
+				  "radiusServDbLogFailed=%u\n"
+				  "radiusServDbLogDropped=%u\n"
+				  "radiusServDbLogBlocked=%u\n"
+				  "radiusServDbLogTransactions=%u\n",
+				  (unsigned int) data->db_log->count,
+				  data->db_log->queued,
+				  data->db_log->written,
+				  data->db_log->failed,
+				  data->db_log->dropped,
+				  data->db_log->blocked,
+				  data->db_log->transactions);
+		if (os_snprintf_error(end - pos, ret)) {
+			*pos = '\0';
+			return pos - buf;
+		}
+		pos += ret;
+	}
+#endif /* CONFIG_SQLITE */
+
 	for (cli = data->clients, idx = 0; cli; cli = cli->next, idx++) {
 		char abuf[50], mbuf[50];
 #ifdef CONFIG_IPV6
@@ -2757,6 +3072,7 @@ int radius_server_dac_request(struct radius_server_data *data, const char *req)
 
 	os_snprintf(addrtxt, sizeof(addrtxt), MACSTR, MAC2STR(addr));
 
+	radius_db_log_flush(data);
 	sql = sqlite3_mprintf("SELECT * FROM current_sessions WHERE mac_addr=%Q",
 			      addrtxt);
 	if (!sql)
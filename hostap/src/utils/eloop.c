@@ -50,11 +50,16 @@ struct eloop_sock {
 };
 
 struct eloop_timeout {
-	struct dl_list list;
+	struct dl_list list; /* sorted list, or hash bucket with the heap */
 	struct os_reltime time;
 	void *eloop_data;
 	void *user_data;
 	eloop_timeout_handler handler;
+	eloop_timeout_id id;
+#ifdef CONFIG_ELOOP_TIMER_HEAP
+	u64 seq;
+	size_t heap_idx;
+#endif /* CONFIG_ELOOP_TIMER_HEAP */
 	WPA_TRACE_REF(eloop);
 	WPA_TRACE_REF(user);
 	WPA_TRACE_INFO
@@ -67,6 +72,17 @@ struct eloop_signal {
 	int signaled;
 };
 
+#ifdef CONFIG_ELOOP_TIMER_HEAP
+#define ELOOP_TIMEOUT_NO_SLOT 0xffffffff
+
+/* Maps the handle of a timeout to the timeout, see eloop_timeout_by_id() */
+struct eloop_timeout_slot {
+	struct eloop_timeout *timeout;
+	u32 gen;
+	u32 next_free;
+};
+#endif /* CONFIG_ELOOP_TIMER_HEAP */
+
 struct eloop_sock_table {
 	size_t count;
 	struct eloop_sock *table;
@@ -102,7 +118,20 @@ struct eloop_data {
 	struct eloop_sock_table writers;
 	struct eloop_sock_table exceptions;
 
+#ifdef CONFIG_ELOOP_TIMER_HEAP
+	struct eloop_timeout **timeout_heap;
+	size_t timeout_count;
+	size_t timeout_heap_size;
+	struct dl_list *timeout_buckets;
+	size_t timeout_bucket_count;
+	struct eloop_timeout_slot *timeout_slots;
+	size_t timeout_slot_count;
+	u32 timeout_free_slot;
+	u64 timeout_seq;
+#else /* CONFIG_ELOOP_TIMER_HEAP */
 	struct dl_list timeout;
+	eloop_timeout_id timeout_last_id;
+#endif /* CONFIG_ELOOP_TIMER_HEAP */
 
 	size_t signal_count;
 	struct eloop_signal *signals;
@@ -163,7 +192,11 @@ static void eloop_trace_sock_remove_ref(struct eloop_sock_table *table)
 int eloop_init(void)
 {
 	os_memset(&eloop, 0, sizeof(eloop));
+#ifdef CONFIG_ELOOP_TIMER_HEAP
+	eloop.timeout_free_slot = ELOOP_TIMEOUT_NO_SLOT;
+#else /* CONFIG_ELOOP_TIMER_HEAP */
 	dl_list_init(&eloop.timeout);
+#endif /* CONFIG_ELOOP_TIMER_HEAP */
 #ifdef CONFIG_ELOOP_EPOLL
 	eloop.epollfd = epoll_create1(0);
 	if (eloop.epollfd < 0) {
@@ -769,13 +802,343 @@ void eloop_unregister_sock(int sock, eloop_event_type type)
 }
 
 
+#ifdef CONFIG_ELOOP_TIMER_HEAP
+
+/*
+ * Timer heap backend: the timeouts are kept in a binary min-heap ordered by
+ * expiry time and registration order, so registering a timeout and running
+ * the first one are O(log n). A hash table on <handler,eloop_data,user_data>
+ * makes the lookups of eloop_cancel_timeout() and friends O(1) on average,
+ * and a slot table maps the handles of eloop_register_timeout_id() to the
+ * timeouts. Wildcard cancellation with ELOOP_ALL_CTX still visits every
+ * timeout.
+ */
+
+#define ELOOP_TIMEOUT_MIN_ALLOC 64
+
+static int eloop_timeout_before(struct eloop_timeout *a,
+				struct eloop_timeout *b)
+{
+	if (a->time.sec != b->time.sec || a->time.usec != b->time.usec)
+		return os_reltime_before(&a->time, &b->time);
+	/* Timeouts with the same expiry time run in registration order */
+	return a->seq < b->seq;
+}
+
+
+static size_t eloop_timeout_bucket(eloop_timeout_handler handler,
+				   void *eloop_data, void *user_data)
+{
+	u64 h;
+
+	h = (u64) (uintptr_t) handler;
+	h = (h ^ (u64) (uintptr_t) eloop_data) * 0x9e3779b97f4a7c15ULL;
+	h = (h ^ (u64) (uintptr_t) user_data) * 0x9e3779b97f4a7c15ULL;
+	return (size_t) (h >> 32) & (eloop.timeout_bucket_count - 1);
+}
+
+
+static void eloop_timeout_heap_set(size_t idx, struct eloop_timeout *timeout)
+{
+	eloop.timeout_heap[idx] = timeout;
+	timeout->heap_idx = idx;
+}
+
+
+static void eloop_timeout_sift_up(size_t idx)
+{
+	struct eloop_timeout *timeout = eloop.timeout_heap[idx];
+
+	while (idx > 0) {
+		size_t parent = (idx - 1) / 2;
+
+		if (!eloop_timeout_before(timeout, eloop.timeout_heap[parent]))
+			break;
+		eloop_timeout_heap_set(idx, eloop.timeout_heap[parent]);
+		idx = parent;
+	}
+	eloop_timeout_heap_set(idx, timeout);
+}
+
+
+static void eloop_timeout_sift_down(size_t idx)
+{
+	struct eloop_timeout *timeout = eloop.timeout_heap[idx];
+	size_t count = eloop.timeout_count;
+
+	for (;;) {
+		size_t child = 2 * idx + 1;
+
+		if (child >= count)
+			break;
+		if (child + 1 < count &&
+		    eloop_timeout_before(eloop.timeout_heap[child + 1],
+					 eloop.timeout_heap[child]))
+			child++;
+		if (!eloop_timeout_before(eloop.timeout_heap[child], timeout))
+			break;
+		eloop_timeout_heap_set(idx, eloop.timeout_heap[child]);
+		idx = child;
+	}
+	eloop_timeout_heap_set(idx, timeout);
+}
+
+
+static int eloop_timeout_rehash(size_t bucket_count)
+{
+	struct dl_list *buckets;
+	size_t i;
+
+	buckets = os_calloc(bucket_count, sizeof(*buckets));
+	if (!buckets)
+		return -1;
+	for (i = 0; i < bucket_count; i++)
+		dl_list_init(&buckets[i]);
+	os_free(eloop.timeout_buckets);
+	eloop.timeout_buckets = buckets;
+	eloop.timeout_bucket_count = bucket_count;
+
+	for (i = 0; i < eloop.timeout_count; i++) {
+		struct eloop_timeout *timeout = eloop.timeout_heap[i];
+
+		dl_list_add_tail(&buckets[eloop_timeout_bucket(
+						timeout->handler,
+						timeout->eloop_data,
+						timeout->user_data)],
+				 &timeout->list);
+	}
+	return 0;
+}
+
+
+static int eloop_timeout_alloc_slot(struct eloop_timeout *timeout)
+{
+	struct eloop_timeout_slot *slot;
+	u32 idx;
+
+	if (eloop.timeout_free_slot == ELOOP_TIMEOUT_NO_SLOT) {
+		struct eloop_timeout_slot *slots;
+		size_t count, i;
+
+		count = eloop.timeout_slot_count ?
+			2 * eloop.timeout_slot_count :
+			ELOOP_TIMEOUT_MIN_ALLOC;
+		if (count >= ELOOP_TIMEOUT_NO_SLOT)
+			return -1;
+		slots = os_realloc_array(eloop.timeout_slots, count,
+					 sizeof(*slots));
+		if (!slots)
+			return -1;
+		for (i = eloop.timeout_slot_count; i < count; i++) {
+			slots[i].timeout = NULL;
+			slots[i].gen = 1;
+			slots[i].next_free = i + 1 < count ? i + 1 :
+				ELOOP_TIMEOUT_NO_SLOT;
+		}
+		eloop.timeout_free_slot = eloop.timeout_slot_count;
+		eloop.timeout_slots = slots;
+		eloop.timeout_slot_count = count;
+	}
+
+	idx = eloop.timeout_free_slot;
+	slot = &eloop.timeout_slots[idx];
+	eloop.timeout_free_slot = slot->next_free;
+	slot->timeout = timeout;
+	timeout->id = ((u64) slot->gen << 32) | idx;
+	return 0;
+}
+
+
+static void eloop_timeout_free_slot(struct eloop_timeout *timeout)
+{
+	u32 idx = timeout->id & 0xffffffff;
+	struct eloop_timeout_slot *slot = &eloop.timeout_slots[idx];
+
+	slot->timeout = NULL;
+	/* Stale handles of this slot must not match the next timeout */
+	if (++slot->gen == 0)
+		slot->gen = 1;
+	slot->next_free = eloop.timeout_free_slot;
+	eloop.timeout_free_slot = idx;
+}
+
+
+static int eloop_insert_timeout(struct eloop_timeout *timeout)
+{
+	if (eloop.timeout_count == eloop.timeout_heap_size) {
+		struct eloop_timeout **heap;
+		size_t size;
+
+		size = eloop.timeout_heap_size ? 2 * eloop.timeout_heap_size :
+			ELOOP_TIMEOUT_MIN_ALLOC;
+		heap = os_realloc_array(eloop.timeout_heap, size,
+					sizeof(*heap));
+		if (!heap)
+			return -1;
+		eloop.timeout_heap = heap;
+		eloop.timeout_heap_size = size;
+	}
+	if (eloop.timeout_count >= eloop.timeout_bucket_count &&
+	    eloop_timeout_rehash(eloop.timeout_bucket_count ?
+				 2 * eloop.timeout_bucket_count :
+				 ELOOP_TIMEOUT_MIN_ALLOC) < 0 &&
+	    !eloop.timeout_bucket_count)
+		return -1;
+	if (eloop_timeout_alloc_slot(timeout) < 0)
+		return -1;
+
+	timeout->seq = eloop.timeout_seq++;
+	eloop_timeout_heap_set(eloop.timeout_count++, timeout);
+	eloop_timeout_sift_up(timeout->heap_idx);
+	dl_list_add_tail(&eloop.timeout_buckets[eloop_timeout_bucket(
+					timeout->handler, timeout->eloop_data,
+					timeout->user_data)],
+			 &timeout->list);
+	return 0;
+}
+
+
+static void eloop_unlink_timeout(struct eloop_timeout *timeout)
+{
+	size_t idx = timeout->heap_idx;
+
+	dl_list_del(&timeout->list);
+	eloop_timeout_free_slot(timeout);
+	if (idx != --eloop.timeout_count) {
+		struct eloop_timeout *last =
+			eloop.timeout_heap[eloop.timeout_count];
+
+		eloop_timeout_heap_set(idx, last);
+		if (idx > 0 &&
+		    eloop_timeout_before(last,
+					 eloop.timeout_heap[(idx - 1) / 2]))
+			eloop_timeout_sift_up(idx);
+		else
+			eloop_timeout_sift_down(idx);
+	}
+}
+
+
+static struct eloop_timeout * eloop_first_timeout(void)
+{
+	return eloop.timeout_count ? eloop.timeout_heap[0] : NULL;
+}
+
+
+/* The matching timeout that expires first, as with the sorted list */
+static struct eloop_timeout * eloop_find_timeout(eloop_timeout_handler handler,
+						 void *eloop_data,
+						 void *user_data)
+{
+	struct eloop_timeout *tmp, *found = NULL;
+
+	if (!eloop.timeout_count)
+		return NULL;
+	dl_list_for_each(tmp, &eloop.timeout_buckets[eloop_timeout_bucket(
+						handler, eloop_data, user_data)],
+			 struct eloop_timeout, list) {
+		if (tmp->handler == handler &&
+		    tmp->eloop_data == eloop_data &&
+		    tmp->user_data == user_data &&
+		    (!found || eloop_timeout_before(tmp, found)))
+			found = tmp;
+	}
+	return found;
+}
+
+
+static struct eloop_timeout * eloop_timeout_by_id(eloop_timeout_id id)
+{
+	u32 idx = id & 0xffffffff;
+	struct eloop_timeout *timeout;
+
+	if (idx >= eloop.timeout_slot_count)
+		return NULL;
+	timeout = eloop.timeout_slots[idx].timeout;
+	return timeout && timeout->id == id ? timeout : NULL;
+}
+
+#else /* CONFIG_ELOOP_TIMER_HEAP */
+
+static int eloop_insert_timeout(struct eloop_timeout *timeout)
+{
+	struct eloop_timeout *tmp;
+
+	timeout->id = ++eloop.timeout_last_id;
+
+	/* Maintain timeouts in order of increasing time */
+	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
+		if (os_reltime_before(&timeout->time, &tmp->time)) {
+			dl_list_add(tmp->list.prev, &timeout->list);
+			return 0;
+		}
+	}
+	dl_list_add_tail(&eloop.timeout, &timeout->list);
+	return 0;
+}
+
+
+static void eloop_unlink_timeout(struct eloop_timeout *timeout)
+{
+	dl_list_del(&timeout->list);
+}
+
+
+static struct eloop_timeout * eloop_first_timeout(void)
+{
+	return dl_list_first(&eloop.timeout, struct eloop_timeout, list);
+}
+
+
+static struct eloop_timeout * eloop_find_timeout(eloop_timeout_handler handler,
+						 void *eloop_data,
+						 void *user_data)
+{
+	struct eloop_timeout *tmp;
+
+	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
+		if (tmp->handler == handler &&
+		    tmp->eloop_data == eloop_data &&
+		    tmp->user_data == user_data)
+			return tmp;
+	}
+	return NULL;
+}
+
+
+static struct eloop_timeout * eloop_timeout_by_id(eloop_timeout_id id)
+{
+	struct eloop_timeout *tmp;
+
+	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
+		if (tmp->id == id)
+			return tmp;
+	}
+	return NULL;
+}
+
+#endif /* CONFIG_ELOOP_TIMER_HEAP */
+
+
 int eloop_register_timeout(unsigned int secs, unsigned int usecs,
 			   eloop_timeout_handler handler,
 			   void *eloop_data, void *user_data)
 {
-	struct eloop_timeout *timeout, *tmp;
+	return eloop_register_timeout_id(secs, usecs, handler, eloop_data,
+					 user_data, NULL);
+}
+
+
+int eloop_register_timeout_id(unsigned int secs, unsigned int usecs,
+			      eloop_timeout_handler handler,
+			      void *eloop_data, void *user_data,
+			      eloop_timeout_id *id)
+{
+	struct eloop_timeout *timeout;
 	os_time_t now_sec;
 
+	if (id)
+		*id = 0;
 	timeout = os_zalloc(sizeof(*timeout));
 	if (timeout == NULL)
 		return -1;
@@ -797,18 +1160,16 @@ int eloop_register_timeout(unsigned int secs, unsigned int usecs,
 	timeout->eloop_data = eloop_data;
 	timeout->user_data = user_data;
 	timeout->handler = handler;
+
+	if (eloop_insert_timeout(timeout) < 0) {
+		os_free(timeout);
+		return -1;
+	}
 	wpa_trace_add_ref(timeout, eloop, eloop_data);
 	wpa_trace_add_ref(timeout, user, user_data);
 	wpa_trace_record(timeout);
-
-	/* Maintain timeouts in order of increasing time */
-	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
-		if (os_reltime_before(&timeout->time, &tmp->time)) {
-			dl_list_add(tmp->list.prev, &timeout->list);
-			return 0;
-		}
-	}
-	dl_list_add_tail(&eloop.timeout, &timeout->list);
+	if (id)
+		*id = timeout->id;
 
 	return 0;
 
@@ -827,7 +1188,7 @@ overflow:
 
 static void eloop_remove_timeout(struct eloop_timeout *timeout)
 {
-	dl_list_del(&timeout->list);
+	eloop_unlink_timeout(timeout);
 	wpa_trace_remove_ref(timeout, eloop, timeout->eloop_data);
 	wpa_trace_remove_ref(timeout, user, timeout->user_data);
 	os_free(timeout);
@@ -838,17 +1199,37 @@ int eloop_cancel_timeout(eloop_timeout_handler handler,
 			 void *eloop_data, void *user_data)
 {
 	struct eloop_timeout *timeout, *prev;
+	struct dl_list *heads;
+	size_t i, count;
 	int removed = 0;
 
-	dl_list_for_each_safe(timeout, prev, &eloop.timeout,
-			      struct eloop_timeout, list) {
-		if (timeout->handler == handler &&
-		    (timeout->eloop_data == eloop_data ||
-		     eloop_data == ELOOP_ALL_CTX) &&
-		    (timeout->user_data == user_data ||
-		     user_data == ELOOP_ALL_CTX)) {
-			eloop_remove_timeout(timeout);
-			removed++;
+#ifdef CONFIG_ELOOP_TIMER_HEAP
+	if (!eloop.timeout_count)
+		return 0;
+	if (eloop_data == ELOOP_ALL_CTX || user_data == ELOOP_ALL_CTX) {
+		heads = eloop.timeout_buckets;
+		count = eloop.timeout_bucket_count;
+	} else {
+		heads = &eloop.timeout_buckets[eloop_timeout_bucket(
+				handler, eloop_data, user_data)];
+		count = 1;
+	}
+#else /* CONFIG_ELOOP_TIMER_HEAP */
+	heads = &eloop.timeout;
+	count = 1;
+#endif /* CONFIG_ELOOP_TIMER_HEAP */
+
+	for (i = 0; i < count; i++) {
+		dl_list_for_each_safe(timeout, prev, &heads[i],
+				      struct eloop_timeout, list) {
+			if (timeout->handler == handler &&
+			    (timeout->eloop_data == eloop_data ||
+			     eloop_data == ELOOP_ALL_CTX) &&
+			    (timeout->user_data == user_data ||
+			     user_data == ELOOP_ALL_CTX)) {
+				eloop_remove_timeout(timeout);
+				removed++;
+			}
 		}
 	}
 
@@ -860,42 +1241,40 @@ int eloop_cancel_timeout_one(eloop_timeout_handler handler,
 			     void *eloop_data, void *user_data,
 			     struct os_reltime *remaining)
 {
-	struct eloop_timeout *timeout, *prev;
-	int removed = 0;
+	struct eloop_timeout *timeout;
 	struct os_reltime now;
 
 	os_get_reltime(&now);
 	remaining->sec = remaining->usec = 0;
 
-	dl_list_for_each_safe(timeout, prev, &eloop.timeout,
-			      struct eloop_timeout, list) {
-		if (timeout->handler == handler &&
-		    (timeout->eloop_data == eloop_data) &&
-		    (timeout->user_data == user_data)) {
-			removed = 1;
-			if (os_reltime_before(&now, &timeout->time))
-				os_reltime_sub(&timeout->time, &now, remaining);
-			eloop_remove_timeout(timeout);
-			break;
-		}
-	}
-	return removed;
+	timeout = eloop_find_timeout(handler, eloop_data, user_data);
+	if (!timeout)
+		return 0;
+	if (os_reltime_before(&now, &timeout->time))
+		os_reltime_sub(&timeout->time, &now, remaining);
+	eloop_remove_timeout(timeout);
+	return 1;
 }
 
 
-int eloop_is_timeout_registered(eloop_timeout_handler handler,
-				void *eloop_data, void *user_data)
+int eloop_cancel_timeout_id(eloop_timeout_id id)
 {
-	struct eloop_timeout *tmp;
+	struct eloop_timeout *timeout;
 
-	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
-		if (tmp->handler == handler &&
-		    tmp->eloop_data == eloop_data &&
-		    tmp->user_data == user_data)
-			return 1;
-	}
+	if (!id)
+		return 0;
+	timeout = eloop_timeout_by_id(id);
+	if (!timeout)
+		return 0;
+	eloop_remove_timeout(timeout);
+	return 1;
+}
 
-	return 0;
+
+int eloop_is_timeout_registered(eloop_timeout_handler handler,
+				void *eloop_data, void *user_data)
+{
+	return eloop_find_timeout(handler, eloop_data, user_data) != NULL;
 }
 
 
@@ -906,28 +1285,21 @@ int eloop_deplete_timeout(unsigned int req_secs, unsigned int req_usecs,
 	struct os_reltime now, requested, remaining;
 	struct eloop_timeout *tmp;
 
-	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
-		if (tmp->handler == handler &&
-		    tmp->eloop_data == eloop_data &&
-		    tmp->user_data == user_data) {
-			requested.sec = req_secs;
-			requested.usec = req_usecs;
-			os_get_reltime(&now);
-			os_reltime_sub(&tmp->time, &now, &remaining);
-			if (os_reltime_before(&requested, &remaining)) {
-				eloop_cancel_timeout(handler, eloop_data,
-						     user_data);
-				eloop_register_timeout(requested.sec,
-						       requested.usec,
-						       handler, eloop_data,
-						       user_data);
-				return 1;
-			}
-			return 0;
-		}
-	}
+	tmp = eloop_find_timeout(handler, eloop_data, user_data);
+	if (!tmp)
+		return -1;
 
-	return -1;
+	requested.sec = req_secs;
+	requested.usec = req_usecs;
+	os_get_reltime(&now);
+	os_reltime_sub(&tmp->time, &now, &remaining);
+	if (os_reltime_before(&requested, &remaining)) {
+		eloop_cancel_timeout(handler, eloop_data, user_data);
+		eloop_register_timeout(requested.sec, requested.usec,
+				       handler, eloop_data, user_data);
+		return 1;
+	}
+	return 0;
 }
 
 
@@ -938,28 +1310,21 @@ int eloop_replenish_timeout(unsigned int req_secs, unsigned int req_usecs,
 	struct os_reltime now, requested, remaining;
 	struct eloop_timeout *tmp;
 
-	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
-		if (tmp->handler == handler &&
-		    tmp->eloop_data == eloop_data &&
-		    tmp->user_data == user_data) {
-			requested.sec = req_secs;
-			requested.usec = req_usecs;
-			os_get_reltime(&now);
-			os_reltime_sub(&tmp->time, &now, &remaining);
-			if (os_reltime_before(&remaining, &requested)) {
-				eloop_cancel_timeout(handler, eloop_data,
-						     user_data);
-				eloop_register_timeout(requested.sec,
-						       requested.usec,
-						       handler, eloop_data,
-						       user_data);
-				return 1;
-			}
-			return 0;
-		}
-	}
+	tmp = eloop_find_timeout(handler, eloop_data, user_data);
+	if (!tmp)
+		return -1;
 
-	return -1;
+	requested.sec = req_secs;
+	requested.usec = req_usecs;
+	os_get_reltime(&now);
+	os_reltime_sub(&tmp->time, &now, &remaining);
+	if (os_reltime_before(&remaining, &requested)) {
+		eloop_cancel_timeout(handler, eloop_data, user_data);
+		eloop_register_timeout(requested.sec, requested.usec,
+				       handler, eloop_data, user_data);
+		return 1;
+	}
+	return 0;
 }
 
 
@@ -1096,7 +1461,7 @@ void eloop_run(void)
 #endif /* CONFIG_ELOOP_SELECT */
 
 	while (!eloop.terminate &&
-	       (!dl_list_empty(&eloop.timeout) || eloop.readers.count > 0 ||
+	       (eloop_first_timeout() || eloop.readers.count > 0 ||
 		eloop.writers.count > 0 || eloop.exceptions.count > 0)) {
 		struct eloop_timeout *timeout;
 
@@ -1113,8 +1478,7 @@ void eloop_run(void)
 				break;
 		}
 
-		timeout = dl_list_first(&eloop.timeout, struct eloop_timeout,
-					list);
+		timeout = eloop_first_timeout();
 		if (timeout) {
 			os_get_reltime(&now);
 			if (os_reltime_before(&now, &timeout->time))
@@ -1193,8 +1557,7 @@ void eloop_run(void)
 
 
 		/* check if some registered timeouts have occurred */
-		timeout = dl_list_first(&eloop.timeout, struct eloop_timeout,
-					list);
+		timeout = eloop_first_timeout();
 		if (timeout) {
 			os_get_reltime(&now);
 			if (!os_reltime_before(&now, &timeout->time)) {
@@ -1261,12 +1624,11 @@ void eloop_terminate(void)
 
 void eloop_destroy(void)
 {
-	struct eloop_timeout *timeout, *prev;
+	struct eloop_timeout *timeout;
 	struct os_reltime now;
 
 	os_get_reltime(&now);
-	dl_list_for_each_safe(timeout, prev, &eloop.timeout,
-			      struct eloop_timeout, list) {
+	while ((timeout = eloop_first_timeout()) != NULL) {
 		int sec, usec;
 		sec = timeout->time.sec - now.sec;
 		usec = timeout->time.usec - now.usec;
@@ -1287,6 +1649,11 @@ void eloop_destroy(void)
 	eloop_sock_table_destroy(&eloop.writers);
 	eloop_sock_table_destroy(&eloop.exceptions);
 	os_free(eloop.signals);
+#ifdef CONFIG_ELOOP_TIMER_HEAP
+	os_free(eloop.timeout_heap);
+	os_free(eloop.timeout_buckets);
+	os_free(eloop.timeout_slots);
+#endif /* CONFIG_ELOOP_TIMER_HEAP */
 
 #ifdef CONFIG_ELOOP_POLL
 	os_free(eloop.pollfds);
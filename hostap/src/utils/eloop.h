@@ -56,6 +56,13 @@ typedef void (*eloop_event_handler)(void *eloop_ctx, void *user_ctx);
  */
 typedef void (*eloop_timeout_handler)(void *eloop_ctx, void *user_ctx);
 
+/**
+ * eloop_timeout_id - Handle of a timeout from eloop_register_timeout_id()
+ *
+ * 0 is never the handle of a registered timeout.
+ */
+typedef u64 eloop_timeout_id;
+
 /**
  * eloop_signal_handler - eloop signal event callback type
  * @sig: Signal number
@@ -180,6 +187,25 @@ int eloop_register_timeout(unsigned int secs, unsigned int usecs,
 			   eloop_timeout_handler handler,
 			   void *eloop_data, void *user_data);
 
+/**
+ * eloop_register_timeout_id - Register timeout and get a handle for it
+ * @secs: Number of seconds to the timeout
+ * @usecs: Number of microseconds to the timeout
+ * @handler: Callback function to be called when timeout occurs
+ * @eloop_data: Callback context data (eloop_ctx)
+ * @user_data: Callback context data (sock_ctx)
+ * @id: Buffer for the handle of the timeout, or %NULL
+ * Returns: 0 on success, -1 on failure
+ *
+ * The same as eloop_register_timeout(), but the timeout can also be cancelled
+ * with eloop_cancel_timeout_id(), which does not need to search for it. The
+ * handle is set to 0 if the timeout would never happen.
+ */
+int eloop_register_timeout_id(unsigned int secs, unsigned int usecs,
+			      eloop_timeout_handler handler,
+			      void *eloop_data, void *user_data,
+			      eloop_timeout_id *id);
+
 /**
  * eloop_cancel_timeout - Cancel timeouts
  * @handler: Matching callback function
@@ -209,6 +235,16 @@ int eloop_cancel_timeout_one(eloop_timeout_handler handler,
 			     void *eloop_data, void *user_data,
 			     struct os_reltime *remaining);
 
+/**
+ * eloop_cancel_timeout_id - Cancel a timeout by its handle
+ * @id: Handle from eloop_register_timeout_id()
+ * Returns: 1 if the timeout was cancelled, 0 if it had already run or been
+ * cancelled
+ *
+ * Handles are not reused, so a stale handle does not cancel another timeout.
+ */
+int eloop_cancel_timeout_id(eloop_timeout_id id);
+
 /**
  * eloop_is_timeout_registered - Check if a timeout is already registered
  * @handler: Matching callback function
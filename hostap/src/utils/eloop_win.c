@@ -35,6 +35,7 @@ struct eloop_timeout {
 	void *eloop_data;
 	void *user_data;
 	eloop_timeout_handler handler;
+	eloop_timeout_id id;
 };
 
 struct eloop_signal {
@@ -53,6 +54,7 @@ struct eloop_data {
 	struct eloop_event *events;
 
 	struct dl_list timeout;
+	eloop_timeout_id timeout_last_id;
 
 	size_t signal_count;
 	struct eloop_signal *signals;
@@ -237,10 +239,22 @@ void eloop_unregister_event(void *event, size_t event_size)
 int eloop_register_timeout(unsigned int secs, unsigned int usecs,
 			   eloop_timeout_handler handler,
 			   void *eloop_data, void *user_data)
+{
+	return eloop_register_timeout_id(secs, usecs, handler, eloop_data,
+					 user_data, NULL);
+}
+
+
+int eloop_register_timeout_id(unsigned int secs, unsigned int usecs,
+			      eloop_timeout_handler handler,
+			      void *eloop_data, void *user_data,
+			      eloop_timeout_id *id)
 {
 	struct eloop_timeout *timeout, *tmp;
 	os_time_t now_sec;
 
+	if (id)
+		*id = 0;
 	timeout = os_zalloc(sizeof(*timeout));
 	if (timeout == NULL)
 		return -1;
@@ -268,6 +282,9 @@ int eloop_register_timeout(unsigned int secs, unsigned int usecs,
 	timeout->eloop_data = eloop_data;
 	timeout->user_data = user_data;
 	timeout->handler = handler;
+	timeout->id = ++eloop.timeout_last_id;
+	if (id)
+		*id = timeout->id;
 
 	/* Maintain timeouts in order of increasing time */
 	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
@@ -311,6 +328,21 @@ int eloop_cancel_timeout(eloop_timeout_handler handler,
 }
 
 
+int eloop_cancel_timeout_id(eloop_timeout_id id)
+{
+	struct eloop_timeout *timeout;
+
+	dl_list_for_each(timeout, &eloop.timeout, struct eloop_timeout, list) {
+		if (timeout->id == id) {
+			eloop_remove_timeout(timeout);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
 int eloop_cancel_timeout_one(eloop_timeout_handler handler,
 			     void *eloop_data, void *user_data,
 			     struct os_reltime *remaining)
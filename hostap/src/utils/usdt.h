@@ -0,0 +1,37 @@
+/*
+ * Static user space tracepoints (USDT)
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * With CONFIG_USDT=y, the probes are compiled in as sys/sdt.h probes, which
+ * cost a single nop until a tracer such as perf or bpftrace attaches to
+ * them. Without it, they compile to nothing and their arguments are not
+ * evaluated. The probes of the DecoyAuth handshake use the provider
+ * decoyauth, see hostapd/README-DECOYAUTH-PROBES.
+ */
+
+#ifndef USDT_H
+#define USDT_H
+
+#ifdef CONFIG_USDT
+
+#include <sys/sdt.h>
+
+#define USDT_PROBE0(provider, name) DTRACE_PROBE(provider, name)
+#define USDT_PROBE1(provider, name, a1) DTRACE_PROBE1(provider, name, a1)
+#define USDT_PROBE2(provider, name, a1, a2) \
+	DTRACE_PROBE2(provider, name, a1, a2)
+#define USDT_PROBE3(provider, name, a1, a2, a3) \
+	DTRACE_PROBE3(provider, name, a1, a2, a3)
+
+#else /* CONFIG_USDT */
+
+#define USDT_PROBE0(provider, name) do { } while (0)
+#define USDT_PROBE1(provider, name, a1) do { } while (0)
+#define USDT_PROBE2(provider, name, a1, a2) do { } while (0)
+#define USDT_PROBE3(provider, name, a1, a2, a3) do { } while (0)
+
+#endif /* CONFIG_USDT */
+
+#endif /* USDT_H */
@@ -0,0 +1,13 @@
+/*
+ * eloop timeouts - test program for the timer heap backend
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * Builds eloop.c with CONFIG_ELOOP_TIMER_HEAP into the program, so that the
+ * same checks run against both backends.
+ */
+
+#define CONFIG_ELOOP_TIMER_HEAP
+#include "utils/eloop.c"
+#include "test-eloop.c"
@@ -0,0 +1,271 @@
+/*
+ * eloop timeouts - test program
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * Checks the timeout semantics that callers rely on and measures register,
+ * lookup and cancel with many pending timeouts:
+ *
+ * ./test-eloop [number of timeouts]
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "eloop.h"
+
+
+static int errors;
+static char order[16];
+static size_t order_len;
+
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("FAIL line %d: %s\n", __LINE__, #cond); \
+			errors++; \
+		} \
+	} while (0)
+
+
+static void record_timeout(void *eloop_ctx, void *user_ctx)
+{
+	if (order_len < sizeof(order) - 1)
+		order[order_len++] = *(char *) user_ctx;
+}
+
+
+static void terminate_timeout(void *eloop_ctx, void *user_ctx)
+{
+	eloop_terminate();
+}
+
+
+static void unused_timeout(void *eloop_ctx, void *user_ctx)
+{
+}
+
+
+static void run_timeouts(void)
+{
+	order_len = 0;
+	os_memset(order, 0, sizeof(order));
+	eloop_register_timeout(0, 100000, terminate_timeout, NULL, NULL);
+	eloop_run();
+}
+
+
+static void test_order(void)
+{
+	static char a = 'a', b = 'b', c = 'c', d = 'd';
+
+	/* Expiry time first, registration order for the same time */
+	eloop_register_timeout(0, 30000, record_timeout, NULL, &d);
+	eloop_register_timeout(0, 10000, record_timeout, NULL, &a);
+	eloop_register_timeout(0, 20000, record_timeout, NULL, &b);
+	eloop_register_timeout(0, 20000, record_timeout, NULL, &c);
+	run_timeouts();
+	CHECK(os_strcmp(order, "abcd") == 0);
+}
+
+
+static void test_cancel(void)
+{
+	static char a = 'a', b = 'b', c = 'c';
+	char ctx;
+
+	eloop_register_timeout(0, 10000, record_timeout, &ctx, &a);
+	eloop_register_timeout(0, 20000, record_timeout, &ctx, &b);
+	eloop_register_timeout(0, 30000, record_timeout, NULL, &c);
+	CHECK(eloop_is_timeout_registered(record_timeout, &ctx, &b));
+	CHECK(!eloop_is_timeout_registered(record_timeout, NULL, &b));
+	CHECK(!eloop_is_timeout_registered(unused_timeout, &ctx, &b));
+	CHECK(eloop_cancel_timeout(record_timeout, &ctx, ELOOP_ALL_CTX) == 2);
+	CHECK(!eloop_is_timeout_registered(record_timeout, &ctx, &a));
+	CHECK(eloop_cancel_timeout(record_timeout, &ctx, &a) == 0);
+	run_timeouts();
+	CHECK(os_strcmp(order, "c") == 0);
+
+	eloop_register_timeout(0, 10000, record_timeout, NULL, &a);
+	eloop_register_timeout(0, 20000, record_timeout, NULL, &b);
+	eloop_register_timeout(0, 30000, record_timeout, &ctx, &c);
+	CHECK(eloop_cancel_timeout(record_timeout, ELOOP_ALL_CTX,
+				   ELOOP_ALL_CTX) == 3);
+	run_timeouts();
+	CHECK(order_len == 0);
+}
+
+
+static void test_cancel_one(void)
+{
+	static char a = 'a';
+	struct os_reltime remaining;
+
+	eloop_register_timeout(5, 0, record_timeout, NULL, &a);
+	eloop_register_timeout(2, 0, record_timeout, NULL, &a);
+	/* The timeout that expires first is the one cancelled */
+	CHECK(eloop_cancel_timeout_one(record_timeout, NULL, &a,
+				       &remaining) == 1);
+	CHECK(remaining.sec <= 2 && remaining.sec >= 1);
+	CHECK(eloop_cancel_timeout_one(record_timeout, NULL, &a,
+				       &remaining) == 1);
+	CHECK(remaining.sec <= 5 && remaining.sec >= 4);
+	CHECK(eloop_cancel_timeout_one(record_timeout, NULL, &a,
+				       &remaining) == 0);
+	CHECK(remaining.sec == 0 && remaining.usec == 0);
+}
+
+
+static void test_deplete_replenish(void)
+{
+	static char a = 'a', b = 'b';
+
+	eloop_register_timeout(10, 0, record_timeout, NULL, &a);
+	CHECK(eloop_deplete_timeout(20, 0, record_timeout, NULL, &a) == 0);
+	CHECK(eloop_deplete_timeout(0, 10000, record_timeout, NULL, &a) == 1);
+	CHECK(eloop_deplete_timeout(0, 10000, record_timeout, NULL, &b) == -1);
+
+	eloop_register_timeout(0, 10000, record_timeout, NULL, &b);
+	CHECK(eloop_replenish_timeout(0, 5000, record_timeout, NULL, &b) == 0);
+	CHECK(eloop_replenish_timeout(10, 0, record_timeout, NULL, &b) == 1);
+	CHECK(eloop_replenish_timeout(1, 0, unused_timeout, NULL, &b) == -1);
+
+	run_timeouts();
+	CHECK(os_strcmp(order, "a") == 0);
+	CHECK(eloop_cancel_timeout(record_timeout, NULL, &b) == 1);
+}
+
+
+static void test_handles(void)
+{
+	static char a = 'a', b = 'b';
+	eloop_timeout_id id_a, id_b, id_c;
+
+	CHECK(eloop_register_timeout_id(0, 10000, record_timeout, NULL, &a,
+					&id_a) == 0);
+	CHECK(eloop_register_timeout_id(0, 20000, record_timeout, NULL, &b,
+					&id_b) == 0);
+	CHECK(id_a != 0 && id_b != 0 && id_a != id_b);
+	CHECK(eloop_cancel_timeout_id(id_a) == 1);
+	CHECK(eloop_cancel_timeout_id(id_a) == 0);
+	CHECK(eloop_cancel_timeout_id(0) == 0);
+
+	/* A stale handle does not cancel a timeout reusing its memory */
+	CHECK(eloop_register_timeout_id(0, 10000, record_timeout, NULL, &a,
+					&id_c) == 0);
+	CHECK(id_c != id_a);
+	CHECK(eloop_cancel_timeout_id(id_a) == 0);
+	CHECK(eloop_is_timeout_registered(record_timeout, NULL, &a));
+
+	run_timeouts();
+	CHECK(os_strcmp(order, "ab") == 0);
+	/* Handles of timeouts that have run are stale as well */
+	CHECK(eloop_cancel_timeout_id(id_b) == 0);
+}
+
+
+static unsigned int bench_usecs(struct os_reltime *start)
+{
+	struct os_reltime now, diff;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	return diff.sec * 1000000 + diff.usec;
+}
+
+
+static void bench(unsigned int count)
+{
+	eloop_timeout_id *ids;
+	struct os_reltime start;
+	unsigned int i, found = 0, seed = 1;
+	char *ctx;
+
+	ids = os_calloc(count, sizeof(*ids));
+	ctx = os_malloc(count);
+	if (!ids || !ctx) {
+		os_free(ids);
+		os_free(ctx);
+		errors++;
+		return;
+	}
+
+	printf("%u timeouts:\n", count);
+
+	os_get_reltime(&start);
+	for (i = 0; i < count; i++) {
+		seed = seed * 1103515245 + 12345;
+		eloop_register_timeout(100 + (seed >> 16) % 1000, 0,
+				       unused_timeout, NULL, &ctx[i]);
+	}
+	printf("  register          %8u usec\n", bench_usecs(&start));
+
+	os_get_reltime(&start);
+	for (i = 0; i < count; i++)
+		found += eloop_is_timeout_registered(unused_timeout, NULL,
+						     &ctx[i]);
+	printf("  is_registered     %8u usec\n", bench_usecs(&start));
+	CHECK(found == count);
+
+	os_get_reltime(&start);
+	for (i = 0; i < count; i++)
+		found -= eloop_cancel_timeout(unused_timeout, NULL, &ctx[i]);
+	printf("  cancel            %8u usec\n", bench_usecs(&start));
+	CHECK(found == 0);
+
+	/* A pending timeout per station, rescheduled on each frame */
+	for (i = 0; i < count; i++)
+		eloop_register_timeout_id(300, 0, unused_timeout, NULL,
+					  &ctx[i], &ids[i]);
+	os_get_reltime(&start);
+	for (i = 0; i < count; i++) {
+		found += eloop_cancel_timeout_id(ids[i]);
+		eloop_register_timeout_id(300, i, unused_timeout, NULL,
+					  &ctx[i], &ids[i]);
+	}
+	printf("  reschedule by id  %8u usec\n", bench_usecs(&start));
+	CHECK(found == count);
+
+	os_get_reltime(&start);
+	for (i = 0; i < count; i++) {
+		eloop_cancel_timeout(unused_timeout, NULL, &ctx[i]);
+		eloop_register_timeout(300, i, unused_timeout, NULL, &ctx[i]);
+	}
+	printf("  reschedule        %8u usec\n", bench_usecs(&start));
+
+	CHECK(eloop_cancel_timeout(unused_timeout, ELOOP_ALL_CTX,
+				   ELOOP_ALL_CTX) == (int) count);
+
+	os_free(ids);
+	os_free(ctx);
+}
+
+
+int main(int argc, char *argv[])
+{
+	unsigned int count = 10000;
+
+	if (argc > 1)
+		count = atoi(argv[1]);
+
+	if (eloop_init() < 0)
+		return -1;
+
+	test_order();
+	test_cancel();
+	test_cancel_one();
+	test_deplete_replenish();
+	test_handles();
+	if (count)
+		bench(count);
+
+	eloop_destroy();
+
+	if (errors) {
+		printf("%d test(s) failed\n", errors);
+		return -1;
+	}
+	return 0;
+}
@@ -20,7 +20,8 @@ struct wlantest_bss * bss_find(struct wlantest *wt, const u8 *bssid)
 {
 	struct wlantest_bss *bss;
 
-	dl_list_for_each(bss, &wt->bss, struct wlantest_bss, list) {
+	dl_list_for_each(bss, &wt->bss_hash[WLANTEST_BSS_HASH(bssid)],
+			 struct wlantest_bss, hash) {
 		if (ether_addr_equal(bss->bssid, bssid))
 			return bss;
 	}
@@ -48,6 +49,7 @@ struct wlantest_bss * bss_find_mld(struct wlantest *wt, const u8 *mld_mac_addr,
 struct wlantest_bss * bss_get(struct wlantest *wt, const u8 *bssid)
 {
 	struct wlantest_bss *bss;
+	int i;
 
 	if (bssid[0] & 0x01)
 		return NULL; /* Skip group addressed frames */
@@ -62,8 +64,13 @@ struct wlantest_bss * bss_get(struct wlantest *wt, const u8 *bssid)
 	dl_list_init(&bss->sta);
 	dl_list_init(&bss->pmk);
 	dl_list_init(&bss->tdls);
+	for (i = 0; i < WLANTEST_STA_HASH_SIZE; i++)
+		dl_list_init(&bss->sta_hash[i]);
+	for (i = 0; i < WLANTEST_TDLS_HASH_SIZE; i++)
+		dl_list_init(&bss->tdls_hash[i]);
 	os_memcpy(bss->bssid, bssid, ETH_ALEN);
 	dl_list_add(&wt->bss, &bss->list);
+	dl_list_add(&wt->bss_hash[WLANTEST_BSS_HASH(bssid)], &bss->hash);
 	wpa_printf(MSG_DEBUG, "Discovered new BSS - " MACSTR,
 		   MAC2STR(bss->bssid));
 	return bss;
@@ -77,9 +84,63 @@ void pmk_deinit(struct wlantest_pmk *pmk)
 }
 
 
+/* The same bucket for both directions of a link */
+static unsigned int tdls_hash(struct wlantest_sta *sta1,
+			      struct wlantest_sta *sta2)
+{
+	uintptr_t val = (uintptr_t) sta1 ^ (uintptr_t) sta2;
+
+	return (val ^ (val >> 8)) / sizeof(void *) % WLANTEST_TDLS_HASH_SIZE;
+}
+
+
+void tdls_add(struct wlantest_bss *bss, struct wlantest_tdls *tdls)
+{
+	dl_list_add(&bss->tdls, &tdls->list);
+	dl_list_add(&bss->tdls_hash[tdls_hash(tdls->init, tdls->resp)],
+		    &tdls->hash);
+}
+
+
+/**
+ * tdls_find - Find the TDLS link context of two STAs
+ * @bss: BSS of the STAs
+ * @sta1: Initiator
+ * @sta2: Responder
+ * @any_direction: Whether the roles of the STAs may also be swapped
+ * Returns: The newest matching link context, or %NULL if none
+ *
+ * With @any_direction, a link that is up is preferred over the newest one
+ * and the oldest entry is returned if none of the matches is up.
+ */
+struct wlantest_tdls * tdls_find(struct wlantest_bss *bss,
+				 struct wlantest_sta *sta1,
+				 struct wlantest_sta *sta2, bool any_direction)
+{
+	struct wlantest_tdls *tdls, *found = NULL;
+
+	dl_list_for_each(tdls, &bss->tdls_hash[tdls_hash(sta1, sta2)],
+			 struct wlantest_tdls, hash) {
+		if (tdls->init == sta1 && tdls->resp == sta2) {
+			if (!any_direction)
+				return tdls;
+		} else if (!any_direction ||
+			   tdls->init != sta2 || tdls->resp != sta1) {
+			continue;
+		}
+		found = tdls;
+		if (tdls->link_up)
+			break;
+	}
+
+	return found;
+}
+
+
 void tdls_deinit(struct wlantest_tdls *tdls)
 {
 	dl_list_del(&tdls->list);
+	dl_list_del(&tdls->hash);
 	os_free(tdls);
 }
 
@@ -96,6 +157,7 @@ void bss_deinit(struct wlantest_bss *bss)
 	dl_list_for_each_safe(tdls, nt, &bss->tdls, struct wlantest_tdls, list)
 		tdls_deinit(tdls);
 	dl_list_del(&bss->list);
+	dl_list_del(&bss->hash);
 	os_free(bss);
 }
 
@@ -337,6 +337,51 @@ u8 * ccmp_256_decrypt(const u8 *tk, const struct ieee80211_hdr *hdr,
 }
 
 
+/**
+ * ccmp_decrypt_ctx - Decrypt a CCMP or CCMP-256 frame with an AES context
+ * @aes: Context from aes_encrypt_init() with the TK
+ * @mic_len: MIC length; 8 for CCMP and 16 for CCMP-256
+ * Returns: Decrypted frame body or %NULL on failure
+ *
+ * Unlike ccmp_decrypt() and ccmp_256_decrypt(), this does not report MIC
+ * failures.
+ */
+u8 * ccmp_decrypt_ctx(void *aes, size_t mic_len,
+		      const struct ieee80211_hdr *hdr,
+		      const u8 *a1, const u8 *a2, const u8 *a3,
+		      const u8 *data, size_t data_len, size_t *decrypted_len)
+{
+	u8 aad[30], nonce[13];
+	size_t aad_len;
+	size_t mlen;
+	u8 *plain;
+
+	if (data_len < 8 + mic_len)
+		return NULL;
+
+	plain = os_malloc(data_len + AES_BLOCK_SIZE);
+	if (plain == NULL)
+		return NULL;
+
+	mlen = data_len - 8 - mic_len;
+
+	os_memset(aad, 0, sizeof(aad));
+	ccmp_aad_nonce(hdr, data, a1, a2, a3, aad, &aad_len, nonce);
+	wpa_hexdump(MSG_EXCESSIVE, "CCMP AAD", aad, aad_len);
+	wpa_hexdump(MSG_EXCESSIVE, "CCM Nonce", nonce, 13);
+
+	if (aes_ccm_ad_ctx(aes, nonce, mic_len, data + 8, mlen, aad, aad_len,
+			   data + 8 + mlen, plain) < 0) {
+		os_free(plain);
+		return NULL;
+	}
+	wpa_hexdump(MSG_EXCESSIVE, "CCMP decrypted", plain, mlen);
+
+	*decrypted_len = mlen;
+	return plain;
+}
+
+
 u8 * ccmp_256_encrypt(const u8 *tk, u8 *frame, size_t len, size_t hdrlen,
 		      const u8 *qos, const u8 *a1, const u8 *a2, const u8 *a3,
 		      const u8 *pn, int keyid, size_t *encrypted_len)
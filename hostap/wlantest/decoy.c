@@ -0,0 +1,586 @@
+/*
+ * wlantest - DecoyAuth SAE commit analyzer
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * A DecoyAuth AP sends its commit element as two polynomials (u and v
+ * coefficients) that evaluate to the encoding of the element for each of its
+ * passwords at H(password). Given the list of configured passwords, the
+ * analyzer evaluates and decodes the element for every candidate and checks
+ * the STA commit of the same handshake against them. The evaluate/decode step
+ * dominates the cost, so handshakes are handed to a pool of worker threads and
+ * the results are reported in capture order.
+ */
+
+#include "utils/includes.h"
+#include <pthread.h>
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "utils/list.h"
+#include "crypto/crypto.h"
+#include "crypto/sha256.h"
+#include "common/ieee802_11_defs.h"
+#include "wlantest.h"
+
+#define DECOY_MAX_PRIME_LEN 66
+#define DECOY_MAX_PASSWORDS 4096
+#define DECOY_REPORT_INTERVAL_MS 100
+
+struct decoy_job {
+	struct dl_list list;
+	unsigned int seq;
+	unsigned int frame_num;
+	u8 bssid[ETH_ALEN];
+	u8 sta[ETH_ALEN];
+	u16 group;
+	u8 *ap_commit;
+	size_t ap_commit_len;
+	u8 *sta_commit; /* NULL if the STA commit was not captured */
+	size_t sta_commit_len;
+	bool sta_h2e;
+
+	/* Results from the worker */
+	const char *error;
+	int num_passwords;
+	int decoded; /* candidates that decoded to a point */
+	int reflected; /* candidate index equal to the STA commit, or -1 */
+};
+
+struct wlantest_decoy {
+	u8 (*hash)[SHA256_MAC_LEN]; /* H(password) per candidate */
+	int num_candidates;
+
+	pthread_t *threads;
+	int num_threads;
+	pthread_mutex_t lock;
+	pthread_cond_t cond; /* queue not empty or stopping */
+	struct dl_list queue; /* struct decoy_job, not yet started */
+	struct dl_list done; /* struct decoy_job, sorted by seq */
+	unsigned int next_seq; /* assigned to the next job */
+	unsigned int report_seq; /* next job to report */
+	unsigned int pending; /* queued or running jobs */
+	int stop;
+	int report_scheduled;
+
+	unsigned int handshakes;
+	unsigned int reflections;
+	unsigned int failures;
+};
+
+
+static void decoy_job_free(struct decoy_job *job)
+{
+	os_free(job->ap_commit);
+	os_free(job->sta_commit);
+	os_free(job);
+}
+
+
+static struct crypto_bignum *
+decoy_evaluate(struct crypto_bignum **coeff, int num,
+	       const struct crypto_bignum *x, const struct crypto_bignum *prime)
+{
+	struct crypto_bignum *res;
+	int i;
+
+	/* Horner's rule, reduced after every step */
+	res = crypto_bignum_init();
+	if (!res || crypto_bignum_mod(coeff[num - 1], prime, res) < 0)
+		goto fail;
+	for (i = num - 2; i >= 0; i--) {
+		if (crypto_bignum_mulmod(res, x, prime, res) < 0 ||
+		    crypto_bignum_addmod(res, coeff[i], prime, res) < 0)
+			goto fail;
+	}
+	return res;
+fail:
+	crypto_bignum_deinit(res, 0);
+	return NULL;
+}
+
+
+static void decoy_analyze(struct wlantest_decoy *decoy, struct decoy_job *job)
+{
+	struct crypto_ec *ec;
+	const struct crypto_bignum *prime;
+	struct crypto_bignum **coeff = NULL, *scalar = NULL, *sta_scalar = NULL;
+	struct crypto_bignum *x = NULL, *u = NULL, *v = NULL;
+	struct crypto_ec_point *elem = NULL, *sta_elem = NULL;
+	const u8 *pos, *end;
+	size_t prime_len, order_len, scalar_elem_len;
+	u8 uv[2 * DECOY_MAX_PRIME_LEN];
+	int i, n;
+
+	job->reflected = -1;
+	ec = crypto_ec_init(job->group);
+	if (!ec) {
+		job->error = "unsupported group";
+		return;
+	}
+	prime = crypto_ec_get_prime(ec);
+	prime_len = crypto_ec_prime_len(ec);
+	order_len = crypto_ec_order_len(ec);
+
+	/* group | scalar | number of passwords | u[n] | v[n] */
+	pos = job->ap_commit + 2;
+	end = job->ap_commit + job->ap_commit_len;
+	if ((size_t) (end - pos) < order_len + 4) {
+		job->error = "truncated AP commit";
+		goto out;
+	}
+	scalar = crypto_bignum_init_set(pos, order_len);
+	pos += order_len;
+	/* Written in host byte order by the AP; all deployments are LE */
+	n = WPA_GET_LE32(pos);
+	pos += 4;
+	if (n < 1 || n > DECOY_MAX_PASSWORDS ||
+	    (size_t) (end - pos) < 2 * n * prime_len) {
+		job->error = "invalid coefficient block";
+		goto out;
+	}
+	job->num_passwords = n;
+
+	coeff = os_calloc(2 * n, sizeof(struct crypto_bignum *));
+	if (!scalar || !coeff)
+		goto fail;
+	for (i = 0; i < 2 * n; i++) {
+		coeff[i] = crypto_bignum_init_set(pos, prime_len);
+		if (!coeff[i])
+			goto fail;
+		pos += prime_len;
+	}
+
+	/* group | [Anti-Clogging Token] | scalar | element | elements */
+	scalar_elem_len = order_len + 2 * prime_len;
+	if (job->sta_commit && job->sta_commit_len >= 2 + scalar_elem_len &&
+	    WPA_GET_LE16(job->sta_commit) == job->group) {
+		pos = job->sta_commit + 2;
+		end = job->sta_commit + job->sta_commit_len;
+		/* As in sae_parse_commit_token(); H2E uses a container */
+		if (!job->sta_h2e &&
+		    (size_t) (end - pos) >= scalar_elem_len + SHA256_MAC_LEN)
+			pos = end - scalar_elem_len;
+		sta_scalar = crypto_bignum_init_set(pos, order_len);
+		sta_elem = crypto_ec_point_from_bin(ec, pos + order_len);
+	}
+
+	x = crypto_bignum_init();
+	elem = crypto_ec_point_init(ec);
+	if (!x || !elem)
+		goto fail;
+	for (i = 0; i < decoy->num_candidates; i++) {
+		struct crypto_bignum *h;
+
+		h = crypto_bignum_init_set(decoy->hash[i], SHA256_MAC_LEN);
+		if (!h || crypto_bignum_mod(h, prime, x) < 0) {
+			crypto_bignum_deinit(h, 1);
+			goto fail;
+		}
+		crypto_bignum_deinit(h, 1);
+
+		u = decoy_evaluate(coeff, n, x, prime);
+		v = decoy_evaluate(coeff + n, n, x, prime);
+		if (!u || !v ||
+		    crypto_bignum_to_bin(u, uv, sizeof(uv), prime_len) < 0 ||
+		    crypto_bignum_to_bin(v, uv + prime_len,
+					 sizeof(uv) - prime_len,
+					 prime_len) < 0)
+			goto fail;
+		crypto_bignum_deinit(u, 0);
+		crypto_bignum_deinit(v, 0);
+		u = v = NULL;
+
+		if (crypto_ec_point_from_values_bin(ec, uv, elem) < 0)
+			continue;
+		job->decoded++;
+
+		/* A STA that replays the element of one index */
+		if (sta_scalar && sta_elem && job->reflected < 0 &&
+		    crypto_bignum_cmp(scalar, sta_scalar) == 0 &&
+		    crypto_ec_point_cmp(ec, elem, sta_elem) == 0)
+			job->reflected = i;
+	}
+	goto out;
+
+fail:
+	job->error = "evaluation failed";
+out:
+	if (coeff) {
+		for (i = 0; i < 2 * job->num_passwords; i++)
+			crypto_bignum_deinit(coeff[i], 0);
+		os_free(coeff);
+	}
+	crypto_bignum_deinit(scalar, 0);
+	crypto_bignum_deinit(sta_scalar, 0);
+	crypto_bignum_deinit(x, 0);
+	crypto_bignum_deinit(u, 0);
+	crypto_bignum_deinit(v, 0);
+	crypto_ec_point_deinit(elem, 0);
+	crypto_ec_point_deinit(sta_elem, 0);
+	crypto_ec_deinit(ec);
+}
+
+
+static void * decoy_worker(void *ctx)
+{
+	struct wlantest_decoy *decoy = ctx;
+	struct decoy_job *job, *prev;
+
+	pthread_mutex_lock(&decoy->lock);
+	for (;;) {
+		while (!decoy->stop && dl_list_empty(&decoy->queue))
+			pthread_cond_wait(&decoy->cond, &decoy->lock);
+		if (decoy->stop)
+			break;
+		job = dl_list_first(&decoy->queue, struct decoy_job, list);
+		dl_list_del(&job->list);
+		pthread_mutex_unlock(&decoy->lock);
+
+		decoy_analyze(decoy, job);
+
+		pthread_mutex_lock(&decoy->lock);
+		/* Keep the done list sorted so that reports follow the capture */
+		dl_list_for_each_reverse(prev, &decoy->done, struct decoy_job,
+					 list) {
+			if (prev->seq < job->seq)
+				break;
+		}
+		dl_list_add(&prev->list, &job->list);
+		decoy->pending--;
+		pthread_cond_broadcast(&decoy->cond);
+	}
+	pthread_mutex_unlock(&decoy->lock);
+	return NULL;
+}
+
+
+static void decoy_print(struct wlantest_decoy *decoy, struct decoy_job *job)
+{
+	decoy->handshakes++;
+	if (job->error) {
+		decoy->failures++;
+		wpa_printf(MSG_INFO, "DecoyAuth: frame #%u BSSID " MACSTR
+			   " STA " MACSTR " group %u: %s",
+			   job->frame_num, MAC2STR(job->bssid),
+			   MAC2STR(job->sta), job->group, job->error);
+		return;
+	}
+	if (job->reflected >= 0) {
+		decoy->reflections++;
+		wpa_printf(MSG_INFO, "DecoyAuth: frame #%u BSSID " MACSTR
+			   " STA " MACSTR " group %u: STA commit reflects "
+			   "candidate index %d",
+			   job->frame_num, MAC2STR(job->bssid),
+			   MAC2STR(job->sta), job->group, job->reflected);
+		return;
+	}
+	wpa_printf(MSG_INFO, "DecoyAuth: frame #%u BSSID " MACSTR " STA " MACSTR
+		   " group %u: %d AP passwords, %d/%d candidates decoded%s",
+		   job->frame_num, MAC2STR(job->bssid), MAC2STR(job->sta),
+		   job->group, job->num_passwords, job->decoded,
+		   decoy->num_candidates,
+		   job->sta_commit ? "" : " (no STA commit captured)");
+}
+
+
+/* Report finished jobs in capture order without waiting for the rest */
+static void decoy_report(struct wlantest_decoy *decoy)
+{
+	struct decoy_job *job;
+
+	for (;;) {
+		pthread_mutex_lock(&decoy->lock);
+		job = dl_list_first(&decoy->done, struct decoy_job, list);
+		if (!job || job->seq != decoy->report_seq) {
+			pthread_mutex_unlock(&decoy->lock);
+			break;
+		}
+		dl_list_del(&job->list);
+		decoy->report_seq++;
+		pthread_mutex_unlock(&decoy->lock);
+
+		decoy_print(decoy, job);
+		decoy_job_free(job);
+	}
+}
+
+
+static void decoy_report_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	struct wlantest_decoy *decoy = eloop_ctx;
+	unsigned int pending;
+
+	decoy_report(decoy);
+	pthread_mutex_lock(&decoy->lock);
+	pending = decoy->pending;
+	pthread_mutex_unlock(&decoy->lock);
+	if (pending || decoy->report_seq != decoy->next_seq)
+		eloop_register_timeout(0, DECOY_REPORT_INTERVAL_MS * 1000,
+				       decoy_report_timeout, decoy, NULL);
+	else
+		decoy->report_scheduled = 0;
+}
+
+
+static int decoy_read_passwords(struct wlantest_decoy *decoy,
+				const char *fname)
+{
+	FILE *f;
+	char buf[256], *pos;
+	u8 (*hash)[SHA256_MAC_LEN];
+	const u8 *addr[1];
+	size_t len[1];
+
+	f = fopen(fname, "r");
+	if (!f) {
+		wpa_printf(MSG_ERROR, "Could not open '%s'", fname);
+		return -1;
+	}
+
+	while (fgets(buf, sizeof(buf), f)) {
+		pos = buf;
+		while (*pos && *pos != '\r' && *pos != '\n')
+			pos++;
+		*pos = '\0';
+		if (pos == buf)
+			continue;
+		if (decoy->num_candidates == DECOY_MAX_PASSWORDS)
+			break;
+
+		hash = os_realloc_array(decoy->hash, decoy->num_candidates + 1,
+					SHA256_MAC_LEN);
+		if (!hash)
+			break;
+		decoy->hash = hash;
+		addr[0] = (const u8 *) buf;
+		len[0] = pos - buf;
+		if (sha256_vector(1, addr, len,
+				  decoy->hash[decoy->num_candidates]) < 0)
+			break;
+		decoy->num_candidates++;
+	}
+	forced_memzero(buf, sizeof(buf));
+	fclose(f);
+
+	if (decoy->num_candidates == 0) {
+		wpa_printf(MSG_ERROR, "No DecoyAuth passwords in '%s'", fname);
+		return -1;
+	}
+	wpa_printf(MSG_DEBUG, "DecoyAuth: %d candidate passwords",
+		   decoy->num_candidates);
+	return 0;
+}
+
+
+/**
+ * decoy_init - Start the DecoyAuth analyzer
+ * @wt: wlantest data
+ * @fname: File with one candidate password per line, index order
+ * @threads: Number of worker threads, 0 for one per online CPU
+ * Returns: 0 on success, -1 on failure
+ */
+int decoy_init(struct wlantest *wt, const char *fname, int threads)
+{
+	struct wlantest_decoy *decoy;
+	long cpus;
+
+	decoy = os_zalloc(sizeof(*decoy));
+	if (!decoy)
+		return -1;
+	dl_list_init(&decoy->queue);
+	dl_list_init(&decoy->done);
+	pthread_mutex_init(&decoy->lock, NULL);
+	pthread_cond_init(&decoy->cond, NULL);
+	wt->decoy = decoy;
+
+	if (decoy_read_passwords(decoy, fname) < 0)
+		return -1;
+
+	if (threads <= 0) {
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = cpus > 0 ? cpus : 1;
+	}
+	decoy->threads = os_calloc(threads, sizeof(pthread_t));
+	if (!decoy->threads)
+		return -1;
+	while (decoy->num_threads < threads) {
+		if (pthread_create(&decoy->threads[decoy->num_threads], NULL,
+				   decoy_worker, decoy) != 0) {
+			wpa_printf(MSG_ERROR,
+				   "DecoyAuth: Could not start worker thread");
+			return -1;
+		}
+		decoy->num_threads++;
+	}
+	wpa_printf(MSG_DEBUG, "DecoyAuth: %d worker threads",
+		   decoy->num_threads);
+	return 0;
+}
+
+
+/**
+ * decoy_flush - Wait for all queued handshakes and report them
+ * @wt: wlantest data
+ */
+void decoy_flush(struct wlantest *wt)
+{
+	struct wlantest_decoy *decoy = wt->decoy;
+
+	if (!decoy)
+		return;
+	pthread_mutex_lock(&decoy->lock);
+	while (decoy->pending && decoy->num_threads)
+		pthread_cond_wait(&decoy->cond, &decoy->lock);
+	pthread_mutex_unlock(&decoy->lock);
+	decoy_report(decoy);
+}
+
+
+/**
+ * decoy_deinit - Report pending results and stop the DecoyAuth analyzer
+ * @wt: wlantest data
+ */
+void decoy_deinit(struct wlantest *wt)
+{
+	struct wlantest_decoy *decoy = wt->decoy;
+	struct decoy_job *job, *n;
+	int i;
+
+	if (!decoy)
+		return;
+	decoy_flush(wt);
+	eloop_cancel_timeout(decoy_report_timeout, decoy, NULL);
+
+	pthread_mutex_lock(&decoy->lock);
+	decoy->stop = 1;
+	pthread_cond_broadcast(&decoy->cond);
+	pthread_mutex_unlock(&decoy->lock);
+	for (i = 0; i < decoy->num_threads; i++)
+		pthread_join(decoy->threads[i], NULL);
+
+	if (decoy->handshakes)
+		wpa_printf(MSG_INFO, "DecoyAuth: %u handshakes analyzed, "
+			   "%u reflected, %u failed", decoy->handshakes,
+			   decoy->reflections, decoy->failures);
+
+	dl_list_for_each_safe(job, n, &decoy->queue, struct decoy_job, list)
+		decoy_job_free(job);
+	dl_list_for_each_safe(job, n, &decoy->done, struct decoy_job, list)
+		decoy_job_free(job);
+	pthread_cond_destroy(&decoy->cond);
+	pthread_mutex_destroy(&decoy->lock);
+	os_free(decoy->threads);
+	bin_clear_free(decoy->hash, decoy->num_candidates * SHA256_MAC_LEN);
+	os_free(decoy);
+	wt->decoy = NULL;
+}
+
+
+/*
+ * Whether an AP commit has the DecoyAuth layout: group | scalar | number of
+ * passwords | u[n] | v[n], optionally followed by elements. A standard SAE
+ * commit is too short for it or has an implausible number of passwords.
+ */
+static bool decoy_ap_commit_layout(const u8 *data, size_t len)
+{
+	struct crypto_ec *ec;
+	size_t prime_len, order_len, coeff_len;
+	u32 n;
+	bool ret = false;
+
+	ec = crypto_ec_init(WPA_GET_LE16(data));
+	if (!ec)
+		return false;
+	prime_len = crypto_ec_prime_len(ec);
+	order_len = crypto_ec_order_len(ec);
+	crypto_ec_deinit(ec);
+
+	if (len < 2 + order_len + 4)
+		return false;
+	n = WPA_GET_LE32(data + 2 + order_len);
+	if (n >= 1 && n <= DECOY_MAX_PASSWORDS) {
+		coeff_len = 2 + order_len + 4 + 2 * n * prime_len;
+		ret = len == coeff_len ||
+			(len > coeff_len && data[coeff_len] == WLAN_EID_EXTENSION);
+	}
+	return ret;
+}
+
+
+/**
+ * decoy_rx_sae_commit - Process an SAE Commit in DecoyAuth mode
+ * @wt: wlantest data
+ * @bss: BSS of the exchange
+ * @sta: STA of the exchange
+ * @from_ap: Whether the frame was sent by the AP
+ * @h2e: Whether the commit uses hash-to-element (status code 126 or 127)
+ * @data: Authentication frame body after the fixed fields (group first)
+ * @len: Length of @data
+ *
+ * The STA commit is kept until the AP commit of the same exchange arrives,
+ * which is then queued for the workers if it has the DecoyAuth layout.
+ */
+void decoy_rx_sae_commit(struct wlantest *wt, struct wlantest_bss *bss,
+			 struct wlantest_sta *sta, bool from_ap, bool h2e,
+			 const u8 *data, size_t len)
+{
+	struct wlantest_decoy *decoy = wt->decoy;
+	struct decoy_job *job;
+
+	if (!decoy || len < 2)
+		return;
+
+	if (!from_ap) {
+		os_free(sta->decoy_commit);
+		sta->decoy_commit = os_memdup(data, len);
+		sta->decoy_commit_len = sta->decoy_commit ? len : 0;
+		sta->decoy_commit_h2e = h2e;
+		return;
+	}
+
+	if (!decoy_ap_commit_layout(data, len)) {
+		wpa_printf(MSG_DEBUG, "DecoyAuth: frame #%u: AP commit from "
+			   MACSTR " is not a DecoyAuth commit",
+			   wt->frame_num, MAC2STR(bss->bssid));
+		os_free(sta->decoy_commit);
+		sta->decoy_commit = NULL;
+		sta->decoy_commit_len = 0;
+		return;
+	}
+
+	job = os_zalloc(sizeof(*job));
+	if (!job)
+		return;
+	job->frame_num = wt->frame_num;
+	os_memcpy(job->bssid, bss->bssid, ETH_ALEN);
+	os_memcpy(job->sta, sta->addr, ETH_ALEN);
+	job->group = WPA_GET_LE16(data);
+	job->ap_commit = os_memdup(data, len);
+	job->ap_commit_len = len;
+	if (!job->ap_commit) {
+		decoy_job_free(job);
+		return;
+	}
+	/* The STA commit is consumed by this exchange */
+	job->sta_commit = sta->decoy_commit;
+	job->sta_commit_len = sta->decoy_commit_len;
+	job->sta_h2e = sta->decoy_commit_h2e;
+	sta->decoy_commit = NULL;
+	sta->decoy_commit_len = 0;
+
+	pthread_mutex_lock(&decoy->lock);
+	job->seq = decoy->next_seq++;
+	dl_list_add_tail(&decoy->queue, &job->list);
+	decoy->pending++;
+	pthread_cond_signal(&decoy->cond);
+	pthread_mutex_unlock(&decoy->lock);
+
+	decoy_report(decoy);
+	if (!decoy->report_scheduled) {
+		decoy->report_scheduled = 1;
+		eloop_register_timeout(0, DECOY_REPORT_INTERVAL_MS * 1000,
+				       decoy_report_timeout, decoy, NULL);
+	}
+}
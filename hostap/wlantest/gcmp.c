@@ -119,6 +119,47 @@ u8 * gcmp_decrypt(const u8 *tk, size_t tk_len, const struct ieee80211_hdr *hdr,
 }
 
 
+/**
+ * gcmp_decrypt_ctx - Decrypt a GCMP or GCMP-256 frame with an AES context
+ * @aes: Context from aes_encrypt_init() with the TK
+ * Returns: Decrypted frame body or %NULL on failure
+ *
+ * Unlike gcmp_decrypt(), this does not report invalid frames.
+ */
+u8 * gcmp_decrypt_ctx(void *aes, const struct ieee80211_hdr *hdr,
+		      const u8 *a1, const u8 *a2, const u8 *a3,
+		      const u8 *data, size_t data_len, size_t *decrypted_len)
+{
+	u8 aad[30], nonce[12], *plain;
+	size_t aad_len, mlen;
+	const u8 *m;
+
+	if (data_len < 8 + 16)
+		return NULL;
+
+	plain = os_malloc(data_len + AES_BLOCK_SIZE);
+	if (plain == NULL)
+		return NULL;
+
+	m = data + 8;
+	mlen = data_len - 8 - 16;
+
+	os_memset(aad, 0, sizeof(aad));
+	gcmp_aad_nonce(hdr, data, a1, a2, a3, aad, &aad_len, nonce);
+	wpa_hexdump(MSG_EXCESSIVE, "GCMP AAD", aad, aad_len);
+	wpa_hexdump(MSG_EXCESSIVE, "GCMP nonce", nonce, sizeof(nonce));
+
+	if (aes_gcm_ad_ctx(aes, nonce, sizeof(nonce), m, mlen, aad, aad_len,
+			   m + mlen, plain) < 0) {
+		os_free(plain);
+		return NULL;
+	}
+
+	*decrypted_len = mlen;
+	return plain;
+}
+
+
 u8 * gcmp_encrypt(const u8 *tk, size_t tk_len, const u8 *frame, size_t len,
 		  size_t hdrlen, const u8 *qos, const u8 *a1, const u8 *a2,
 		  const u8 *a3, const u8 *pn, int keyid, size_t *encrypted_len)
@@ -0,0 +1,679 @@
+/*
+ * wlantest - Pipelined capture file processing
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * A reader thread reads the capture file into batches of frames. Before a
+ * batch is processed, the frames in it that are protected with a known
+ * CCMP/GCMP TK are handed to a pool of decryption workers. The worker is
+ * picked by BSSID and STA address, so the frames of a flow are decrypted in
+ * order on the same worker. The frames are then processed in capture order as
+ * before. A worker result is used only if the processing thread decrypts the
+ * frame with the same cipher, TK, and addresses as the worker did. Key changes
+ * made by frames that were in flight thus fall back to decryption in order.
+ * Replay detection and all the other state updates stay in the processing
+ * thread.
+ */
+
+#include "utils/includes.h"
+#include <pthread.h>
+#include <pcap.h>
+
+#include "utils/common.h"
+#include "utils/list.h"
+#include "utils/radiotap.h"
+#include "utils/radiotap_iter.h"
+#include "common/defs.h"
+#include "common/ieee802_11_defs.h"
+#include "wlantest.h"
+
+#define PIPELINE_BATCH_FRAMES 256
+#define PIPELINE_READ_AHEAD 4 /* batches dispatched ahead of processing */
+#define PIPELINE_BATCHES (2 * PIPELINE_READ_AHEAD + 2)
+
+enum pipeline_job_state {
+	PIPELINE_JOB_NONE,
+	PIPELINE_JOB_QUEUED,
+	PIPELINE_JOB_RUNNING,
+	PIPELINE_JOB_DONE,
+};
+
+struct pipeline_worker;
+
+struct pipeline_job {
+	struct dl_list list; /* in pipeline_worker::queue */
+	enum pipeline_job_state state;
+	struct pipeline_worker *worker;
+	const struct ieee80211_hdr *hdr;
+	const u8 *data;
+	size_t len;
+	int cipher;
+	u8 tk[32];
+	size_t tk_len;
+	u8 addr[3][ETH_ALEN]; /* A1..A3 override for MLO */
+	u8 addr_set; /* BIT(i) if addr[i] is used */
+
+	/* Result from the worker */
+	u8 *decrypted;
+	size_t decrypted_len;
+};
+
+struct pipeline_frame {
+	struct pcap_pkthdr hdr;
+	size_t offset; /* in pipeline_batch::buf */
+	struct pipeline_job job;
+};
+
+struct pipeline_batch {
+	struct dl_list list;
+	struct pipeline_frame frames[PIPELINE_BATCH_FRAMES];
+	unsigned int num_frames;
+	u8 *buf;
+	size_t buf_len;
+	size_t buf_size;
+	int res; /* last pcap_next_ex() result; 1 if more frames follow */
+	char error[PCAP_ERRBUF_SIZE];
+};
+
+struct pipeline_worker {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond; /* job queued, job done, or stopping */
+	struct dl_list queue; /* struct pipeline_job, not yet started */
+	struct dl_list pending; /* struct pipeline_job, not yet queued */
+	struct tk_cache *tk_cache;
+	int waiting; /* processing thread waits for a running job */
+	int stop;
+	int started;
+};
+
+struct wlantest_pipeline {
+	struct pipeline_worker *workers;
+	int num_workers;
+
+	pcap_t *pcap;
+	pthread_t reader;
+	pthread_mutex_t lock;
+	pthread_cond_t cond; /* batch read or freed */
+	struct dl_list free; /* struct pipeline_batch */
+	struct dl_list read; /* struct pipeline_batch, in capture order */
+
+	struct pipeline_job *cur; /* job of the frame being processed */
+
+	unsigned int dispatched;
+	unsigned int used;
+};
+
+
+static void * pipeline_worker_run(void *ctx)
+{
+	struct pipeline_worker *w = ctx;
+	struct pipeline_job *job;
+	const u8 *a[3];
+	u8 *decrypted;
+	size_t dlen = 0;
+	int i;
+
+	pthread_mutex_lock(&w->lock);
+	for (;;) {
+		while (dl_list_empty(&w->queue) && !w->stop)
+			pthread_cond_wait(&w->cond, &w->lock);
+		if (w->stop)
+			break;
+		job = dl_list_first(&w->queue, struct pipeline_job, list);
+		dl_list_del(&job->list);
+		job->state = PIPELINE_JOB_RUNNING;
+		pthread_mutex_unlock(&w->lock);
+
+		for (i = 0; i < 3; i++)
+			a[i] = (job->addr_set & BIT(i)) ? job->addr[i] : NULL;
+		decrypted = tk_cache_decrypt(w->tk_cache, job->cipher, job->tk,
+					     job->tk_len, job->hdr,
+					     a[0], a[1], a[2], job->data,
+					     job->len, &dlen);
+
+		pthread_mutex_lock(&w->lock);
+		job->decrypted = decrypted;
+		job->decrypted_len = dlen;
+		job->state = PIPELINE_JOB_DONE;
+		if (w->waiting) {
+			w->waiting = 0;
+			pthread_cond_broadcast(&w->cond);
+		}
+	}
+	pthread_mutex_unlock(&w->lock);
+
+	return NULL;
+}
+
+
+/* Frame body as passed to rx_frame() or NULL if none */
+static const u8 * pipeline_80211_frame(struct wlantest *wt, int dlt,
+				       const u8 *data, size_t len,
+				       size_t *frame_len)
+{
+	struct ieee80211_radiotap_iterator iter;
+	int fcs = wt->assume_fcs;
+
+	switch (dlt) {
+	case DLT_IEEE802_11_RADIO:
+		if (wt->ethernet ||
+		    ieee80211_radiotap_iterator_init(&iter, (void *) data, len,
+						     NULL))
+			return NULL;
+		fcs = 0;
+		while (ieee80211_radiotap_iterator_next(&iter) == 0) {
+			if (iter.this_arg_index == IEEE80211_RADIOTAP_FLAGS &&
+			    (*iter.this_arg & IEEE80211_RADIOTAP_F_FCS))
+				fcs = 1;
+		}
+		data += iter._max_length;
+		len -= iter._max_length;
+		break;
+	case DLT_PRISM_HEADER:
+		if (len < 8 || len < WPA_GET_LE32(data + 4))
+			return NULL;
+		len -= WPA_GET_LE32(data + 4);
+		data += WPA_GET_LE32(data + 4);
+		fcs = 1;
+		break;
+	case DLT_IEEE802_11:
+		break;
+	default:
+		return NULL;
+	}
+
+	if (fcs && len >= 4)
+		len -= 4;
+	*frame_len = len;
+	return data;
+}
+
+
+/*
+ * Prepare a decryption job for a frame that rx_data_bss_prot() would decrypt
+ * with the current PTK of the STA. Returns the worker index or -1.
+ */
+static int pipeline_prepare_job(struct wlantest *wt, struct pipeline_job *job,
+				const u8 *frame, size_t len)
+{
+	const struct ieee80211_hdr *hdr;
+	struct wlantest_bss *bss;
+	struct wlantest_sta *sta;
+	const u8 *bssid, *sta_addr;
+	u16 fc;
+	size_t hdrlen;
+	bool a1_is_sta;
+	struct wlantest_pipeline *p = wt->pipeline;
+
+	if (len < 24)
+		return -1;
+	hdr = (const struct ieee80211_hdr *) frame;
+	fc = le_to_host16(hdr->frame_control);
+	if ((fc & WLAN_FC_PVER) ||
+	    WLAN_FC_GET_TYPE(fc) != WLAN_FC_TYPE_DATA ||
+	    !(fc & WLAN_FC_ISWEP) || (hdr->addr1[0] & 0x01))
+		return -1;
+
+	switch (fc & (WLAN_FC_TODS | WLAN_FC_FROMDS)) {
+	case WLAN_FC_TODS:
+		bssid = hdr->addr1;
+		sta_addr = hdr->addr2;
+		a1_is_sta = false;
+		break;
+	case WLAN_FC_FROMDS:
+		bssid = hdr->addr2;
+		sta_addr = hdr->addr1;
+		a1_is_sta = true;
+		break;
+	default:
+		return -1;
+	}
+
+	hdrlen = 24;
+	if (WLAN_FC_GET_STYPE(fc) & 0x08) {
+		hdrlen += 2;
+		if (fc & WLAN_FC_HTC)
+			hdrlen += 4;
+	}
+	if (len < hdrlen + 8)
+		return -1;
+
+	bss = bss_find(wt, bssid);
+	if (!bss)
+		return -1;
+	sta = sta_find(bss, sta_addr);
+	if (!sta || !sta->ptk_set ||
+	    !(sta->pairwise_cipher & (WPA_CIPHER_CCMP | WPA_CIPHER_CCMP_256 |
+				      WPA_CIPHER_GCMP | WPA_CIPHER_GCMP_256)) ||
+	    sta->ptk.tk_len > sizeof(job->tk))
+		return -1;
+
+	job->hdr = hdr;
+	job->data = frame + hdrlen;
+	job->len = len - hdrlen;
+	job->cipher = sta->pairwise_cipher;
+	os_memcpy(job->tk, sta->ptk.tk, sta->ptk.tk_len);
+	job->tk_len = sta->ptk.tk_len;
+	job->addr_set = 0;
+	if (!is_zero_ether_addr(sta->mld_mac_addr) &&
+	    !is_zero_ether_addr(bss->mld_mac_addr)) {
+		os_memcpy(job->addr[0], a1_is_sta ? sta->mld_mac_addr :
+			  bss->mld_mac_addr, ETH_ALEN);
+		os_memcpy(job->addr[1], a1_is_sta ? bss->mld_mac_addr :
+			  sta->mld_mac_addr, ETH_ALEN);
+		job->addr_set = BIT(0) | BIT(1);
+		if (ether_addr_equal(hdr->addr3, bss->bssid)) {
+			os_memcpy(job->addr[2], bss->mld_mac_addr, ETH_ALEN);
+			job->addr_set |= BIT(2);
+		}
+	}
+
+	return (WPA_GET_BE16(&sta_addr[4]) ^ bssid[5]) % p->num_workers;
+}
+
+
+static void pipeline_dispatch(struct wlantest *wt,
+			      struct pipeline_batch *batch, int dlt)
+{
+	struct wlantest_pipeline *p = wt->pipeline;
+	struct pipeline_frame *frame;
+	struct pipeline_worker *w;
+	struct pipeline_job *job;
+	const u8 *data;
+	size_t len;
+	unsigned int i;
+	int idx;
+
+	/* Keep the excessive debug output of decryption in frame order */
+	if (wpa_debug_level <= MSG_EXCESSIVE)
+		return;
+
+	for (i = 0; i < batch->num_frames; i++) {
+		frame = &batch->frames[i];
+		if (frame->hdr.caplen < frame->hdr.len)
+			continue;
+		data = pipeline_80211_frame(wt, dlt, batch->buf + frame->offset,
+					    frame->hdr.caplen, &len);
+		if (!data)
+			continue;
+		idx = pipeline_prepare_job(wt, &frame->job, data, len);
+		if (idx < 0)
+			continue;
+		w = &p->workers[idx];
+		frame->job.worker = w;
+		frame->job.state = PIPELINE_JOB_QUEUED;
+		dl_list_add_tail(&w->pending, &frame->job.list);
+		p->dispatched++;
+	}
+
+	for (idx = 0; idx < p->num_workers; idx++) {
+		w = &p->workers[idx];
+		if (dl_list_empty(&w->pending))
+			continue;
+		pthread_mutex_lock(&w->lock);
+		while ((job = dl_list_first(&w->pending, struct pipeline_job,
+					    list))) {
+			dl_list_del(&job->list);
+			dl_list_add_tail(&w->queue, &job->list);
+		}
+		pthread_cond_broadcast(&w->cond);
+		pthread_mutex_unlock(&w->lock);
+	}
+}
+
+
+/* Detach the job from its worker, waiting for it to complete if running */
+/* Returns 1 if the worker processed the job, 0 if it was dropped */
+static int pipeline_job_finish(struct pipeline_job *job)
+{
+	struct pipeline_worker *w = job->worker;
+	int done;
+
+	pthread_mutex_lock(&w->lock);
+	if (job->state == PIPELINE_JOB_QUEUED)
+		dl_list_del(&job->list);
+	while (job->state == PIPELINE_JOB_RUNNING) {
+		w->waiting = 1;
+		pthread_cond_wait(&w->cond, &w->lock);
+	}
+	done = job->state == PIPELINE_JOB_DONE;
+	job->state = PIPELINE_JOB_NONE;
+	pthread_mutex_unlock(&w->lock);
+
+	return done;
+}
+
+
+/**
+ * pipeline_decrypted - Get a frame decrypted by a worker
+ * @wt: wlantest data
+ * @cipher: Pairwise cipher (WPA_CIPHER_*)
+ * @tk: Temporal key
+ * @tk_len: Length of the TK
+ * @failed: Set to 1 if the worker tried the key and the decryption failed
+ * Returns: Decrypted frame body or %NULL if not available
+ *
+ * A result is returned only for the frame that is currently being processed
+ * and only if the worker used the same key and addresses. The caller is
+ * responsible for freeing the returned buffer. When *failed is set, the frame
+ * does not need to be decrypted again with this key.
+ */
+u8 * pipeline_decrypted(struct wlantest *wt, int cipher,
+			const u8 *tk, size_t tk_len,
+			const struct ieee80211_hdr *hdr,
+			const u8 *a1, const u8 *a2, const u8 *a3,
+			const u8 *data, size_t data_len, size_t *decrypted_len,
+			int *failed)
+{
+	struct wlantest_pipeline *p = wt->pipeline;
+	struct pipeline_job *job = p ? p->cur : NULL;
+	const u8 *a[3] = { a1, a2, a3 };
+	u8 *decrypted;
+	int i, done;
+
+	*failed = 0;
+	if (!job || job->hdr != hdr || job->data != data ||
+	    job->len != data_len || job->cipher != cipher ||
+	    job->tk_len != tk_len || os_memcmp(job->tk, tk, tk_len) != 0)
+		return NULL;
+	for (i = 0; i < 3; i++) {
+		if (!!(job->addr_set & BIT(i)) != !!a[i] ||
+		    (a[i] && !ether_addr_equal(job->addr[i], a[i])))
+			return NULL;
+	}
+
+	/*
+	 * A job that has not been started is dropped and the caller decrypts
+	 * the frame instead of waiting for the worker.
+	 */
+	p->cur = NULL;
+	done = pipeline_job_finish(job);
+	decrypted = job->decrypted;
+	job->decrypted = NULL;
+	if (decrypted) {
+		*decrypted_len = job->decrypted_len;
+		p->used++;
+	} else if (done) {
+		*failed = 1;
+	}
+	return decrypted;
+}
+
+
+static int pipeline_batch_add(struct pipeline_batch *batch,
+			      const struct pcap_pkthdr *hdr, const u8 *data)
+{
+	struct pipeline_frame *frame;
+	size_t size;
+	u8 *buf;
+
+	if (batch->buf_size - batch->buf_len < hdr->caplen) {
+		size = 2 * batch->buf_size + hdr->caplen;
+		buf = os_realloc(batch->buf, size);
+		if (!buf)
+			return -1;
+		batch->buf = buf;
+		batch->buf_size = size;
+	}
+
+	frame = &batch->frames[batch->num_frames++];
+	frame->hdr = *hdr;
+	frame->offset = batch->buf_len;
+	os_memcpy(batch->buf + batch->buf_len, data, hdr->caplen);
+	batch->buf_len += hdr->caplen;
+	return 0;
+}
+
+
+static void * pipeline_reader(void *ctx)
+{
+	struct wlantest_pipeline *p = ctx;
+	struct pipeline_batch *batch;
+	struct pcap_pkthdr *hdr;
+	const u_char *data;
+	int res = 1;
+
+	while (res == 1) {
+		pthread_mutex_lock(&p->lock);
+		while (dl_list_empty(&p->free))
+			pthread_cond_wait(&p->cond, &p->lock);
+		batch = dl_list_first(&p->free, struct pipeline_batch, list);
+		dl_list_del(&batch->list);
+		pthread_mutex_unlock(&p->lock);
+
+		batch->num_frames = 0;
+		batch->buf_len = 0;
+		while (batch->num_frames < PIPELINE_BATCH_FRAMES) {
+			res = pcap_next_ex(p->pcap, &hdr, &data);
+			if (res == -1)
+				os_strlcpy(batch->error, pcap_geterr(p->pcap),
+					   sizeof(batch->error));
+			if (res != 1)
+				break;
+			if (pipeline_batch_add(batch, hdr, data) < 0) {
+				os_strlcpy(batch->error, "Out of memory",
+					   sizeof(batch->error));
+				res = -1;
+				break;
+			}
+		}
+		batch->res = res;
+
+		pthread_mutex_lock(&p->lock);
+		dl_list_add_tail(&p->read, &batch->list);
+		pthread_cond_broadcast(&p->cond);
+		pthread_mutex_unlock(&p->lock);
+	}
+
+	return NULL;
+}
+
+
+static struct pipeline_batch *
+pipeline_next_batch(struct wlantest_pipeline *p, bool wait)
+{
+	struct pipeline_batch *batch;
+
+	pthread_mutex_lock(&p->lock);
+	while (wait && dl_list_empty(&p->read))
+		pthread_cond_wait(&p->cond, &p->lock);
+	batch = dl_list_first(&p->read, struct pipeline_batch, list);
+	if (batch)
+		dl_list_del(&batch->list);
+	pthread_mutex_unlock(&p->lock);
+
+	return batch;
+}
+
+
+static void pipeline_batch_release(struct wlantest_pipeline *p,
+				   struct pipeline_batch *batch)
+{
+	struct pipeline_job *job;
+	unsigned int i;
+
+	for (i = 0; i < batch->num_frames; i++) {
+		job = &batch->frames[i].job;
+		if (job->state == PIPELINE_JOB_NONE)
+			continue;
+		pipeline_job_finish(job);
+		os_free(job->decrypted);
+		job->decrypted = NULL;
+	}
+
+	pthread_mutex_lock(&p->lock);
+	dl_list_add_tail(&p->free, &batch->list);
+	pthread_cond_broadcast(&p->cond);
+	pthread_mutex_unlock(&p->lock);
+}
+
+
+/**
+ * pipeline_read_cap_file - Process the frames of a capture file
+ * @wt: wlantest data
+ * @pcap: Capture file opened with pcap_open_offline()
+ * @dlt: Datalink type of the capture file
+ * Returns: Number of processed frames or -1 on failure
+ */
+int pipeline_read_cap_file(struct wlantest *wt, void *pcap, int dlt)
+{
+	struct wlantest_pipeline *p = wt->pipeline;
+	struct pipeline_batch *batch;
+	struct pipeline_frame *frame;
+	struct dl_list ready;
+	unsigned int num_ready = 0, i;
+	bool read_done = false;
+	int res = 1, count = 0;
+
+	p->pcap = pcap;
+	if (pthread_create(&p->reader, NULL, pipeline_reader, p) != 0) {
+		wpa_printf(MSG_ERROR, "Could not start pcap reader thread");
+		return -1;
+	}
+
+	dl_list_init(&ready);
+	while (res == 1) {
+		while (!read_done && num_ready < PIPELINE_READ_AHEAD) {
+			batch = pipeline_next_batch(p, num_ready == 0);
+			if (!batch)
+				break;
+			pipeline_dispatch(wt, batch, dlt);
+			dl_list_add_tail(&ready, &batch->list);
+			num_ready++;
+			if (batch->res != 1)
+				read_done = true;
+		}
+
+		batch = dl_list_first(&ready, struct pipeline_batch, list);
+		dl_list_del(&batch->list);
+		num_ready--;
+
+		for (i = 0; i < batch->num_frames; i++) {
+			frame = &batch->frames[i];
+			if (frame->job.state != PIPELINE_JOB_NONE)
+				p->cur = &frame->job;
+			count += read_cap_process(wt, dlt, &frame->hdr,
+						  batch->buf + frame->offset);
+			p->cur = NULL;
+		}
+
+		res = batch->res;
+		if (res == -1)
+			wpa_printf(MSG_INFO, "pcap_next_ex failure: %s",
+				   batch->error);
+		else if (res != 1 && res != -2)
+			wpa_printf(MSG_INFO, "Unexpected pcap_next_ex return "
+				   "value %d", res);
+		pipeline_batch_release(p, batch);
+	}
+
+	pthread_join(p->reader, NULL);
+	p->pcap = NULL;
+
+	wpa_printf(MSG_DEBUG, "Pipeline: %u frames queued for workers, "
+		   "%u results used", p->dispatched, p->used);
+	p->dispatched = 0;
+	p->used = 0;
+
+	return count;
+}
+
+
+/**
+ * pipeline_init - Start the capture file processing pipeline
+ * @wt: wlantest data
+ * @threads: Number of decryption worker threads, 0 for one per online CPU
+ * Returns: 0 on success, -1 on failure
+ */
+int pipeline_init(struct wlantest *wt, int threads)
+{
+	struct wlantest_pipeline *p;
+	struct pipeline_batch *batch;
+	struct pipeline_worker *w;
+	long cpus;
+	int i;
+
+	p = os_zalloc(sizeof(*p));
+	if (!p)
+		return -1;
+	dl_list_init(&p->free);
+	dl_list_init(&p->read);
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->cond, NULL);
+	wt->pipeline = p;
+
+	for (i = 0; i < PIPELINE_BATCHES; i++) {
+		batch = os_zalloc(sizeof(*batch));
+		if (!batch)
+			return -1;
+		dl_list_add(&p->free, &batch->list);
+	}
+
+	if (threads <= 0) {
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = cpus > 0 ? cpus : 1;
+	}
+	p->workers = os_calloc(threads, sizeof(*w));
+	if (!p->workers)
+		return -1;
+	while (p->num_workers < threads) {
+		w = &p->workers[p->num_workers];
+		dl_list_init(&w->queue);
+		dl_list_init(&w->pending);
+		pthread_mutex_init(&w->lock, NULL);
+		pthread_cond_init(&w->cond, NULL);
+		p->num_workers++;
+		w->tk_cache = tk_cache_init();
+		if (!w->tk_cache ||
+		    pthread_create(&w->thread, NULL, pipeline_worker_run,
+				   w) != 0) {
+			wpa_printf(MSG_ERROR,
+				   "Could not start decryption worker thread");
+			return -1;
+		}
+		w->started = 1;
+	}
+	wpa_printf(MSG_DEBUG, "Pipeline: %d decryption worker threads",
+		   p->num_workers);
+	return 0;
+}
+
+
+void pipeline_deinit(struct wlantest *wt)
+{
+	struct wlantest_pipeline *p = wt->pipeline;
+	struct pipeline_batch *batch, *n;
+	struct pipeline_worker *w;
+	int i;
+
+	if (!p)
+		return;
+
+	for (i = 0; i < p->num_workers; i++) {
+		w = &p->workers[i];
+		if (w->started) {
+			pthread_mutex_lock(&w->lock);
+			w->stop = 1;
+			pthread_cond_broadcast(&w->cond);
+			pthread_mutex_unlock(&w->lock);
+			pthread_join(w->thread, NULL);
+		}
+		tk_cache_deinit(w->tk_cache);
+		pthread_cond_destroy(&w->cond);
+		pthread_mutex_destroy(&w->lock);
+	}
+	os_free(p->workers);
+
+	dl_list_for_each_safe(batch, n, &p->free, struct pipeline_batch,
+			      list) {
+		dl_list_del(&batch->list);
+		os_free(batch->buf);
+		os_free(batch);
+	}
+	pthread_cond_destroy(&p->cond);
+	pthread_mutex_destroy(&p->lock);
+	os_free(p);
+	wt->pipeline = NULL;
+}
@@ -46,6 +46,58 @@ static void write_pcap_with_radiotap(struct wlantest *wt,
 }
 
 
+/**
+ * read_cap_process - Process a frame read from a capture file
+ * @wt: wlantest data
+ * @dlt: Datalink type of the capture file
+ * @hdr: pcap header of the frame
+ * @data: Frame
+ * Returns: 1 if the frame was processed, 0 if it was incomplete
+ */
+int read_cap_process(struct wlantest *wt, int dlt, struct pcap_pkthdr *hdr,
+		     const u8 *data)
+{
+	clear_notes(wt);
+	os_free(wt->decrypted);
+	wt->decrypted = NULL;
+
+	wt->frame_num++;
+	wpa_printf(MSG_EXCESSIVE, "pcap hdr: ts=%d.%06d "
+		   "len=%u/%u",
+		   (int) hdr->ts.tv_sec, (int) hdr->ts.tv_usec,
+		   hdr->caplen, hdr->len);
+	if (wt->write_pcap_dumper) {
+		wt->write_pcap_time = hdr->ts;
+		if (dlt == DLT_IEEE802_11)
+			write_pcap_with_radiotap(wt, data, hdr->caplen);
+		else
+			pcap_dump(wt->write_pcap_dumper, hdr, data);
+		if (wt->pcap_no_buffer)
+			pcap_dump_flush(wt->write_pcap_dumper);
+	}
+	if (hdr->caplen < hdr->len) {
+		add_note(wt, MSG_DEBUG, "pcap: Dropped incomplete "
+			 "frame (%u/%u captured)",
+			 hdr->caplen, hdr->len);
+		write_pcapng_write_read(wt, dlt, hdr, data);
+		return 0;
+	}
+	switch (dlt) {
+	case DLT_IEEE802_11_RADIO:
+		wlantest_process(wt, data, hdr->caplen);
+		break;
+	case DLT_PRISM_HEADER:
+		wlantest_process_prism(wt, data, hdr->caplen);
+		break;
+	case DLT_IEEE802_11:
+		wlantest_process_80211(wt, data, hdr->caplen);
+		break;
+	}
+	write_pcapng_write_read(wt, dlt, hdr, data);
+	return 1;
+}
+
+
 int read_cap_file(struct wlantest *wt, const char *fname)
 {
 	char errbuf[PCAP_ERRBUF_SIZE];
@@ -72,11 +124,16 @@ int read_cap_file(struct wlantest *wt, const char *fname)
 	}
 	wpa_printf(MSG_DEBUG, "pcap datalink type: %d", dlt);
 
-	for (;;) {
-		clear_notes(wt);
-		os_free(wt->decrypted);
-		wt->decrypted = NULL;
+	if (wt->pipeline) {
+		res = pipeline_read_cap_file(wt, pcap, dlt);
+		if (res < 0) {
+			pcap_close(pcap);
+			return -1;
+		}
+		count = res;
+	}
 
+	while (!wt->pipeline) {
 		res = pcap_next_ex(pcap, &hdr, &data);
 		if (res == -2)
 			break; /* No more packets */
@@ -92,42 +149,13 @@ int read_cap_file(struct wlantest *wt, const char *fname)
 		}
 
 		/* Packet was read without problems */
-		wt->frame_num++;
-		wpa_printf(MSG_EXCESSIVE, "pcap hdr: ts=%d.%06d "
-			   "len=%u/%u",
-			   (int) hdr->ts.tv_sec, (int) hdr->ts.tv_usec,
-			   hdr->caplen, hdr->len);
-		if (wt->write_pcap_dumper) {
-			wt->write_pcap_time = hdr->ts;
-			if (dlt == DLT_IEEE802_11)
-				write_pcap_with_radiotap(wt, data, hdr->caplen);
-			else
-				pcap_dump(wt->write_pcap_dumper, hdr, data);
-			if (wt->pcap_no_buffer)
-				pcap_dump_flush(wt->write_pcap_dumper);
-		}
-		if (hdr->caplen < hdr->len) {
-			add_note(wt, MSG_DEBUG, "pcap: Dropped incomplete "
-				 "frame (%u/%u captured)",
-				 hdr->caplen, hdr->len);
-			write_pcapng_write_read(wt, dlt, hdr, data);
-			continue;
-		}
-		count++;
-		switch (dlt) {
-		case DLT_IEEE802_11_RADIO:
-			wlantest_process(wt, data, hdr->caplen);
-			break;
-		case DLT_PRISM_HEADER:
-			wlantest_process_prism(wt, data, hdr->caplen);
-			break;
-		case DLT_IEEE802_11:
-			wlantest_process_80211(wt, data, hdr->caplen);
-			break;
-		}
-		write_pcapng_write_read(wt, dlt, hdr, data);
+		count += read_cap_process(wt, dlt, hdr, data);
 	}
 
+	clear_notes(wt);
+	os_free(wt->decrypted);
+	wt->decrypted = NULL;
+
 	pcap_close(pcap);
 
 	wpa_printf(MSG_DEBUG, "Read %s: %u packets", fname, count);
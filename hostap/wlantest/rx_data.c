@@ -376,6 +376,37 @@ skip_replay_det:
 }
 
 
+/*
+ * The same report as ccmp_decrypt(), ccmp_256_decrypt(), and gcmp_decrypt()
+ * print for a frame that is long enough to have been authenticated
+ */
+static void report_ptk_decrypt_failure(int cipher,
+				       const struct ieee80211_hdr *hdr,
+				       size_t len)
+{
+	u16 seq_ctrl = le_to_host16(hdr->seq_ctrl);
+	const char *what = "Invalid CCMP MIC in frame";
+	size_t mic_len = 8;
+
+	if (cipher == WPA_CIPHER_CCMP_256) {
+		what = "Invalid CCMP-256 MIC in frame";
+		mic_len = 16;
+	} else if (cipher == WPA_CIPHER_GCMP ||
+		   cipher == WPA_CIPHER_GCMP_256) {
+		what = "Invalid GCMP frame";
+		mic_len = 16;
+	}
+	if (len < 8 + mic_len)
+		return;
+
+	wpa_printf(MSG_INFO, "%s: A1=" MACSTR " A2=" MACSTR " A3=" MACSTR
+		   " seq=%u frag=%u", what,
+		   MAC2STR(hdr->addr1), MAC2STR(hdr->addr2),
+		   MAC2STR(hdr->addr3),
+		   WLAN_GET_SEQ_SEQ(seq_ctrl), WLAN_GET_SEQ_FRAG(seq_ctrl));
+}
+
+
 static u8 * try_ptk_decrypt(struct wlantest *wt, struct wlantest_sta *sta,
 			    const struct ieee80211_hdr *hdr,
 			    const u8 *a1, const u8 *a2, const u8 *a3,
@@ -383,17 +414,18 @@ static u8 * try_ptk_decrypt(struct wlantest *wt, struct wlantest_sta *sta,
 			    const u8 *data, size_t len,
 			    const u8 *tk, size_t tk_len, size_t *dlen)
 {
-	u8 *decrypted = NULL;
-
-	if (sta->pairwise_cipher == WPA_CIPHER_CCMP_256)
-		decrypted = ccmp_256_decrypt(tk, hdr, a1, a2, a3,
+	u8 *decrypted;
+	int failed;
+
+	decrypted = pipeline_decrypted(wt, sta->pairwise_cipher, tk, tk_len,
+				       hdr, a1, a2, a3, data, len, dlen,
+				       &failed);
+	if (!decrypted && !failed)
+		decrypted = tk_cache_decrypt(wt->tk_cache, sta->pairwise_cipher,
+					     tk, tk_len, hdr, a1, a2, a3,
 					     data, len, dlen);
-	else if (sta->pairwise_cipher == WPA_CIPHER_GCMP ||
-		 sta->pairwise_cipher == WPA_CIPHER_GCMP_256)
-		decrypted = gcmp_decrypt(tk, tk_len, hdr, a1, a2, a3,
-					 data, len, dlen);
-	else
-		decrypted = ccmp_decrypt(tk, hdr, a1, a2, a3, data, len, dlen);
+	if (!decrypted)
+		report_ptk_decrypt_failure(sta->pairwise_cipher, hdr, len);
 	write_decrypted_note(wt, decrypted, tk, tk_len, keyid);
 
 	return decrypted;
@@ -486,16 +518,7 @@ static void rx_data_bss_prot(struct wlantest *wt,
 		sta2 = sta_find(bss, hdr->addr1);
 		if (sta == NULL || sta2 == NULL)
 			return;
-		found = NULL;
-		dl_list_for_each(tdls, &bss->tdls, struct wlantest_tdls, list)
-		{
-			if ((tdls->init == sta && tdls->resp == sta2) ||
-			    (tdls->init == sta2 && tdls->resp == sta)) {
-				found = tdls;
-				if (tdls->link_up)
-					break;
-			}
-		}
+		found = tdls_find(bss, sta, sta2, true);
 		if (found) {
 			if (!found->link_up)
 				add_note(wt, MSG_DEBUG,
@@ -847,7 +870,6 @@ static struct wlantest_tdls * get_tdls(struct wlantest *wt, const u8 *bssid,
 {
 	struct wlantest_bss *bss;
 	struct wlantest_sta *sta1, *sta2;
-	struct wlantest_tdls *tdls, *found = NULL;
 
 	bss = bss_find(wt, bssid);
 	if (bss == NULL)
@@ -859,16 +881,7 @@ static struct wlantest_tdls * get_tdls(struct wlantest *wt, const u8 *bssid,
 	if (sta2 == NULL)
 		return NULL;
 
-	dl_list_for_each(tdls, &bss->tdls, struct wlantest_tdls, list) {
-		if ((tdls->init == sta1 && tdls->resp == sta2) ||
-		    (tdls->init == sta2 && tdls->resp == sta1)) {
-			found = tdls;
-			if (tdls->link_up)
-				break;
-		}
-	}
-
-	return found;
+	return tdls_find(bss, sta1, sta2, true);
 }
 
 
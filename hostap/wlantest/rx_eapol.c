@@ -443,6 +443,7 @@ static void rx_data_eapol_key_2_of_4(struct wlantest *wt, const u8 *dst,
 				   MAC2STR(ie.mac_addr));
 		}
 		os_memcpy(sta->mld_mac_addr, ie.mac_addr, ETH_ALEN);
+		sta->bss->sta_mlo_addr = true;
 	}
 
 	derive_ptk(wt, bss, sta, key_info & WPA_KEY_INFO_TYPE_MASK, data, len);
@@ -513,6 +514,7 @@ static void rx_data_eapol_key_2_of_4(struct wlantest *wt, const u8 *dst,
 			   " from EAPOL-Key 2/4",
 			   link_id, MAC2STR(addr));
 		os_memcpy(sta->link_addr[link_id], addr, ETH_ALEN);
+		sta->bss->sta_mlo_addr = true;
 	}
 }
 
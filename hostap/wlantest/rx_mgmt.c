@@ -103,6 +103,7 @@ static void parse_basic_ml(const u8 *ie, size_t len, bool ap,
 	wpa_printf(MSG_DEBUG, "MLD MAC Address: " MACSTR, MAC2STR(pos));
 	if (!ap && sta && is_zero_ether_addr(sta->mld_mac_addr)) {
 		os_memcpy(sta->mld_mac_addr, pos, ETH_ALEN);
+		sta->bss->sta_mlo_addr = true;
 		wpa_printf(MSG_DEBUG,
 			   "Learned non-AP STA MLD MAC Address from Basic MLE: "
 			   MACSTR, MAC2STR(sta->mld_mac_addr));
@@ -283,6 +284,7 @@ static void parse_basic_ml(const u8 *ie, size_t len, bool ap,
 			if (sta && link_id < MAX_NUM_MLD_LINKS) {
 				os_memcpy(sta->link_addr[link_id], pos,
 					  ETH_ALEN);
+				sta->bss->sta_mlo_addr = true;
 				wpa_printf(MSG_DEBUG,
 					   "Learned Link ID %u MAC address "
 					   MACSTR
@@ -863,6 +865,12 @@ static void process_sae_auth(struct wlantest *wt, struct wlantest_bss *bss,
 	group = WPA_GET_LE16(mgmt->u.auth.variable);
 	wpa_printf(MSG_DEBUG, "SAE Commit using group %u", group);
 	sta->sae_group = group;
+
+	decoy_rx_sae_commit(wt, bss, sta,
+			    ether_addr_equal(mgmt->sa, mgmt->bssid),
+			    status != WLAN_STATUS_SUCCESS,
+			    mgmt->u.auth.variable,
+			    len - IEEE80211_HDRLEN - sizeof(mgmt->u.auth));
 }
 
 
@@ -1263,6 +1271,7 @@ static void rx_mgmt_assoc_req(struct wlantest *wt, const u8 *data, size_t len)
 		if (bss->link_id_set) {
 			os_memcpy(sta->link_addr[bss->link_id], mgmt->sa,
 				  ETH_ALEN);
+			sta->bss->sta_mlo_addr = true;
 			wpa_printf(MSG_DEBUG,
 				   "Learned Link ID %u MAC address "
 				   MACSTR
@@ -1508,13 +1517,11 @@ static void rx_mgmt_reassoc_req(struct wlantest *wt, const u8 *data,
 
 		sta1 = sta_find_mlo(wt, bss, mld_addr);
 		if (sta1 && sta1->ft_over_ds) {
-			dl_list_del(&sta1->list);
-			dl_list_add(&bss->sta, &sta1->list);
 			wpa_printf(MSG_DEBUG,
 				   "Move existing STA entry from another affiliated BSS to the reassociation BSS (addr "
 				   MACSTR " -> " MACSTR ")",
 				   MAC2STR(sta1->addr), MAC2STR(mgmt->sa));
-			os_memcpy(sta1->addr, mgmt->sa, ETH_ALEN);
+			sta_move(bss, sta1, mgmt->sa);
 			sta = sta1;
 		}
 	}
@@ -1567,6 +1574,7 @@ static void rx_mgmt_reassoc_req(struct wlantest *wt, const u8 *data,
 		if (bss->link_id_set) {
 			os_memcpy(sta->link_addr[bss->link_id], mgmt->sa,
 				  ETH_ALEN);
+			sta->bss->sta_mlo_addr = true;
 			wpa_printf(MSG_DEBUG,
 				   "Learned Link ID %u MAC address "
 				   MACSTR
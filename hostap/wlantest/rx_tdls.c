@@ -45,10 +45,9 @@ static struct wlantest_tdls * get_tdls(struct wlantest *wt, const u8 *linkid,
 	if (resp == NULL)
 		return NULL;
 
-	dl_list_for_each(tdls, &bss->tdls, struct wlantest_tdls, list) {
-		if (tdls->init == init && tdls->resp == resp)
-			return tdls;
-	}
+	tdls = tdls_find(bss, init, resp, false);
+	if (tdls)
+		return tdls;
 
 	if (!create_new)
 		return NULL;
@@ -64,7 +63,7 @@ static struct wlantest_tdls * get_tdls(struct wlantest *wt, const u8 *linkid,
 		return NULL;
 	tdls->init = init;
 	tdls->resp = resp;
-	dl_list_add(&bss->tdls, &tdls->list);
+	tdls_add(bss, tdls);
 	return tdls;
 }
 
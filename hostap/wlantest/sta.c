@@ -19,7 +19,8 @@ struct wlantest_sta * sta_find(struct wlantest_bss *bss, const u8 *addr)
 {
 	struct wlantest_sta *sta;
 
-	dl_list_for_each(sta, &bss->sta, struct wlantest_sta, list) {
+	dl_list_for_each(sta, &bss->sta_hash[WLANTEST_STA_HASH(addr)],
+			 struct wlantest_sta, hash) {
 		if (ether_addr_equal(sta->addr, addr))
 			return sta;
 	}
@@ -35,20 +36,32 @@ struct wlantest_sta * sta_find_mlo(struct wlantest *wt,
 	struct wlantest_bss *obss;
 	int link_id;
 
-	dl_list_for_each(sta, &bss->sta, struct wlantest_sta, list) {
-		if (ether_addr_equal(sta->addr, addr))
-			return sta;
-		if (ether_addr_equal(sta->mld_mac_addr, addr))
-			return sta;
+	sta = sta_find(bss, addr);
+	if (sta)
+		return sta;
+
+	/*
+	 * Without MLD or link addresses in a BSS only the STA address can
+	 * match (and a zero address matches the zero MLD address of any entry)
+	 */
+	if (is_zero_ether_addr(addr) || bss->sta_mlo_addr) {
+		dl_list_for_each(sta, &bss->sta, struct wlantest_sta, list) {
+			if (ether_addr_equal(sta->mld_mac_addr, addr))
+				return sta;
+		}
 	}
 
 	if (is_zero_ether_addr(addr))
 		return NULL;
 
-	dl_list_for_each(sta, &bss->sta, struct wlantest_sta, list) {
-		for (link_id = 0; link_id < MAX_NUM_MLD_LINKS; link_id++) {
-			if (ether_addr_equal(sta->link_addr[link_id], addr))
-				return sta;
+	if (bss->sta_mlo_addr) {
+		dl_list_for_each(sta, &bss->sta, struct wlantest_sta, list) {
+			for (link_id = 0; link_id < MAX_NUM_MLD_LINKS;
+			     link_id++) {
+				if (ether_addr_equal(sta->link_addr[link_id],
+						     addr))
+					return sta;
+			}
 		}
 	}
 
@@ -58,6 +71,12 @@ struct wlantest_sta * sta_find_mlo(struct wlantest *wt,
 		if (!is_zero_ether_addr(bss->mld_mac_addr) &&
 		    !ether_addr_equal(obss->mld_mac_addr, bss->mld_mac_addr))
 			continue;
+		if (!obss->sta_mlo_addr) {
+			sta = sta_find(obss, addr);
+			if (sta)
+				return sta;
+			continue;
+		}
 		dl_list_for_each(sta, &obss->sta, struct wlantest_sta, list) {
 			if (ether_addr_equal(sta->addr, addr))
 				return sta;
@@ -95,6 +114,7 @@ struct wlantest_sta * sta_get(struct wlantest_bss *bss, const u8 *addr)
 	sta->bss = bss;
 	os_memcpy(sta->addr, addr, ETH_ALEN);
 	dl_list_add(&bss->sta, &sta->list);
+	dl_list_add(&bss->sta_hash[WLANTEST_STA_HASH(addr)], &sta->hash);
 	wpa_printf(MSG_DEBUG, "Discovered new STA " MACSTR " in BSS " MACSTR
 		   " (MLD " MACSTR ")",
 		   MAC2STR(sta->addr),
@@ -103,10 +123,31 @@ struct wlantest_sta * sta_get(struct wlantest_bss *bss, const u8 *addr)
 }
 
 
+/*
+ * Moves the entry to the list of another affiliated BSS of an AP MLD under a
+ * new address. sta->bss is left unchanged, so the target BSS is marked here
+ * for the MLD and link addresses the entry may have or learn later.
+ */
+void sta_move(struct wlantest_bss *bss, struct wlantest_sta *sta,
+	      const u8 *addr)
+{
+	dl_list_del(&sta->list);
+	dl_list_del(&sta->hash);
+	os_memcpy(sta->addr, addr, ETH_ALEN);
+	dl_list_add(&bss->sta, &sta->list);
+	dl_list_add(&bss->sta_hash[WLANTEST_STA_HASH(addr)], &sta->hash);
+	bss->sta_mlo_addr = true;
+}
+
+
 void sta_deinit(struct wlantest_sta *sta)
 {
 	dl_list_del(&sta->list);
+	dl_list_del(&sta->hash);
 	os_free(sta->assocreq_ies);
+#ifdef CONFIG_DECOYAUTH
+	os_free(sta->decoy_commit);
+#endif /* CONFIG_DECOYAUTH */
 	os_free(sta);
 }
 
@@ -128,6 +169,7 @@ static void sta_update_assoc_ml(struct wlantest_sta *sta,
 
 	wpa_printf(MSG_DEBUG, "STA MLD Address: " MACSTR, MAC2STR(mld_addr));
 	os_memcpy(sta->mld_mac_addr, mld_addr, ETH_ALEN);
+	sta->bss->sta_mlo_addr = true;
 }
 
 
@@ -361,6 +403,7 @@ void sta_new_ptk(struct wlantest *wt, struct wlantest_sta *sta,
 			sta_copy_ptk(osta, ptk);
 			os_memcpy(osta->mld_mac_addr, sta->mld_mac_addr,
 				  ETH_ALEN);
+			osta->bss->sta_mlo_addr = true;
 		}
 	}
 }
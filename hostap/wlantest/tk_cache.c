@@ -0,0 +1,171 @@
+/*
+ * wlantest - Cache of expanded AES key schedules per TK
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * Each decrypted CCMP/GCMP frame would otherwise expand the AES key schedule
+ * of its TK again. The cache is not locked; each thread that decrypts frames
+ * uses its own.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "utils/list.h"
+#include "common/defs.h"
+#include "crypto/aes.h"
+#include "wlantest.h"
+
+#define TK_CACHE_SIZE 1024
+#define TK_CACHE_HASH_SIZE 256
+
+struct tk_cache_entry {
+	struct dl_list list; /* in tk_cache::lru */
+	struct dl_list hash; /* in tk_cache::hash */
+	u8 tk[32];
+	size_t tk_len;
+	void *aes;
+};
+
+struct tk_cache {
+	struct dl_list lru; /* most recently used first */
+	struct dl_list hash[TK_CACHE_HASH_SIZE];
+	unsigned int num_entries;
+};
+
+
+struct tk_cache * tk_cache_init(void)
+{
+	struct tk_cache *cache;
+	int i;
+
+	cache = os_zalloc(sizeof(*cache));
+	if (!cache)
+		return NULL;
+	dl_list_init(&cache->lru);
+	for (i = 0; i < TK_CACHE_HASH_SIZE; i++)
+		dl_list_init(&cache->hash[i]);
+	return cache;
+}
+
+
+static void tk_cache_entry_free(struct tk_cache *cache,
+				struct tk_cache_entry *entry)
+{
+	dl_list_del(&entry->list);
+	dl_list_del(&entry->hash);
+	aes_encrypt_deinit(entry->aes);
+	bin_clear_free(entry, sizeof(*entry));
+	cache->num_entries--;
+}
+
+
+void tk_cache_deinit(struct tk_cache *cache)
+{
+	struct tk_cache_entry *entry, *n;
+
+	if (!cache)
+		return;
+	dl_list_for_each_safe(entry, n, &cache->lru, struct tk_cache_entry,
+			      list)
+		tk_cache_entry_free(cache, entry);
+	os_free(cache);
+}
+
+
+/**
+ * tk_cache_get - Get an AES context for a TK
+ * @cache: Cache from tk_cache_init() or %NULL
+ * @tk: Temporal key
+ * @tk_len: Length of the TK in octets (16 or 32)
+ * Returns: Context for aes_encrypt() or %NULL on failure
+ *
+ * The context remains valid until the next call with the same cache.
+ */
+void * tk_cache_get(struct tk_cache *cache, const u8 *tk, size_t tk_len)
+{
+	struct dl_list *bucket;
+	struct tk_cache_entry *entry;
+
+	if (!cache || tk_len > sizeof(entry->tk))
+		return NULL;
+
+	bucket = &cache->hash[tk[0]];
+	dl_list_for_each(entry, bucket, struct tk_cache_entry, hash) {
+		if (entry->tk_len == tk_len &&
+		    os_memcmp(entry->tk, tk, tk_len) == 0) {
+			dl_list_del(&entry->list);
+			dl_list_add(&cache->lru, &entry->list);
+			return entry->aes;
+		}
+	}
+
+	if (cache->num_entries >= TK_CACHE_SIZE)
+		tk_cache_entry_free(cache,
+				    dl_list_last(&cache->lru,
+						 struct tk_cache_entry, list));
+
+	entry = os_zalloc(sizeof(*entry));
+	if (!entry)
+		return NULL;
+	entry->aes = aes_encrypt_init(tk, tk_len);
+	if (!entry->aes) {
+		os_free(entry);
+		return NULL;
+	}
+	os_memcpy(entry->tk, tk, tk_len);
+	entry->tk_len = tk_len;
+	dl_list_add(&cache->lru, &entry->list);
+	dl_list_add(bucket, &entry->hash);
+	cache->num_entries++;
+	return entry->aes;
+}
+
+
+/**
+ * tk_cache_decrypt - Decrypt a CCMP/GCMP protected frame with a cached TK
+ * @cache: Cache from tk_cache_init() or %NULL
+ * @cipher: Pairwise cipher (WPA_CIPHER_*)
+ * @tk: Temporal key
+ * @tk_len: Length of the TK for GCMP; CCMP ciphers imply the length
+ * Returns: Decrypted frame body or %NULL on failure
+ *
+ * Any cipher other than CCMP-256, GCMP, and GCMP-256 is decrypted as CCMP.
+ * Without a cache, or when the TK cannot be cached, a context is set up for
+ * this frame only. Failures are not reported.
+ */
+u8 * tk_cache_decrypt(struct tk_cache *cache, int cipher,
+		      const u8 *tk, size_t tk_len,
+		      const struct ieee80211_hdr *hdr,
+		      const u8 *a1, const u8 *a2, const u8 *a3,
+		      const u8 *data, size_t data_len, size_t *decrypted_len)
+{
+	int gcmp = cipher == WPA_CIPHER_GCMP || cipher == WPA_CIPHER_GCMP_256;
+	size_t key_len = 16, mic_len = 8;
+	void *aes, *tmp = NULL;
+	u8 *decrypted;
+
+	if (gcmp) {
+		key_len = tk_len;
+	} else if (cipher == WPA_CIPHER_CCMP_256) {
+		key_len = 32;
+		mic_len = 16;
+	}
+
+	aes = tk_cache_get(cache, tk, key_len);
+	if (!aes)
+		aes = tmp = aes_encrypt_init(tk, key_len);
+	if (!aes)
+		return NULL;
+
+	if (gcmp)
+		decrypted = gcmp_decrypt_ctx(aes, hdr, a1, a2, a3, data,
+					     data_len, decrypted_len);
+	else
+		decrypted = ccmp_decrypt_ctx(aes, mic_len, hdr, a1, a2, a3,
+					     data, data_len, decrypted_len);
+	if (tmp)
+		aes_encrypt_deinit(tmp);
+	return decrypted;
+}
@@ -27,7 +27,11 @@ static void usage(void)
 	       "[-P<RADIUS shared secret>]\n"
 	       "         [-n<write pcapng file>]\n"
 	       "         [-w<write pcap file>] [-f<MSK/PMK file>]\n"
-	       "         [-L<log file>] [-T<PTK file>] [-W<WEP key>]\n");
+	       "         [-L<log file>] [-T<PTK file>] [-W<WEP key>]\n"
+	       "         [-J<decryption threads>]\n");
+#ifdef CONFIG_DECOYAUTH
+	printf("         [-D<DecoyAuth password file>] [-j<worker threads>]\n");
+#endif /* CONFIG_DECOYAUTH */
 }
 
 
@@ -55,11 +59,14 @@ static void wlantest_init(struct wlantest *wt)
 		wt->ctrl_socks[i] = -1;
 	dl_list_init(&wt->passphrase);
 	dl_list_init(&wt->bss);
+	for (i = 0; i < WLANTEST_BSS_HASH_SIZE; i++)
+		dl_list_init(&wt->bss_hash[i]);
 	dl_list_init(&wt->secret);
 	dl_list_init(&wt->radius);
 	dl_list_init(&wt->pmk);
 	dl_list_init(&wt->ptk);
 	dl_list_init(&wt->wep);
+	wt->tk_cache = tk_cache_init();
 }
 
 
@@ -112,6 +119,10 @@ static void wlantest_deinit(struct wlantest *wt)
 		ptk_deinit(ptk);
 	dl_list_for_each_safe(wep, nw, &wt->wep, struct wlantest_wep, list)
 		wep_deinit(wep);
+	decoy_deinit(wt);
+	pipeline_deinit(wt);
+	tk_cache_deinit(wt->tk_cache);
+	wt->tk_cache = NULL;
 	write_pcap_deinit(wt);
 	write_pcapng_deinit(wt);
 	clear_notes(wt);
@@ -381,6 +392,11 @@ int main(int argc, char *argv[])
 	const char *logfile = NULL;
 	struct wlantest wt;
 	int ctrl_iface = 0;
+#ifdef CONFIG_DECOYAUTH
+	const char *decoy_file = NULL;
+	int decoy_threads = 0;
+#endif /* CONFIG_DECOYAUTH */
+	int pipeline_threads = -1;
 	bool eloop_init_done = false;
 
 	wpa_debug_level = MSG_INFO;
@@ -392,7 +408,7 @@ int main(int argc, char *argv[])
 	wlantest_init(&wt);
 
 	for (;;) {
-		c = getopt(argc, argv, "cdef:Fhi:I:L:n:Np:P:qr:R:tT:w:W:");
+		c = getopt(argc, argv, "cdD:ef:Fhi:I:j:J:L:n:Np:P:qr:R:tT:w:W:");
 		if (c < 0)
 			break;
 		switch (c) {
@@ -403,6 +419,11 @@ int main(int argc, char *argv[])
 			if (wpa_debug_level > 0)
 				wpa_debug_level--;
 			break;
+#ifdef CONFIG_DECOYAUTH
+		case 'D':
+			decoy_file = optarg;
+			break;
+#endif /* CONFIG_DECOYAUTH */
 		case 'e':
 			wt.ethernet = 1;
 			break;
@@ -425,6 +446,16 @@ int main(int argc, char *argv[])
 		case 'I':
 			ifname_wired = optarg;
 			break;
+#ifdef CONFIG_DECOYAUTH
+		case 'j':
+			decoy_threads = atoi(optarg);
+			break;
+#endif /* CONFIG_DECOYAUTH */
+		case 'J':
+			pipeline_threads = atoi(optarg);
+			if (pipeline_threads < 0)
+				pipeline_threads = 0;
+			break;
 		case 'L':
 			logfile = optarg;
 			break;
@@ -496,6 +527,19 @@ int main(int argc, char *argv[])
 	if (logfile)
 		wpa_debug_open_file(logfile);
 
+#ifdef CONFIG_DECOYAUTH
+	if (decoy_file && decoy_init(&wt, decoy_file, decoy_threads) < 0) {
+		ret = -1;
+		goto deinit;
+	}
+#endif /* CONFIG_DECOYAUTH */
+
+	if (num_read_file && pipeline_threads >= 0 &&
+	    pipeline_init(&wt, pipeline_threads) < 0) {
+		ret = -1;
+		goto deinit;
+	}
+
 	if ((wt.write_file && write_pcap_init(&wt, wt.write_file) < 0) ||
 	    (wt.pcapng_file && write_pcapng_init(&wt, wt.pcapng_file) < 0) ||
 	    (read_wired_file &&
@@ -511,6 +555,7 @@ int main(int argc, char *argv[])
 			goto deinit;
 		}
 	}
+	decoy_flush(&wt);
 
 	if ((ifname && monitor_init(&wt, ifname) < 0) ||
 	    (ifname_wired && monitor_init_wired(&wt, ifname_wired) < 0) ||
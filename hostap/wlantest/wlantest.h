@@ -17,6 +17,15 @@ struct ieee802_11_elems;
 struct radius_msg;
 struct ieee80211_hdr;
 struct wlantest_bss;
+struct tk_cache;
+struct wlantest_pipeline;
+
+/* Hash tables on the MAC address next to the BSS and STA lists */
+#define WLANTEST_BSS_HASH_SIZE 256
+#define WLANTEST_BSS_HASH(bssid) ((bssid)[5])
+#define WLANTEST_STA_HASH_SIZE 256
+#define WLANTEST_STA_HASH(addr) ((addr)[5])
+#define WLANTEST_TDLS_HASH_SIZE 16
 
 #define MAX_RADIUS_SECRET_LEN 128
 
@@ -53,6 +62,7 @@ struct wlantest_wep {
 
 struct wlantest_sta {
 	struct dl_list list;
+	struct dl_list hash; /* entry in sta_hash of the BSS listing it */
 	struct wlantest_bss *bss;
 	u8 addr[ETH_ALEN];
 	u8 mld_mac_addr[ETH_ALEN];
@@ -121,12 +131,18 @@ struct wlantest_sta {
 
 	u16 sae_group;
 	u16 owe_group;
+#ifdef CONFIG_DECOYAUTH
+	u8 *decoy_commit; /* STA SAE commit waiting for the AP commit */
+	size_t decoy_commit_len;
+	bool decoy_commit_h2e;
+#endif /* CONFIG_DECOYAUTH */
 
 	enum rsn_selection_variant rsn_selection;
 };
 
 struct wlantest_tdls {
 	struct dl_list list;
+	struct dl_list hash; /* entry in bss->tdls_hash */
 	struct wlantest_sta *init;
 	struct wlantest_sta *resp;
 	struct tpk {
@@ -144,6 +160,7 @@ struct wlantest_tdls {
 
 struct wlantest_bss {
 	struct dl_list list;
+	struct dl_list hash; /* entry in wt->bss_hash */
 	u8 bssid[ETH_ALEN];
 	u8 mld_mac_addr[ETH_ALEN];
 	u8 link_id;
@@ -170,6 +187,8 @@ struct wlantest_bss {
 	int key_mgmt;
 	int rsn_capab;
 	struct dl_list sta; /* struct wlantest_sta */
+	/* An entry in sta has had an MLD or link address set */
+	bool sta_mlo_addr;
 	struct dl_list pmk; /* struct wlantest_pmk */
 	u8 gtk[4][32];
 	size_t gtk_len[4];
@@ -182,6 +201,8 @@ struct wlantest_bss {
 	int bigtk_idx;
 	u32 counters[NUM_WLANTEST_BSS_COUNTER];
 	struct dl_list tdls; /* struct wlantest_tdls */
+	struct dl_list sta_hash[WLANTEST_STA_HASH_SIZE];
+	struct dl_list tdls_hash[WLANTEST_TDLS_HASH_SIZE];
 	u8 mdid[MOBILITY_DOMAIN_ID_LEN];
 	u8 r0kh_id[FT_R0KH_ID_MAX_LEN];
 	size_t r0kh_id_len;
@@ -217,6 +238,7 @@ struct wlantest {
 
 	struct dl_list passphrase; /* struct wlantest_passphrase */
 	struct dl_list bss; /* struct wlantest_bss */
+	struct dl_list bss_hash[WLANTEST_BSS_HASH_SIZE];
 	struct dl_list secret; /* struct wlantest_radius_secret */
 	struct dl_list radius; /* struct wlantest_radius */
 	struct dl_list pmk; /* struct wlantest_pmk */
@@ -253,6 +275,10 @@ struct wlantest {
 	const char *pcapng_file;
 
 	struct tkip_frag tkip_frag;
+
+	struct wlantest_decoy *decoy;
+	struct wlantest_pipeline *pipeline;
+	struct tk_cache *tk_cache;
 };
 
 void add_note(struct wlantest *wt, int level, const char *fmt, ...)
@@ -265,6 +291,19 @@ void write_decrypted_note(struct wlantest *wt, const u8 *decrypted,
 int add_wep(struct wlantest *wt, const char *key);
 int read_cap_file(struct wlantest *wt, const char *fname);
 int read_wired_cap_file(struct wlantest *wt, const char *fname);
+struct pcap_pkthdr;
+int read_cap_process(struct wlantest *wt, int dlt, struct pcap_pkthdr *hdr,
+		     const u8 *data);
+
+int pipeline_init(struct wlantest *wt, int threads);
+void pipeline_deinit(struct wlantest *wt);
+int pipeline_read_cap_file(struct wlantest *wt, void *pcap, int dlt);
+u8 * pipeline_decrypted(struct wlantest *wt, int cipher,
+			const u8 *tk, size_t tk_len,
+			const struct ieee80211_hdr *hdr,
+			const u8 *a1, const u8 *a2, const u8 *a3,
+			const u8 *data, size_t data_len, size_t *decrypted_len,
+			int *failed);
 
 int write_pcap_init(struct wlantest *wt, const char *fname);
 void write_pcap_deinit(struct wlantest *wt);
@@ -274,7 +313,6 @@ void write_pcap_decrypted(struct wlantest *wt, const u8 *buf1, size_t len1,
 
 int write_pcapng_init(struct wlantest *wt, const char *fname);
 void write_pcapng_deinit(struct wlantest *wt);
-struct pcap_pkthdr;
 void write_pcapng_write_read(struct wlantest *wt, int dlt,
 			     struct pcap_pkthdr *hdr, const u8 *data);
 void write_pcapng_captured(struct wlantest *wt, const u8 *buf, size_t len);
@@ -310,12 +348,18 @@ void bss_flush(struct wlantest *wt);
 int bss_add_pmk_from_passphrase(struct wlantest_bss *bss,
 				const char *passphrase);
 void pmk_deinit(struct wlantest_pmk *pmk);
+void tdls_add(struct wlantest_bss *bss, struct wlantest_tdls *tdls);
+struct wlantest_tdls * tdls_find(struct wlantest_bss *bss,
+				 struct wlantest_sta *sta1,
+				 struct wlantest_sta *sta2, bool any_direction);
 void tdls_deinit(struct wlantest_tdls *tdls);
 
 struct wlantest_sta * sta_find(struct wlantest_bss *bss, const u8 *addr);
 struct wlantest_sta * sta_find_mlo(struct wlantest *wt,
 				   struct wlantest_bss *bss, const u8 *addr);
 struct wlantest_sta * sta_get(struct wlantest_bss *bss, const u8 *addr);
+void sta_move(struct wlantest_bss *bss, struct wlantest_sta *sta,
+	      const u8 *addr);
 void sta_deinit(struct wlantest_sta *sta);
 void sta_update_assoc(struct wlantest_sta *sta,
 		      struct ieee802_11_elems *elems);
@@ -339,6 +383,10 @@ u8 * ccmp_256_decrypt(const u8 *tk, const struct ieee80211_hdr *hdr,
 u8 * ccmp_256_encrypt(const u8 *tk, u8 *frame, size_t len, size_t hdrlen,
 		      const u8 *qos, const u8 *a1, const u8 *a2, const u8 *a3,
 		      const u8 *pn, int keyid, size_t *encrypted_len);
+u8 * ccmp_decrypt_ctx(void *aes, size_t mic_len,
+		      const struct ieee80211_hdr *hdr,
+		      const u8 *a1, const u8 *a2, const u8 *a3,
+		      const u8 *data, size_t data_len, size_t *decrypted_len);
 
 enum michael_mic_result {
 	MICHAEL_MIC_OK,
@@ -372,6 +420,18 @@ u8 * gcmp_decrypt(const u8 *tk, size_t tk_len, const struct ieee80211_hdr *hdr,
 u8 * gcmp_encrypt(const u8 *tk, size_t tk_len, const u8 *frame, size_t len,
 		  size_t hdrlen, const u8 *qos, const u8 *a1, const u8 *a2,
 		  const u8 *a3, const u8 *pn, int keyid, size_t *encrypted_len);
+u8 * gcmp_decrypt_ctx(void *aes, const struct ieee80211_hdr *hdr,
+		      const u8 *a1, const u8 *a2, const u8 *a3,
+		      const u8 *data, size_t data_len, size_t *decrypted_len);
+
+struct tk_cache * tk_cache_init(void);
+void tk_cache_deinit(struct tk_cache *cache);
+void * tk_cache_get(struct tk_cache *cache, const u8 *tk, size_t tk_len);
+u8 * tk_cache_decrypt(struct tk_cache *cache, int cipher,
+		      const u8 *tk, size_t tk_len,
+		      const struct ieee80211_hdr *hdr,
+		      const u8 *a1, const u8 *a2, const u8 *a3,
+		      const u8 *data, size_t data_len, size_t *decrypted_len);
 
 int ctrl_init(struct wlantest *wt);
 void ctrl_deinit(struct wlantest *wt);
@@ -382,4 +442,28 @@ int wlantest_inject(struct wlantest *wt, struct wlantest_bss *bss,
 
 int wlantest_relog(struct wlantest *wt);
 
+#ifdef CONFIG_DECOYAUTH
+int decoy_init(struct wlantest *wt, const char *fname, int threads);
+void decoy_flush(struct wlantest *wt);
+void decoy_deinit(struct wlantest *wt);
+void decoy_rx_sae_commit(struct wlantest *wt, struct wlantest_bss *bss,
+			 struct wlantest_sta *sta, bool from_ap, bool h2e,
+			 const u8 *data, size_t len);
+#else /* CONFIG_DECOYAUTH */
+static inline void decoy_flush(struct wlantest *wt)
+{
+}
+
+static inline void decoy_deinit(struct wlantest *wt)
+{
+}
+
+static inline void decoy_rx_sae_commit(struct wlantest *wt,
+				       struct wlantest_bss *bss,
+				       struct wlantest_sta *sta, bool from_ap,
+				       bool h2e, const u8 *data, size_t len)
+{
+}
+#endif /* CONFIG_DECOYAUTH */
+
 #endif /* WLANTEST_H */
@@ -0,0 +1,336 @@
+/*
+ * wlantest_bench - Frame processing throughput of wlantest
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * Replays capture files and a synthetic capture with many BSSs and STAs
+ * through the normal processing path and reports the frame rate. A capture
+ * of CCMP protected frames is also written and read back with and without
+ * the decryption pipeline (-J):
+ *
+ * ./wlantest_bench [-b num BSS] [-s STAs per BSS] [-n frames]
+ *                  [-J decryption threads] [capture file]
+ */
+
+#define main wlantest_main
+#include "wlantest.c"
+#undef main
+
+#include "common/ieee802_11_defs.h"
+
+
+static unsigned int bench_usecs(struct os_reltime *start)
+{
+	struct os_reltime now, diff;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	return diff.sec * 1000000 + diff.usec;
+}
+
+
+static void bench_report(const char *name, unsigned int frames,
+			 unsigned int usecs)
+{
+	printf("%-24s %8u frames %8u usec %10.0f frames/s\n", name, frames,
+	       usecs, usecs ? frames * 1000000.0 / usecs : 0.0);
+}
+
+
+static void bench_file(const char *fname, unsigned int rounds)
+{
+	struct wlantest wt;
+	struct os_reltime start;
+	unsigned int i, usecs, frames = 0;
+
+	os_get_reltime(&start);
+	for (i = 0; i < rounds; i++) {
+		wlantest_init(&wt);
+		if (read_cap_file(&wt, fname) < 0) {
+			wlantest_deinit(&wt);
+			return;
+		}
+		frames += wt.rx_mgmt + wt.rx_ctrl + wt.rx_data;
+		wlantest_deinit(&wt);
+	}
+	usecs = bench_usecs(&start);
+	bench_report(fname, frames, usecs);
+}
+
+
+/*
+ * Unprotected ToDS Data frames behind a minimal radiotap header. Each STA
+ * and BSS is created on its first frame and looked up on all the others.
+ */
+static void bench_synthetic(unsigned int num_bss, unsigned int num_sta,
+			    unsigned int frames)
+{
+	struct wlantest wt;
+	struct os_reltime start;
+	u8 buf[8 + 24 + 8 + 64];
+	struct ieee80211_hdr *hdr;
+	unsigned int i, bss_idx, sta_idx, usecs, seed = 1;
+
+	os_memset(buf, 0, sizeof(buf));
+	/* radiotap: version 0, length 8, no fields present */
+	WPA_PUT_LE16(&buf[2], 8);
+	hdr = (struct ieee80211_hdr *) &buf[8];
+	hdr->frame_control = IEEE80211_FC(WLAN_FC_TYPE_DATA,
+					  WLAN_FC_STYPE_DATA);
+	hdr->frame_control |= host_to_le16(WLAN_FC_TODS);
+	hdr->addr1[0] = 0x02;
+	hdr->addr2[0] = 0x02;
+	hdr->addr2[1] = 0x01;
+	os_memset(hdr->addr3, 0xff, ETH_ALEN);
+	os_memcpy(&buf[8 + 24], "\xaa\xaa\x03\x00\x00\x00\x88\xb5", 8);
+
+	wlantest_init(&wt);
+	os_get_reltime(&start);
+	for (i = 0; i < frames; i++) {
+		seed = seed * 1103515245 + 12345;
+		bss_idx = (seed >> 8) % num_bss;
+		sta_idx = (seed >> 20) % num_sta;
+		WPA_PUT_BE16(&hdr->addr1[4], bss_idx);
+		WPA_PUT_BE16(&hdr->addr2[2], bss_idx);
+		WPA_PUT_BE16(&hdr->addr2[4], sta_idx);
+		hdr->seq_ctrl = host_to_le16((i & 0xfff) << 4);
+		wlantest_process(&wt, buf, sizeof(buf));
+	}
+	usecs = bench_usecs(&start);
+	bench_report("synthetic", frames, usecs);
+	printf("  %u BSS, %u STAs per BSS, rx_data=%u\n",
+	       (unsigned int) dl_list_len(&wt.bss), num_sta, wt.rx_data);
+	wlantest_deinit(&wt);
+}
+
+
+#define BENCH_PROT_BSS 4
+#define BENCH_PROT_STA 16
+#define BENCH_PROT_LEN 1500
+
+static void bench_prot_tk(u8 *tk, unsigned int bss_idx, unsigned int sta_idx)
+{
+	os_memset(tk, 0x11, 16);
+	tk[0] = bss_idx;
+	tk[1] = sta_idx;
+}
+
+
+static void bench_prot_addr(u8 *bssid, u8 *sta_addr, unsigned int bss_idx,
+			    unsigned int sta_idx)
+{
+	os_memcpy(bssid, "\x02\x00\x00\x00\x00\x00", ETH_ALEN);
+	bssid[5] = bss_idx;
+	os_memcpy(sta_addr, "\x02\x01\x00\x00\x00\x00", ETH_ALEN);
+	sta_addr[4] = bss_idx;
+	sta_addr[5] = sta_idx;
+}
+
+
+/* Classic pcap file of CCMP protected ToDS Data frames behind radiotap */
+static int bench_prot_write(const char *fname, unsigned int frames)
+{
+	FILE *f;
+	u8 file_hdr[24], rec_hdr[16], radiotap[8], pn[6];
+	u8 frame[24 + BENCH_PROT_LEN], tk[16], *crypt;
+	struct ieee80211_hdr *hdr;
+	unsigned int i, bss_idx, sta_idx, seed = 1;
+	size_t crypt_len;
+	int ret = 0;
+
+	f = fopen(fname, "wb");
+	if (!f)
+		return -1;
+
+	os_memset(file_hdr, 0, sizeof(file_hdr));
+	WPA_PUT_LE32(&file_hdr[0], 0xa1b2c3d4);
+	WPA_PUT_LE16(&file_hdr[4], 2);
+	WPA_PUT_LE16(&file_hdr[6], 4);
+	WPA_PUT_LE32(&file_hdr[16], 65535);
+	WPA_PUT_LE32(&file_hdr[20], 127); /* DLT_IEEE802_11_RADIO */
+	os_memset(radiotap, 0, sizeof(radiotap));
+	WPA_PUT_LE16(&radiotap[2], sizeof(radiotap));
+	if (fwrite(file_hdr, sizeof(file_hdr), 1, f) != 1)
+		ret = -1;
+
+	os_memset(frame, 0, sizeof(frame));
+	hdr = (struct ieee80211_hdr *) frame;
+	hdr->frame_control = IEEE80211_FC(WLAN_FC_TYPE_DATA,
+					  WLAN_FC_STYPE_DATA);
+	hdr->frame_control |= host_to_le16(WLAN_FC_TODS);
+	os_memset(hdr->addr3, 0xff, ETH_ALEN);
+	os_memcpy(&frame[24], "\xaa\xaa\x03\x00\x00\x00\x88\xb5", 8);
+	for (i = 32; i < sizeof(frame); i++)
+		frame[i] = i;
+
+	for (i = 0; ret == 0 && i < frames; i++) {
+		seed = seed * 1103515245 + 12345;
+		bss_idx = (seed >> 8) % BENCH_PROT_BSS;
+		sta_idx = (seed >> 20) % BENCH_PROT_STA;
+		bench_prot_addr(hdr->addr1, hdr->addr2, bss_idx, sta_idx);
+		hdr->seq_ctrl = host_to_le16((i & 0xfff) << 4);
+		bench_prot_tk(tk, bss_idx, sta_idx);
+		os_memset(pn, 0, sizeof(pn));
+		WPA_PUT_BE32(&pn[2], i + 1);
+		crypt = ccmp_encrypt(tk, frame, sizeof(frame), 24, NULL,
+				     hdr->addr1, hdr->addr2, hdr->addr3, pn, 0,
+				     &crypt_len);
+		if (!crypt) {
+			ret = -1;
+			break;
+		}
+		os_memset(rec_hdr, 0, sizeof(rec_hdr));
+		WPA_PUT_LE32(&rec_hdr[0], i / 1000);
+		WPA_PUT_LE32(&rec_hdr[4], (i % 1000) * 1000);
+		WPA_PUT_LE32(&rec_hdr[8], sizeof(radiotap) + crypt_len);
+		WPA_PUT_LE32(&rec_hdr[12], sizeof(radiotap) + crypt_len);
+		if (fwrite(rec_hdr, sizeof(rec_hdr), 1, f) != 1 ||
+		    fwrite(radiotap, sizeof(radiotap), 1, f) != 1 ||
+		    fwrite(crypt, crypt_len, 1, f) != 1)
+			ret = -1;
+		os_free(crypt);
+	}
+
+	if (fclose(f) != 0)
+		ret = -1;
+	return ret;
+}
+
+
+static int bench_prot_read(const char *fname, int threads, u64 *pn_sum)
+{
+	struct wlantest wt;
+	struct wlantest_bss *bss;
+	struct wlantest_sta *sta;
+	struct os_reltime start;
+	u8 bssid[ETH_ALEN], sta_addr[ETH_ALEN];
+	unsigned int b, s, i, usecs;
+	u64 pn, decrypted = 0;
+	char name[32];
+	int ret = -1;
+
+	wlantest_init(&wt);
+	for (b = 0; b < BENCH_PROT_BSS; b++) {
+		for (s = 0; s < BENCH_PROT_STA; s++) {
+			bench_prot_addr(bssid, sta_addr, b, s);
+			bss = bss_get(&wt, bssid);
+			sta = bss ? sta_get(bss, sta_addr) : NULL;
+			if (!sta)
+				goto out;
+			sta->pairwise_cipher = WPA_CIPHER_CCMP;
+			bench_prot_tk(sta->ptk.tk, b, s);
+			sta->ptk.tk_len = 16;
+			sta->ptk_set = 1;
+		}
+	}
+
+	if (threads >= 0 && pipeline_init(&wt, threads) < 0)
+		goto out;
+
+	os_get_reltime(&start);
+	if (read_cap_file(&wt, fname) < 0)
+		goto out;
+	usecs = bench_usecs(&start);
+
+	/* Frames that were decrypted in order leave the same PNs behind */
+	dl_list_for_each(bss, &wt.bss, struct wlantest_bss, list) {
+		dl_list_for_each(sta, &bss->sta, struct wlantest_sta, list) {
+			pn = 0;
+			for (i = 0; i < 6; i++)
+				pn = (pn << 8) | sta->rsc_tods[0][i];
+			decrypted += pn;
+		}
+	}
+
+	if (threads < 0)
+		os_snprintf(name, sizeof(name), "CCMP");
+	else
+		os_snprintf(name, sizeof(name), "CCMP pipeline -J%d", threads);
+	bench_report(name, wt.rx_data, usecs);
+	printf("  last PN sum %llu\n", (unsigned long long) decrypted);
+	*pn_sum = decrypted;
+	ret = 0;
+out:
+	wlantest_deinit(&wt);
+	return ret;
+}
+
+
+/* Returns -1 if the pipeline did not decrypt the same frames */
+static int bench_prot(unsigned int frames, int threads)
+{
+	char fname[64];
+	u64 serial, pipelined;
+	int ret = -1;
+
+	os_snprintf(fname, sizeof(fname), "/tmp/wlantest_bench_%d.pcap",
+		    getpid());
+	if (bench_prot_write(fname, frames) == 0 &&
+	    bench_prot_read(fname, -1, &serial) == 0 &&
+	    bench_prot_read(fname, threads, &pipelined) == 0) {
+		if (serial != pipelined)
+			printf("FAIL: PN sums differ\n");
+		else if (frames && !serial)
+			printf("FAIL: no frame was decrypted\n");
+		else
+			ret = 0;
+	}
+	unlink(fname);
+	return ret;
+}
+
+
+int main(int argc, char *argv[])
+{
+	unsigned int num_bss = 500, num_sta = 20, frames = 200000;
+	int threads = 0;
+	int c, ret;
+
+	wpa_debug_level = MSG_ERROR;
+
+	for (;;) {
+		c = getopt(argc, argv, "b:J:n:s:");
+		if (c < 0)
+			break;
+		switch (c) {
+		case 'b':
+			num_bss = atoi(optarg);
+			break;
+		case 'J':
+			threads = atoi(optarg);
+			if (threads < 0)
+				threads = 0;
+			break;
+		case 'n':
+			frames = atoi(optarg);
+			break;
+		case 's':
+			num_sta = atoi(optarg);
+			break;
+		default:
+			printf("usage: wlantest_bench [-b num BSS] "
+			       "[-s STAs per BSS] [-n frames] "
+			       "[-J decryption threads] "
+			       "[capture file..]\n");
+			return -1;
+		}
+	}
+
+	if (num_bss < 1 || num_bss > 0xffff || num_sta < 1 ||
+	    num_sta > 0xffff)
+		return -1;
+
+	if (os_program_init() || eloop_init())
+		return -1;
+
+	for (; optind < argc; optind++)
+		bench_file(argv[optind], 100);
+	bench_synthetic(num_bss, num_sta, frames);
+	ret = bench_prot(frames, threads);
+
+	eloop_destroy();
+	os_program_deinit();
+
+	return ret ? 1 : 0;
+}
@@ -240,6 +240,7 @@ endif
 ifdef CONFIG_SAE
 L_CFLAGS += -DCONFIG_SAE
 OBJS += src/common/sae.c
+OBJS += src/crypto/sha256-mb.c
 ifdef CONFIG_SAE_PK
 L_CFLAGS += -DCONFIG_SAE_PK
 NEED_AES_SIV=y
@@ -980,6 +981,8 @@ ifdef NEED_AP_MLME
 OBJS += src/ap/wmm.c
 OBJS += src/ap/ap_list.c
 OBJS += src/ap/comeback_token.c
+OBJS += src/ap/decoy_alert.c
+OBJS += src/ap/decoy_table.c
 OBJS += src/pasn/pasn_responder.c
 OBJS += src/ap/ieee802_11.c
 OBJS += src/ap/hw_features.c
@@ -1786,6 +1789,7 @@ endif
 
 ifdef CONFIG_SAE
 PASNOBJS += src/common/sae.c
+PASNOBJS += src/crypto/sha256-mb.c
 endif
 
 ifdef CONFIG_SAE_PK
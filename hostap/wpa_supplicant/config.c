@@ -2960,6 +2960,7 @@ void wpa_config_free_ssid(struct wpa_ssid *ssid)
 	}
 #ifdef CONFIG_SAE
 	sae_deinit_pt(ssid->pt);
+	sae_pw_cache_deinit(ssid->sae_pw_cache);
 #endif /* CONFIG_SAE */
 	bin_clear_free(ssid, sizeof(*ssid));
 }
@@ -3360,6 +3361,8 @@ int wpa_config_set(struct wpa_ssid *ssid, const char *var, const char *value,
 		    os_strcmp(var, "sae_password_id") == 0) {
 			sae_deinit_pt(ssid->pt);
 			ssid->pt = NULL;
+			sae_pw_cache_deinit(ssid->sae_pw_cache);
+			ssid->sae_pw_cache = NULL;
 		}
 #endif /* CONFIG_SAE */
 		break;
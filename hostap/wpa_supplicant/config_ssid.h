@@ -271,6 +271,14 @@ struct wpa_ssid {
 
 	struct sae_pt *pt;
 
+	/**
+	 * sae_pw_cache - Hashed password state for DecoyAuth AP commits
+	 *
+	 * This depends only on the password and the group, so it is reused
+	 * when reconnecting or roaming to another AP of the same network.
+	 */
+	struct sae_pw_cache *sae_pw_cache;
+
 	/**
 	 * ext_psk - PSK/passphrase name in external storage
 	 *
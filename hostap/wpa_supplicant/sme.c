@@ -1839,6 +1839,7 @@ static int sme_sae_auth(struct wpa_supplicant *wpa_s, u16 auth_transaction,
 	}
 
 	if (auth_transaction == 1) {
+		struct wpa_ssid *ssid;
 		u16 res;
 
 		groups = wpa_s->conf->sae_groups;
@@ -1876,7 +1877,10 @@ static int sme_sae_auth(struct wpa_supplicant *wpa_s, u16 auth_transaction,
 
 		wpa_printf(MSG_DEBUG, "SME: USING PASSWORD: %s", wpa_s->password);
 
-		res = sae_ap_parse_commit(&wpa_s->sme.sae, (u8 *) wpa_s->password, os_strlen(wpa_s->password), data, len, NULL, NULL,
+		ssid = external ? wpa_s->sme.ext_auth_wpa_ssid :
+			wpa_s->current_ssid;
+		res = sae_ap_parse_commit(&wpa_s->sme.sae, (u8 *) wpa_s->password, os_strlen(wpa_s->password),
+				       &ssid->sae_pw_cache, data, len, NULL, NULL,
 				       groups, status_code ==
 				       WLAN_STATUS_SAE_HASH_TO_ELEMENT ||
 				       status_code == WLAN_STATUS_SAE_PK,
@@ -114,3 +114,7 @@ def values_to_point(u: int, v :int, a: int, b: int, prime: int):
     point_v = (f_v[0], f_v[1])
     return ec_add(point_u, point_v, a, prime)
 
+
+# The C implementation of c-prototype, built by setup.py
+if use_native():
+    from decoyauth_native import point_to_values, point_to_values_for_u_j, values_to_point
@@ -0,0 +1,739 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/obj_mac.h>
+#include "encode.h"
+#include "rng.h"
+#include "weaver.h"
+
+// Python bindings of the encoder and weaver of c-prototype. The functions
+// take and return the same values as their counterparts in encode.py and
+// weaver.py, integers being accepted as Python ints or big-endian bytes, so
+// that the scripts can switch to them with DECOYAUTH_NATIVE=1 (see
+// README.md). The GIL is released around the arithmetic, so vector sets can
+// be generated from several threads.
+
+struct curve {
+	int nid;
+	EC_GROUP *group;
+	BIGNUM *a;
+	BIGNUM *b;
+	BIGNUM *prime;
+};
+
+// The curves supported by the map, selected by the prime that is passed in
+static struct curve curves[] = {
+	{ NID_X9_62_prime256v1 },
+	{ NID_secp384r1 },
+	{ NID_secp521r1 },
+};
+
+#define NUM_CURVES (sizeof(curves) / sizeof(curves[0]))
+
+// Context of encode_bytes() and decode_bytes(), only used with the GIL held
+static struct es_ctx *bytes_ctx;
+
+static PyObject *zero;
+
+// Values are converted through big-endian buffers, on the stack unless they
+// are larger than a few field elements like the results of eval_weave()
+// without a prime
+#define STACK_INT_BYTES 256
+
+// 3.13 made the conversions between ints and byte arrays public
+static int long_as_bytes(PyObject *obj, unsigned char *buf, size_t len)
+{
+#if PY_VERSION_HEX >= 0x030D0000
+	Py_ssize_t ret = PyLong_AsNativeBytes(obj, buf, len,
+					      Py_ASNATIVEBYTES_BIG_ENDIAN |
+					      Py_ASNATIVEBYTES_UNSIGNED_BUFFER);
+	return ret < 0 ? -1 : 0;
+#else
+	return _PyLong_AsByteArray((PyLongObject *)obj, buf, len, 0, 0);
+#endif
+}
+
+static PyObject *long_from_bytes(const unsigned char *buf, size_t len)
+{
+#if PY_VERSION_HEX >= 0x030D0000
+	return PyLong_FromUnsignedNativeBytes(buf, len,
+					      Py_ASNATIVEBYTES_BIG_ENDIAN);
+#else
+	return _PyLong_FromByteArray(buf, len, 0, 0);
+#endif
+}
+
+static BIGNUM *to_bn(PyObject *obj)
+{
+	BIGNUM *bn = NULL;
+
+	if (PyBytes_Check(obj)) {
+		bn = BN_bin2bn((const unsigned char *)PyBytes_AS_STRING(obj),
+			       (int)PyBytes_GET_SIZE(obj), NULL);
+	} else if (PyLong_Check(obj)) {
+		if (PyObject_RichCompareBool(obj, zero, Py_LT)) {
+			PyErr_SetString(PyExc_ValueError,
+					"negative values are not supported");
+			return NULL;
+		}
+		unsigned char stack_buf[STACK_INT_BYTES];
+		size_t len = (_PyLong_NumBits(obj) + 7) / 8;
+		unsigned char *buf = len <= sizeof(stack_buf) ?
+		    stack_buf : PyMem_Malloc(len);
+		if (buf == NULL) {
+			PyErr_NoMemory();
+			return NULL;
+		}
+		if (long_as_bytes(obj, buf, len) == 0)
+			bn = BN_bin2bn(buf, (int)len, NULL);
+		if (buf != stack_buf)
+			PyMem_Free(buf);
+		if (PyErr_Occurred())
+			return NULL;
+	} else {
+		PyErr_Format(PyExc_TypeError, "expected int or bytes, got %s",
+			     Py_TYPE(obj)->tp_name);
+		return NULL;
+	}
+
+	if (bn == NULL)
+		PyErr_NoMemory();
+	return bn;
+}
+
+static PyObject *from_bn(const BIGNUM *bn)
+{
+	unsigned char stack_buf[STACK_INT_BYTES];
+	size_t len = BN_num_bytes(bn);
+	unsigned char *buf = len <= sizeof(stack_buf) ?
+	    stack_buf : PyMem_Malloc(len);
+
+	if (buf == NULL)
+		return PyErr_NoMemory();
+	BN_bn2bin(bn, buf);
+	PyObject *result = long_from_bytes(buf, len);
+	if (buf != stack_buf)
+		PyMem_Free(buf);
+	return result;
+}
+
+static void free_bns(BIGNUM **bns, Py_ssize_t count)
+{
+	if (bns == NULL)
+		return;
+	for (Py_ssize_t i = 0; i < count; i++)
+		BN_free(bns[i]);
+	PyMem_Free(bns);
+}
+
+// Converts a sequence of ints into an array of count BIGNUMs, count being
+// set to the length of the sequence when it is negative
+static BIGNUM **to_bns(PyObject *obj, Py_ssize_t *count)
+{
+	PyObject *seq = PySequence_Fast(obj, "expected a sequence of ints");
+	if (seq == NULL)
+		return NULL;
+
+	Py_ssize_t len = PySequence_Fast_GET_SIZE(seq);
+	if (*count >= 0 && len != *count) {
+		PyErr_Format(PyExc_ValueError, "expected %zd values, got %zd",
+			     *count, len);
+		Py_DECREF(seq);
+		return NULL;
+	}
+
+	BIGNUM **bns = PyMem_Calloc(len ? len : 1, sizeof(BIGNUM *));
+	if (bns == NULL) {
+		Py_DECREF(seq);
+		PyErr_NoMemory();
+		return NULL;
+	}
+	for (Py_ssize_t i = 0; i < len; i++) {
+		bns[i] = to_bn(PySequence_Fast_GET_ITEM(seq, i));
+		if (bns[i] == NULL) {
+			free_bns(bns, i);
+			Py_DECREF(seq);
+			return NULL;
+		}
+	}
+
+	Py_DECREF(seq);
+	*count = len;
+	return bns;
+}
+
+// Converts count BIGNUMs starting at offset into a list of ints
+static PyObject *to_list(BIGNUM **bns, Py_ssize_t offset, Py_ssize_t count)
+{
+	PyObject *list = PyList_New(count);
+	if (list == NULL)
+		return NULL;
+	for (Py_ssize_t i = 0; i < count; i++) {
+		PyObject *item = from_bn(bns[offset + i]);
+		if (item == NULL) {
+			Py_DECREF(list);
+			return NULL;
+		}
+		PyList_SET_ITEM(list, i, item);
+	}
+	return list;
+}
+
+static const struct curve *find_curve(PyObject *prime_obj)
+{
+	BIGNUM *prime = to_bn(prime_obj);
+	if (prime == NULL)
+		return NULL;
+
+	const struct curve *curve = NULL;
+	for (size_t i = 0; i < NUM_CURVES; i++) {
+		if (BN_cmp(prime, curves[i].prime) == 0) {
+			curve = &curves[i];
+			break;
+		}
+	}
+	BN_free(prime);
+
+	if (curve == NULL)
+		PyErr_SetString(PyExc_ValueError,
+				"only the primes of P-256, P-384 and P-521 "
+				"are supported");
+	return curve;
+}
+
+// Checks that a and b are the ones of the curve of prime, since the C code
+// only knows about the NIST curves
+static const struct curve *find_curve_ab(PyObject *a_obj, PyObject *b_obj,
+					 PyObject *prime_obj)
+{
+	const struct curve *curve = find_curve(prime_obj);
+	if (curve == NULL)
+		return NULL;
+
+	BIGNUM *a = to_bn(a_obj);
+	BIGNUM *b = a ? to_bn(b_obj) : NULL;
+	int match = b != NULL && BN_cmp(a, curve->a) == 0 &&
+	    BN_cmp(b, curve->b) == 0;
+	BN_free(a);
+	BN_free(b);
+
+	if (PyErr_Occurred())
+		return NULL;
+	if (!match) {
+		PyErr_SetString(PyExc_ValueError,
+				"a and b do not match the curve of prime");
+		return NULL;
+	}
+	return curve;
+}
+
+static EC_POINT *to_point(PyObject *obj, const struct curve *curve)
+{
+	PyObject *x_obj, *y_obj;
+
+	if (!PyArg_ParseTuple(obj, "OO;point must be a tuple (x, y)", &x_obj,
+			      &y_obj))
+		return NULL;
+
+	BIGNUM *x = to_bn(x_obj);
+	BIGNUM *y = x ? to_bn(y_obj) : NULL;
+	EC_POINT *point = y ? EC_POINT_new(curve->group) : NULL;
+
+	if (point != NULL &&
+	    !EC_POINT_set_affine_coordinates(curve->group, point, x, y, NULL)) {
+		EC_POINT_free(point);
+		point = NULL;
+		PyErr_SetString(PyExc_ValueError, "point is not on the curve");
+	}
+	BN_free(x);
+	BN_free(y);
+
+	if (point == NULL && !PyErr_Occurred())
+		PyErr_NoMemory();
+	return point;
+}
+
+// The point at infinity is (0, 0) like in encode.py
+static PyObject *from_point(const EC_POINT *point, const struct curve *curve)
+{
+	BIGNUM *x = BN_new();
+	BIGNUM *y = BN_new();
+	PyObject *result = NULL;
+
+	if (x == NULL || y == NULL)
+		goto out;
+	if (EC_POINT_is_at_infinity(curve->group, point)) {
+		BN_zero(x);
+		BN_zero(y);
+	} else if (!EC_POINT_get_affine_coordinates(curve->group, point, x, y,
+						    NULL)) {
+		goto out;
+	}
+
+	PyObject *x_obj = from_bn(x);
+	PyObject *y_obj = x_obj ? from_bn(y) : NULL;
+	if (y_obj != NULL)
+		result = PyTuple_Pack(2, x_obj, y_obj);
+	Py_XDECREF(x_obj);
+	Py_XDECREF(y_obj);
+
+out:
+	BN_free(x);
+	BN_free(y);
+	if (result == NULL && !PyErr_Occurred())
+		PyErr_NoMemory();
+	return result;
+}
+
+PyDoc_STRVAR(point_to_values_doc,
+	     "point_to_values(point, a, b, prime) -> (u, v)\n\n"
+	     "Encodes point with random values u and v, None on failure.");
+
+static PyObject *py_point_to_values(PyObject *self, PyObject *args)
+{
+	PyObject *point_obj, *a_obj, *b_obj, *prime_obj;
+
+	if (!PyArg_ParseTuple(args, "OOOO:point_to_values", &point_obj,
+			      &a_obj, &b_obj, &prime_obj))
+		return NULL;
+
+	const struct curve *curve = find_curve_ab(a_obj, b_obj, prime_obj);
+	if (curve == NULL)
+		return NULL;
+	EC_POINT *point = to_point(point_obj, curve);
+	if (point == NULL)
+		return NULL;
+
+	BIGNUM **uv;
+	Py_BEGIN_ALLOW_THREADS
+	uv = es_encode(point, curve->group, curve->a, curve->b, curve->prime);
+	Py_END_ALLOW_THREADS
+	EC_POINT_free(point);
+
+	if (uv == NULL)
+		Py_RETURN_NONE;
+
+	PyObject *u = from_bn(uv[0]);
+	PyObject *v = u ? from_bn(uv[1]) : NULL;
+	PyObject *result = v ? PyTuple_Pack(2, u, v) : NULL;
+	Py_XDECREF(u);
+	Py_XDECREF(v);
+	BN_free(uv[0]);
+	BN_free(uv[1]);
+	free(uv);
+	return result;
+}
+
+PyDoc_STRVAR(point_to_values_for_u_j_doc,
+	     "point_to_values_for_u_j(point, a, b, prime, u, j) -> v\n\n"
+	     "Value v that encodes point together with u, using the j-th "
+	     "preimage.\nNone if there is none.");
+
+static PyObject *py_point_to_values_for_u_j(PyObject *self, PyObject *args)
+{
+	PyObject *point_obj, *a_obj, *b_obj, *prime_obj, *u_obj;
+	int j;
+
+	if (!PyArg_ParseTuple(args, "OOOOOi:point_to_values_for_u_j",
+			      &point_obj, &a_obj, &b_obj, &prime_obj, &u_obj,
+			      &j))
+		return NULL;
+
+	const struct curve *curve = find_curve_ab(a_obj, b_obj, prime_obj);
+	if (curve == NULL)
+		return NULL;
+	BIGNUM *u = to_bn(u_obj);
+	if (u == NULL)
+		return NULL;
+	EC_POINT *point = to_point(point_obj, curve);
+	if (point == NULL) {
+		BN_free(u);
+		return NULL;
+	}
+
+	BIGNUM *v = NULL;
+	EC_POINT *f_u = NULL;
+	EC_POINT *q = EC_POINT_new(curve->group);
+
+	Py_BEGIN_ALLOW_THREADS
+	// f() maps 0, 1 and -1 to infinity, which calc_v() cannot handle
+	f_u = f(u, curve->group, curve->a, curve->b, curve->prime);
+	if (f_u != NULL && q != NULL &&
+	    !EC_POINT_is_at_infinity(curve->group, f_u) &&
+	    EC_POINT_invert(curve->group, f_u, NULL) &&
+	    EC_POINT_add(curve->group, q, point, f_u, NULL) &&
+	    !EC_POINT_is_at_infinity(curve->group, q))
+		v = calc_v(q, j, curve->group, curve->a, curve->b,
+			   curve->prime);
+	Py_END_ALLOW_THREADS
+
+	EC_POINT_free(q);
+	EC_POINT_free(f_u);
+	EC_POINT_free(point);
+	BN_free(u);
+
+	if (v == NULL)
+		Py_RETURN_NONE;
+	PyObject *result = from_bn(v);
+	BN_free(v);
+	return result;
+}
+
+PyDoc_STRVAR(values_to_point_doc,
+	     "values_to_point(u, v, a, b, prime) -> (x, y)\n\n"
+	     "Decodes the values u and v into a point.");
+
+static PyObject *py_values_to_point(PyObject *self, PyObject *args)
+{
+	PyObject *u_obj, *v_obj, *a_obj, *b_obj, *prime_obj;
+
+	if (!PyArg_ParseTuple(args, "OOOOO:values_to_point", &u_obj, &v_obj,
+			      &a_obj, &b_obj, &prime_obj))
+		return NULL;
+
+	const struct curve *curve = find_curve_ab(a_obj, b_obj, prime_obj);
+	if (curve == NULL)
+		return NULL;
+
+	BIGNUM *uv[2];
+	uv[0] = to_bn(u_obj);
+	if (uv[0] == NULL)
+		return NULL;
+	uv[1] = to_bn(v_obj);
+	if (uv[1] == NULL) {
+		BN_free(uv[0]);
+		return NULL;
+	}
+
+	EC_POINT *point;
+	Py_BEGIN_ALLOW_THREADS
+	point = es_decode(uv, curve->group, curve->a, curve->b, curve->prime);
+	Py_END_ALLOW_THREADS
+	BN_free(uv[0]);
+	BN_free(uv[1]);
+
+	if (point == NULL) {
+		PyErr_SetString(PyExc_ValueError, "values could not be decoded");
+		return NULL;
+	}
+	PyObject *result = from_point(point, curve);
+	EC_POINT_free(point);
+	return result;
+}
+
+PyDoc_STRVAR(encode_bytes_doc,
+	     "encode_bytes(point) -> bytes\n\n"
+	     "Encodes the P-256 point x || y into u || v, all values being "
+	     "32 byte\nbig-endian integers.");
+
+static PyObject *py_encode_bytes(PyObject *self, PyObject *args)
+{
+	Py_buffer in;
+
+	if (!PyArg_ParseTuple(args, "y*:encode_bytes", &in))
+		return NULL;
+	if (in.len != ES_BYTES) {
+		PyBuffer_Release(&in);
+		return PyErr_Format(PyExc_ValueError,
+				    "point must be %d bytes long", ES_BYTES);
+	}
+
+	uint8_t out[ES_BYTES];
+	int ret = es_encode_bytes(in.buf, out, bytes_ctx);
+	PyBuffer_Release(&in);
+
+	if (ret < 0) {
+		PyErr_SetString(PyExc_ValueError, "point could not be encoded");
+		return NULL;
+	}
+	return PyBytes_FromStringAndSize((const char *)out, ES_BYTES);
+}
+
+PyDoc_STRVAR(decode_bytes_doc,
+	     "decode_bytes(uv) -> bytes\n\n"
+	     "Inverse of encode_bytes(), returns the point x || y.");
+
+static PyObject *py_decode_bytes(PyObject *self, PyObject *args)
+{
+	Py_buffer in;
+
+	if (!PyArg_ParseTuple(args, "y*:decode_bytes", &in))
+		return NULL;
+	if (in.len != ES_BYTES) {
+		PyBuffer_Release(&in);
+		return PyErr_Format(PyExc_ValueError,
+				    "uv must be %d bytes long", ES_BYTES);
+	}
+
+	uint8_t out[ES_BYTES];
+	int ret = es_decode_bytes(in.buf, out, bytes_ctx);
+	PyBuffer_Release(&in);
+
+	if (ret < 0) {
+		PyErr_SetString(PyExc_ValueError, "values could not be decoded");
+		return NULL;
+	}
+	return PyBytes_FromStringAndSize((const char *)out, ES_BYTES);
+}
+
+PyDoc_STRVAR(precompute_doc,
+	     "precompute(xs, prime) -> list of lists\n\n"
+	     "Matrix that turns values at the points xs into the coefficients "
+	     "of the\npolynomial through them.");
+
+static PyObject *py_precompute(PyObject *self, PyObject *args)
+{
+	PyObject *xs_obj, *prime_obj;
+	Py_ssize_t n = -1;
+
+	if (!PyArg_ParseTuple(args, "OO:precompute", &xs_obj, &prime_obj))
+		return NULL;
+
+	BIGNUM *prime = to_bn(prime_obj);
+	if (prime == NULL)
+		return NULL;
+	BIGNUM **xs = to_bns(xs_obj, &n);
+	if (xs == NULL) {
+		BN_free(prime);
+		return NULL;
+	}
+	if (n < 2) {
+		free_bns(xs, n);
+		BN_free(prime);
+		PyErr_SetString(PyExc_ValueError, "at least two xs are needed");
+		return NULL;
+	}
+
+	BIGNUM **matrix = NULL;
+	BN_CTX *ctx = BN_CTX_new();
+	if (ctx != NULL) {
+		Py_BEGIN_ALLOW_THREADS
+		matrix = precompute(xs, (int)n, prime, ctx);
+		Py_END_ALLOW_THREADS
+		BN_CTX_free(ctx);
+	}
+	free_bns(xs, n);
+	BN_free(prime);
+	if (matrix == NULL)
+		return PyErr_NoMemory();
+
+	PyObject *rows = PyList_New(n);
+	for (Py_ssize_t i = 0; rows != NULL && i < n; i++) {
+		PyObject *row = to_list(matrix, i * n, n);
+		if (row == NULL)
+			Py_CLEAR(rows);
+		else
+			PyList_SET_ITEM(rows, i, row);
+	}
+	for (Py_ssize_t i = 0; i < n * n; i++)
+		BN_free(matrix[i]);
+	free(matrix);
+	return rows;
+}
+
+PyDoc_STRVAR(weaver_doc,
+	     "weaver(ys, matrix, prime) -> list\n\n"
+	     "Coefficients of the polynomial through the values ys, using a "
+	     "matrix\nof precompute().");
+
+static PyObject *py_weaver(PyObject *self, PyObject *args)
+{
+	PyObject *ys_obj, *matrix_obj, *prime_obj;
+	Py_ssize_t n = -1;
+
+	if (!PyArg_ParseTuple(args, "OOO:weaver", &ys_obj, &matrix_obj,
+			      &prime_obj))
+		return NULL;
+
+	BIGNUM *prime = to_bn(prime_obj);
+	if (prime == NULL)
+		return NULL;
+	BIGNUM **ys = to_bns(ys_obj, &n);
+	if (ys == NULL) {
+		BN_free(prime);
+		return NULL;
+	}
+
+	// The rows of the matrix are flattened like precompute() returns them
+	PyObject *result = NULL;
+	BIGNUM **matrix = PyMem_Calloc(n > 0 ? n * n : 1, sizeof(BIGNUM *));
+	PyObject *rows = PySequence_Fast(matrix_obj,
+					 "matrix must be a list of rows");
+	if (matrix == NULL || rows == NULL)
+		goto out;
+	if (PySequence_Fast_GET_SIZE(rows) != n) {
+		PyErr_Format(PyExc_ValueError, "expected %zd rows", n);
+		goto out;
+	}
+	for (Py_ssize_t i = 0; i < n; i++) {
+		Py_ssize_t count = n;
+		BIGNUM **row = to_bns(PySequence_Fast_GET_ITEM(rows, i), &count);
+		if (row == NULL)
+			goto out;
+		memcpy(matrix + i * n, row, n * sizeof(BIGNUM *));
+		PyMem_Free(row);
+	}
+
+	BIGNUM **c = NULL;
+	BN_CTX *ctx = BN_CTX_new();
+	if (ctx != NULL && n > 0) {
+		Py_BEGIN_ALLOW_THREADS
+		c = weave(ys, matrix, (int)n, prime, ctx);
+		Py_END_ALLOW_THREADS
+	}
+	BN_CTX_free(ctx);
+	if (n == 0) {
+		result = PyList_New(0);
+	} else if (c == NULL) {
+		PyErr_NoMemory();
+	} else {
+		result = to_list(c, 0, n);
+		for (Py_ssize_t i = 0; i < n; i++)
+			BN_free(c[i]);
+		free(c);
+	}
+
+out:
+	Py_XDECREF(rows);
+	free_bns(matrix, n * n);
+	free_bns(ys, n);
+	BN_free(prime);
+	return result;
+}
+
+PyDoc_STRVAR(eval_weave_doc,
+	     "eval_weave(c, x, prime=None) -> int\n\n"
+	     "Evaluates the polynomial with coefficients c at x, modulo prime "
+	     "unless\nit is None.");
+
+static PyObject *py_eval_weave(PyObject *self, PyObject *args)
+{
+	PyObject *c_obj, *x_obj, *prime_obj = Py_None;
+	Py_ssize_t n = -1;
+
+	if (!PyArg_ParseTuple(args, "OO|O:eval_weave", &c_obj, &x_obj,
+			      &prime_obj))
+		return NULL;
+
+	BIGNUM **c = to_bns(c_obj, &n);
+	if (c == NULL)
+		return NULL;
+	BIGNUM *x = to_bn(x_obj);
+	BIGNUM *prime = NULL;
+	if (x != NULL && prime_obj != Py_None)
+		prime = to_bn(prime_obj);
+	if (x == NULL || n == 0 || (prime == NULL && prime_obj != Py_None)) {
+		if (n == 0)
+			PyErr_SetString(PyExc_IndexError,
+					"c must not be empty");
+		free_bns(c, n);
+		BN_free(x);
+		return NULL;
+	}
+
+	BIGNUM *result = NULL;
+	BN_CTX *ctx = BN_CTX_new();
+	if (ctx != NULL) {
+		Py_BEGIN_ALLOW_THREADS
+		if (prime != NULL) {
+			result = evaluate(c, x, (int)n, prime, ctx);
+		} else {
+			// Horner's rule over the integers, like eval_weave()
+			// in weaver.py without a prime
+			result = BN_dup(c[n - 1]);
+			for (Py_ssize_t k = n - 2; result != NULL && k >= 0;
+			     k--) {
+				if (!BN_mul(result, result, x, ctx) ||
+				    !BN_add(result, result, c[k])) {
+					BN_free(result);
+					result = NULL;
+				}
+			}
+		}
+		Py_END_ALLOW_THREADS
+		BN_CTX_free(ctx);
+	}
+	free_bns(c, n);
+	BN_free(x);
+	BN_free(prime);
+
+	if (result == NULL)
+		return PyErr_NoMemory();
+	PyObject *value = from_bn(result);
+	BN_free(result);
+	return value;
+}
+
+PyDoc_STRVAR(seed_doc,
+	     "seed(value)\n\n"
+	     "Makes the random values of point_to_values() and encode_bytes() "
+	     "in the\ncalling thread deterministic, for reproducible vector "
+	     "sets.");
+
+static PyObject *py_seed(PyObject *self, PyObject *args)
+{
+	unsigned long long value;
+
+	if (!PyArg_ParseTuple(args, "K:seed", &value))
+		return NULL;
+	rng_seed(value);
+	Py_RETURN_NONE;
+}
+
+static PyMethodDef methods[] = {
+	{ "point_to_values", py_point_to_values, METH_VARARGS,
+	 point_to_values_doc },
+	{ "point_to_values_for_u_j", py_point_to_values_for_u_j, METH_VARARGS,
+	 point_to_values_for_u_j_doc },
+	{ "values_to_point", py_values_to_point, METH_VARARGS,
+	 values_to_point_doc },
+	{ "encode_bytes", py_encode_bytes, METH_VARARGS, encode_bytes_doc },
+	{ "decode_bytes", py_decode_bytes, METH_VARARGS, decode_bytes_doc },
+	{ "precompute", py_precompute, METH_VARARGS, precompute_doc },
+	{ "weaver", py_weaver, METH_VARARGS, weaver_doc },
+	{ "eval_weave", py_eval_weave, METH_VARARGS, eval_weave_doc },
+	{ "seed", py_seed, METH_VARARGS, seed_doc },
+	{ NULL, NULL, 0, NULL }
+};
+
+// The curves and the byte context live as long as the process, like the
+// module itself
+static int init_curves(void)
+{
+	for (size_t i = 0; i < NUM_CURVES; i++) {
+		struct curve *curve = &curves[i];
+		curve->group = EC_GROUP_new_by_curve_name(curve->nid);
+		curve->a = BN_new();
+		curve->b = BN_new();
+		curve->prime = BN_new();
+		if (curve->group == NULL || curve->a == NULL ||
+		    curve->b == NULL || curve->prime == NULL ||
+		    !EC_GROUP_get_curve(curve->group, curve->prime, curve->a,
+					curve->b, NULL))
+			return -1;
+	}
+
+	zero = PyLong_FromLong(0);
+	bytes_ctx = es_ctx_new(curves[0].group, curves[0].a, curves[0].b,
+			       curves[0].prime);
+	return zero == NULL || bytes_ctx == NULL ? -1 : 0;
+}
+
+static struct PyModuleDef module = {
+	PyModuleDef_HEAD_INIT,
+	"decoyauth_native",
+	"Encoder and weaver of c-prototype, see README.md",
+	-1,
+	methods,
+};
+
+PyMODINIT_FUNC PyInit_decoyauth_native(void)
+{
+	if (curves[0].group == NULL && init_curves() < 0) {
+		PyErr_SetString(PyExc_RuntimeError,
+				"could not set up the curves");
+		return NULL;
+	}
+	return PyModule_Create(&module);
+}
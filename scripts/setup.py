@@ -0,0 +1,17 @@
+# Builds the decoyauth_native extension from the sources of c-prototype:
+#
+#   python3 setup.py build_ext --inplace
+#
+# It needs the OpenSSL headers, e.g. libssl-dev. See README.md.
+from setuptools import setup, Extension
+
+SRC = "../c-prototype/src/"
+
+native = Extension("decoyauth_native",
+	sources=["native/decoyauth_native.c"] + [SRC + name for name in
+		("encode.c", "field.c", "rng.c", "weaver.c")],
+	include_dirs=[SRC],
+	libraries=["crypto"],
+	extra_compile_args=["-O2"])
+
+setup(name="decoyauth_native", ext_modules=[native])
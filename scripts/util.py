@@ -1,4 +1,4 @@
-import math, hashlib, hmac, struct
+import math, hashlib, hmac, os, struct
 from datetime import datetime
 
 ALL, DEBUG, INFO, STATUS, WARNING, ERROR = range(6)
@@ -8,6 +8,11 @@ COLORCODES = { "gray"  : "\033[0;37m",
                "red"   : "\033[0;31m" }
 
 global_log_level = INFO
+
+def use_native():
+	"""Whether DECOYAUTH_NATIVE=1 selects the decoyauth_native extension, see README.md"""
+	return os.environ.get("DECOYAUTH_NATIVE", "0") == "1"
+
 def log(level, msg, color=None, showtime=True):
 	if level < global_log_level: return
 	if level == DEBUG   and color is None: color="gray"
@@ -47,3 +47,7 @@ def eval_weave(c, x, prime=None):
         result = c[k] + x * result
     return result if prime is None else (result % prime)
 
+
+# The C implementation of c-prototype, built by setup.py
+if use_native():
+    from decoyauth_native import precompute, weaver, eval_weave